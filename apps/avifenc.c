@@ -163,6 +163,12 @@ typedef struct
     uint32_t fileBitDepth;
     avifBool fileIsRGB;
     avifAppSourceTiming sourceTiming;
+    const char * filename; // Set if image holds the whole file, so that later occurrences of the same file can reuse it.
+    // The conversion requested when reading filename.
+    avifPixelFormat requestedFormat;
+    int requestedDepth;
+    avifBool ignoreAlpha;
+    avifChromaDownsampling chromaDownsampling;
 } avifInputCacheEntry;
 
 typedef struct avifInput
@@ -478,6 +484,55 @@ static avifBool avifInputAddCachedImage(avifInput * input)
     return AVIF_TRUE;
 }
 
+// Returns AVIF_TRUE if the RGB to YUV conversion of the same RGB samples gives the same result with the settings of
+// both images.
+static avifBool avifSameRGBToYUVSettings(const avifImage * a, const avifImage * b)
+{
+    if (a->yuvRange != b->yuvRange || a->matrixCoefficients != b->matrixCoefficients ||
+        a->alphaPremultiplied != b->alphaPremultiplied) {
+        return AVIF_FALSE;
+    }
+    // The color primaries only matter to derive the matrix coefficients.
+    if ((a->matrixCoefficients == AVIF_MATRIX_COEFFICIENTS_CHROMA_DERIVED_NCL ||
+         a->matrixCoefficients == AVIF_MATRIX_COEFFICIENTS_CHROMA_DERIVED_CL) &&
+        a->colorPrimaries != b->colorPrimaries) {
+        return AVIF_FALSE;
+    }
+    // The transfer characteristics matter to sharp YUV, which treats unspecified as sRGB.
+    const avifTransferCharacteristics tcA = (a->transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_UNSPECIFIED)
+                                                ? AVIF_TRANSFER_CHARACTERISTICS_SRGB
+                                                : a->transferCharacteristics;
+    const avifTransferCharacteristics tcB = (b->transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_UNSPECIFIED)
+                                                ? AVIF_TRANSFER_CHARACTERISTICS_SRGB
+                                                : b->transferCharacteristics;
+    return tcA == tcB;
+}
+
+// Returns the depth requested to avifReadImage().
+static int avifInputRequestedDepth(const avifInput * input)
+{
+    return input->requestedDepthExtension == 0 ? input->requestedDepth : 16;
+}
+
+// Returns the cache entry of a previous read of filename, if its samples were converted with the same settings as
+// image would be with the given conversion settings. Returns NULL otherwise.
+static const avifInputCacheEntry * avifInputFindCachedFile(const avifInput * input,
+                                                           const char * filename,
+                                                           const avifImage * image,
+                                                           avifBool ignoreAlpha,
+                                                           avifChromaDownsampling chromaDownsampling)
+{
+    for (int i = 0; i < input->cacheCount; ++i) {
+        const avifInputCacheEntry * entry = &input->cache[i];
+        if (entry->filename && !strcmp(entry->filename, filename) && entry->requestedFormat == input->requestedFormat &&
+            entry->requestedDepth == avifInputRequestedDepth(input) && entry->ignoreAlpha == ignoreAlpha &&
+            entry->chromaDownsampling == chromaDownsampling && avifSameRGBToYUVSettings(entry->image, image)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
 static avifBool fileExists(const char * filename)
 {
     FILE * outfile = fopen(filename, "rb");
@@ -545,6 +600,13 @@ static avifBool avifInputReadImage(avifInput * input,
         if (avifImageSetViewRect(image, cached->image, &rect) != AVIF_RESULT_OK) {
             assert(AVIF_FALSE);
         }
+        // A view does not carry the metadata.
+        if (avifRWDataSet(&image->icc, cached->image->icc.data, cached->image->icc.size) != AVIF_RESULT_OK ||
+            avifRWDataSet(&image->exif, cached->image->exif.data, cached->image->exif.size) != AVIF_RESULT_OK ||
+            avifRWDataSet(&image->xmp, cached->image->xmp.data, cached->image->xmp.size) != AVIF_RESULT_OK) {
+            fprintf(stderr, "ERROR: Out of memory\n");
+            return AVIF_FALSE;
+        }
 #if defined(AVIF_ENABLE_JPEG_GAIN_MAP_CONVERSION)
         if (cached->image->gainMap && cached->image->gainMap->image) {
             image->gainMap->image = avifImageCreateEmpty();
@@ -615,12 +677,61 @@ static avifBool avifInputReadImage(avifInput * input,
         }
     }
 
+    if (input->cacheEnabled && !input->frameIter && currentFile->filename != AVIF_FILENAME_STDIN && ignoreColorProfile &&
+        ignoreExif && ignoreXMP && ignoreGainMap) {
+        // The same file may be listed several times, for example once per layer. Reuse its samples rather than reading and
+        // converting it to YUV again. A view carries no metadata nor gain map, which are ignored here anyway.
+        const avifInputCacheEntry * sameFile =
+            avifInputFindCachedFile(input, currentFile->filename, dstImage, ignoreAlpha, chromaDownsampling);
+        if (sameFile) {
+            const avifColorPrimaries colorPrimaries = dstImage->colorPrimaries;
+            const avifTransferCharacteristics transferCharacteristics = dstImage->transferCharacteristics;
+            const avifCropRect rect = { 0, 0, sameFile->image->width, sameFile->image->height };
+            if (avifImageSetViewRect(dstImage, sameFile->image, &rect) != AVIF_RESULT_OK) {
+                assert(AVIF_FALSE);
+            }
+            // Keep the CICP set by the caller. Layers, the only later reads allowed to change it, already start from
+            // the CICP of the first image.
+            dstImage->colorPrimaries = colorPrimaries;
+            dstImage->transferCharacteristics = transferCharacteristics;
+            ++input->fileIndex;
+            if (dstSourceIsRGB) {
+                *dstSourceIsRGB = sameFile->fileIsRGB;
+            }
+            if (dstSettings) {
+                *dstSettings = &currentFile->settings;
+            }
+            if (dstDepth) {
+                *dstDepth = sameFile->fileBitDepth;
+            }
+            if (dstSourceTiming) {
+                *dstSourceTiming = sameFile->sourceTiming;
+            }
+            return avifInputReadImage(input,
+                                      imageIndex,
+                                      ignoreColorProfile,
+                                      ignoreExif,
+                                      ignoreXMP,
+                                      allowChangingCicp,
+                                      ignoreAlpha,
+                                      ignoreGainMap,
+                                      image,
+                                      settings,
+                                      outDepth,
+                                      sourceIsRGB,
+                                      sourceTiming,
+                                      chromaDownsampling,
+                                      inputFormat);
+        }
+    }
+    const avifBool wholeFile = (input->frameIter == NULL);
+
     const avifColorPrimaries colorPrimariesBefore = dstImage->colorPrimaries;
     const avifTransferCharacteristics transferCharacteristicsBefore = dstImage->transferCharacteristics;
     const avifAppFileFormat actualInputFormat = avifReadImage(currentFile->filename,
                                                               inputFormat,
                                                               input->requestedFormat,
-                                                              input->requestedDepthExtension == 0 ? input->requestedDepth : 16,
+                                                              avifInputRequestedDepth(input),
                                                               chromaDownsampling,
                                                               ignoreColorProfile,
                                                               ignoreExif,
@@ -673,6 +784,14 @@ static avifBool avifInputReadImage(avifInput * input,
     assert(dstImage->yuvFormat != AVIF_PIXEL_FORMAT_NONE);
 
     if (input->cacheEnabled) {
+        if (wholeFile && !input->frameIter && currentFile->filename != AVIF_FILENAME_STDIN) {
+            avifInputCacheEntry * entry = &input->cache[imageIndex];
+            entry->filename = currentFile->filename;
+            entry->requestedFormat = input->requestedFormat;
+            entry->requestedDepth = avifInputRequestedDepth(input);
+            entry->ignoreAlpha = ignoreAlpha;
+            entry->chromaDownsampling = chromaDownsampling;
+        }
         // Reuse the just created cache entry.
         assert(imageIndex < input->cacheCount);
         return avifInputReadImage(input,
@@ -2338,7 +2457,9 @@ int main(int argc, char * argv[])
     }
 
     // --target-size requires multiple encodings of the same files. Cache the input images.
-    input.cacheEnabled = (settings.targetSize != -1);
+    // --layered often lists the same file for several layers, which can then share a single read and RGB to YUV
+    // conversion. There are at most AVIF_MAX_AV1_LAYER_COUNT images to cache in that case.
+    input.cacheEnabled = (settings.targetSize != -1) || settings.layered;
 
     const avifInputFile * firstFile = avifInputGetFile(&input, /*imageIndex=*/0);
     uint32_t sourceDepth = 0;
@@ -921,6 +921,56 @@ AVIF_API avifResult avifImageAddUUIDProperty(avifImage * image, const uint8_t uu
 // dstWidth*dstHeight should be <= AVIF_DEFAULT_IMAGE_SIZE_LIMIT.
 AVIF_API avifResult avifImageScale(avifImage * image, uint32_t dstWidth, uint32_t dstHeight, avifDiagnostics * diag);
 
+typedef enum avifScaleFilter
+{
+    AVIF_SCALE_FILTER_BOX = 0,  // Average of the covered samples when downscaling, nearest sample when upscaling.
+    AVIF_SCALE_FILTER_BILINEAR, // Triangle filter.
+    AVIF_SCALE_FILTER_BICUBIC,  // Catmull-Rom cubic filter.
+    AVIF_SCALE_FILTER_LANCZOS3, // Lanczos filter with 3 lobes. Sharpest and slowest.
+    AVIF_SCALE_FILTER_COUNT
+} avifScaleFilter;
+
+// Scales the YUV/A planes of srcImage into dstImage with a separable filter, using up to maxThreads threads for the planes
+// and bands of rows of each plane. The filter is widened by the scaling factor when downscaling. Does not use libyuv.
+// dstImage->width and dstImage->height are the destination dimensions, which must both be <=
+// AVIF_DEFAULT_IMAGE_DIMENSION_LIMIT, with dstWidth*dstHeight <= AVIF_DEFAULT_IMAGE_SIZE_LIMIT. dstImage->depth and
+// dstImage->yuvFormat must be those of srcImage. The planes present in srcImage are written to the planes of dstImage,
+// which are allocated only if they are missing, so that a destination can be reused. Other fields of dstImage are left
+// untouched. dstImage must not share planes with srcImage. diag may be NULL.
+AVIF_API avifResult avifImageScaleInto(const avifImage * srcImage,
+                                       avifImage * dstImage,
+                                       avifScaleFilter filter,
+                                       int maxThreads,
+                                       avifDiagnostics * diag);
+
+// ---------------------------------------------------------------------------
+// Distortion
+
+typedef struct avifImageDistortion
+{
+    // Peak signal-to-noise ratio in decibels, indexed by avifChannelIndex. 99 means that the planes are identical,
+    // otherwise it is at most 98.99.
+    double psnr[AVIF_PLANE_COUNT_YUV + 1];
+    // Mean structural similarity (SSIM) of 8x8 windows placed every 4 samples, indexed by avifChannelIndex.
+    // At most 1, which means that the planes are identical.
+    double ssim[AVIF_PLANE_COUNT_YUV + 1];
+    // PSNR of all the samples of the compared planes.
+    double psnrAll;
+    // Average of the SSIM of the compared planes, weighted by their sample counts.
+    double ssimAll;
+} avifImageDistortion;
+
+// Measures the distortion between the given planes of image1 and image2, directly on their YUV and alpha samples.
+// image1 and image2 must have the same dimensions, depth, yuvFormat and yuvRange. Their color properties are not
+// checked. If only one of the images has an alpha plane, the other one is considered opaque. The metrics of planes
+// that are not compared, because they are missing from both images or not set in planes, are 0.
+// Up to maxThreads threads are used.
+AVIF_API avifResult avifImageComputeDistortion(const avifImage * image1,
+                                               const avifImage * image2,
+                                               avifPlanesFlags planes,
+                                               int maxThreads,
+                                               avifImageDistortion * distortion);
+
 // ---------------------------------------------------------------------------
 // Optional YUV<->RGB support
 
@@ -966,6 +1016,17 @@ typedef enum avifRGBFormat
     AVIF_RGB_FORMAT_GRAY,
     AVIF_RGB_FORMAT_GRAYA,
     AVIF_RGB_FORMAT_AGRAY,
+    // RGBA1010102 format uses ten bits for the red, green and blue components
+    // and two bits for the alpha component. Each pixel is 32 bits (4 bytes),
+    // which is packed as follows:
+    //   uint32_t: [a1 a0 b9 ... b0 g9 ... g0 r9 ... r0]
+    //   a1, b9, g9 and r9 are the MSB of each component.
+    // This is the layout of GL_RGB10_A2 (with GL_UNSIGNED_INT_2_10_10_10_REV),
+    // DXGI_FORMAT_R10G10B10A2_UNORM and VK_FORMAT_A2B10G10R10_UNORM_PACK32.
+    // This format is only supported for YUV -> RGB conversion and when
+    // avifRGBImage.depth is set to 10. If avifRGBImage.alphaPremultiplied is
+    // set, the color components are premultiplied by the stored 2-bit alpha.
+    AVIF_RGB_FORMAT_RGBA1010102,
     AVIF_RGB_FORMAT_COUNT
 } avifRGBFormat;
 AVIF_API uint32_t avifRGBFormatChannelCount(avifRGBFormat format);
@@ -1009,12 +1070,20 @@ typedef struct avifRGBImage
                           // the alpha bits as if they were all 1.
     avifBool alphaPremultiplied; // indicates if RGB value is pre-multiplied by alpha. Default: false
     avifBool isFloat; // indicates if RGBA values are in half float (f16) format. Valid only when depth == 16. Default: false
-    int maxThreads; // Number of threads to be used for the YUV to RGB conversion. Note that this value is ignored for RGB to YUV
-                    // conversion. Setting this to zero has the same effect as setting it to one. Negative values are invalid.
+    int maxThreads; // Number of threads to be used for the YUV to RGB conversion, alpha (un)premultiplication and the gain map
+                    // rescaling of avifRGBImageApplyGainMap(). Note that this value is ignored for RGB to YUV conversion.
+                    // Setting this to zero has the same effect as setting it to one. Negative values are invalid.
                     // Default: 1.
 
     uint8_t * pixels;
     uint32_t rowBytes;
+
+    avifBool toneMapToSDR; // If AVIF_TRUE and the image has the PQ or HLG transfer characteristics, avifImageYUVToRGB() maps the
+                           // HDR colors to SDR with the sRGB transfer characteristics and BT.709 primaries, compressing the
+                           // highlights with the ITU-R BT.2390 EETF as in ITU-R BT.2408 (HDR reference white is SDR white).
+                           // The source peak luminance is image->clli.maxCLL for PQ if set, 1000 nits otherwise. Only
+                           // supported for RGB formats with or without alpha, without isFloat. Ignored for other transfer
+                           // characteristics and for RGB to YUV conversion. Default: false
 } avifRGBImage;
 
 // Sets rgb->width, rgb->height, and rgb->depth to image->width, image->height, and image->depth.
@@ -1030,6 +1099,37 @@ AVIF_API void avifRGBImageFreePixels(avifRGBImage * rgb);
 // The main conversion functions
 AVIF_API avifResult avifImageRGBToYUV(avifImage * image, const avifRGBImage * rgb);
 AVIF_API avifResult avifImageYUVToRGB(const avifImage * image, avifRGBImage * rgb);
+// Same as avifImageYUVToRGB() but only for the pixels of image within rect, for example the rows decoded so far (see
+// avifDecoderDecodedRowCount()). rgb->width and rgb->height must be rect->width and rect->height, and rgb->pixels must be
+// allocated. rect may start at any position: the chroma samples around rect are used for upsampling, so that converting
+// adjacent rects leaves no seams. If image is itself a view (see avifImageSetViewRect()), only its pixels are used.
+AVIF_API avifResult avifImageYUVToRGBRect(const avifImage * image, const avifCropRect * rect, avifRGBImage * rgb);
+// Same as avifImageYUVToRGB() but downscales image to rgb->width by rgb->height (which must not be greater than the image
+// dimensions) with a box filter while converting. A few rows are filtered and converted at a time, so that no
+// full-resolution intermediate image is written. rgb->pixels must be allocated.
+AVIF_API avifResult avifImageYUVToRGBScaled(const avifImage * image, avifRGBImage * rgb);
+// Writes the Y, U and V samples of image in a semi-planar layout, as used for GPU upload: the luma plane to yPlane and the
+// interleaved U and V samples (U first) to uvPlane, for example NV12 for an 8-bit 4:2:0 image. Samples of images with a depth
+// greater than 8 are written as uint16_t with the value in the most significant bits, for example P010 for a 10-bit 4:2:0
+// image. image must not be 4:0:0. yRowBytes and uvRowBytes must fit image->width and twice avifImagePlaneWidth(image,
+// AVIF_CHAN_U) samples respectively, and uvPlane must hold avifImagePlaneHeight(image, AVIF_CHAN_U) rows.
+AVIF_API avifResult avifImageToSemiPlanar(const avifImage * image,
+                                          uint8_t * yPlane,
+                                          uint32_t yRowBytes,
+                                          uint8_t * uvPlane,
+                                          uint32_t uvRowBytes);
+
+// Conversion plans hold the setup of avifImageYUVToRGB() (coefficients, look-up tables) so that it is done only once when
+// converting many images with the same properties, such as the frames of an image sequence.
+// A plan is valid for the avifImage depth, yuvFormat, yuvRange, colorPrimaries and matrixCoefficients, and for the
+// avifRGBImage depth, format and isFloat it was created with. The other fields, including the dimensions, are read at
+// each conversion. A plan is not modified by avifImageYUVToRGBWithPlan(), which can be called by several threads at once.
+typedef struct avifYUVToRGBPlan avifYUVToRGBPlan;
+// Returns NULL if the conversion is not supported or in case of memory allocation failure.
+AVIF_NODISCARD AVIF_API avifYUVToRGBPlan * avifYUVToRGBPlanCreate(const avifImage * image, const avifRGBImage * rgb);
+AVIF_API void avifYUVToRGBPlanDestroy(avifYUVToRGBPlan * plan);
+// Same as avifImageYUVToRGB(). Returns AVIF_RESULT_INVALID_ARGUMENT if image or rgb does not match the plan.
+AVIF_API avifResult avifImageYUVToRGBWithPlan(const avifYUVToRGBPlan * plan, const avifImage * image, avifRGBImage * rgb);
 
 // Premultiply handling functions.
 // (Un)premultiply is automatically done by the main conversion functions above,
@@ -1092,6 +1192,10 @@ typedef void (*avifIODestroyFunc)(struct avifIO * io);
 // * Otherwise, provide the range and return AVIF_RESULT_OK.
 typedef avifResult (*avifIOReadFunc)(struct avifIO * io, uint32_t readFlags, uint64_t offset, size_t size, avifROData * out);
 
+// This function must write the size bytes of data at offset, overwriting any previously written bytes in
+// that range. The offset may be before the end of the previous writes, to update what was written, or
+// past it, in which case the content of the skipped range does not matter. writeFlags is 0.
+// Return AVIF_RESULT_IO_ERROR if the bytes cannot be written.
 typedef avifResult (*avifIOWriteFunc)(struct avifIO * io, uint32_t writeFlags, uint64_t offset, const uint8_t * data, size_t size);
 
 typedef struct avifIO
@@ -1099,7 +1203,7 @@ typedef struct avifIO
     avifIODestroyFunc destroy;
     avifIOReadFunc read;
 
-    // This is reserved for future use - but currently ignored. Set it to a null pointer.
+    // Only used by the encoder (see avifEncoderSetIO()). Set it to a null pointer for reading.
     avifIOWriteFunc write;
 
     // If non-zero, this is a hint to internal structures of the max size offered by the content
@@ -1127,6 +1231,8 @@ typedef struct avifIO
 AVIF_API avifIO * avifIOCreateMemoryReader(const uint8_t * data, size_t size);
 // Returns NULL if the file cannot be opened or if the reader cannot be allocated.
 AVIF_API avifIO * avifIOCreateFileReader(const char * filename);
+// Creates or truncates the file. Returns NULL if the file cannot be opened or if the writer cannot be allocated.
+AVIF_API avifIO * avifIOCreateFileWriter(const char * filename);
 AVIF_API void avifIODestroy(avifIO * io);
 
 // ---------------------------------------------------------------------------
@@ -1245,6 +1351,12 @@ typedef enum avifImageContentTypeFlag
 } avifImageContentTypeFlag;
 typedef uint32_t avifImageContentTypeFlags;
 
+struct avifDecoder;
+
+// Called when rows [firstRow, firstRow+rowCount) of the image being decoded become available.
+// See avifDecoder::rowsReady.
+typedef void (*avifDecoderRowsReadyFunc)(struct avifDecoder * decoder, uint32_t firstRow, uint32_t rowCount, void * userData);
+
 // AVIF decoder struct. It may be extended in a future release. Code outside the libavif
 // library must allocate avifDecoder by calling the avifDecoderCreate() function, and destroy it with
 // avifDecoderDestroy().
@@ -1390,6 +1502,32 @@ typedef struct avifDecoder
     // Enable this to avoid reading and surfacing ICC profile to the decoded avifImage and gain map
     // metadata.
     avifBool ignoreICC;
+
+    // If not NULL, the pixels of decoder->image are converted to this RGB image by avifDecoderNextImage()
+    // and avifDecoderNthImage() as they get decoded. For grids, each band of cells is converted as soon
+    // as it is complete, interleaved with the decoding of the next cells. With allowIncremental, the
+    // top of the image can thus be converted while the rest is still being downloaded.
+    // The caller owns this RGB image and must allocate its pixels with the dimensions of decoder->image
+    // after avifDecoderParse(), see avifRGBImageSetDefaults() and avifRGBImageAllocatePixels().
+    avifRGBImage * rgbOutput; // Changeable decoder setting.
+
+    // If not NULL, this function is called by avifDecoderNextImage() and avifDecoderNthImage() each time
+    // new rows of the image become available: rows of rgbOutput if set, rows of decoder->image otherwise.
+    // Rows are reported once, from top to bottom, possibly over several calls if allowIncremental is
+    // true. With 4:2:0 images, rgbOutput rows lag one row behind decoded rows until the image is
+    // complete, because chroma upsampling may need the next chroma row.
+    avifDecoderRowsReadyFunc rowsReady; // Changeable decoder setting.
+    void * rowsReadyUserData;           // Passed to rowsReady.
+
+    // If true, the codec instances are not destroyed when they are no longer needed, for example when
+    // avifDecoderParse() is called for another file, when avifDecoderSetSource() is called, or when
+    // avifDecoderNthImage() seeks to a keyframe. Instead, they are reset and reused for the next image
+    // as long as codecChoice, maxThreads, imageSizeLimit, imageDimensionLimit and the coding format,
+    // operating point and layers of the tiles did not change. This avoids setting up the underlying
+    // decoder (context, thread pool) for every image when decoding many files with the same avifDecoder.
+    // Only the instances of codecs that support being reset (dav1d) are reused. Instances that are not
+    // needed by the next image are destroyed. Defaults to AVIF_FALSE.
+    avifBool reuseCodecs; // Changeable decoder setting.
 } avifDecoder;
 
 // Creates a decoder initialized with default settings values.
@@ -1402,6 +1540,34 @@ AVIF_API avifResult avifDecoderRead(avifDecoder * decoder, avifImage * image); /
 AVIF_API avifResult avifDecoderReadMemory(avifDecoder * decoder, avifImage * image, const uint8_t * data, size_t size);
 AVIF_API avifResult avifDecoderReadFile(avifDecoder * decoder, avifImage * image, const char * filename);
 
+// One file decoded by avifDecoderReadMemoryBatch().
+typedef struct avifDecodeBatchItem
+{
+    // Input. Must remain valid until avifDecoderReadMemoryBatch() returns.
+    const uint8_t * data;
+    size_t size;
+
+    // Outputs. At least one of image and rgb must be set.
+    // If not NULL, the first image of the file is copied to this avifImage, as with avifDecoderReadMemory().
+    avifImage * image;
+    // If not NULL, the first image of the file is converted to this avifRGBImage. The caller sets the
+    // conversion settings such as format and chromaUpsampling (see avifRGBImageSetDefaults()). If depth is 0,
+    // the depth of the decoded image is used. width, height, pixels and rowBytes are set by
+    // avifDecoderReadMemoryBatch() with avifRGBImageAllocatePixels(). The caller must call
+    // avifRGBImageFreePixels() afterwards.
+    avifRGBImage * rgb;
+    avifResult result; // The result of decoding this file.
+} avifDecodeBatchItem;
+
+// Decodes the first image of many independent files, such as icons or sprites, faster than calling
+// avifDecoderReadMemory() for each of them. Up to settings->maxThreads files are decoded in parallel, each
+// thread reusing the same decoder and codec instances for all the files it decodes.
+// The decoding settings (codecChoice, maxThreads, strictFlags, imageSizeLimit etc.) are read from settings,
+// which is not modified and does not need to be parsed. settings->rgbOutput and settings->rowsReady are ignored.
+// Returns AVIF_RESULT_OK if all files were decoded, or the result of the first item that failed otherwise.
+// The result of each file is also stored in its avifDecodeBatchItem. No detailed diagnostics are available.
+AVIF_API avifResult avifDecoderReadMemoryBatch(const avifDecoder * settings, avifDecodeBatchItem * items, size_t itemCount);
+
 // Multi-function alternative to avifDecoderRead() for image sequences and gaining direct access
 // to the decoder's YUV buffers (for performance's sake). Data passed into avifDecoderParse() is NOT
 // copied, so it must continue to exist until the decoder is destroyed.
@@ -1493,6 +1659,19 @@ typedef struct avifExtent
 // This function may be used after a successful call (AVIF_RESULT_OK) to avifDecoderParse().
 AVIF_API avifResult avifDecoderNthImageMaxExtent(const avifDecoder * decoder, uint32_t frameIndex, avifExtent * outExtent);
 
+// Streaming data helper - When avifDecoderParse(), avifDecoderNextImage() or avifDecoderNthImage()
+// returns AVIF_RESULT_WAITING_ON_IO, this function retrieves the range that was requested from the
+// avifIO but that was not available yet. An event-driven caller can wait for these bytes to arrive
+// and then call the same function again. The size may go past the end of the data when a box
+// extends to the end of the file, in which case all remaining bytes are expected.
+//
+// Calling avifDecoderParse() again after it returned AVIF_RESULT_WAITING_ON_IO resumes parsing at
+// the top-level box that was being read, instead of starting over from the beginning of the data.
+// Calling avifDecoderSetIO() in between discards that progress.
+//
+// Returns AVIF_RESULT_NO_CONTENT if the last call did not return AVIF_RESULT_WAITING_ON_IO.
+AVIF_API avifResult avifDecoderGetIOWaitExtent(const avifDecoder * decoder, avifExtent * outExtent);
+
 // ---------------------------------------------------------------------------
 // avifEncoder
 
@@ -1628,6 +1807,33 @@ typedef struct avifEncoder
 
     // Version 1.4.0 ends here. Add any new members after this line.
     // --------------------------------------------------------------------------------------------
+
+    // If not 0, avifEncoderWrite() searches the highest quality for which the encoded file fits in
+    // targetSize bytes, or returns the file encoded at AVIF_QUALITY_WORST if none fits. The same quality
+    // is used for the color, alpha and gain map images. quality is used as the first guess (60 if
+    // AVIF_QUALITY_DEFAULT), and the following ones are predicted from the sizes of the previous trial
+    // encodes. After a successful call, quality, qualityAlpha and qualityGainMap contain the chosen
+    // value. Ignored by avifEncoderAddImage() and avifEncoderAddImageGrid(). Defaults to 0.
+    size_t targetSize; // Changeable encoder setting.
+
+    // For image sequences, if keyframeInterval is positive, the frames following the first
+    // keyframeInterval ones are split into segments of keyframeInterval frames, each starting with a
+    // keyframe and encoded by its own codec instance in its own thread. Up to maxThreads segments are
+    // encoded concurrently, each with a single thread. The input images are copied until their segment
+    // is encoded. Only used for single-cell image sequences without gain map, layers or sample
+    // transform. The output may differ from a serial encode because the codec state is not carried
+    // across segments. Read during the first avifEncoderAddImage() call. Defaults to AVIF_FALSE.
+    avifBool parallelSegments;
+
+    // If AVIF_TRUE, avifEncoderWrite() and avifEncoderAddImage() with AVIF_ADD_IMAGE_FLAG_SINGLE encode
+    // large images as grids, with cells of at most 4096x4096 pixels, made smaller (down to 1024x1024)
+    // to give each of the maxThreads threads a cell. The cells are views into the input image and are
+    // encoded in parallel. Images with a gain map, or whose dimensions are incompatible with the chroma
+    // subsampling of a grid, are encoded as a single cell. Defaults to AVIF_FALSE.
+    avifBool autoGrid;
+
+    // Output destination. This field is managed by the encoder. Use one of the avifEncoderSetIO*() functions to set it.
+    avifIO * io;
 } avifEncoder;
 
 // Creates an encoder initialized with default settings values.
@@ -1691,6 +1897,30 @@ AVIF_API avifResult avifEncoderAddImageGrid(avifEncoder * encoder,
                                             avifAddImageFlags addImageFlags);
 AVIF_API avifResult avifEncoderFinish(avifEncoder * encoder, avifRWData * output);
 
+// Discards the images added to the encoder so that it can encode another image or image sequence,
+// as if it was just created but with its current settings. Typically called after
+// avifEncoderFinish() or avifEncoderWrite() when encoding many images with similar settings.
+// Settings that are not marked as changeable may still be modified after this call. No codec
+// instance is kept: the next image is encoded with new ones, exactly as by a new encoder. Like after
+// avifEncoderFinish(), the codec-specific options must be set again if needed. The avifIO set by
+// avifEncoderSetIO(), if any, is destroyed (if io->destroy is set) and the next image is written to
+// the output of avifEncoderFinish() unless avifEncoderSetIO() is called again.
+AVIF_API avifResult avifEncoderReset(avifEncoder * encoder);
+
+// Makes the encoder write the file to 'io' instead of the output of avifEncoderFinish(), which is left empty.
+// The encoded samples are written to 'io' by each avifEncoderAddImage() call and then freed, except the first
+// one of each track, so that the memory used while encoding an image sequence of any length stays bounded by
+// the frames being encoded (the frames of avifEncoder::parallelSegments are written by avifEncoderFinish()).
+// The file starts with space reserved for the 'ftyp' box, followed by a 'mdat' box growing with each frame.
+// avifEncoderFinish() appends the 'meta' and 'moov' boxes, and then rewrites the 'mdat' box size and the
+// 'ftyp' box, so the file is only valid once avifEncoderFinish() returned AVIF_RESULT_OK. Layered images
+// are not supported. Call it before the first avifEncoderAddImage() call, and again before encoding another
+// image after avifEncoderReset(), which releases 'io'. Passing NULL goes back to the output of avifEncoderFinish().
+// As for avifDecoderSetIO(), the encoder takes ownership of 'io' if io->destroy is set, and destroys the
+// previous one.
+AVIF_API avifResult avifEncoderSetIO(avifEncoder * encoder, avifIO * io);
+AVIF_API avifResult avifEncoderSetIOFile(avifEncoder * encoder, const char * filename);
+
 // Codec-specific, optional "advanced" tuning settings, in the form of string key/value pairs,
 // to be consumed by the codec in the next avifEncoderAddImage() call.
 // See the codec documentation to know if a setting is persistent or applied only to the next frame.
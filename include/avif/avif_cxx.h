@@ -22,6 +22,7 @@ struct UniquePtrDeleter
     void operator()(avifEncoder * encoder) const { avifEncoderDestroy(encoder); }
     void operator()(avifGainMap * gainMap) const { avifGainMapDestroy(gainMap); }
     void operator()(avifImage * image) const { avifImageDestroy(image); }
+    void operator()(avifYUVToRGBPlan * plan) const { avifYUVToRGBPlanDestroy(plan); }
 };
 
 // Use these unique_ptr to ensure the structs are automatically destroyed.
@@ -29,6 +30,7 @@ using DecoderPtr = std::unique_ptr<avifDecoder, UniquePtrDeleter>;
 using EncoderPtr = std::unique_ptr<avifEncoder, UniquePtrDeleter>;
 using GainMapPtr = std::unique_ptr<avifGainMap, UniquePtrDeleter>;
 using ImagePtr = std::unique_ptr<avifImage, UniquePtrDeleter>;
+using YUVToRGBPlanPtr = std::unique_ptr<avifYUVToRGBPlan, UniquePtrDeleter>;
 
 // Automatically cleans the resources of the avifRGBImage.
 // To use when RGBImage actually owns the pixels. RGBImage can also be used as a view, in which case it does not own the pixels.
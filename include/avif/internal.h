@@ -161,6 +161,21 @@ void avifImageCopyNoAlloc(avifImage * dstImage, const avifImage * srcImage);
 // If the AVIF_PLANES_YUV bit is set in planes, then srcImage and dstImage must have the same yuvFormat.
 // Ignores the gainMap field.
 void avifImageCopySamples(avifImage * dstImage, const avifImage * srcImage, avifPlanesFlags planes);
+// Same as avifImageCopySamples() but dstImage may be larger than srcImage, in which case the last column and row of
+// each plane of srcImage are replicated up to the dimensions of dstImage. The rows are split into bands copied by up to
+// maxThreads threads.
+avifResult avifImageCopyAndPadSamples(avifImage * dstImage, const avifImage * srcImage, avifPlanesFlags planes, int maxThreads);
+// Same as avifImageCopyAndPadSamples() for imageCount pairs of images, such as the tiles of a row of a grid. Each thread copies
+// the same band of rows of every pair. dstImages are views of wholeDstImage, or wholeDstImage itself, whose size decides whether
+// the rows are written with non-temporal stores.
+avifResult avifImagesCopyAndPadSamples(avifImage * const dstImages[],
+                                       const avifImage * const srcImages[],
+                                       uint32_t imageCount,
+                                       const avifImage * wholeDstImage,
+                                       avifPlanesFlags planes,
+                                       int maxThreads);
+// Same as avifImageCopy() but the samples are copied by up to maxThreads threads.
+avifResult avifImageCopyWithMaxThreads(avifImage * dstImage, const avifImage * srcImage, avifPlanesFlags planes, int maxThreads);
 
 // Appends an opaque image item property.
 avifResult avifImagePushProperty(avifImage * image,
@@ -338,8 +353,17 @@ typedef struct avifReformatState
 {
     avifRGBColorSpaceInfo rgb;
     avifYUVColorSpaceInfo yuv;
+
+    // Look-up tables from YUV unorm to float, used by the built-in YUV to RGB conversions. NULL unless created once for
+    // several conversions by an avifYUVToRGBPlan, otherwise they are created for each conversion that needs them.
+    float * unormFloatTableY;
+    float * unormFloatTableUV; // Same as unormFloatTableY for AVIF_REFORMAT_MODE_IDENTITY.
 } avifReformatState;
 
+// Same as avifYUVToRGBPlanCreate() but returns AVIF_RESULT_REFORMAT_FAILED if the conversion is not supported and
+// AVIF_RESULT_OUT_OF_MEMORY in case of memory allocation failure. *plan is set to NULL in case of failure.
+avifResult avifYUVToRGBPlanCreateWithResult(const avifImage * image, const avifRGBImage * rgb, avifYUVToRGBPlan ** plan);
+
 // Retrieves the pixel value at position (x, y) expressed as floats in [0, 1]. If the image's format doesn't have alpha,
 // rgbaPixel[3] is set to 1.0f.
 void avifGetRGBAPixel(const avifRGBImage * src, uint32_t x, uint32_t y, const avifRGBColorSpaceInfo * info, float rgbaPixel[4]);
@@ -377,7 +401,8 @@ avifResult avifImageRGBToYUVLibSharpYUV(avifImage * image, const avifRGBImage *
 // * AVIF_RESULT_OK               - Converted successfully with libyuv.
 // * AVIF_RESULT_NOT_IMPLEMENTED  - The fast path for this conversion is not implemented with libyuv, use built-in conversion.
 // * AVIF_RESULT_INVALID_ARGUMENT - Return error to caller.
-avifResult avifRGBImageToF16LibYUV(avifRGBImage * rgb);
+// Converts count 16-bit samples at src to half floats in [0, 1] at dst.
+avifResult avifRowToF16LibYUV(const uint16_t * src, uint16_t * dst, uint32_t count);
 
 // Returns:
 // * AVIF_RESULT_OK              - (Un)Premultiply successfully with libyuv
@@ -386,6 +411,15 @@ avifResult avifRGBImageToF16LibYUV(avifRGBImage * rgb);
 avifResult avifRGBImagePremultiplyAlphaLibYUV(avifRGBImage * rgb);
 avifResult avifRGBImageUnpremultiplyAlphaLibYUV(avifRGBImage * rgb);
 
+// Returns:
+// * AVIF_RESULT_OK              - Written successfully with libyuv
+// * AVIF_RESULT_NOT_IMPLEMENTED - The fast path for this image is not implemented with libyuv, use built-in copy
+avifResult avifImageToSemiPlanarLibYUV(const avifImage * image,
+                                       uint8_t * yPlane,
+                                       uint32_t yRowBytes,
+                                       uint8_t * uvPlane,
+                                       uint32_t uvRowBytes);
+
 AVIF_NODISCARD avifBool avifDimensionsTooLarge(uint32_t width, uint32_t height, uint32_t imageSizeLimit, uint32_t imageDimensionLimit);
 
 // Given the number of encoding threads or decoding threads available and the image dimensions,
@@ -396,6 +430,34 @@ AVIF_NODISCARD avifBool avifDimensionsTooLarge(uint32_t width, uint32_t height,
 // unit tests.
 void avifSetTileConfiguration(int threads, uint32_t width, uint32_t height, int * tileRowsLog2, int * tileColsLog2);
 
+// Returns the number of flushed codec instances that the decoder keeps for the next file when avifDecoder::reuseCodecs
+// is true. Only used by unit tests to check that the instances are reused.
+uint32_t avifDecoderSpareCodecCount(const avifDecoder * decoder);
+
+// ---------------------------------------------------------------------------
+// Built-in SIMD kernels
+
+// SSE2 is part of x86-64, so it needs no runtime check. AVX2 kernels are compiled with a target attribute and selected at
+// runtime, which GCC and Clang support (clang-cl and MSVC do not define __GNUC__). Source files using them include
+// <emmintrin.h> and <immintrin.h> accordingly.
+#if defined(__x86_64__) || defined(_M_X64)
+#define AVIF_SIMD_SSE2 1
+#if defined(__GNUC__)
+#define AVIF_SIMD_AVX2 1
+#endif
+#endif
+
+// Instruction sets that the built-in SIMD kernels may use.
+#define AVIF_CPU_SSE2 (1 << 0)
+#define AVIF_CPU_AVX2 (1 << 1)
+#define AVIF_CPU_ALL (AVIF_CPU_SSE2 | AVIF_CPU_AVX2)
+// Restricts the built-in SIMD kernels to the instruction sets in mask, a combination of AVIF_CPU_* bits, so that tests can
+// compare each kernel with the scalar code. Not thread-safe. Defaults to AVIF_CPU_ALL.
+void avifSetCPUMask(uint32_t mask);
+// Returns the AVIF_CPU_* bits of the instruction sets that are compiled in, supported by the CPU and allowed by
+// avifSetCPUMask().
+uint32_t avifGetCPUFeatures(void);
+
 // ---------------------------------------------------------------------------
 // Scaling
 
@@ -407,6 +469,17 @@ avifResult avifImageScaleWithLimit(avifImage * image,
                                    uint32_t imageDimensionLimit,
                                    avifDiagnostics * diag);
 
+// ---------------------------------------------------------------------------
+// Threads (threads.c)
+
+typedef void (*avifThreadFunc)(void * userData);
+typedef struct avifThread avifThread;
+
+// Calls func(userData) in a new thread. Returns NULL if the thread could not be created.
+AVIF_NODISCARD avifThread * avifThreadCreate(avifThreadFunc func, void * userData);
+// Waits for func to return and frees the thread. Returns AVIF_FALSE if the thread could not be joined.
+AVIF_NODISCARD avifBool avifThreadJoin(avifThread * thread);
+
 // ---------------------------------------------------------------------------
 // AVIF item category
 
@@ -601,6 +674,9 @@ typedef avifResult (*avifCodecEncodeImageFunc)(struct avifCodec * codec,
                                                avifCodecEncodeOutput * output);
 typedef avifBool (*avifCodecEncodeFinishFunc)(struct avifCodec * codec, avifCodecEncodeOutput * output);
 typedef void (*avifCodecDestroyInternalFunc)(struct avifCodec * codec);
+// Discards any decoding state, as if the codec instance was just created, so that it can decode
+// an unrelated bitstream with the same decoder options. Frees any buffer output by getNextImage.
+typedef void (*avifCodecFlushFunc)(struct avifCodec * codec);
 
 typedef struct avifCodec
 {
@@ -615,12 +691,16 @@ typedef struct avifCodec
     uint32_t imageDimensionLimit; // See avifDecoder::imageDimensionLimit.
     uint8_t operatingPoint;       // Operating point, defaults to 0.
     avifBool allLayers;           // if true, the underlying codec must decode all layers, not just the best layer
+    avifCodecChoice choice;       // The choice this instance was created from. See avifDecoder::reuseCodecs.
+    avifCodecType codecType;      // The type of the tiles decoded by this instance. See avifDecoder::reuseCodecs.
 
     avifCodecGetNextImageFunc getNextImage;
     avifCodecEncodeImageFunc encodeImage;
     avifCodecEncodeFinishFunc encodeFinish;
     avifCodecDestroyInternalFunc destroyInternal;
+    avifCodecFlushFunc flush; // Optional. Decoding codec instances without it are never reused.
 } avifCodec;
+AVIF_ARRAY_DECLARE(avifCodecArray, avifCodec *, codec);
 
 avifResult avifCodecCreate(avifCodecChoice choice, avifCodecFlags requiredFlags, avifCodec ** codec);
 void avifCodecDestroy(avifCodec * codec);
@@ -6,6 +6,13 @@
 #include <assert.h>
 #include <string.h>
 
+#if defined(AVIF_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(AVIF_SIMD_AVX2)
+#include <immintrin.h>
+#endif
+
 void avifFillAlpha(const avifAlphaParams * params)
 {
     if (params->dstDepth > 8) {
@@ -148,194 +155,575 @@ void avifReformatAlpha(const avifAlphaParams * params)
     }
 }
 
-avifResult avifRGBImagePremultiplyAlpha(avifRGBImage * rgb)
+// Alpha (un)multiplication kernels, in place, on a row of width pixels of channelCount samples with the alpha sample at
+// alphaIndex. The callers pass constants for channelCount and alphaIndex so that these loops can be unrolled and
+// vectorized for each layout.
+//
+// The results are exactly rounded:
+//   premultiplied = round(color * alpha / max)
+//   unpremultiplied = min(round(color * max / alpha), max), or 0 if alpha is 0
+// which is the same as the former float implementation up to 12 bits. Alpha samples above max are opaque.
+
+// Number of bits of the fixed-point reciprocals of alpha used to unpremultiply samples of at most 12 bits.
+// The quotients are exact because the dividend is less than 2^(2*depth) and the product fits in 64 bits.
+#define AVIF_RECIPROCAL_SHIFT(depth) (3 * (depth) + 1)
+#define AVIF_RECIPROCAL_MAX_DEPTH 12
+
+static inline void avifPremultiplyAlphaRow8(uint8_t * pixel, uint32_t width, uint32_t channelCount, uint32_t alphaIndex)
 {
-    // no data
-    if (!rgb->pixels || !rgb->rowBytes) {
-        return AVIF_RESULT_REFORMAT_FAILED;
+    for (uint32_t i = 0; i < width; ++i, pixel += channelCount) {
+        const uint16_t a = pixel[alphaIndex];
+        for (uint32_t c = 0; c < channelCount; ++c) {
+            if (c != alphaIndex) {
+                // (x + 1 + (x >> 8)) >> 8 is x / 255 for all x up to 255 * 255 + 127.
+                const uint16_t x = (uint16_t)(pixel[c] * a + 127);
+                pixel[c] = (uint8_t)((x + 1 + (x >> 8)) >> 8);
+            }
+        }
     }
+}
 
-    // no alpha.
-    if (!avifRGBFormatHasAlpha(rgb->format)) {
-        return AVIF_RESULT_INVALID_ARGUMENT;
+static inline void avifPremultiplyAlphaRow16(uint16_t * pixel,
+                                             uint32_t width,
+                                             uint32_t channelCount,
+                                             uint32_t alphaIndex,
+                                             uint32_t depth)
+{
+    const uint32_t max = (1u << depth) - 1;
+    for (uint32_t i = 0; i < width; ++i, pixel += channelCount) {
+        const uint32_t a = pixel[alphaIndex];
+        for (uint32_t c = 0; c < channelCount; ++c) {
+            if (c != alphaIndex) {
+                // Same as avifPremultiplyAlphaRow8(). x does not overflow even for 16-bit samples.
+                const uint32_t x = (uint32_t)pixel[c] * a + (max >> 1);
+                const uint32_t premultiplied = (x + 1 + (x >> depth)) >> depth;
+                pixel[c] = (uint16_t)((a >= max) ? pixel[c] : premultiplied);
+            }
+        }
     }
+}
 
-    avifResult libyuvResult = avifRGBImagePremultiplyAlphaLibYUV(rgb);
-    if (libyuvResult != AVIF_RESULT_NOT_IMPLEMENTED) {
-        return libyuvResult;
+// reciprocals[a] is ceil(2^AVIF_RECIPROCAL_SHIFT(8) / a), or 0 if a is 0.
+static inline void avifUnpremultiplyAlphaRow8(uint8_t * pixel,
+                                              uint32_t width,
+                                              uint32_t channelCount,
+                                              uint32_t alphaIndex,
+                                              const uint64_t * reciprocals)
+{
+    for (uint32_t i = 0; i < width; ++i, pixel += channelCount) {
+        const uint32_t a = pixel[alphaIndex];
+        const uint64_t reciprocal = reciprocals[a];
+        for (uint32_t c = 0; c < channelCount; ++c) {
+            if (c != alphaIndex) {
+                const uint64_t unpremultiplied = (((uint64_t)pixel[c] * 255 + (a >> 1)) * reciprocal) >> AVIF_RECIPROCAL_SHIFT(8);
+                pixel[c] = (uint8_t)AVIF_MIN(unpremultiplied, 255);
+            }
+        }
     }
+}
 
-    assert(rgb->depth >= 8 && rgb->depth <= 16);
-
-    uint32_t max = (1 << rgb->depth) - 1;
-    float maxF = (float)max;
-
-    if (rgb->depth > 8) {
-        if (rgb->format == AVIF_RGB_FORMAT_RGBA || rgb->format == AVIF_RGB_FORMAT_BGRA) {
-            uint8_t * row = rgb->pixels;
-            for (uint32_t j = 0; j < rgb->height; ++j) {
-                uint16_t * pixel = (uint16_t *)row;
-                for (uint32_t i = 0; i < rgb->width; ++i) {
-                    uint16_t a = pixel[3];
-                    if (a >= max) {
-                        // opaque is no-op
-                    } else if (a == 0) {
-                        // result must be zero
-                        pixel[0] = 0;
-                        pixel[1] = 0;
-                        pixel[2] = 0;
-                    } else {
-                        // a < maxF is always true now, so we don't need clamp here
-                        pixel[0] = (uint16_t)avifRoundf((float)pixel[0] * (float)a / maxF);
-                        pixel[1] = (uint16_t)avifRoundf((float)pixel[1] * (float)a / maxF);
-                        pixel[2] = (uint16_t)avifRoundf((float)pixel[2] * (float)a / maxF);
-                    }
-                    pixel += 4;
-                }
-                row += rgb->rowBytes;
-            }
-        } else if (rgb->format == AVIF_RGB_FORMAT_ARGB || rgb->format == AVIF_RGB_FORMAT_ABGR) {
-            uint8_t * row = rgb->pixels;
-            for (uint32_t j = 0; j < rgb->height; ++j) {
-                uint16_t * pixel = (uint16_t *)row;
-                for (uint32_t i = 0; i < rgb->width; ++i) {
-                    uint16_t a = pixel[0];
-                    if (a >= max) {
-                    } else if (a == 0) {
-                        pixel[1] = 0;
-                        pixel[2] = 0;
-                        pixel[3] = 0;
-                    } else {
-                        pixel[1] = (uint16_t)avifRoundf((float)pixel[1] * (float)a / maxF);
-                        pixel[2] = (uint16_t)avifRoundf((float)pixel[2] * (float)a / maxF);
-                        pixel[3] = (uint16_t)avifRoundf((float)pixel[3] * (float)a / maxF);
-                    }
-                    pixel += 4;
-                }
-                row += rgb->rowBytes;
-            }
-        } else if (rgb->format == AVIF_RGB_FORMAT_GRAYA) {
-            uint8_t * row = rgb->pixels;
-            for (uint32_t j = 0; j < rgb->height; ++j) {
-                uint16_t * pixel = (uint16_t *)row;
-                for (uint32_t i = 0; i < rgb->width; ++i) {
-                    uint16_t a = pixel[1];
-                    if (a >= max) {
-                        // opaque is no-op
-                    } else if (a == 0) {
-                        // result must be zero
-                        pixel[0] = 0;
-                    } else {
-                        // a < maxF is always true now, so we don't need clamp here
-                        pixel[0] = (uint16_t)avifRoundf((float)pixel[0] * (float)a / maxF);
-                    }
-                    pixel += 2;
-                }
-                row += rgb->rowBytes;
+// reciprocals[a] is ceil(2^AVIF_RECIPROCAL_SHIFT(depth) / a) for a in [1:max], and 0 if a is 0.
+static inline void avifUnpremultiplyAlphaRow16(uint16_t * pixel,
+                                               uint32_t width,
+                                               uint32_t channelCount,
+                                               uint32_t alphaIndex,
+                                               uint32_t depth,
+                                               const uint64_t * reciprocals)
+{
+    const uint32_t max = (1u << depth) - 1;
+    const uint32_t shift = AVIF_RECIPROCAL_SHIFT(depth);
+    for (uint32_t i = 0; i < width; ++i, pixel += channelCount) {
+        const uint32_t a = pixel[alphaIndex];
+        const uint64_t reciprocal = reciprocals[AVIF_MIN(a, max)];
+        for (uint32_t c = 0; c < channelCount; ++c) {
+            if (c != alphaIndex) {
+                const uint64_t unpremultiplied = (((uint64_t)pixel[c] * max + (a >> 1)) * reciprocal) >> shift;
+                pixel[c] = (uint16_t)((a >= max) ? pixel[c] : AVIF_MIN(unpremultiplied, max));
             }
-        } else if (rgb->format == AVIF_RGB_FORMAT_AGRAY) {
-            uint8_t * row = rgb->pixels;
-            for (uint32_t j = 0; j < rgb->height; ++j) {
-                uint16_t * pixel = (uint16_t *)row;
-                for (uint32_t i = 0; i < rgb->width; ++i) {
-                    uint16_t a = pixel[0];
-                    if (a >= max) {
-                    } else if (a == 0) {
-                        pixel[1] = 0;
-                    } else {
-                        pixel[1] = (uint16_t)avifRoundf((float)pixel[1] * (float)a / maxF);
-                    }
-                    pixel += 2;
-                }
-                row += rgb->rowBytes;
+        }
+    }
+}
+
+// Used when there are too few pixels to be worth computing the reciprocals, or when they do not fit in 64 bits.
+static void avifUnpremultiplyAlphaRow16WithDivisions(uint16_t * pixel,
+                                                     uint32_t width,
+                                                     uint32_t channelCount,
+                                                     uint32_t alphaIndex,
+                                                     uint32_t depth)
+{
+    const uint32_t max = (1u << depth) - 1;
+    for (uint32_t i = 0; i < width; ++i, pixel += channelCount) {
+        const uint32_t a = pixel[alphaIndex];
+        if (a >= max) {
+            continue;
+        }
+        for (uint32_t c = 0; c < channelCount; ++c) {
+            if (c != alphaIndex) {
+                const uint32_t unpremultiplied = (a == 0) ? 0 : (uint32_t)(((uint64_t)pixel[c] * max + (a >> 1)) / a);
+                pixel[c] = (uint16_t)AVIF_MIN(unpremultiplied, max);
             }
+        }
+    }
+}
+
+// SIMD kernel that (un)multiplies the leading pixels of a row of width pixels that fill whole vectors, in place, with the
+// same results as the scalar kernels above. Returns the number of pixels processed.
+typedef uint32_t (*avifMultiplyAlphaRowSIMDFunc)(uint8_t * row,
+                                                 uint32_t width,
+                                                 uint32_t channelCount,
+                                                 uint32_t alphaIndex,
+                                                 uint32_t depth);
+
+#if defined(AVIF_SIMD_SSE2)
+// The kernels work on 16-bit lanes. The alpha sample of each pixel is broadcast to the lanes of the pixel with shifts by
+// 16 * alphaIndex bits, so that the same code handles all the layouts. Unpremultiplication divides in single precision,
+// which is exact for dividends below 2^24, that is for depths of up to 12 bits. Only the AVX2 kernels handle samples of
+// more than 8 bits.
+
+// Returns the mask of the alpha lanes.
+static inline __m128i avifAlphaLanesSSE2(uint32_t channelCount, __m128i alphaShift)
+{
+    if (channelCount == 4) {
+        return _mm_sll_epi64(_mm_set1_epi64x(0xFFFF), alphaShift);
+    }
+    return _mm_sll_epi32(_mm_set1_epi32(0xFFFF), alphaShift);
+}
+
+// Returns the alpha sample of each pixel in all the lanes of the pixel.
+static inline __m128i avifBroadcastAlphaSSE2(__m128i pixels, uint32_t channelCount, __m128i alphaShift)
+{
+    if (channelCount == 4) {
+        const __m128i alpha = _mm_and_si128(_mm_srl_epi64(pixels, alphaShift), _mm_set1_epi64x(0xFFFF));
+        const __m128i alpha2 = _mm_or_si128(alpha, _mm_slli_epi64(alpha, 16));
+        return _mm_or_si128(alpha2, _mm_slli_epi64(alpha2, 32));
+    }
+    const __m128i alpha = _mm_and_si128(_mm_srl_epi32(pixels, alphaShift), _mm_set1_epi32(0xFFFF));
+    return _mm_or_si128(alpha, _mm_slli_epi32(alpha, 16));
+}
+
+// Returns the samples of a where mask is set and the samples of b elsewhere.
+static inline __m128i avifSelectSSE2(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline __m128i avifPremultiply8SSE2(__m128i pixels, uint32_t channelCount, __m128i alphaShift, __m128i alphaLanes)
+{
+    const __m128i alpha = avifBroadcastAlphaSSE2(pixels, channelCount, alphaShift);
+    const __m128i x = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), _mm_set1_epi16(127));
+    const __m128i premultiplied = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8)), 8);
+    return avifSelectSSE2(alphaLanes, pixels, premultiplied);
+}
+
+// Returns floor(dividend / divisor) for the 32-bit lanes. Lanes with a divisor of 0 give INT32_MIN.
+static inline __m128i avifDivideSSE2(__m128i dividend, __m128i divisor)
+{
+    return _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(dividend), _mm_cvtepi32_ps(divisor)));
+}
+
+static inline __m128i avifUnpremultiply8SSE2(__m128i pixels, uint32_t channelCount, __m128i alphaShift, __m128i alphaLanes)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = avifBroadcastAlphaSSE2(pixels, channelCount, alphaShift);
+    // At most 255 * 255 + 127, which fits in 16 bits.
+    const __m128i dividend = _mm_add_epi16(_mm_mullo_epi16(pixels, _mm_set1_epi16(255)), _mm_srli_epi16(alpha, 1));
+    const __m128i quotient0 = avifDivideSSE2(_mm_unpacklo_epi16(dividend, zero), _mm_unpacklo_epi16(alpha, zero));
+    const __m128i quotient1 = avifDivideSSE2(_mm_unpackhi_epi16(dividend, zero), _mm_unpackhi_epi16(alpha, zero));
+    // The signed saturation here and the unsigned saturation of the caller clamp the quotients to [0:255], and give 0 for
+    // fully transparent pixels.
+    return avifSelectSSE2(alphaLanes, pixels, _mm_packs_epi32(quotient0, quotient1));
+}
+
+static uint32_t avifPremultiplyAlphaRow8SSE2(uint8_t * row,
+                                             uint32_t width,
+                                             uint32_t channelCount,
+                                             uint32_t alphaIndex,
+                                             uint32_t depth)
+{
+    (void)depth;
+    const __m128i alphaShift = _mm_cvtsi32_si128((int)(16 * alphaIndex));
+    const __m128i alphaLanes = avifAlphaLanesSSE2(channelCount, alphaShift);
+    const __m128i zero = _mm_setzero_si128();
+    const uint32_t pixelsPerVector = 16 / channelCount;
+    uint32_t i = 0;
+    for (; i + pixelsPerVector <= width; i += pixelsPerVector) {
+        __m128i * vector = (__m128i *)&row[i * channelCount];
+        const __m128i pixels = _mm_loadu_si128(vector);
+        const __m128i lo = avifPremultiply8SSE2(_mm_unpacklo_epi8(pixels, zero), channelCount, alphaShift, alphaLanes);
+        const __m128i hi = avifPremultiply8SSE2(_mm_unpackhi_epi8(pixels, zero), channelCount, alphaShift, alphaLanes);
+        _mm_storeu_si128(vector, _mm_packus_epi16(lo, hi));
+    }
+    return i;
+}
+
+static uint32_t avifUnpremultiplyAlphaRow8SSE2(uint8_t * row,
+                                               uint32_t width,
+                                               uint32_t channelCount,
+                                               uint32_t alphaIndex,
+                                               uint32_t depth)
+{
+    (void)depth;
+    const __m128i alphaShift = _mm_cvtsi32_si128((int)(16 * alphaIndex));
+    const __m128i alphaLanes = avifAlphaLanesSSE2(channelCount, alphaShift);
+    const __m128i zero = _mm_setzero_si128();
+    const uint32_t pixelsPerVector = 16 / channelCount;
+    uint32_t i = 0;
+    for (; i + pixelsPerVector <= width; i += pixelsPerVector) {
+        __m128i * vector = (__m128i *)&row[i * channelCount];
+        const __m128i pixels = _mm_loadu_si128(vector);
+        const __m128i lo = avifUnpremultiply8SSE2(_mm_unpacklo_epi8(pixels, zero), channelCount, alphaShift, alphaLanes);
+        const __m128i hi = avifUnpremultiply8SSE2(_mm_unpackhi_epi8(pixels, zero), channelCount, alphaShift, alphaLanes);
+        _mm_storeu_si128(vector, _mm_packus_epi16(lo, hi));
+    }
+    return i;
+}
+
+#if defined(AVIF_SIMD_AVX2)
+// The unpacking and packing instructions work within 128-bit lanes, which keeps the samples in order.
+
+__attribute__((target("avx2"))) static inline __m256i avifAlphaLanesAVX2(uint32_t channelCount, __m128i alphaShift)
+{
+    if (channelCount == 4) {
+        return _mm256_sll_epi64(_mm256_set1_epi64x(0xFFFF), alphaShift);
+    }
+    return _mm256_sll_epi32(_mm256_set1_epi32(0xFFFF), alphaShift);
+}
+
+__attribute__((target("avx2"))) static inline __m256i avifBroadcastAlphaAVX2(__m256i pixels,
+                                                                             uint32_t channelCount,
+                                                                             __m128i alphaShift)
+{
+    if (channelCount == 4) {
+        const __m256i alpha = _mm256_and_si256(_mm256_srl_epi64(pixels, alphaShift), _mm256_set1_epi64x(0xFFFF));
+        const __m256i alpha2 = _mm256_or_si256(alpha, _mm256_slli_epi64(alpha, 16));
+        return _mm256_or_si256(alpha2, _mm256_slli_epi64(alpha2, 32));
+    }
+    const __m256i alpha = _mm256_and_si256(_mm256_srl_epi32(pixels, alphaShift), _mm256_set1_epi32(0xFFFF));
+    return _mm256_or_si256(alpha, _mm256_slli_epi32(alpha, 16));
+}
+
+// Returns the mask of the lanes of alpha that are at least max.
+__attribute__((target("avx2"))) static inline __m256i avifIsOpaqueAVX2(__m256i alpha, uint32_t max)
+{
+    // Offset by 0x8000 for the signed comparison to behave as an unsigned one.
+    const __m256i sign = _mm256_set1_epi16((short)0x8000);
+    return _mm256_cmpgt_epi16(_mm256_xor_si256(alpha, sign), _mm256_xor_si256(_mm256_set1_epi16((short)(max - 1)), sign));
+}
+
+// Returns floor(dividend / divisor) for the 32-bit lanes. Lanes with a divisor of 0 give INT32_MIN.
+__attribute__((target("avx2"))) static inline __m256i avifDivideAVX2(__m256i dividend, __m256i divisor)
+{
+    return _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(dividend), _mm256_cvtepi32_ps(divisor)));
+}
+
+__attribute__((target("avx2"))) static inline __m256i avifPremultiply8AVX2(__m256i pixels,
+                                                                           uint32_t channelCount,
+                                                                           __m128i alphaShift,
+                                                                           __m256i alphaLanes)
+{
+    const __m256i alpha = avifBroadcastAlphaAVX2(pixels, channelCount, alphaShift);
+    const __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(pixels, alpha), _mm256_set1_epi16(127));
+    const __m256i premultiplied =
+        _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(x, _mm256_set1_epi16(1)), _mm256_srli_epi16(x, 8)), 8);
+    return _mm256_blendv_epi8(premultiplied, pixels, alphaLanes);
+}
+
+__attribute__((target("avx2"))) static inline __m256i avifPremultiply16AVX2(__m256i pixels,
+                                                                            uint32_t channelCount,
+                                                                            __m128i alphaShift,
+                                                                            __m256i alphaLanes,
+                                                                            uint32_t depth)
+{
+    const uint32_t max = (1u << depth) - 1;
+    const __m128i depthShift = _mm_cvtsi32_si128((int)depth);
+    const __m256i alpha = avifBroadcastAlphaAVX2(pixels, channelCount, alphaShift);
+    const __m256i productLo = _mm256_mullo_epi16(pixels, alpha);
+    const __m256i productHi = _mm256_mulhi_epu16(pixels, alpha);
+    const __m256i half = _mm256_set1_epi32((int)(max >> 1));
+    const __m256i x0 = _mm256_add_epi32(_mm256_unpacklo_epi16(productLo, productHi), half);
+    const __m256i x1 = _mm256_add_epi32(_mm256_unpackhi_epi16(productLo, productHi), half);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i premultiplied0 =
+        _mm256_srl_epi32(_mm256_add_epi32(_mm256_add_epi32(x0, one), _mm256_srl_epi32(x0, depthShift)), depthShift);
+    const __m256i premultiplied1 =
+        _mm256_srl_epi32(_mm256_add_epi32(_mm256_add_epi32(x1, one), _mm256_srl_epi32(x1, depthShift)), depthShift);
+    const __m256i keep = _mm256_or_si256(alphaLanes, avifIsOpaqueAVX2(alpha, max));
+    return _mm256_blendv_epi8(_mm256_packus_epi32(premultiplied0, premultiplied1), pixels, keep);
+}
+
+__attribute__((target("avx2"))) static inline __m256i avifUnpremultiply8AVX2(__m256i pixels,
+                                                                             uint32_t channelCount,
+                                                                             __m128i alphaShift,
+                                                                             __m256i alphaLanes)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha = avifBroadcastAlphaAVX2(pixels, channelCount, alphaShift);
+    const __m256i dividend = _mm256_add_epi16(_mm256_mullo_epi16(pixels, _mm256_set1_epi16(255)), _mm256_srli_epi16(alpha, 1));
+    const __m256i quotient0 = avifDivideAVX2(_mm256_unpacklo_epi16(dividend, zero), _mm256_unpacklo_epi16(alpha, zero));
+    const __m256i quotient1 = avifDivideAVX2(_mm256_unpackhi_epi16(dividend, zero), _mm256_unpackhi_epi16(alpha, zero));
+    return _mm256_blendv_epi8(_mm256_packs_epi32(quotient0, quotient1), pixels, alphaLanes);
+}
+
+__attribute__((target("avx2"))) static inline __m256i avifUnpremultiply16AVX2(__m256i pixels,
+                                                                              uint32_t channelCount,
+                                                                              __m128i alphaShift,
+                                                                              __m256i alphaLanes,
+                                                                              uint32_t depth)
+{
+    const uint32_t max = (1u << depth) - 1;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha = avifBroadcastAlphaAVX2(pixels, channelCount, alphaShift);
+    const __m256i productLo = _mm256_mullo_epi16(pixels, _mm256_set1_epi16((short)max));
+    const __m256i productHi = _mm256_mulhi_epu16(pixels, _mm256_set1_epi16((short)max));
+    const __m256i halfAlpha = _mm256_srli_epi16(alpha, 1);
+    const __m256i dividend0 =
+        _mm256_add_epi32(_mm256_unpacklo_epi16(productLo, productHi), _mm256_unpacklo_epi16(halfAlpha, zero));
+    const __m256i dividend1 =
+        _mm256_add_epi32(_mm256_unpackhi_epi16(productLo, productHi), _mm256_unpackhi_epi16(halfAlpha, zero));
+    // Fully transparent pixels give INT32_MIN, which is clamped to 0.
+    const __m256i maxSample = _mm256_set1_epi32((int)max);
+    const __m256i quotient0 =
+        _mm256_max_epi32(_mm256_min_epi32(avifDivideAVX2(dividend0, _mm256_unpacklo_epi16(alpha, zero)), maxSample), zero);
+    const __m256i quotient1 =
+        _mm256_max_epi32(_mm256_min_epi32(avifDivideAVX2(dividend1, _mm256_unpackhi_epi16(alpha, zero)), maxSample), zero);
+    const __m256i keep = _mm256_or_si256(alphaLanes, avifIsOpaqueAVX2(alpha, max));
+    return _mm256_blendv_epi8(_mm256_packus_epi32(quotient0, quotient1), pixels, keep);
+}
+
+__attribute__((target("avx2"))) static uint32_t avifPremultiplyAlphaRow8AVX2(uint8_t * row,
+                                                                             uint32_t width,
+                                                                             uint32_t channelCount,
+                                                                             uint32_t alphaIndex,
+                                                                             uint32_t depth)
+{
+    (void)depth;
+    const __m128i alphaShift = _mm_cvtsi32_si128((int)(16 * alphaIndex));
+    const __m256i alphaLanes = avifAlphaLanesAVX2(channelCount, alphaShift);
+    const __m256i zero = _mm256_setzero_si256();
+    const uint32_t pixelsPerVector = 32 / channelCount;
+    uint32_t i = 0;
+    for (; i + pixelsPerVector <= width; i += pixelsPerVector) {
+        __m256i * vector = (__m256i *)&row[i * channelCount];
+        const __m256i pixels = _mm256_loadu_si256(vector);
+        const __m256i lo = avifPremultiply8AVX2(_mm256_unpacklo_epi8(pixels, zero), channelCount, alphaShift, alphaLanes);
+        const __m256i hi = avifPremultiply8AVX2(_mm256_unpackhi_epi8(pixels, zero), channelCount, alphaShift, alphaLanes);
+        _mm256_storeu_si256(vector, _mm256_packus_epi16(lo, hi));
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) static uint32_t avifPremultiplyAlphaRow16AVX2(uint8_t * row,
+                                                                              uint32_t width,
+                                                                              uint32_t channelCount,
+                                                                              uint32_t alphaIndex,
+                                                                              uint32_t depth)
+{
+    const __m128i alphaShift = _mm_cvtsi32_si128((int)(16 * alphaIndex));
+    const __m256i alphaLanes = avifAlphaLanesAVX2(channelCount, alphaShift);
+    const uint32_t pixelsPerVector = 16 / channelCount;
+    uint32_t i = 0;
+    for (; i + pixelsPerVector <= width; i += pixelsPerVector) {
+        __m256i * vector = (__m256i *)&row[i * channelCount * 2];
+        const __m256i pixels = _mm256_loadu_si256(vector);
+        _mm256_storeu_si256(vector, avifPremultiply16AVX2(pixels, channelCount, alphaShift, alphaLanes, depth));
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) static uint32_t avifUnpremultiplyAlphaRow8AVX2(uint8_t * row,
+                                                                               uint32_t width,
+                                                                               uint32_t channelCount,
+                                                                               uint32_t alphaIndex,
+                                                                               uint32_t depth)
+{
+    (void)depth;
+    const __m128i alphaShift = _mm_cvtsi32_si128((int)(16 * alphaIndex));
+    const __m256i alphaLanes = avifAlphaLanesAVX2(channelCount, alphaShift);
+    const __m256i zero = _mm256_setzero_si256();
+    const uint32_t pixelsPerVector = 32 / channelCount;
+    uint32_t i = 0;
+    for (; i + pixelsPerVector <= width; i += pixelsPerVector) {
+        __m256i * vector = (__m256i *)&row[i * channelCount];
+        const __m256i pixels = _mm256_loadu_si256(vector);
+        const __m256i lo = avifUnpremultiply8AVX2(_mm256_unpacklo_epi8(pixels, zero), channelCount, alphaShift, alphaLanes);
+        const __m256i hi = avifUnpremultiply8AVX2(_mm256_unpackhi_epi8(pixels, zero), channelCount, alphaShift, alphaLanes);
+        _mm256_storeu_si256(vector, _mm256_packus_epi16(lo, hi));
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) static uint32_t avifUnpremultiplyAlphaRow16AVX2(uint8_t * row,
+                                                                                uint32_t width,
+                                                                                uint32_t channelCount,
+                                                                                uint32_t alphaIndex,
+                                                                                uint32_t depth)
+{
+    const __m128i alphaShift = _mm_cvtsi32_si128((int)(16 * alphaIndex));
+    const __m256i alphaLanes = avifAlphaLanesAVX2(channelCount, alphaShift);
+    const uint32_t pixelsPerVector = 16 / channelCount;
+    uint32_t i = 0;
+    for (; i + pixelsPerVector <= width; i += pixelsPerVector) {
+        __m256i * vector = (__m256i *)&row[i * channelCount * 2];
+        const __m256i pixels = _mm256_loadu_si256(vector);
+        _mm256_storeu_si256(vector, avifUnpremultiply16AVX2(pixels, channelCount, alphaShift, alphaLanes, depth));
+    }
+    return i;
+}
+#endif // defined(AVIF_SIMD_AVX2)
+#endif // defined(AVIF_SIMD_SSE2)
+
+// Returns the SIMD kernel to (un)multiply rows of the given depth, or NULL if there is none.
+static avifMultiplyAlphaRowSIMDFunc avifGetMultiplyAlphaRowSIMD(uint32_t depth, avifBool unpremultiply)
+{
+    avifMultiplyAlphaRowSIMDFunc simdRow = NULL;
+#if defined(AVIF_SIMD_SSE2)
+    if (unpremultiply && depth > AVIF_RECIPROCAL_MAX_DEPTH) {
+        return NULL;
+    }
+    const uint32_t cpuFeatures = avifGetCPUFeatures();
+    // With 16-bit samples, the SSE2 kernels are not faster than the scalar ones.
+    if ((cpuFeatures & AVIF_CPU_SSE2) && depth == 8) {
+        simdRow = unpremultiply ? avifUnpremultiplyAlphaRow8SSE2 : avifPremultiplyAlphaRow8SSE2;
+    }
+#if defined(AVIF_SIMD_AVX2)
+    if (cpuFeatures & AVIF_CPU_AVX2) {
+        if (unpremultiply) {
+            simdRow = (depth > 8) ? avifUnpremultiplyAlphaRow16AVX2 : avifUnpremultiplyAlphaRow8AVX2;
         } else {
-            return AVIF_RESULT_NOT_IMPLEMENTED;
+            simdRow = (depth > 8) ? avifPremultiplyAlphaRow16AVX2 : avifPremultiplyAlphaRow8AVX2;
         }
+    }
+#endif
+#else
+    (void)depth;
+    (void)unpremultiply;
+#endif
+    return simdRow;
+}
+
+// In practice, we rarely need more than 8 threads for alpha (un)multiplication.
+#define AVIF_ALPHA_MULTIPLY_MAX_JOBS 8
+// Spawning a thread costs more than (un)multiplying fewer pixels than this.
+#define AVIF_ALPHA_MULTIPLY_MIN_PIXELS_PER_JOB (1 << 14)
+
+typedef struct avifAlphaMultiplyJob
+{
+    avifThread * thread;
+    avifRGBImage rgb; // A band of rows of the image.
+    avifBool unpremultiply;
+    const uint64_t * reciprocals; // NULL if divisions are used to unpremultiply.
+    avifMultiplyAlphaRowSIMDFunc simdRow; // May be NULL.
+} avifAlphaMultiplyJob;
+
+static inline void avifMultiplyAlphaRow(const avifAlphaMultiplyJob * job,
+                                        uint8_t * row,
+                                        uint32_t channelCount,
+                                        uint32_t alphaIndex)
+{
+    const avifRGBImage * rgb = &job->rgb;
+    uint32_t width = rgb->width;
+    if (job->simdRow) {
+        // The scalar kernels process the remaining pixels.
+        const uint32_t simdWidth = job->simdRow(row, width, channelCount, alphaIndex, rgb->depth);
+        row += (size_t)simdWidth * channelCount * ((rgb->depth > 8) ? 2 : 1);
+        width -= simdWidth;
+    }
+    if (!job->unpremultiply) {
+        if (rgb->depth > 8) {
+            avifPremultiplyAlphaRow16((uint16_t *)row, width, channelCount, alphaIndex, rgb->depth);
+        } else {
+            avifPremultiplyAlphaRow8(row, width, channelCount, alphaIndex);
+        }
+    } else if (rgb->depth == 8) {
+        avifUnpremultiplyAlphaRow8(row, width, channelCount, alphaIndex, job->reciprocals);
+    } else if (job->reciprocals) {
+        avifUnpremultiplyAlphaRow16((uint16_t *)row, width, channelCount, alphaIndex, rgb->depth, job->reciprocals);
     } else {
+        avifUnpremultiplyAlphaRow16WithDivisions((uint16_t *)row, width, channelCount, alphaIndex, rgb->depth);
+    }
+}
+
+static void avifAlphaMultiplyJobWorker(void * arg)
+{
+    const avifAlphaMultiplyJob * job = (const avifAlphaMultiplyJob *)arg;
+    const avifRGBImage * rgb = &job->rgb;
+    for (uint32_t j = 0; j < rgb->height; ++j) {
+        uint8_t * row = &rgb->pixels[(size_t)j * rgb->rowBytes];
+        // Order of RGB doesn't matter here.
         if (rgb->format == AVIF_RGB_FORMAT_RGBA || rgb->format == AVIF_RGB_FORMAT_BGRA) {
-            uint8_t * row = rgb->pixels;
-            for (uint32_t j = 0; j < rgb->height; ++j) {
-                uint8_t * pixel = row;
-                for (uint32_t i = 0; i < rgb->width; ++i) {
-                    uint8_t a = pixel[3];
-                    // uint8_t can't exceed 255
-                    if (a == max) {
-                    } else if (a == 0) {
-                        pixel[0] = 0;
-                        pixel[1] = 0;
-                        pixel[2] = 0;
-                    } else {
-                        pixel[0] = (uint8_t)avifRoundf((float)pixel[0] * (float)a / maxF);
-                        pixel[1] = (uint8_t)avifRoundf((float)pixel[1] * (float)a / maxF);
-                        pixel[2] = (uint8_t)avifRoundf((float)pixel[2] * (float)a / maxF);
-                    }
-                    pixel += 4;
-                }
-                row += rgb->rowBytes;
-            }
+            avifMultiplyAlphaRow(job, row, 4, 3);
         } else if (rgb->format == AVIF_RGB_FORMAT_ARGB || rgb->format == AVIF_RGB_FORMAT_ABGR) {
-            uint8_t * row = rgb->pixels;
-            for (uint32_t j = 0; j < rgb->height; ++j) {
-                uint8_t * pixel = row;
-                for (uint32_t i = 0; i < rgb->width; ++i) {
-                    uint8_t a = pixel[0];
-                    if (a == max) {
-                    } else if (a == 0) {
-                        pixel[1] = 0;
-                        pixel[2] = 0;
-                        pixel[3] = 0;
-                    } else {
-                        pixel[1] = (uint8_t)avifRoundf((float)pixel[1] * (float)a / maxF);
-                        pixel[2] = (uint8_t)avifRoundf((float)pixel[2] * (float)a / maxF);
-                        pixel[3] = (uint8_t)avifRoundf((float)pixel[3] * (float)a / maxF);
-                    }
-                    pixel += 4;
-                }
-                row += rgb->rowBytes;
-            }
+            avifMultiplyAlphaRow(job, row, 4, 0);
         } else if (rgb->format == AVIF_RGB_FORMAT_GRAYA) {
-            uint8_t * row = rgb->pixels;
-            for (uint32_t j = 0; j < rgb->height; ++j) {
-                uint8_t * pixel = row;
-                for (uint32_t i = 0; i < rgb->width; ++i) {
-                    uint8_t a = pixel[1];
-                    // uint8_t can't exceed 255
-                    if (a == max) {
-                    } else if (a == 0) {
-                        pixel[0] = 0;
-                    } else {
-                        pixel[0] = (uint8_t)avifRoundf((float)pixel[0] * (float)a / maxF);
-                    }
-                    pixel += 2;
-                }
-                row += rgb->rowBytes;
-            }
-        } else if (rgb->format == AVIF_RGB_FORMAT_AGRAY) {
-            uint8_t * row = rgb->pixels;
-            for (uint32_t j = 0; j < rgb->height; ++j) {
-                uint8_t * pixel = row;
-                for (uint32_t i = 0; i < rgb->width; ++i) {
-                    uint8_t a = pixel[0];
-                    if (a == max) {
-                    } else if (a == 0) {
-                        pixel[1] = 0;
-                    } else {
-                        pixel[1] = (uint8_t)avifRoundf((float)pixel[1] * (float)a / maxF);
-                    }
-                    pixel += 2;
-                }
-                row += rgb->rowBytes;
-            }
+            avifMultiplyAlphaRow(job, row, 2, 1);
         } else {
-            return AVIF_RESULT_NOT_IMPLEMENTED;
+            assert(rgb->format == AVIF_RGB_FORMAT_AGRAY);
+            avifMultiplyAlphaRow(job, row, 2, 0);
+        }
+    }
+}
+
+static avifResult avifRGBImageMultiplyAlpha(avifRGBImage * rgb, avifBool unpremultiply)
+{
+    assert(rgb->depth >= 8 && rgb->depth <= 16);
+    if (rgb->format != AVIF_RGB_FORMAT_RGBA && rgb->format != AVIF_RGB_FORMAT_BGRA && rgb->format != AVIF_RGB_FORMAT_ARGB &&
+        rgb->format != AVIF_RGB_FORMAT_ABGR && rgb->format != AVIF_RGB_FORMAT_GRAYA && rgb->format != AVIF_RGB_FORMAT_AGRAY) {
+        return AVIF_RESULT_NOT_IMPLEMENTED;
+    }
+
+    const uint64_t pixelCount = (uint64_t)rgb->width * rgb->height;
+    const uint32_t max = (1u << rgb->depth) - 1;
+    uint64_t * reciprocals = NULL;
+    // Computing the reciprocals costs about as much as unpremultiplying max pixels with divisions.
+    if (unpremultiply && (rgb->depth == 8 || (rgb->depth <= AVIF_RECIPROCAL_MAX_DEPTH && pixelCount > max))) {
+        reciprocals = (uint64_t *)avifAlloc(sizeof(uint64_t) * (max + 1));
+        AVIF_CHECKERR(reciprocals != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+        reciprocals[0] = 0; // Fully transparent pixels are black.
+        for (uint32_t a = 1; a <= max; ++a) {
+            reciprocals[a] = (((uint64_t)1 << AVIF_RECIPROCAL_SHIFT(rgb->depth)) + a - 1) / a;
+        }
+    }
+
+    const avifMultiplyAlphaRowSIMDFunc simdRow = avifGetMultiplyAlphaRowSIMD(rgb->depth, unpremultiply);
+
+    const uint64_t maxJobCount = AVIF_MIN(pixelCount / AVIF_ALPHA_MULTIPLY_MIN_PIXELS_PER_JOB, rgb->height);
+    uint32_t jobCount = (uint32_t)AVIF_CLAMP(rgb->maxThreads, 1, AVIF_ALPHA_MULTIPLY_MAX_JOBS);
+    if (jobCount > maxJobCount) {
+        jobCount = (uint32_t)AVIF_MAX(maxJobCount, 1);
+    }
+    avifAlphaMultiplyJob jobs[AVIF_ALPHA_MULTIPLY_MAX_JOBS];
+    memset(jobs, 0, sizeof(jobs));
+    for (uint32_t jobIndex = 0; jobIndex < jobCount; ++jobIndex) {
+        avifAlphaMultiplyJob * job = &jobs[jobIndex];
+        const uint32_t firstRow = (uint32_t)((uint64_t)rgb->height * jobIndex / jobCount);
+        const uint32_t lastRow = (uint32_t)((uint64_t)rgb->height * (jobIndex + 1) / jobCount);
+        job->rgb = *rgb;
+        job->rgb.pixels += (size_t)firstRow * rgb->rowBytes;
+        job->rgb.height = lastRow - firstRow;
+        job->unpremultiply = unpremultiply;
+        job->reciprocals = reciprocals;
+        job->simdRow = simdRow;
+    }
+    // The calling thread runs the first job.
+    for (uint32_t jobIndex = 1; jobIndex < jobCount; ++jobIndex) {
+        jobs[jobIndex].thread = avifThreadCreate(avifAlphaMultiplyJobWorker, &jobs[jobIndex]);
+        if (jobs[jobIndex].thread == NULL) {
+            avifAlphaMultiplyJobWorker(&jobs[jobIndex]);
         }
     }
+    avifAlphaMultiplyJobWorker(&jobs[0]);
 
-    return AVIF_RESULT_OK;
+    avifResult result = AVIF_RESULT_OK;
+    for (uint32_t jobIndex = 1; jobIndex < jobCount; ++jobIndex) {
+        if (jobs[jobIndex].thread != NULL && !avifThreadJoin(jobs[jobIndex].thread)) {
+            result = AVIF_RESULT_UNKNOWN_ERROR;
+        }
+    }
+    avifFree(reciprocals);
+    return result;
 }
 
-avifResult avifRGBImageUnpremultiplyAlpha(avifRGBImage * rgb)
+avifResult avifRGBImagePremultiplyAlpha(avifRGBImage * rgb)
 {
     // no data
     if (!rgb->pixels || !rgb->rowBytes) {
@@ -344,192 +732,33 @@ avifResult avifRGBImageUnpremultiplyAlpha(avifRGBImage * rgb)
 
     // no alpha.
     if (!avifRGBFormatHasAlpha(rgb->format)) {
-        return AVIF_RESULT_REFORMAT_FAILED;
+        return AVIF_RESULT_INVALID_ARGUMENT;
     }
 
-    avifResult libyuvResult = avifRGBImageUnpremultiplyAlphaLibYUV(rgb);
+    avifResult libyuvResult = avifRGBImagePremultiplyAlphaLibYUV(rgb);
     if (libyuvResult != AVIF_RESULT_NOT_IMPLEMENTED) {
         return libyuvResult;
     }
 
-    assert(rgb->depth >= 8 && rgb->depth <= 16);
+    return avifRGBImageMultiplyAlpha(rgb, /*unpremultiply=*/AVIF_FALSE);
+}
 
-    uint32_t max = (1 << rgb->depth) - 1;
-    float maxF = (float)max;
+avifResult avifRGBImageUnpremultiplyAlpha(avifRGBImage * rgb)
+{
+    // no data
+    if (!rgb->pixels || !rgb->rowBytes) {
+        return AVIF_RESULT_REFORMAT_FAILED;
+    }
 
-    if (rgb->depth > 8) {
-        if (rgb->format == AVIF_RGB_FORMAT_RGBA || rgb->format == AVIF_RGB_FORMAT_BGRA) {
-            uint8_t * row = rgb->pixels;
-            for (uint32_t j = 0; j < rgb->height; ++j) {
-                uint16_t * pixel = (uint16_t *)row;
-                for (uint32_t i = 0; i < rgb->width; ++i) {
-                    uint16_t a = pixel[3];
-                    if (a >= max) {
-                        // opaque is no-op
-                    } else if (a == 0) {
-                        // prevent division by zero
-                        pixel[0] = 0;
-                        pixel[1] = 0;
-                        pixel[2] = 0;
-                    } else {
-                        float c1 = avifRoundf((float)pixel[0] * maxF / (float)a);
-                        float c2 = avifRoundf((float)pixel[1] * maxF / (float)a);
-                        float c3 = avifRoundf((float)pixel[2] * maxF / (float)a);
-                        pixel[0] = (uint16_t)AVIF_MIN(c1, maxF);
-                        pixel[1] = (uint16_t)AVIF_MIN(c2, maxF);
-                        pixel[2] = (uint16_t)AVIF_MIN(c3, maxF);
-                    }
-                    pixel += 4;
-                }
-                row += rgb->rowBytes;
-            }
-        } else if (rgb->format == AVIF_RGB_FORMAT_ARGB || rgb->format == AVIF_RGB_FORMAT_ABGR) {
-            uint8_t * row = rgb->pixels;
-            for (uint32_t j = 0; j < rgb->height; ++j) {
-                uint16_t * pixel = (uint16_t *)row;
-                for (uint32_t i = 0; i < rgb->width; ++i) {
-                    uint16_t a = pixel[0];
-                    if (a >= max) {
-                    } else if (a == 0) {
-                        pixel[1] = 0;
-                        pixel[2] = 0;
-                        pixel[3] = 0;
-                    } else {
-                        float c1 = avifRoundf((float)pixel[1] * maxF / (float)a);
-                        float c2 = avifRoundf((float)pixel[2] * maxF / (float)a);
-                        float c3 = avifRoundf((float)pixel[3] * maxF / (float)a);
-                        pixel[1] = (uint16_t)AVIF_MIN(c1, maxF);
-                        pixel[2] = (uint16_t)AVIF_MIN(c2, maxF);
-                        pixel[3] = (uint16_t)AVIF_MIN(c3, maxF);
-                    }
-                    pixel += 4;
-                }
-                row += rgb->rowBytes;
-            }
-        } else if (rgb->format == AVIF_RGB_FORMAT_GRAYA) {
-            uint8_t * row = rgb->pixels;
-            for (uint32_t j = 0; j < rgb->height; ++j) {
-                uint16_t * pixel = (uint16_t *)row;
-                for (uint32_t i = 0; i < rgb->width; ++i) {
-                    uint16_t a = pixel[1];
-                    if (a >= max) {
-                        // opaque is no-op
-                    } else if (a == 0) {
-                        // prevent division by zero
-                        pixel[0] = 0;
-                    } else {
-                        float c1 = avifRoundf((float)pixel[0] * maxF / (float)a);
-                        pixel[0] = (uint16_t)AVIF_MIN(c1, maxF);
-                    }
-                    pixel += 2;
-                }
-                row += rgb->rowBytes;
-            }
-        } else if (rgb->format == AVIF_RGB_FORMAT_AGRAY) {
-            uint8_t * row = rgb->pixels;
-            for (uint32_t j = 0; j < rgb->height; ++j) {
-                uint16_t * pixel = (uint16_t *)row;
-                for (uint32_t i = 0; i < rgb->width; ++i) {
-                    uint16_t a = pixel[0];
-                    if (a >= max) {
-                    } else if (a == 0) {
-                        pixel[1] = 0;
-                    } else {
-                        float c1 = avifRoundf((float)pixel[1] * maxF / (float)a);
-                        pixel[1] = (uint16_t)AVIF_MIN(c1, maxF);
-                    }
-                    pixel += 2;
-                }
-                row += rgb->rowBytes;
-            }
-        } else {
-            return AVIF_RESULT_NOT_IMPLEMENTED;
-        }
-    } else {
-        if (rgb->format == AVIF_RGB_FORMAT_RGBA || rgb->format == AVIF_RGB_FORMAT_BGRA) {
-            uint8_t * row = rgb->pixels;
-            for (uint32_t j = 0; j < rgb->height; ++j) {
-                uint8_t * pixel = row;
-                for (uint32_t i = 0; i < rgb->width; ++i) {
-                    uint8_t a = pixel[3];
-                    if (a == max) {
-                    } else if (a == 0) {
-                        pixel[0] = 0;
-                        pixel[1] = 0;
-                        pixel[2] = 0;
-                    } else {
-                        float c1 = avifRoundf((float)pixel[0] * maxF / (float)a);
-                        float c2 = avifRoundf((float)pixel[1] * maxF / (float)a);
-                        float c3 = avifRoundf((float)pixel[2] * maxF / (float)a);
-                        pixel[0] = (uint8_t)AVIF_MIN(c1, maxF);
-                        pixel[1] = (uint8_t)AVIF_MIN(c2, maxF);
-                        pixel[2] = (uint8_t)AVIF_MIN(c3, maxF);
-                    }
-                    pixel += 4;
-                }
-                row += rgb->rowBytes;
-            }
-        } else if (rgb->format == AVIF_RGB_FORMAT_ARGB || rgb->format == AVIF_RGB_FORMAT_ABGR) {
-            uint8_t * row = rgb->pixels;
-            for (uint32_t j = 0; j < rgb->height; ++j) {
-                uint8_t * pixel = row;
-                for (uint32_t i = 0; i < rgb->width; ++i) {
-                    uint8_t a = pixel[0];
-                    if (a == max) {
-                    } else if (a == 0) {
-                        pixel[1] = 0;
-                        pixel[2] = 0;
-                        pixel[3] = 0;
-                    } else {
-                        float c1 = avifRoundf((float)pixel[1] * maxF / (float)a);
-                        float c2 = avifRoundf((float)pixel[2] * maxF / (float)a);
-                        float c3 = avifRoundf((float)pixel[3] * maxF / (float)a);
-                        pixel[1] = (uint8_t)AVIF_MIN(c1, maxF);
-                        pixel[2] = (uint8_t)AVIF_MIN(c2, maxF);
-                        pixel[3] = (uint8_t)AVIF_MIN(c3, maxF);
-                    }
-                    pixel += 4;
-                }
-                row += rgb->rowBytes;
-            }
-        } else if (rgb->format == AVIF_RGB_FORMAT_GRAYA) {
-            uint8_t * row = rgb->pixels;
-            for (uint32_t j = 0; j < rgb->height; ++j) {
-                uint8_t * pixel = row;
-                for (uint32_t i = 0; i < rgb->width; ++i) {
-                    uint8_t a = pixel[1];
-                    if (a == max) {
-                    } else if (a == 0) {
-                        pixel[0] = 0;
-                    } else {
-                        float c1 = avifRoundf((float)pixel[0] * maxF / (float)a);
-                        pixel[0] = (uint8_t)AVIF_MIN(c1, maxF);
-                    }
-                    pixel += 2;
-                }
-                row += rgb->rowBytes;
-            }
-        } else if (rgb->format == AVIF_RGB_FORMAT_AGRAY) {
-            uint8_t * row = rgb->pixels;
-            for (uint32_t j = 0; j < rgb->height; ++j) {
-                uint8_t * pixel = row;
-                for (uint32_t i = 0; i < rgb->width; ++i) {
-                    uint8_t a = pixel[0];
-                    if (a == max) {
-                    } else if (a == 0) {
-                        pixel[1] = 0;
-                    } else {
-                        float c1 = avifRoundf((float)pixel[1] * maxF / (float)a);
-                        pixel[1] = (uint8_t)AVIF_MIN(c1, maxF);
-                    }
-                    pixel += 2;
-                }
-                row += rgb->rowBytes;
-            }
-        } else {
-            return AVIF_RESULT_NOT_IMPLEMENTED;
-        }
+    // no alpha.
+    if (!avifRGBFormatHasAlpha(rgb->format)) {
+        return AVIF_RESULT_REFORMAT_FAILED;
+    }
+
+    avifResult libyuvResult = avifRGBImageUnpremultiplyAlphaLibYUV(rgb);
+    if (libyuvResult != AVIF_RESULT_NOT_IMPLEMENTED) {
+        return libyuvResult;
     }
 
-    return AVIF_RESULT_OK;
+    return avifRGBImageMultiplyAlpha(rgb, /*unpremultiply=*/AVIF_TRUE);
 }
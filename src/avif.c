@@ -8,6 +8,13 @@
 #include <stdint.h>
 #include <string.h>
 
+#if defined(AVIF_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(AVIF_SIMD_AVX2)
+#include <immintrin.h>
+#endif
+
 #define STR_HELPER(x) #x
 #define STR(x) STR_HELPER(x)
 #define AVIF_VERSION_STRING (STR(AVIF_VERSION_MAJOR) "." STR(AVIF_VERSION_MINOR) "." STR(AVIF_VERSION_PATCH))
@@ -184,44 +191,239 @@ void avifImageCopyNoAlloc(avifImage * dstImage, const avifImage * srcImage)
     dstImage->imir = srcImage->imir;
 }
 
-void avifImageCopySamples(avifImage * dstImage, const avifImage * srcImage, avifPlanesFlags planes)
+// In practice, we rarely need more than 8 threads to copy samples.
+#define AVIF_COPY_MAX_JOBS 8
+// Spawning a thread costs more than copying fewer bytes than this.
+#define AVIF_COPY_MIN_BYTES_PER_JOB (1 << 20)
+
+// Copies larger than this are unlikely to be read back from the cache, so their rows are written with non-temporal stores.
+#define AVIF_COPY_MIN_STREAM_BYTES (64 << 20)
+
+typedef void (*avifCopyRowFunc)(uint8_t * dst, const uint8_t * src, size_t size);
+
+static void avifCopyRow(uint8_t * dst, const uint8_t * src, size_t size)
 {
-    assert(srcImage->depth == dstImage->depth);
-    if (planes & AVIF_PLANES_YUV) {
-        assert(srcImage->yuvFormat == dstImage->yuvFormat);
-        // Note that there may be a mismatch between srcImage->yuvRange and dstImage->yuvRange
-        // because libavif allows for 'colr' and AV1 OBU video range values to differ.
+    memcpy(dst, src, size);
+}
+
+#if defined(AVIF_SIMD_AVX2)
+// Same as avifCopyRow() but with non-temporal stores, which do not read dst into the cache before overwriting it.
+// There is no SSE2 version: 16-byte non-temporal stores were slower than memcpy().
+__attribute__((target("avx2"))) static void avifCopyRowStreamAVX2(uint8_t * dst, const uint8_t * src, size_t size)
+{
+    // Non-temporal stores must be aligned.
+    size_t x = AVIF_MIN((size_t)(-(uintptr_t)dst & 31), size);
+    memcpy(dst, src, x);
+    for (; x + 128 <= size; x += 128) {
+        const __m256i a = _mm256_loadu_si256((const __m256i *)(src + x));
+        const __m256i b = _mm256_loadu_si256((const __m256i *)(src + x + 32));
+        const __m256i c = _mm256_loadu_si256((const __m256i *)(src + x + 64));
+        const __m256i d = _mm256_loadu_si256((const __m256i *)(src + x + 96));
+        _mm256_stream_si256((__m256i *)(dst + x), a);
+        _mm256_stream_si256((__m256i *)(dst + x + 32), b);
+        _mm256_stream_si256((__m256i *)(dst + x + 64), c);
+        _mm256_stream_si256((__m256i *)(dst + x + 96), d);
+    }
+    for (; x + 32 <= size; x += 32) {
+        _mm256_stream_si256((__m256i *)(dst + x), _mm256_loadu_si256((const __m256i *)(src + x)));
+    }
+    memcpy(dst + x, src + x, size - x);
+    // Non-temporal stores are weakly ordered. Make them visible before the row is padded or another thread reads it.
+    _mm_sfence();
+}
+#endif // defined(AVIF_SIMD_AVX2)
+
+typedef struct avifCopyJob
+{
+    avifThread * thread;
+    avifImage * const * dstImages;
+    const avifImage * const * srcImages;
+    uint32_t imageCount;
+    avifPlanesFlags planes;
+    avifCopyRowFunc copyRow;
+    uint32_t jobIndex;
+    uint32_t jobCount;
+} avifCopyJob;
+
+// Copies the rows of the planes of srcImage to the band of rows of dstImage assigned to job.
+// Each destination row only reads from srcImage so that the bands are independent.
+static void avifCopyJobBand(const avifCopyJob * job, avifImage * dstImage, const avifImage * srcImage)
+{
+    if (srcImage->width == 0 || srcImage->height == 0) {
+        return;
     }
-    const size_t bytesPerPixel = avifImageUsesU16(srcImage) ? 2 : 1;
+    const avifBool usesU16 = avifImageUsesU16(srcImage);
 
-    const avifBool skipColor = !(planes & AVIF_PLANES_YUV);
-    const avifBool skipAlpha = !(planes & AVIF_PLANES_A);
+    const avifBool skipColor = !(job->planes & AVIF_PLANES_YUV);
+    const avifBool skipAlpha = !(job->planes & AVIF_PLANES_A);
     for (int c = AVIF_CHAN_Y; c <= AVIF_CHAN_A; ++c) {
         const avifBool alpha = c == AVIF_CHAN_A;
         if ((skipColor && !alpha) || (skipAlpha && alpha)) {
             continue;
         }
-
-        const uint32_t planeWidth = avifImagePlaneWidth(srcImage, c);
-        const uint32_t planeHeight = avifImagePlaneHeight(srcImage, c);
-        const uint8_t * srcRow = avifImagePlane(srcImage, c);
-        uint8_t * dstRow = avifImagePlane(dstImage, c);
-        const uint32_t srcRowBytes = avifImagePlaneRowBytes(srcImage, c);
-        const uint32_t dstRowBytes = avifImagePlaneRowBytes(dstImage, c);
-        assert(!srcRow == !dstRow);
-        if (!srcRow) {
+        const uint8_t * srcPlane = avifImagePlane(srcImage, c);
+        uint8_t * dstPlane = avifImagePlane(dstImage, c);
+        if (!srcPlane || !dstPlane) {
             continue;
         }
-        assert(planeWidth == avifImagePlaneWidth(dstImage, c));
-        assert(planeHeight == avifImagePlaneHeight(dstImage, c));
-
-        const size_t planeWidthBytes = planeWidth * bytesPerPixel;
-        for (uint32_t y = 0; y < planeHeight; ++y) {
-            memcpy(dstRow, srcRow, planeWidthBytes);
-            srcRow += srcRowBytes;
-            dstRow += dstRowBytes;
+        const uint32_t srcPlaneWidth = avifImagePlaneWidth(srcImage, c);
+        const uint32_t srcPlaneHeight = avifImagePlaneHeight(srcImage, c);
+        const size_t srcRowBytes = avifImagePlaneRowBytes(srcImage, c);
+        const uint32_t dstPlaneWidth = avifImagePlaneWidth(dstImage, c);
+        const uint32_t dstPlaneHeight = avifImagePlaneHeight(dstImage, c);
+        const size_t dstRowBytes = avifImagePlaneRowBytes(dstImage, c);
+        const size_t srcPlaneWidthBytes = (size_t)srcPlaneWidth << usesU16;
+        const uint32_t firstRow = (uint32_t)((uint64_t)dstPlaneHeight * job->jobIndex / job->jobCount);
+        const uint32_t lastRow = (uint32_t)((uint64_t)dstPlaneHeight * (job->jobIndex + 1) / job->jobCount);
+
+        uint32_t y = firstRow;
+        if (srcPlaneWidth == dstPlaneWidth && srcRowBytes == srcPlaneWidthBytes && dstRowBytes == srcPlaneWidthBytes) {
+            // Both planes are contiguous. A single large memcpy() lets the C library pick its fastest strategy,
+            // such as non-temporal stores for copies larger than the cache.
+            const uint32_t lastCopiedRow = AVIF_MIN(lastRow, srcPlaneHeight);
+            if (y < lastCopiedRow) {
+                memcpy(&dstPlane[y * dstRowBytes], &srcPlane[y * srcRowBytes], (lastCopiedRow - y) * srcPlaneWidthBytes);
+                y = lastCopiedRow;
+            }
+        }
+        for (; y < lastRow; ++y) {
+            // Pad rows by replicating the last row of srcImage.
+            const uint8_t * srcRow = &srcPlane[AVIF_MIN(y, srcPlaneHeight - 1) * srcRowBytes];
+            uint8_t * dstRow = &dstPlane[y * dstRowBytes];
+            job->copyRow(dstRow, srcRow, srcPlaneWidthBytes);
+
+            // Pad columns by replicating the last sample of the row.
+            if (dstPlaneWidth > srcPlaneWidth) {
+                if (usesU16) {
+                    uint16_t * dstRow16 = (uint16_t *)dstRow;
+                    for (uint32_t x = srcPlaneWidth; x < dstPlaneWidth; ++x) {
+                        dstRow16[x] = dstRow16[srcPlaneWidth - 1];
+                    }
+                } else {
+                    memset(&dstRow[srcPlaneWidth], dstRow[srcPlaneWidth - 1], dstPlaneWidth - srcPlaneWidth);
+                }
+            }
+        }
+    }
+}
+
+// Copies the band of rows assigned to the job of each pair of images.
+static void avifCopyJobWorker(void * arg)
+{
+    const avifCopyJob * job = (const avifCopyJob *)arg;
+    for (uint32_t i = 0; i < job->imageCount; ++i) {
+        avifCopyJobBand(job, job->dstImages[i], job->srcImages[i]);
+    }
+}
+
+// Returns the number of bytes of the planes of image selected by planes.
+static uint64_t avifImagePlanesByteCount(const avifImage * image, avifPlanesFlags planes)
+{
+    const uint64_t sampleBytes = avifImageUsesU16(image) ? 2 : 1;
+    uint64_t byteCount = 0;
+    for (int c = AVIF_CHAN_Y; c <= AVIF_CHAN_A; ++c) {
+        const avifBool alpha = c == AVIF_CHAN_A;
+        if (((alpha && (planes & AVIF_PLANES_A)) || (!alpha && (planes & AVIF_PLANES_YUV))) && avifImagePlane(image, c)) {
+            byteCount += (uint64_t)avifImagePlaneWidth(image, c) * avifImagePlaneHeight(image, c) * sampleBytes;
+        }
+    }
+    return byteCount;
+}
+
+avifResult avifImagesCopyAndPadSamples(avifImage * const dstImages[],
+                                       const avifImage * const srcImages[],
+                                       uint32_t imageCount,
+                                       const avifImage * wholeDstImage,
+                                       avifPlanesFlags planes,
+                                       int maxThreads)
+{
+    uint64_t byteCount = 0;
+    uint32_t minHeight = UINT32_MAX;
+    for (uint32_t i = 0; i < imageCount; ++i) {
+        const avifImage * dstImage = dstImages[i];
+        const avifImage * srcImage = srcImages[i];
+        assert(srcImage->depth == dstImage->depth);
+        if (planes & AVIF_PLANES_YUV) {
+            assert(srcImage->yuvFormat == dstImage->yuvFormat);
+            // Note that there may be a mismatch between srcImage->yuvRange and dstImage->yuvRange
+            // because libavif allows for 'colr' and AV1 OBU video range values to differ.
+        }
+        assert(dstImage->width >= srcImage->width && dstImage->height >= srcImage->height);
+        for (int c = AVIF_CHAN_Y; c <= AVIF_CHAN_A; ++c) {
+            const avifBool alpha = c == AVIF_CHAN_A;
+            if ((alpha && (planes & AVIF_PLANES_A)) || (!alpha && (planes & AVIF_PLANES_YUV))) {
+                assert(!avifImagePlane(srcImage, c) == !avifImagePlane(dstImage, c));
+            }
+        }
+        if (srcImage->width != 0 && srcImage->height != 0) {
+            byteCount += avifImagePlanesByteCount(dstImage, planes);
+            minHeight = AVIF_MIN(minHeight, dstImage->height);
+        }
+    }
+    if (byteCount == 0) {
+        return AVIF_RESULT_OK;
+    }
+
+    // The thread count depends on the amount of samples copied by this call.
+    const uint64_t maxJobCount = AVIF_MIN(byteCount / AVIF_COPY_MIN_BYTES_PER_JOB, minHeight);
+    uint32_t jobCount = (uint32_t)AVIF_CLAMP(maxThreads, 1, AVIF_COPY_MAX_JOBS);
+    if (jobCount > maxJobCount) {
+        jobCount = (uint32_t)AVIF_MAX(maxJobCount, 1);
+    }
+    // Whether the destination stays in the cache depends on the whole image written by the calls of a grid.
+    avifCopyRowFunc copyRow = avifCopyRow;
+#if defined(AVIF_SIMD_AVX2)
+    const uint64_t wholeByteCount = avifImagePlanesByteCount(wholeDstImage, planes);
+    if ((wholeByteCount >= AVIF_COPY_MIN_STREAM_BYTES) && (avifGetCPUFeatures() & AVIF_CPU_AVX2)) {
+        copyRow = avifCopyRowStreamAVX2;
+    }
+#else
+    (void)wholeDstImage;
+#endif
+    avifCopyJob jobs[AVIF_COPY_MAX_JOBS];
+    memset(jobs, 0, sizeof(jobs));
+    for (uint32_t jobIndex = 0; jobIndex < jobCount; ++jobIndex) {
+        avifCopyJob * job = &jobs[jobIndex];
+        job->dstImages = dstImages;
+        job->srcImages = srcImages;
+        job->imageCount = imageCount;
+        job->planes = planes;
+        job->copyRow = copyRow;
+        job->jobIndex = jobIndex;
+        job->jobCount = jobCount;
+    }
+    // The calling thread runs the first job.
+    for (uint32_t jobIndex = 1; jobIndex < jobCount; ++jobIndex) {
+        jobs[jobIndex].thread = avifThreadCreate(avifCopyJobWorker, &jobs[jobIndex]);
+        if (jobs[jobIndex].thread == NULL) {
+            avifCopyJobWorker(&jobs[jobIndex]);
+        }
+    }
+    avifCopyJobWorker(&jobs[0]);
+
+    avifResult result = AVIF_RESULT_OK;
+    for (uint32_t jobIndex = 1; jobIndex < jobCount; ++jobIndex) {
+        if (jobs[jobIndex].thread != NULL && !avifThreadJoin(jobs[jobIndex].thread)) {
+            result = AVIF_RESULT_UNKNOWN_ERROR;
         }
     }
+    return result;
+}
+
+avifResult avifImageCopyAndPadSamples(avifImage * dstImage, const avifImage * srcImage, avifPlanesFlags planes, int maxThreads)
+{
+    avifImage * const dstImages[1] = { dstImage };
+    const avifImage * const srcImages[1] = { srcImage };
+    return avifImagesCopyAndPadSamples(dstImages, srcImages, 1, dstImage, planes, maxThreads);
+}
+
+void avifImageCopySamples(avifImage * dstImage, const avifImage * srcImage, avifPlanesFlags planes)
+{
+    assert(srcImage->width == dstImage->width && srcImage->height == dstImage->height);
+    // A single job runs in the calling thread and cannot fail.
+    const avifResult result = avifImageCopyAndPadSamples(dstImage, srcImage, planes, 1);
+    assert(result == AVIF_RESULT_OK);
+    (void)result;
 }
 
 static avifResult avifImageCopyProperties(avifImage * dstImage, const avifImage * srcImage)
@@ -248,7 +450,7 @@ static avifResult avifImageCopyProperties(avifImage * dstImage, const avifImage
     return AVIF_RESULT_OK;
 }
 
-avifResult avifImageCopy(avifImage * dstImage, const avifImage * srcImage, avifPlanesFlags planes)
+avifResult avifImageCopyWithMaxThreads(avifImage * dstImage, const avifImage * srcImage, avifPlanesFlags planes, int maxThreads)
 {
     // Disallow self copy even though it could be supported easily. Self copy is
     // unlikely to be needed, so it almost always indicates a programming error.
@@ -279,7 +481,7 @@ avifResult avifImageCopy(avifImage * dstImage, const avifImage * srcImage, avifP
             return allocationResult;
         }
     }
-    avifImageCopySamples(dstImage, srcImage, planes);
+    AVIF_CHECKRES(avifImageCopyAndPadSamples(dstImage, srcImage, planes, maxThreads));
 
     if (srcImage->gainMap) {
         if (!dstImage->gainMap) {
@@ -309,7 +511,7 @@ avifResult avifImageCopy(avifImage * dstImage, const avifImage * srcImage, avifP
                 dstImage->gainMap->image = avifImageCreateEmpty();
                 AVIF_CHECKERR(dstImage->gainMap->image, AVIF_RESULT_OUT_OF_MEMORY);
             }
-            AVIF_CHECKRES(avifImageCopy(dstImage->gainMap->image, srcImage->gainMap->image, planes));
+            AVIF_CHECKRES(avifImageCopyWithMaxThreads(dstImage->gainMap->image, srcImage->gainMap->image, planes, maxThreads));
         } else if (dstImage->gainMap->image) {
             avifImageDestroy(dstImage->gainMap->image);
             dstImage->gainMap->image = NULL;
@@ -322,6 +524,11 @@ avifResult avifImageCopy(avifImage * dstImage, const avifImage * srcImage, avifP
     return AVIF_RESULT_OK;
 }
 
+avifResult avifImageCopy(avifImage * dstImage, const avifImage * srcImage, avifPlanesFlags planes)
+{
+    return avifImageCopyWithMaxThreads(dstImage, srcImage, planes, 1);
+}
+
 avifResult avifImageSetViewRect(avifImage * dstImage, const avifImage * srcImage, const avifCropRect * rect)
 {
     AVIF_CHECKERR(dstImage != srcImage, AVIF_RESULT_INVALID_ARGUMENT);
@@ -555,6 +762,112 @@ avifBool avifImageUsesU16(const avifImage * image)
     return (image->depth > 8);
 }
 
+// Returns AVIF_TRUE if the bytes of row from x to widthBytes are equal to pattern repeated, x being a multiple of 8.
+// The samples are compared eight bytes at a time against pattern, and the row is only checked once fully scanned, so that
+// the inner loop has no branch.
+static avifBool avifRowIsFilledWith(const uint8_t * row, size_t x, size_t widthBytes, uint64_t pattern)
+{
+    uint64_t diff = 0;
+    for (; x + 4 * sizeof(uint64_t) <= widthBytes; x += 4 * sizeof(uint64_t)) {
+        uint64_t words[4];
+        memcpy(words, row + x, sizeof(words));
+        diff |= (words[0] ^ pattern) | (words[1] ^ pattern) | (words[2] ^ pattern) | (words[3] ^ pattern);
+    }
+    for (; x + sizeof(uint64_t) <= widthBytes; x += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, row + x, sizeof(word));
+        diff |= word ^ pattern;
+    }
+    if (x < widthBytes) {
+        // x is a multiple of 8 so the bytes of pattern are in phase with the remaining samples.
+        uint64_t word = pattern;
+        memcpy(&word, row + x, widthBytes - x);
+        diff |= word ^ pattern;
+    }
+    return diff == 0;
+}
+
+typedef avifBool (*avifRowIsFilledWithFunc)(const uint8_t * row, size_t x, size_t widthBytes, uint64_t pattern);
+
+#if defined(AVIF_SIMD_SSE2)
+// Same as avifRowIsFilledWith() for the leading multiple of 16 bytes of the row.
+static avifBool avifRowIsFilledWithSSE2(const uint8_t * row, size_t x, size_t widthBytes, uint64_t pattern)
+{
+    const __m128i p = _mm_set1_epi64x((long long)pattern);
+    __m128i diff = _mm_setzero_si128();
+    for (; x + 64 <= widthBytes; x += 64) {
+        const __m128i a = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(row + x)), p);
+        const __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(row + x + 16)), p);
+        const __m128i c = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(row + x + 32)), p);
+        const __m128i d = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(row + x + 48)), p);
+        diff = _mm_or_si128(diff, _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)));
+    }
+    for (; x + 16 <= widthBytes; x += 16) {
+        diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(row + x)), p));
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xFFFF) {
+        return AVIF_FALSE;
+    }
+    return avifRowIsFilledWith(row, x, widthBytes, pattern);
+}
+
+#if defined(AVIF_SIMD_AVX2)
+// Same as avifRowIsFilledWith() for the leading multiple of 32 bytes of the row.
+__attribute__((target("avx2"))) static avifBool avifRowIsFilledWithAVX2(const uint8_t * row,
+                                                                       size_t x,
+                                                                       size_t widthBytes,
+                                                                       uint64_t pattern)
+{
+    const __m256i p = _mm256_set1_epi64x((long long)pattern);
+    __m256i diff = _mm256_setzero_si256();
+    for (; x + 128 <= widthBytes; x += 128) {
+        const __m256i a = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(row + x)), p);
+        const __m256i b = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(row + x + 32)), p);
+        const __m256i c = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(row + x + 64)), p);
+        const __m256i d = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(row + x + 96)), p);
+        diff = _mm256_or_si256(diff, _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d)));
+    }
+    for (; x + 32 <= widthBytes; x += 32) {
+        diff = _mm256_or_si256(diff, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(row + x)), p));
+    }
+    if (!_mm256_testz_si256(diff, diff)) {
+        return AVIF_FALSE;
+    }
+    return avifRowIsFilledWith(row, x, widthBytes, pattern);
+}
+#endif // defined(AVIF_SIMD_AVX2)
+#endif // defined(AVIF_SIMD_SSE2)
+
+// Returns AVIF_TRUE if all width x height samples of plane are equal to value.
+static avifBool
+avifPlaneIsFilledWith(const uint8_t * plane, uint32_t rowBytes, uint32_t width, uint32_t height, avifBool usesU16, uint32_t value)
+{
+    // Samples are stored in native endianness, so is the repeated value.
+    const uint64_t pattern = usesU16 ? (uint64_t)(uint16_t)value * 0x0001000100010001ull
+                                     : (uint64_t)(uint8_t)value * 0x0101010101010101ull;
+    const size_t widthBytes = (size_t)width << (usesU16 ? 1 : 0);
+    avifRowIsFilledWithFunc rowIsFilledWith = avifRowIsFilledWith;
+#if defined(AVIF_SIMD_SSE2)
+    const uint32_t cpuFeatures = avifGetCPUFeatures();
+    if (cpuFeatures & AVIF_CPU_SSE2) {
+        rowIsFilledWith = avifRowIsFilledWithSSE2;
+    }
+#if defined(AVIF_SIMD_AVX2)
+    if (cpuFeatures & AVIF_CPU_AVX2) {
+        rowIsFilledWith = avifRowIsFilledWithAVX2;
+    }
+#endif
+#endif
+    const uint8_t * row = plane;
+    for (uint32_t y = 0; y < height; ++y) {
+        if (!rowIsFilledWith(row, 0, widthBytes, pattern)) {
+            return AVIF_FALSE;
+        }
+        row += rowBytes;
+    }
+    return AVIF_TRUE;
+}
+
 avifBool avifImageIsOpaque(const avifImage * image)
 {
     if (!image->alphaPlane) {
@@ -562,25 +875,12 @@ avifBool avifImageIsOpaque(const avifImage * image)
     }
 
     const uint32_t opaqueValue = (1u << image->depth) - 1u;
-    const uint8_t * row = image->alphaPlane;
-    for (uint32_t y = 0; y < image->height; ++y) {
-        if (avifImageUsesU16(image)) {
-            const uint16_t * row16 = (const uint16_t *)row;
-            for (uint32_t x = 0; x < image->width; ++x) {
-                if (row16[x] != opaqueValue) {
-                    return AVIF_FALSE;
-                }
-            }
-        } else {
-            for (uint32_t x = 0; x < image->width; ++x) {
-                if (row[x] != opaqueValue) {
-                    return AVIF_FALSE;
-                }
-            }
-        }
-        row += image->alphaRowBytes;
-    }
-    return AVIF_TRUE;
+    return avifPlaneIsFilledWith(image->alphaPlane,
+                                 image->alphaRowBytes,
+                                 image->width,
+                                 image->height,
+                                 avifImageUsesU16(image),
+                                 opaqueValue);
 }
 
 uint8_t * avifImagePlane(const avifImage * image, int channel)
@@ -694,6 +994,9 @@ uint32_t avifRGBImagePixelSize(const avifRGBImage * rgb)
     if (rgb->format == AVIF_RGB_FORMAT_RGB_565) {
         return 2;
     }
+    if (rgb->format == AVIF_RGB_FORMAT_RGBA1010102) {
+        return 4;
+    }
     return avifRGBFormatChannelCount(rgb->format) * ((rgb->depth > 8) ? 2 : 1);
 }
 
@@ -713,6 +1016,7 @@ void avifRGBImageSetDefaults(avifRGBImage * rgb, const avifImage * image)
                                           // setting this to match image->alphaPremultiplied or forcing this to true
                                           // after calling avifRGBImageSetDefaults(),
     rgb->isFloat = AVIF_FALSE;
+    rgb->toneMapToSDR = AVIF_FALSE;
     rgb->maxThreads = 1;
 }
 
@@ -55,6 +55,18 @@ static void dav1dCodecDestroyInternal(avifCodec * codec)
     avifFree(codec->internal);
 }
 
+static void dav1dCodecFlush(avifCodec * codec)
+{
+    if (codec->internal->hasPicture) {
+        dav1d_picture_unref(&codec->internal->dav1dPicture);
+        codec->internal->hasPicture = AVIF_FALSE;
+    }
+    if (codec->internal->dav1dContext) {
+        // Keeps the settings and the thread pool of the context.
+        dav1d_flush(codec->internal->dav1dContext);
+    }
+}
+
 static avifBool dav1dCodecGetNextImage(struct avifCodec * codec,
                                        const avifDecodeSample * sample,
                                        avifBool alpha,
@@ -238,6 +250,7 @@ avifCodec * avifCodecCreateDav1d(void)
     }
     codec->getNextImage = dav1dCodecGetNextImage;
     codec->destroyInternal = dav1dCodecDestroyInternal;
+    codec->flush = dav1dCodecFlush;
 
     codec->internal = (struct avifCodecInternal *)avifCalloc(1, sizeof(struct avifCodecInternal));
     if (codec->internal == NULL) {
@@ -0,0 +1,558 @@
+// Copyright 2026 Google LLC
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "avif/internal.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(AVIF_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(AVIF_SIMD_AVX2)
+#include <immintrin.h>
+#endif
+
+#define AVIF_PLANE_COUNT (AVIF_CHAN_A + 1)
+
+// The SSIM is the average of the similarities of AVIF_SSIM_WINDOW_SIZE x AVIF_SSIM_WINDOW_SIZE windows,
+// placed every AVIF_SSIM_WINDOW_STEP samples in both directions.
+#define AVIF_SSIM_WINDOW_SIZE 8
+#define AVIF_SSIM_WINDOW_STEP 4
+
+// Same values as in the test helpers, to tell identical planes apart from very similar ones.
+#define AVIF_PSNR_IDENTICAL 99.0
+#define AVIF_PSNR_MAX 98.99
+
+typedef struct avifDistortionPlane
+{
+    const uint8_t * samples1;
+    uint32_t rowBytes1; // 0 if samples1 is a single row repeated over the whole plane.
+    const uint8_t * samples2;
+    uint32_t rowBytes2; // 0 if samples2 is a single row repeated over the whole plane.
+    uint32_t width;
+    uint32_t height;
+} avifDistortionPlane;
+
+typedef struct avifSimilaritySums
+{
+    uint64_t sum1;
+    uint64_t sum2;
+    uint64_t squareSum1;
+    uint64_t squareSum2;
+    uint64_t productSum;
+} avifSimilaritySums;
+
+// Returns the sum of the squared differences of the width samples of row1 and row2.
+typedef uint64_t (*avifSquaredErrorSumFunc)(const uint8_t * row1, const uint8_t * row2, uint32_t width);
+// Adds the sums of the AVIF_SSIM_WINDOW_SIZE x AVIF_SSIM_WINDOW_SIZE window starting at row1 and row2 to sums.
+typedef void (*avifSimilaritySumsAddWindowFunc)(avifSimilaritySums * sums,
+                                                const uint8_t * row1,
+                                                uint32_t rowBytes1,
+                                                const uint8_t * row2,
+                                                uint32_t rowBytes2);
+
+typedef struct avifDistortionContext
+{
+    avifDistortionPlane planes[AVIF_PLANE_COUNT]; // Planes with a width of 0 are not compared.
+    avifBool usesU16;
+    double maxSampleValue;
+    uint32_t jobCount;
+    avifSquaredErrorSumFunc squaredErrorSum;
+    avifSimilaritySumsAddWindowFunc similaritySumsAddWindow; // NULL if there is no SIMD kernel for the sample depth.
+} avifDistortionContext;
+
+typedef struct avifDistortionJob
+{
+    avifThread * thread;
+    const avifDistortionContext * context;
+    uint32_t jobIndex;
+    uint64_t squaredErrorSums[AVIF_PLANE_COUNT];
+    double similaritySums[AVIF_PLANE_COUNT];
+} avifDistortionJob;
+
+// The loops below have no branch nor dependency other than the sum, so that compilers vectorize them.
+
+static uint64_t avifSquaredErrorSum8(const uint8_t * row1, const uint8_t * row2, uint32_t width)
+{
+    uint64_t sum = 0;
+    for (uint32_t x = 0; x < width; ++x) {
+        const int32_t diff = (int32_t)row1[x] - (int32_t)row2[x];
+        sum += (uint32_t)(diff * diff);
+    }
+    return sum;
+}
+
+static uint64_t avifSquaredErrorSum16(const uint8_t * row1, const uint8_t * row2, uint32_t width)
+{
+    const uint16_t * row1_16 = (const uint16_t *)row1;
+    const uint16_t * row2_16 = (const uint16_t *)row2;
+    uint64_t sum = 0;
+    for (uint32_t x = 0; x < width; ++x) {
+        const int64_t diff = (int64_t)row1_16[x] - (int64_t)row2_16[x];
+        sum += (uint64_t)(diff * diff);
+    }
+    return sum;
+}
+
+static void avifSimilaritySumsAddRow8(avifSimilaritySums * sums, const uint8_t * row1, const uint8_t * row2, uint32_t width)
+{
+    uint32_t sum1 = 0, sum2 = 0, squareSum1 = 0, squareSum2 = 0, productSum = 0;
+    for (uint32_t x = 0; x < width; ++x) {
+        const uint32_t a = row1[x];
+        const uint32_t b = row2[x];
+        sum1 += a;
+        sum2 += b;
+        squareSum1 += a * a;
+        squareSum2 += b * b;
+        productSum += a * b;
+    }
+    sums->sum1 += sum1;
+    sums->sum2 += sum2;
+    sums->squareSum1 += squareSum1;
+    sums->squareSum2 += squareSum2;
+    sums->productSum += productSum;
+}
+
+static void avifSimilaritySumsAddRow16(avifSimilaritySums * sums, const uint16_t * row1, const uint16_t * row2, uint32_t width)
+{
+    uint64_t sum1 = 0, sum2 = 0, squareSum1 = 0, squareSum2 = 0, productSum = 0;
+    for (uint32_t x = 0; x < width; ++x) {
+        const uint64_t a = row1[x];
+        const uint64_t b = row2[x];
+        sum1 += a;
+        sum2 += b;
+        squareSum1 += a * a;
+        squareSum2 += b * b;
+        productSum += a * b;
+    }
+    sums->sum1 += sum1;
+    sums->sum2 += sum2;
+    sums->squareSum1 += squareSum1;
+    sums->squareSum2 += squareSum2;
+    sums->productSum += productSum;
+}
+
+#if defined(AVIF_SIMD_SSE2)
+// The kernels below give the same sums as the scalar loops. They work on 16-bit signed integers, so the 16-bit kernels only
+// support a depth of up to 12 bits. Their 32-bit sums are added to 64-bit sums often enough not to overflow.
+
+// Returns the sum of the four 32-bit lanes of v.
+static uint32_t avifHorizontalSum32SSE2(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (uint32_t)_mm_cvtsi128_si32(v);
+}
+
+// Returns the sum of the 32-bit lanes of v, added to the 64-bit lanes of sum.
+static __m128i avifAddWiden32SSE2(__m128i sum, __m128i v)
+{
+    const __m128i zero = _mm_setzero_si128();
+    return _mm_add_epi64(sum, _mm_add_epi64(_mm_unpacklo_epi32(v, zero), _mm_unpackhi_epi32(v, zero)));
+}
+
+static uint64_t avifHorizontalSum64SSE2(__m128i v)
+{
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, v);
+    return lanes[0] + lanes[1];
+}
+
+static uint64_t avifSquaredErrorSum8SSE2(const uint8_t * row1, const uint8_t * row2, uint32_t width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    uint32_t x = 0;
+    while (x + 16 <= width) {
+        // Each 32-bit lane grows by at most 4 * 255 * 255 per iteration.
+        const uint32_t end = x + AVIF_MIN(width - x, 4096 * 16);
+        __m128i sum32 = zero;
+        for (; x + 16 <= end; x += 16) {
+            const __m128i a = _mm_loadu_si128((const __m128i *)(row1 + x));
+            const __m128i b = _mm_loadu_si128((const __m128i *)(row2 + x));
+            const __m128i diffLo = _mm_sub_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            const __m128i diffHi = _mm_sub_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+            sum32 = _mm_add_epi32(sum32, _mm_add_epi32(_mm_madd_epi16(diffLo, diffLo), _mm_madd_epi16(diffHi, diffHi)));
+        }
+        sum = avifAddWiden32SSE2(sum, sum32);
+    }
+    return avifHorizontalSum64SSE2(sum) + avifSquaredErrorSum8(row1 + x, row2 + x, width - x);
+}
+
+static uint64_t avifSquaredErrorSum12SSE2(const uint8_t * row1, const uint8_t * row2, uint32_t width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    uint32_t x = 0;
+    while (x + 8 <= width) {
+        // Each 32-bit lane grows by at most 2 * 4095 * 4095 per iteration.
+        const uint32_t end = x + AVIF_MIN(width - x, 64 * 8);
+        __m128i sum32 = zero;
+        for (; x + 8 <= end; x += 8) {
+            const __m128i a = _mm_loadu_si128((const __m128i *)(row1 + 2 * x));
+            const __m128i b = _mm_loadu_si128((const __m128i *)(row2 + 2 * x));
+            const __m128i diff = _mm_sub_epi16(a, b);
+            sum32 = _mm_add_epi32(sum32, _mm_madd_epi16(diff, diff));
+        }
+        sum = avifAddWiden32SSE2(sum, sum32);
+    }
+    return avifHorizontalSum64SSE2(sum) + avifSquaredErrorSum16(row1 + 2 * x, row2 + 2 * x, width - x);
+}
+
+// Loads the AVIF_SSIM_WINDOW_SIZE samples of a window row to 16-bit lanes.
+static inline __m128i avifLoadWindowRowSSE2(const uint8_t * row, avifBool usesU16)
+{
+    if (usesU16) {
+        return _mm_loadu_si128((const __m128i *)row);
+    }
+    return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)row), _mm_setzero_si128());
+}
+
+// Each 32-bit lane grows by at most 2 * 4095 * 4095 per window row.
+static inline void avifSimilaritySumsAddWindowSSE2(avifSimilaritySums * sums,
+                                                   const uint8_t * row1,
+                                                   uint32_t rowBytes1,
+                                                   const uint8_t * row2,
+                                                   uint32_t rowBytes2,
+                                                   avifBool usesU16)
+{
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i sum1 = _mm_setzero_si128();
+    __m128i sum2 = sum1, squareSum1 = sum1, squareSum2 = sum1, productSum = sum1;
+    for (int j = 0; j < AVIF_SSIM_WINDOW_SIZE; ++j) {
+        const __m128i a = avifLoadWindowRowSSE2(row1, usesU16);
+        const __m128i b = avifLoadWindowRowSSE2(row2, usesU16);
+        sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(a, ones));
+        sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(b, ones));
+        squareSum1 = _mm_add_epi32(squareSum1, _mm_madd_epi16(a, a));
+        squareSum2 = _mm_add_epi32(squareSum2, _mm_madd_epi16(b, b));
+        productSum = _mm_add_epi32(productSum, _mm_madd_epi16(a, b));
+        row1 += rowBytes1;
+        row2 += rowBytes2;
+    }
+    sums->sum1 += avifHorizontalSum32SSE2(sum1);
+    sums->sum2 += avifHorizontalSum32SSE2(sum2);
+    sums->squareSum1 += avifHorizontalSum32SSE2(squareSum1);
+    sums->squareSum2 += avifHorizontalSum32SSE2(squareSum2);
+    sums->productSum += avifHorizontalSum32SSE2(productSum);
+}
+
+static void avifSimilaritySumsAddWindow8SSE2(avifSimilaritySums * sums,
+                                             const uint8_t * row1,
+                                             uint32_t rowBytes1,
+                                             const uint8_t * row2,
+                                             uint32_t rowBytes2)
+{
+    avifSimilaritySumsAddWindowSSE2(sums, row1, rowBytes1, row2, rowBytes2, AVIF_FALSE);
+}
+
+static void avifSimilaritySumsAddWindow12SSE2(avifSimilaritySums * sums,
+                                              const uint8_t * row1,
+                                              uint32_t rowBytes1,
+                                              const uint8_t * row2,
+                                              uint32_t rowBytes2)
+{
+    avifSimilaritySumsAddWindowSSE2(sums, row1, rowBytes1, row2, rowBytes2, AVIF_TRUE);
+}
+
+#if defined(AVIF_SIMD_AVX2)
+__attribute__((target("avx2"))) static uint64_t avifHorizontalSum64AVX2(__m256i v)
+{
+    return avifHorizontalSum64SSE2(_mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+}
+
+// Returns the sum of the 32-bit lanes of v, added to the 64-bit lanes of sum.
+__attribute__((target("avx2"))) static __m256i avifAddWiden32AVX2(__m256i sum, __m256i v)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    return _mm256_add_epi64(sum, _mm256_add_epi64(_mm256_unpacklo_epi32(v, zero), _mm256_unpackhi_epi32(v, zero)));
+}
+
+__attribute__((target("avx2"))) static uint64_t avifSquaredErrorSum8AVX2(const uint8_t * row1,
+                                                                        const uint8_t * row2,
+                                                                        uint32_t width)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sum = zero;
+    uint32_t x = 0;
+    while (x + 32 <= width) {
+        // Each 32-bit lane grows by at most 4 * 255 * 255 per iteration.
+        const uint32_t end = x + AVIF_MIN(width - x, 4096 * 32);
+        __m256i sum32 = zero;
+        for (; x + 32 <= end; x += 32) {
+            const __m256i a = _mm256_loadu_si256((const __m256i *)(row1 + x));
+            const __m256i b = _mm256_loadu_si256((const __m256i *)(row2 + x));
+            const __m256i diffLo = _mm256_sub_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+            const __m256i diffHi = _mm256_sub_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+            const __m256i squaresLo = _mm256_madd_epi16(diffLo, diffLo);
+            const __m256i squaresHi = _mm256_madd_epi16(diffHi, diffHi);
+            sum32 = _mm256_add_epi32(sum32, _mm256_add_epi32(squaresLo, squaresHi));
+        }
+        sum = avifAddWiden32AVX2(sum, sum32);
+    }
+    return avifHorizontalSum64AVX2(sum) + avifSquaredErrorSum8SSE2(row1 + x, row2 + x, width - x);
+}
+
+__attribute__((target("avx2"))) static uint64_t avifSquaredErrorSum12AVX2(const uint8_t * row1,
+                                                                         const uint8_t * row2,
+                                                                         uint32_t width)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sum = zero;
+    uint32_t x = 0;
+    while (x + 16 <= width) {
+        // Each 32-bit lane grows by at most 2 * 4095 * 4095 per iteration.
+        const uint32_t end = x + AVIF_MIN(width - x, 64 * 16);
+        __m256i sum32 = zero;
+        for (; x + 16 <= end; x += 16) {
+            const __m256i a = _mm256_loadu_si256((const __m256i *)(row1 + 2 * x));
+            const __m256i b = _mm256_loadu_si256((const __m256i *)(row2 + 2 * x));
+            const __m256i diff = _mm256_sub_epi16(a, b);
+            sum32 = _mm256_add_epi32(sum32, _mm256_madd_epi16(diff, diff));
+        }
+        sum = avifAddWiden32AVX2(sum, sum32);
+    }
+    return avifHorizontalSum64AVX2(sum) + avifSquaredErrorSum12SSE2(row1 + 2 * x, row2 + 2 * x, width - x);
+}
+#endif // defined(AVIF_SIMD_AVX2)
+#endif // defined(AVIF_SIMD_SSE2)
+
+// Returns the structural similarity of the window of size windowWidth x windowHeight at (x, y).
+static double avifWindowSimilarity(const avifDistortionContext * context,
+                                   const avifDistortionPlane * plane,
+                                   uint32_t x,
+                                   uint32_t y,
+                                   uint32_t windowWidth,
+                                   uint32_t windowHeight)
+{
+    avifSimilaritySums sums;
+    memset(&sums, 0, sizeof(sums));
+    const size_t xOffset = (size_t)x << (context->usesU16 ? 1 : 0);
+    if (context->similaritySumsAddWindow != NULL && windowWidth == AVIF_SSIM_WINDOW_SIZE &&
+        windowHeight == AVIF_SSIM_WINDOW_SIZE) {
+        context->similaritySumsAddWindow(&sums,
+                                         plane->samples1 + (size_t)y * plane->rowBytes1 + xOffset,
+                                         plane->rowBytes1,
+                                         plane->samples2 + (size_t)y * plane->rowBytes2 + xOffset,
+                                         plane->rowBytes2);
+    } else {
+        for (uint32_t j = y; j < y + windowHeight; ++j) {
+            const uint8_t * row1 = plane->samples1 + (size_t)j * plane->rowBytes1 + xOffset;
+            const uint8_t * row2 = plane->samples2 + (size_t)j * plane->rowBytes2 + xOffset;
+            if (context->usesU16) {
+                avifSimilaritySumsAddRow16(&sums, (const uint16_t *)row1, (const uint16_t *)row2, windowWidth);
+            } else {
+                avifSimilaritySumsAddRow8(&sums, row1, row2, windowWidth);
+            }
+        }
+    }
+
+    // See "Image Quality Assessment: From Error Visibility to Structural Similarity", Z. Wang et al., 2004.
+    const double count = (double)windowWidth * windowHeight;
+    const double mean1 = sums.sum1 / count;
+    const double mean2 = sums.sum2 / count;
+    const double variance1 = sums.squareSum1 / count - mean1 * mean1;
+    const double variance2 = sums.squareSum2 / count - mean2 * mean2;
+    const double covariance = sums.productSum / count - mean1 * mean2;
+    const double c1 = (0.01 * context->maxSampleValue) * (0.01 * context->maxSampleValue);
+    const double c2 = (0.03 * context->maxSampleValue) * (0.03 * context->maxSampleValue);
+    return ((2 * mean1 * mean2 + c1) * (2 * covariance + c2)) /
+           ((mean1 * mean1 + mean2 * mean2 + c1) * (variance1 + variance2 + c2));
+}
+
+static uint32_t avifWindowSize(uint32_t planeSize)
+{
+    return AVIF_MIN(planeSize, AVIF_SSIM_WINDOW_SIZE);
+}
+
+// Returns the number of windows along a plane dimension.
+static uint32_t avifWindowCount(uint32_t planeSize)
+{
+    return (planeSize - avifWindowSize(planeSize)) / AVIF_SSIM_WINDOW_STEP + 1;
+}
+
+// Each job processes the rows and the rows of windows of a horizontal band of each plane.
+static void avifDistortionJobWorker(void * arg)
+{
+    avifDistortionJob * job = (avifDistortionJob *)arg;
+    const avifDistortionContext * context = job->context;
+    for (int c = 0; c < AVIF_PLANE_COUNT; ++c) {
+        const avifDistortionPlane * plane = &context->planes[c];
+        if (plane->width == 0) {
+            continue;
+        }
+
+        const uint32_t firstRow = (uint32_t)((uint64_t)plane->height * job->jobIndex / context->jobCount);
+        const uint32_t lastRow = (uint32_t)((uint64_t)plane->height * (job->jobIndex + 1) / context->jobCount);
+        uint64_t squaredErrorSum = 0;
+        for (uint32_t y = firstRow; y < lastRow; ++y) {
+            const uint8_t * row1 = plane->samples1 + (size_t)y * plane->rowBytes1;
+            const uint8_t * row2 = plane->samples2 + (size_t)y * plane->rowBytes2;
+            squaredErrorSum += context->squaredErrorSum(row1, row2, plane->width);
+        }
+        job->squaredErrorSums[c] = squaredErrorSum;
+
+        const uint32_t windowWidth = avifWindowSize(plane->width);
+        const uint32_t windowHeight = avifWindowSize(plane->height);
+        const uint32_t windowColumns = avifWindowCount(plane->width);
+        const uint32_t windowRows = avifWindowCount(plane->height);
+        const uint32_t firstWindowRow = (uint32_t)((uint64_t)windowRows * job->jobIndex / context->jobCount);
+        const uint32_t lastWindowRow = (uint32_t)((uint64_t)windowRows * (job->jobIndex + 1) / context->jobCount);
+        double similaritySum = 0;
+        for (uint32_t j = firstWindowRow; j < lastWindowRow; ++j) {
+            for (uint32_t i = 0; i < windowColumns; ++i) {
+                similaritySum += avifWindowSimilarity(context,
+                                                      plane,
+                                                      i * AVIF_SSIM_WINDOW_STEP,
+                                                      j * AVIF_SSIM_WINDOW_STEP,
+                                                      windowWidth,
+                                                      windowHeight);
+            }
+        }
+        job->similaritySums[c] = similaritySum;
+    }
+}
+
+static double avifPsnr(uint64_t squaredErrorSum, uint64_t sampleCount, double maxSampleValue)
+{
+    if (squaredErrorSum == 0) {
+        return AVIF_PSNR_IDENTICAL;
+    }
+    const double normalizedError = (double)squaredErrorSum / ((double)sampleCount * maxSampleValue * maxSampleValue);
+    return AVIF_MIN(-10.0 * log10(normalizedError), AVIF_PSNR_MAX);
+}
+
+avifResult avifImageComputeDistortion(const avifImage * image1,
+                                      const avifImage * image2,
+                                      avifPlanesFlags planes,
+                                      int maxThreads,
+                                      avifImageDistortion * distortion)
+{
+    memset(distortion, 0, sizeof(*distortion));
+    AVIF_CHECKERR(image1->width == image2->width && image1->height == image2->height && image1->width != 0 && image1->height != 0,
+                  AVIF_RESULT_INVALID_ARGUMENT);
+    AVIF_CHECKERR(image1->depth == image2->depth && image1->yuvFormat == image2->yuvFormat &&
+                      image1->yuvRange == image2->yuvRange,
+                  AVIF_RESULT_INVALID_ARGUMENT);
+
+    avifDistortionContext context;
+    memset(&context, 0, sizeof(context));
+    context.usesU16 = avifImageUsesU16(image1);
+    context.maxSampleValue = (double)((1u << image1->depth) - 1u);
+    context.squaredErrorSum = context.usesU16 ? avifSquaredErrorSum16 : avifSquaredErrorSum8;
+#if defined(AVIF_SIMD_SSE2)
+    const uint32_t cpuFeatures = avifGetCPUFeatures();
+    const avifBool simdDepth = image1->depth <= 12;
+    if ((cpuFeatures & AVIF_CPU_SSE2) && simdDepth) {
+        context.squaredErrorSum = context.usesU16 ? avifSquaredErrorSum12SSE2 : avifSquaredErrorSum8SSE2;
+        context.similaritySumsAddWindow = context.usesU16 ? avifSimilaritySumsAddWindow12SSE2 : avifSimilaritySumsAddWindow8SSE2;
+    }
+#if defined(AVIF_SIMD_AVX2)
+    if ((cpuFeatures & AVIF_CPU_AVX2) && simdDepth) {
+        context.squaredErrorSum = context.usesU16 ? avifSquaredErrorSum12AVX2 : avifSquaredErrorSum8AVX2;
+    }
+#endif
+#endif
+
+    if (planes & AVIF_PLANES_YUV) {
+        AVIF_CHECKERR(image1->yuvPlanes[AVIF_CHAN_Y] != NULL && image2->yuvPlanes[AVIF_CHAN_Y] != NULL, AVIF_RESULT_NO_CONTENT);
+        for (int c = AVIF_CHAN_Y; c <= AVIF_CHAN_V; ++c) {
+            const uint8_t * samples1 = avifImagePlane(image1, c);
+            const uint8_t * samples2 = avifImagePlane(image2, c);
+            AVIF_CHECKERR((samples1 == NULL) == (samples2 == NULL), AVIF_RESULT_INVALID_ARGUMENT);
+            if (samples1 != NULL) {
+                avifDistortionPlane * plane = &context.planes[c];
+                plane->samples1 = samples1;
+                plane->rowBytes1 = avifImagePlaneRowBytes(image1, c);
+                plane->samples2 = samples2;
+                plane->rowBytes2 = avifImagePlaneRowBytes(image2, c);
+                plane->width = avifImagePlaneWidth(image1, c);
+                plane->height = avifImagePlaneHeight(image1, c);
+            }
+        }
+    }
+
+    // A missing alpha plane is considered opaque.
+    uint8_t * opaqueRow = NULL;
+    if ((planes & AVIF_PLANES_A) && (image1->alphaPlane != NULL || image2->alphaPlane != NULL)) {
+        avifDistortionPlane * plane = &context.planes[AVIF_CHAN_A];
+        plane->width = image1->width;
+        plane->height = image1->height;
+        if (image1->alphaPlane == NULL || image2->alphaPlane == NULL) {
+            opaqueRow = (uint8_t *)avifAlloc((size_t)image1->width << (context.usesU16 ? 1 : 0));
+            AVIF_CHECKERR(opaqueRow != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+            if (context.usesU16) {
+                for (uint32_t x = 0; x < image1->width; ++x) {
+                    ((uint16_t *)opaqueRow)[x] = (uint16_t)context.maxSampleValue;
+                }
+            } else {
+                memset(opaqueRow, 255, image1->width);
+            }
+        }
+        plane->samples1 = image1->alphaPlane ? image1->alphaPlane : opaqueRow;
+        plane->rowBytes1 = image1->alphaPlane ? image1->alphaRowBytes : 0;
+        plane->samples2 = image2->alphaPlane ? image2->alphaPlane : opaqueRow;
+        plane->rowBytes2 = image2->alphaPlane ? image2->alphaRowBytes : 0;
+    }
+
+    // Give each job at least a few rows of windows of the luma plane.
+    const uint32_t maxJobCount = AVIF_MAX(1u, avifWindowCount(image1->height) / 4);
+    context.jobCount = AVIF_MIN((uint32_t)AVIF_CLAMP(maxThreads, 1, 64), maxJobCount);
+    avifDistortionJob * jobs = (avifDistortionJob *)avifAlloc(sizeof(avifDistortionJob) * context.jobCount);
+    if (jobs == NULL) {
+        avifFree(opaqueRow);
+        return AVIF_RESULT_OUT_OF_MEMORY;
+    }
+    memset(jobs, 0, sizeof(avifDistortionJob) * context.jobCount);
+    for (uint32_t jobIndex = 0; jobIndex < context.jobCount; ++jobIndex) {
+        jobs[jobIndex].context = &context;
+        jobs[jobIndex].jobIndex = jobIndex;
+    }
+    // The calling thread runs the first job.
+    for (uint32_t jobIndex = 1; jobIndex < context.jobCount; ++jobIndex) {
+        jobs[jobIndex].thread = avifThreadCreate(avifDistortionJobWorker, &jobs[jobIndex]);
+        if (jobs[jobIndex].thread == NULL) {
+            avifDistortionJobWorker(&jobs[jobIndex]);
+        }
+    }
+    avifDistortionJobWorker(&jobs[0]);
+
+    avifResult result = AVIF_RESULT_OK;
+    uint64_t squaredErrorSums[AVIF_PLANE_COUNT] = { 0 };
+    double similaritySums[AVIF_PLANE_COUNT] = { 0 };
+    for (uint32_t jobIndex = 0; jobIndex < context.jobCount; ++jobIndex) {
+        const avifDistortionJob * job = &jobs[jobIndex];
+        if (job->thread != NULL && !avifThreadJoin(job->thread)) {
+            result = AVIF_RESULT_UNKNOWN_ERROR;
+        }
+        for (int c = 0; c < AVIF_PLANE_COUNT; ++c) {
+            squaredErrorSums[c] += job->squaredErrorSums[c];
+            similaritySums[c] += job->similaritySums[c];
+        }
+    }
+    avifFree(jobs);
+    avifFree(opaqueRow);
+    AVIF_CHECKRES(result);
+
+    uint64_t totalSquaredErrorSum = 0;
+    uint64_t totalSampleCount = 0;
+    double weightedSsimSum = 0;
+    for (int c = 0; c < AVIF_PLANE_COUNT; ++c) {
+        const avifDistortionPlane * plane = &context.planes[c];
+        if (plane->width == 0) {
+            continue;
+        }
+        const uint64_t sampleCount = (uint64_t)plane->width * plane->height;
+        distortion->psnr[c] = avifPsnr(squaredErrorSums[c], sampleCount, context.maxSampleValue);
+        distortion->ssim[c] = similaritySums[c] / ((double)avifWindowCount(plane->width) * avifWindowCount(plane->height));
+        totalSquaredErrorSum += squaredErrorSums[c];
+        totalSampleCount += sampleCount;
+        weightedSsimSum += distortion->ssim[c] * (double)sampleCount;
+    }
+    if (totalSampleCount != 0) {
+        distortion->psnrAll = avifPsnr(totalSquaredErrorSum, totalSampleCount, context.maxSampleValue);
+        distortion->ssimAll = weightedSsimSum / (double)totalSampleCount;
+    }
+    return AVIF_RESULT_OK;
+}
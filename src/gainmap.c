@@ -190,12 +190,12 @@ avifResult avifRGBImageApplyGainMap(const avifRGBImage * baseImage,
             res = AVIF_RESULT_OUT_OF_MEMORY;
             goto cleanup;
         }
-        const avifCropRect rect = { 0, 0, gainMap->image->width, gainMap->image->height };
-        res = avifImageSetViewRect(rescaledGainMap, gainMap->image, &rect);
-        if (res != AVIF_RESULT_OK) {
-            goto cleanup;
-        }
-        res = avifImageScale(rescaledGainMap, width, height, diag);
+        // Gain maps are usually smaller than the base image and smooth, so bilinear upscaling is enough. The same scaler
+        // is used whatever the thread count, so that the output does not depend on it.
+        avifImageCopyNoAlloc(rescaledGainMap, gainMap->image);
+        rescaledGainMap->width = width;
+        rescaledGainMap->height = height;
+        res = avifImageScaleInto(gainMap->image, rescaledGainMap, AVIF_SCALE_FILTER_BILINEAR, toneMappedImage->maxThreads, diag);
         if (res != AVIF_RESULT_OK) {
             goto cleanup;
         }
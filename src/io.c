@@ -246,3 +246,67 @@ avifIO * avifIOCreateFileReader(const char * filename)
     }
     return (avifIO *)reader;
 }
+
+// --------------------------------------------------------------------------------------
+// avifIOFileWriter
+
+typedef struct avifIOFileWriter
+{
+    avifIO io; // this must be the first member for easy casting to avifIO*
+    FILE * f;
+} avifIOFileWriter;
+
+static avifResult avifIOFileWriterWrite(struct avifIO * io,
+                                        uint32_t writeFlags,
+                                        uint64_t offset,
+                                        const uint8_t * data,
+                                        size_t size)
+{
+    if (writeFlags != 0) {
+        // Unsupported writeFlags
+        return AVIF_RESULT_IO_ERROR;
+    }
+
+    avifIOFileWriter * writer = (avifIOFileWriter *)io;
+    if (offset > AVIF_OFF_MAX) {
+        return AVIF_RESULT_IO_ERROR;
+    }
+    if (avif_fseeko(writer->f, (avif_off_t)offset, SEEK_SET) != 0) {
+        return AVIF_RESULT_IO_ERROR;
+    }
+    if (size > 0 && fwrite(data, 1, size, writer->f) != size) {
+        return AVIF_RESULT_IO_ERROR;
+    }
+    // The encoder writes the beginning of the file last, once it is complete (see avifEncoderSetIO()). The file is not
+    // valid before that, so flushing earlier writes would only cost a system call each.
+    if (offset == 0 && fflush(writer->f) != 0) {
+        return AVIF_RESULT_IO_ERROR;
+    }
+    return AVIF_RESULT_OK;
+}
+
+static void avifIOFileWriterDestroy(struct avifIO * io)
+{
+    avifIOFileWriter * writer = (avifIOFileWriter *)io;
+    fclose(writer->f);
+    avifFree(io);
+}
+
+avifIO * avifIOCreateFileWriter(const char * filename)
+{
+    FILE * f = fopen(filename, "wb");
+    if (!f) {
+        return NULL;
+    }
+
+    avifIOFileWriter * writer = (avifIOFileWriter *)avifCalloc(1, sizeof(avifIOFileWriter));
+    if (!writer) {
+        fclose(f);
+        return NULL;
+    }
+    writer->f = f;
+    writer->io.destroy = avifIOFileWriterDestroy;
+    writer->io.write = avifIOFileWriterWrite;
+    writer->io.persistent = AVIF_FALSE;
+    return (avifIO *)writer;
+}
@@ -809,6 +809,12 @@ typedef struct avifMeta
     // and are then further modified/updated as new information for an item's ID is parsed.
     avifDecoderItemArray items;
 
+    // Open addressing hash table with linear probing, mapping item IDs to the elements of |items|.
+    // Files with large grids have hundreds of items that are looked up by ID from many boxes.
+    // itemIndexCapacity is 0 or a power of two, and the table is kept at most half full.
+    avifDecoderItem ** itemIndex;
+    uint32_t itemIndexCapacity;
+
     // Any ipco boxes explained above are populated into this array as a staging area, which are
     // then duplicated into the appropriate items upon encountering an item property association
     // (ipma) box.
@@ -876,6 +882,7 @@ static void avifMetaDestroy(avifMeta * meta)
         avifFree(item);
     }
     avifArrayDestroy(&meta->items);
+    avifFree(meta->itemIndex);
     avifPropertyArrayDestroy(&meta->properties);
     avifRWDataFree(&meta->idat);
     avifArrayDestroy(&meta->sampleTransformExpression);
@@ -903,18 +910,67 @@ static avifResult avifCheckItemID(const char * boxFourcc, uint32_t itemID, avifD
     return AVIF_RESULT_OK;
 }
 
+// Returns the first slot of the probing sequence of itemID in meta->itemIndex.
+static uint32_t avifMetaItemIndexSlot(const avifMeta * meta, uint32_t itemID)
+{
+    // Fibonacci hashing spreads consecutive IDs, which are the most common.
+    return (uint32_t)(itemID * 2654435769u) & (meta->itemIndexCapacity - 1);
+}
+
+// Returns the item with the given ID, or NULL if there is none.
+static avifDecoderItem * avifMetaFindItem(const avifMeta * meta, uint32_t itemID)
+{
+    if (meta->itemIndexCapacity == 0) {
+        return NULL;
+    }
+    for (uint32_t slot = avifMetaItemIndexSlot(meta, itemID);; slot = (slot + 1) & (meta->itemIndexCapacity - 1)) {
+        avifDecoderItem * item = meta->itemIndex[slot];
+        if (item == NULL || item->id == itemID) {
+            return item;
+        }
+    }
+}
+
+static void avifMetaItemIndexInsert(avifMeta * meta, avifDecoderItem * item)
+{
+    uint32_t slot = avifMetaItemIndexSlot(meta, item->id);
+    while (meta->itemIndex[slot] != NULL) {
+        slot = (slot + 1) & (meta->itemIndexCapacity - 1);
+    }
+    meta->itemIndex[slot] = item;
+}
+
+// Makes sure meta->itemIndex can hold one more item than meta->items.count without exceeding half of its capacity.
+static avifResult avifMetaReserveItemIndex(avifMeta * meta)
+{
+    if (meta->itemIndexCapacity != 0 && meta->items.count < meta->itemIndexCapacity / 2) {
+        return AVIF_RESULT_OK;
+    }
+    AVIF_CHECKERR(meta->itemIndexCapacity <= UINT32_MAX / 4, AVIF_RESULT_OUT_OF_MEMORY);
+    const uint32_t capacity = meta->itemIndexCapacity == 0 ? 16 : meta->itemIndexCapacity * 2;
+    avifDecoderItem ** itemIndex = (avifDecoderItem **)avifAlloc(sizeof(avifDecoderItem *) * capacity);
+    AVIF_CHECKERR(itemIndex != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+    memset(itemIndex, 0, sizeof(avifDecoderItem *) * capacity);
+    avifFree(meta->itemIndex);
+    meta->itemIndex = itemIndex;
+    meta->itemIndexCapacity = capacity;
+    for (uint32_t i = 0; i < meta->items.count; ++i) {
+        avifMetaItemIndexInsert(meta, meta->items.item[i]);
+    }
+    return AVIF_RESULT_OK;
+}
+
 static avifResult avifMetaFindOrCreateItem(avifMeta * meta, uint32_t itemID, avifDecoderItem ** item)
 {
     *item = NULL;
     AVIF_ASSERT_OR_RETURN(itemID != 0);
 
-    for (uint32_t i = 0; i < meta->items.count; ++i) {
-        if (meta->items.item[i]->id == itemID) {
-            *item = meta->items.item[i];
-            return AVIF_RESULT_OK;
-        }
+    *item = avifMetaFindItem(meta, itemID);
+    if (*item != NULL) {
+        return AVIF_RESULT_OK;
     }
 
+    AVIF_CHECKRES(avifMetaReserveItemIndex(meta));
     avifDecoderItem ** itemPtr = (avifDecoderItem **)avifArrayPush(&meta->items);
     AVIF_CHECKERR(itemPtr != NULL, AVIF_RESULT_OUT_OF_MEMORY);
     *item = (avifDecoderItem *)avifAlloc(sizeof(avifDecoderItem));
@@ -940,6 +996,7 @@ static avifResult avifMetaFindOrCreateItem(avifMeta * meta, uint32_t itemID, avi
     }
     (*item)->id = itemID;
     (*item)->meta = meta;
+    avifMetaItemIndexInsert(meta, *item);
     return AVIF_RESULT_OK;
 }
 
@@ -952,6 +1009,25 @@ typedef struct avifTileInfo
     avifImageGrid grid;
 } avifTileInfo;
 
+// The state of avifParse() between two top-level boxes. Top-level boxes are only interpreted once they were
+// entirely read, so parsing can resume from this state after the avifIO returned AVIF_RESULT_WAITING_ON_IO.
+typedef struct avifParseProgress
+{
+    avifBool complete; // avifParse() returned AVIF_RESULT_OK
+    uint64_t offset;   // Offset of the next top-level box header
+    uint8_t ftypMinorVersion[4];
+    avifBool ftypSeen;
+    avifBool metaSeen;
+    avifBool metaIsSizeZero;
+    avifBool moovSeen;
+    avifBool needsMeta;
+    avifBool needsMoov;
+    avifBool miniSeen;
+    avifBool needsMini;
+    avifBool needsTmap;
+    avifBool tmapSeen;
+} avifParseProgress;
+
 typedef struct avifDecoderData
 {
     avifMeta * meta; // The root-level meta box
@@ -973,6 +1049,10 @@ typedef struct avifDecoderData
     //   decoder instance (same as above).
     avifCodec * codec;
     avifCodec * codecAlpha;
+    // Flushed codec instances kept for the next call to avifDecoderCreateCodecs() when avifDecoder::reuseCodecs
+    // is true. Handed over to the next avifDecoderData by avifDecoderParse().
+    avifCodecArray spareCodecs;
+    avifBool reuseCodecs; // avifDecoder::reuseCodecs at the last call to avifDecoderCreateCodecs()
     uint8_t majorBrand[4];                     // From the file's ftyp, used by AVIF_DECODER_SOURCE_AUTO
     avifBrandArray compatibleBrands;           // From the file's ftyp
     avifDiagnostics * diag;                    // Shallow copy; owned by avifDecoder
@@ -988,8 +1068,30 @@ typedef struct avifDecoderData
     // Colour items only. The alpha items are implicit.
     uint8_t sampleTransformNumInputImageItems; // At most AVIF_SAMPLE_TRANSFORM_MAX_NUM_INPUT_IMAGE_ITEMS.
     avifItemCategory sampleTransformInputImageItems[AVIF_SAMPLE_TRANSFORM_MAX_NUM_INPUT_IMAGE_ITEMS];
+
+    avifParseProgress parseProgress; // Checkpoint of avifParse() at the last top-level box boundary
+    avifBool parseResumable;         // True if the last avifDecoderParse() call returned AVIF_RESULT_WAITING_ON_IO
+    avifBool ioWaiting;              // True if the last read returned AVIF_RESULT_WAITING_ON_IO
+    avifExtent ioWaitExtent;         // The range that was requested by that read
+
+    // Number of top rows of the current frame already converted to avifDecoder::rgbOutput
+    // and reported to avifDecoder::rowsReady.
+    uint32_t outputRowCount;
 } avifDecoderData;
 
+// Calls io->read() and remembers the requested range if the avifIO returns AVIF_RESULT_WAITING_ON_IO,
+// so that it can be reported by avifDecoderGetIOWaitExtent().
+static avifResult avifDecoderDataRead(avifDecoderData * data, avifIO * io, uint64_t offset, size_t size, avifROData * out)
+{
+    const avifResult result = io->read(io, 0, offset, size, out);
+    if (result == AVIF_RESULT_WAITING_ON_IO) {
+        data->ioWaiting = AVIF_TRUE;
+        data->ioWaitExtent.offset = offset;
+        data->ioWaitExtent.size = size;
+    }
+    return result;
+}
+
 static void avifDecoderDataDestroy(avifDecoderData * data);
 
 static avifDecoderData * avifDecoderDataCreate(void)
@@ -1001,13 +1103,40 @@ static avifDecoderData * avifDecoderDataCreate(void)
     memset(data, 0, sizeof(avifDecoderData));
     data->meta = avifMetaCreate();
     if (data->meta == NULL || !avifArrayCreate(&data->tracks, sizeof(avifTrack), 2) ||
-        !avifArrayCreate(&data->tiles, sizeof(avifTile), 8)) {
+        !avifArrayCreate(&data->tiles, sizeof(avifTile), 8) || !avifArrayCreate(&data->spareCodecs, sizeof(avifCodec *), 2)) {
         avifDecoderDataDestroy(data);
         return NULL;
     }
     return data;
 }
 
+// Destroys the codec instance, or keeps it in data->spareCodecs if it can be reused.
+static void avifDecoderDataReleaseCodec(avifDecoderData * data, avifCodec * codec)
+{
+    if (data->reuseCodecs && codec->flush) {
+        avifCodec ** spareCodec = (avifCodec **)avifArrayPush(&data->spareCodecs);
+        if (spareCodec != NULL) {
+            codec->flush(codec);
+            *spareCodec = codec;
+            return;
+        }
+    }
+    avifCodecDestroy(codec);
+}
+
+static void avifDecoderDataDestroySpareCodecs(avifDecoderData * data)
+{
+    for (uint32_t i = 0; i < data->spareCodecs.count; ++i) {
+        avifCodecDestroy(data->spareCodecs.codec[i]);
+    }
+    data->spareCodecs.count = 0;
+}
+
+uint32_t avifDecoderSpareCodecCount(const avifDecoder * decoder)
+{
+    return decoder->data ? decoder->data->spareCodecs.count : 0;
+}
+
 static void avifDecoderDataResetCodec(avifDecoderData * data)
 {
     for (unsigned int i = 0; i < data->tiles.count; ++i) {
@@ -1018,7 +1147,7 @@ static void avifDecoderDataResetCodec(avifDecoderData * data)
         if (tile->codec) {
             // Check if tile->codec was created separately and destroy it in that case.
             if (tile->codec != data->codec && tile->codec != data->codecAlpha) {
-                avifCodecDestroy(tile->codec);
+                avifDecoderDataReleaseCodec(data, tile->codec);
             }
             tile->codec = NULL;
         }
@@ -1026,12 +1155,13 @@ static void avifDecoderDataResetCodec(avifDecoderData * data)
     for (int c = 0; c < AVIF_ITEM_CATEGORY_COUNT; ++c) {
         data->tileInfos[c].decodedTileCount = 0;
     }
+    data->outputRowCount = 0;
     if (data->codec) {
-        avifCodecDestroy(data->codec);
+        avifDecoderDataReleaseCodec(data, data->codec);
         data->codec = NULL;
     }
     if (data->codecAlpha) {
-        avifCodecDestroy(data->codecAlpha);
+        avifDecoderDataReleaseCodec(data, data->codecAlpha);
         data->codecAlpha = NULL;
     }
 }
@@ -1092,7 +1222,7 @@ static void avifDecoderDataClearTiles(avifDecoderData * data)
         if (tile->codec) {
             // Check if tile->codec was created separately and destroy it in that case.
             if (tile->codec != data->codec && tile->codec != data->codecAlpha) {
-                avifCodecDestroy(tile->codec);
+                avifDecoderDataReleaseCodec(data, tile->codec);
             }
             tile->codec = NULL;
         }
@@ -1106,12 +1236,13 @@ static void avifDecoderDataClearTiles(avifDecoderData * data)
         data->tileInfos[c].tileCount = 0;
         data->tileInfos[c].decodedTileCount = 0;
     }
+    data->outputRowCount = 0;
     if (data->codec) {
-        avifCodecDestroy(data->codec);
+        avifDecoderDataReleaseCodec(data, data->codec);
         data->codec = NULL;
     }
     if (data->codecAlpha) {
-        avifCodecDestroy(data->codecAlpha);
+        avifDecoderDataReleaseCodec(data, data->codecAlpha);
         data->codecAlpha = NULL;
     }
 }
@@ -1133,6 +1264,8 @@ static void avifDecoderDataDestroy(avifDecoderData * data)
     avifArrayDestroy(&data->tracks);
     avifDecoderDataClearTiles(data);
     avifArrayDestroy(&data->tiles);
+    avifDecoderDataDestroySpareCodecs(data);
+    avifArrayDestroy(&data->spareCodecs);
     avifArrayDestroy(&data->compatibleBrands);
     avifFree(data);
 }
@@ -1416,6 +1549,7 @@ static avifResult avifDecoderItemValidateProperties(const avifDecoderItem * item
 }
 
 static avifResult avifDecoderItemRead(avifDecoderItem * item,
+                                      avifDecoderData * data,
                                       avifIO * io,
                                       avifROData * outData,
                                       size_t offset,
@@ -1518,7 +1652,7 @@ static avifResult avifDecoderItemRead(avifDecoderItem * item,
                 avifDiagnosticsPrintf(diag, "Item ID %u extent offset failed size hint sanity check. Truncated data?", item->id);
                 return AVIF_RESULT_BMFF_PARSE_FAILED;
             }
-            avifResult readResult = io->read(io, 0, extent->offset, bytesToRead, &offsetBuffer);
+            avifResult readResult = avifDecoderDataRead(data, io, extent->offset, bytesToRead, &offsetBuffer);
             if (readResult != AVIF_RESULT_OK) {
                 return readResult;
             }
@@ -1818,63 +1952,92 @@ static avifResult avifDecoderDataAllocateImagePlanes(const avifDecoderData * dat
     return AVIF_RESULT_OK;
 }
 
-// Copies over the pixels from the tile into dstImage.
-// Verifies that the relevant properties of the tile match those of the first tile in case of a grid.
-static avifResult avifDecoderDataCopyTileToImage(avifDecoderData * data,
-                                                 const avifTileInfo * info,
-                                                 avifImage * dstImage,
-                                                 const avifTile * tile,
-                                                 unsigned int tileIndex)
+// Copies over the pixels from the tileCount tiles starting at tileIndex into dstImage using up to maxThreads threads. Each
+// thread copies the same band of rows of every tile, so the tiles should span rows of the grid, if any.
+// Verifies that the relevant properties of the tiles match those of the first tile in case of a grid.
+static avifResult avifDecoderDataCopyTilesToImage(avifDecoderData * data,
+                                                  const avifTileInfo * info,
+                                                  avifImage * dstImage,
+                                                  unsigned int tileIndex,
+                                                  unsigned int tileCount,
+                                                  int maxThreads)
 {
     const avifTile * firstTile = &data->tiles.tile[info->firstTileIndex];
-    if (tile != firstTile) {
-        // Check for tile consistency. All tiles in a grid image should match the first tile in the properties checked below.
-        if ((tile->image->width != firstTile->image->width) || (tile->image->height != firstTile->image->height) ||
-            (tile->image->depth != firstTile->image->depth) || (tile->image->yuvFormat != firstTile->image->yuvFormat) ||
-            (tile->image->yuvRange != firstTile->image->yuvRange) || (tile->image->colorPrimaries != firstTile->image->colorPrimaries) ||
-            (tile->image->transferCharacteristics != firstTile->image->transferCharacteristics) ||
-            (tile->image->matrixCoefficients != firstTile->image->matrixCoefficients)) {
-            avifDiagnosticsPrintf(data->diag, "Grid image contains mismatched tiles");
-            return AVIF_RESULT_INVALID_IMAGE_GRID;
+    for (unsigned int i = tileIndex; i < tileIndex + tileCount; ++i) {
+        const avifTile * tile = &data->tiles.tile[info->firstTileIndex + i];
+        if (tile != firstTile) {
+            // Check for tile consistency. All tiles in a grid image should match the first tile in the properties checked below.
+            if ((tile->image->width != firstTile->image->width) || (tile->image->height != firstTile->image->height) ||
+                (tile->image->depth != firstTile->image->depth) || (tile->image->yuvFormat != firstTile->image->yuvFormat) ||
+                (tile->image->yuvRange != firstTile->image->yuvRange) ||
+                (tile->image->colorPrimaries != firstTile->image->colorPrimaries) ||
+                (tile->image->transferCharacteristics != firstTile->image->transferCharacteristics) ||
+                (tile->image->matrixCoefficients != firstTile->image->matrixCoefficients)) {
+                avifDiagnosticsPrintf(data->diag, "Grid image contains mismatched tiles");
+                return AVIF_RESULT_INVALID_IMAGE_GRID;
+            }
         }
     }
 
     // Only keep the relevant planes in the destination image. Otherwise,
     // unjustified failures may come from trying to copy alpha tiles with odd
     // coordinates into the dstImage when the chroma planes are subsampled.
+    const avifBool alpha = avifIsAlpha(firstTile->input->itemCategory);
     avifImage dstView;
     avifImageSetDefaults(&dstView);
     const avifCropRect srcViewRect = { 0, 0, dstImage->width, dstImage->height };
     AVIF_ASSERT_OR_RETURN(avifImageSetViewRect(&dstView, dstImage, &srcViewRect) == AVIF_RESULT_OK);
-    if (avifIsAlpha(tile->input->itemCategory)) {
+    if (alpha) {
         avifImageFreePlanes(&dstView, AVIF_PLANES_YUV);
         dstView.yuvFormat = AVIF_PIXEL_FORMAT_NONE;
     } else {
         avifImageFreePlanes(&dstView, AVIF_PLANES_A);
     }
 
-    avifImage srcTileView;
-    avifImageSetDefaults(&srcTileView);
-    avifImage dstTileView;
-    avifImageSetDefaults(&dstTileView);
-    avifCropRect dstTileViewRect = { 0, 0, firstTile->image->width, firstTile->image->height };
-    if (info->grid.rows > 0 && info->grid.columns > 0) {
-        unsigned int rowIndex = tileIndex / info->grid.columns;
-        unsigned int colIndex = tileIndex % info->grid.columns;
-        dstTileViewRect.x = firstTile->image->width * colIndex;
-        dstTileViewRect.y = firstTile->image->height * rowIndex;
-        if (dstTileViewRect.x + dstTileViewRect.width > info->grid.outputWidth) {
-            dstTileViewRect.width = info->grid.outputWidth - dstTileViewRect.x;
-        }
-        if (dstTileViewRect.y + dstTileViewRect.height > info->grid.outputHeight) {
-            dstTileViewRect.height = info->grid.outputHeight - dstTileViewRect.y;
-        }
-    }
-    const avifCropRect srcTileViewRect = { 0, 0, dstTileViewRect.width, dstTileViewRect.height };
-    AVIF_ASSERT_OR_RETURN(avifImageSetViewRect(&dstTileView, &dstView, &dstTileViewRect) == AVIF_RESULT_OK);
-    AVIF_ASSERT_OR_RETURN(avifImageSetViewRect(&srcTileView, tile->image, &srcTileViewRect) == AVIF_RESULT_OK);
-    avifImageCopySamples(&dstTileView, &srcTileView, avifIsAlpha(tile->input->itemCategory) ? AVIF_PLANES_A : AVIF_PLANES_YUV);
-    return AVIF_RESULT_OK;
+    // The views of the tiles in dstView and in the tile images.
+    avifImage * tileViews = (avifImage *)avifAlloc(sizeof(avifImage) * 2 * tileCount);
+    avifImage ** dstTileViews = (avifImage **)avifAlloc(sizeof(avifImage *) * tileCount);
+    const avifImage ** srcTileViews = (const avifImage **)avifAlloc(sizeof(const avifImage *) * tileCount);
+    avifResult result = AVIF_RESULT_OK;
+    if (!tileViews || !dstTileViews || !srcTileViews) {
+        result = AVIF_RESULT_OUT_OF_MEMORY;
+        goto cleanup;
+    }
+    for (unsigned int i = 0; i < tileCount; ++i) {
+        const avifTile * tile = &data->tiles.tile[info->firstTileIndex + tileIndex + i];
+        avifImage * dstTileView = &tileViews[2 * i];
+        avifImage * srcTileView = &tileViews[2 * i + 1];
+        avifImageSetDefaults(dstTileView);
+        avifImageSetDefaults(srcTileView);
+        avifCropRect dstTileViewRect = { 0, 0, firstTile->image->width, firstTile->image->height };
+        if (info->grid.rows > 0 && info->grid.columns > 0) {
+            unsigned int rowIndex = (tileIndex + i) / info->grid.columns;
+            unsigned int colIndex = (tileIndex + i) % info->grid.columns;
+            dstTileViewRect.x = firstTile->image->width * colIndex;
+            dstTileViewRect.y = firstTile->image->height * rowIndex;
+            if (dstTileViewRect.x + dstTileViewRect.width > info->grid.outputWidth) {
+                dstTileViewRect.width = info->grid.outputWidth - dstTileViewRect.x;
+            }
+            if (dstTileViewRect.y + dstTileViewRect.height > info->grid.outputHeight) {
+                dstTileViewRect.height = info->grid.outputHeight - dstTileViewRect.y;
+            }
+        }
+        const avifCropRect srcTileViewRect = { 0, 0, dstTileViewRect.width, dstTileViewRect.height };
+        if (avifImageSetViewRect(dstTileView, &dstView, &dstTileViewRect) != AVIF_RESULT_OK ||
+            avifImageSetViewRect(srcTileView, tile->image, &srcTileViewRect) != AVIF_RESULT_OK) {
+            result = AVIF_RESULT_INTERNAL_ERROR;
+            goto cleanup;
+        }
+        dstTileViews[i] = dstTileView;
+        srcTileViews[i] = srcTileView;
+    }
+    result = avifImagesCopyAndPadSamples(dstTileViews, srcTileViews, tileCount, &dstView, alpha ? AVIF_PLANES_A : AVIF_PLANES_YUV, maxThreads);
+
+cleanup:
+    avifFree(tileViews);
+    avifFree(dstTileViews);
+    avifFree(srcTileViews);
+    return result;
 }
 
 // If colorId == 0 (a sentinel value as item IDs must be nonzero), accept any found EXIF/XMP metadata. Passing in 0
@@ -1904,7 +2067,7 @@ static avifResult avifDecoderFindMetadata(avifDecoder * decoder, avifMeta * meta
 
         if (!decoder->ignoreExif && !memcmp(item->type, "Exif", 4)) {
             avifROData exifContents;
-            avifResult readResult = avifDecoderItemRead(item, decoder->io, &exifContents, 0, 0, &decoder->diag);
+            avifResult readResult = avifDecoderItemRead(item, decoder->data, decoder->io, &exifContents, 0, 0, &decoder->diag);
             if (readResult != AVIF_RESULT_OK) {
                 return readResult;
             }
@@ -1930,7 +2093,7 @@ static avifResult avifDecoderFindMetadata(avifDecoder * decoder, avifMeta * meta
         } else if (!decoder->ignoreXMP && !memcmp(item->type, "mime", 4) &&
                    !strcmp(item->contentType.contentType, AVIF_CONTENT_TYPE_XMP)) {
             avifROData xmpContents;
-            avifResult readResult = avifDecoderItemRead(item, decoder->io, &xmpContents, 0, 0, &decoder->diag);
+            avifResult readResult = avifDecoderItemRead(item, decoder->data, decoder->io, &xmpContents, 0, 0, &decoder->diag);
             if (readResult != AVIF_RESULT_OK) {
                 return readResult;
             }
@@ -2442,7 +2605,7 @@ static avifResult avifDecoderItemReadAndParse(const avifDecoder * decoder,
     if (!memcmp(item->type, "grid", 4)) {
         if (isItemInInput) {
             avifROData readData;
-            AVIF_CHECKRES(avifDecoderItemRead(item, decoder->io, &readData, 0, 0, decoder->data->diag));
+            AVIF_CHECKRES(avifDecoderItemRead(item, decoder->data, decoder->io, &readData, 0, 0, decoder->data->diag));
             AVIF_CHECKRES(avifParseImageGridBox(grid,
                                                 readData.data,
                                                 readData.size,
@@ -4812,30 +4975,49 @@ static avifResult avifParse(avifDecoder * decoder)
     // Note: this top-level function is the only avifParse*() function that returns avifResult instead of avifBool.
     // Be sure to use AVIF_CHECKERR() in this function with an explicit error result instead of simply using AVIF_CHECK().
 
+    // Start from the last top-level box boundary reached by a previous call that returned AVIF_RESULT_WAITING_ON_IO, if any.
     avifResult readResult;
-    uint64_t parseOffset = 0;
     avifDecoderData * data = decoder->data;
-    avifBool ftypSeen = AVIF_FALSE;
-    avifBool metaSeen = AVIF_FALSE;
-    avifBool metaIsSizeZero = AVIF_FALSE;
-    avifBool moovSeen = AVIF_FALSE;
-    avifBool needsMeta = AVIF_FALSE;
-    avifBool needsMoov = AVIF_FALSE;
+    avifParseProgress * progress = &data->parseProgress;
+    uint64_t parseOffset = progress->offset;
+    avifBool ftypSeen = progress->ftypSeen;
+    avifBool metaSeen = progress->metaSeen;
+    avifBool metaIsSizeZero = progress->metaIsSizeZero;
+    avifBool moovSeen = progress->moovSeen;
+    avifBool needsMeta = progress->needsMeta;
+    avifBool needsMoov = progress->needsMoov;
 #if defined(AVIF_ENABLE_EXPERIMENTAL_MINI)
-    avifBool miniSeen = AVIF_FALSE;
-    avifBool needsMini = AVIF_FALSE;
+    avifBool miniSeen = progress->miniSeen;
+    avifBool needsMini = progress->needsMini;
 #endif
-    avifBool needsTmap = AVIF_FALSE;
-    avifBool tmapSeen = AVIF_FALSE;
+    avifBool needsTmap = progress->needsTmap;
+    avifBool tmapSeen = progress->tmapSeen;
     avifFileType ftyp = { 0 };
+    memcpy(ftyp.minorVersion, progress->ftypMinorVersion, 4);
 
     for (;;) {
+        // Nothing below modifies the parsing state until the whole box is read, so checkpoint it here.
+        progress->offset = parseOffset;
+        memcpy(progress->ftypMinorVersion, ftyp.minorVersion, 4);
+        progress->ftypSeen = ftypSeen;
+        progress->metaSeen = metaSeen;
+        progress->metaIsSizeZero = metaIsSizeZero;
+        progress->moovSeen = moovSeen;
+        progress->needsMeta = needsMeta;
+        progress->needsMoov = needsMoov;
+#if defined(AVIF_ENABLE_EXPERIMENTAL_MINI)
+        progress->miniSeen = miniSeen;
+        progress->needsMini = needsMini;
+#endif
+        progress->needsTmap = needsTmap;
+        progress->tmapSeen = tmapSeen;
+
         // Read just enough to get the next box header (a max of 32 bytes)
         avifROData headerContents;
         if ((decoder->io->sizeHint > 0) && (parseOffset > decoder->io->sizeHint)) {
             return AVIF_RESULT_BMFF_PARSE_FAILED;
         }
-        readResult = decoder->io->read(decoder->io, 0, parseOffset, 32, &headerContents);
+        readResult = avifDecoderDataRead(data, decoder->io, parseOffset, 32, &headerContents);
         if (readResult != AVIF_RESULT_OK) {
             return readResult;
         }
@@ -4897,7 +5079,7 @@ static avifResult avifParse(avifDecoder * decoder)
             } else {
                 sizeToRead = header.size;
             }
-            readResult = decoder->io->read(decoder->io, 0, parseOffset, sizeToRead, &boxContents);
+            readResult = avifDecoderDataRead(data, decoder->io, parseOffset, sizeToRead, &boxContents);
             if (readResult != AVIF_RESULT_OK) {
                 return readResult;
             }
@@ -5127,6 +5309,10 @@ void avifDecoderSetIO(avifDecoder * decoder, avifIO * io)
 {
     avifIODestroy(decoder->io);
     decoder->io = io;
+    if (decoder->data) {
+        // Parsing cannot be resumed with another avifIO.
+        decoder->data->parseResumable = AVIF_FALSE;
+    }
 }
 
 avifResult avifDecoderSetIOMemory(avifDecoder * decoder, const uint8_t * data, size_t size)
@@ -5246,7 +5432,7 @@ static avifResult avifDecoderPrepareSample(avifDecoder * decoder, avifDecodeSamp
             }
 #endif
             size_t offset = (size_t)sample->offset;
-            avifResult readResult = avifDecoderItemRead(item, decoder->io, &itemContents, offset, bytesToRead, &decoder->diag);
+            avifResult readResult = avifDecoderItemRead(item, decoder->data, decoder->io, &itemContents, offset, bytesToRead, &decoder->diag);
             if (readResult != AVIF_RESULT_OK) {
                 return readResult;
             }
@@ -5263,7 +5449,7 @@ static avifResult avifDecoderPrepareSample(avifDecoder * decoder, avifDecodeSamp
             if ((decoder->io->sizeHint > 0) && (sample->offset > decoder->io->sizeHint)) {
                 return AVIF_RESULT_BMFF_PARSE_FAILED;
             }
-            avifResult readResult = decoder->io->read(decoder->io, 0, sample->offset, bytesToRead, &sampleContents);
+            avifResult readResult = avifDecoderDataRead(decoder->data, decoder->io, sample->offset, bytesToRead, &sampleContents);
             if (readResult != AVIF_RESULT_OK) {
                 return readResult;
             }
@@ -5307,17 +5493,39 @@ avifResult avifDecoderParse(avifDecoder * decoder)
         return AVIF_RESULT_IO_NOT_SET;
     }
 
-    // Cleanup anything lingering in the decoder
-    avifDecoderCleanup(decoder);
+    if (decoder->data && decoder->data->parseResumable) {
+        // The previous call returned AVIF_RESULT_WAITING_ON_IO. Keep what was already parsed.
+        decoder->data->parseResumable = AVIF_FALSE;
+        decoder->data->ioWaiting = AVIF_FALSE;
+    } else {
+        avifDecoderData * newData = avifDecoderDataCreate();
+        AVIF_CHECKERR(newData != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+        if (decoder->data) {
+            // Keep the codec instances that may be reused for the new file.
+            avifDecoderDataClearTiles(decoder->data);
+            const avifCodecArray spareCodecs = newData->spareCodecs;
+            newData->spareCodecs = decoder->data->spareCodecs;
+            decoder->data->spareCodecs = spareCodecs;
+        }
+
+        // Cleanup anything lingering in the decoder
+        avifDecoderCleanup(decoder);
+
+        decoder->data = newData;
+        decoder->data->diag = &decoder->diag;
+    }
 
     // -----------------------------------------------------------------------
     // Parse BMFF boxes
 
-    decoder->data = avifDecoderDataCreate();
-    AVIF_CHECKERR(decoder->data != NULL, AVIF_RESULT_OUT_OF_MEMORY);
-    decoder->data->diag = &decoder->diag;
-
-    AVIF_CHECKRES(avifParse(decoder));
+    if (!decoder->data->parseProgress.complete) {
+        const avifResult parseResult = avifParse(decoder);
+        if (parseResult == AVIF_RESULT_WAITING_ON_IO) {
+            decoder->data->parseResumable = AVIF_TRUE;
+        }
+        AVIF_CHECKRES(parseResult);
+        decoder->data->parseProgress.complete = AVIF_TRUE;
+    }
 
     // Walk the decoded items (if any) and harvest ispe
     avifDecoderData * data = decoder->data;
@@ -5355,7 +5563,12 @@ avifResult avifDecoderParse(avifDecoder * decoder)
             }
         }
     }
-    return avifDecoderReset(decoder);
+    const avifResult resetResult = avifDecoderReset(decoder);
+    if (resetResult == AVIF_RESULT_WAITING_ON_IO) {
+        // Only item payloads such as metadata were missing. Do not parse the boxes again next time.
+        data->parseResumable = AVIF_TRUE;
+    }
+    return resetResult;
 }
 
 static avifResult avifCodecCreateInternal(avifCodecChoice choice, const avifTile * tile, avifDiagnostics * diag, avifCodec ** codec)
@@ -5389,6 +5602,32 @@ static avifResult avifCodecCreateInternal(avifCodecChoice choice, const avifTile
     return AVIF_RESULT_OK;
 }
 
+// Takes a compatible codec instance from decoder->data->spareCodecs, or creates a new one.
+static avifResult avifDecoderCreateCodec(avifDecoder * decoder, const avifTile * tile, avifCodec ** codec)
+{
+    avifDecoderData * data = decoder->data;
+    for (uint32_t i = 0; i < data->spareCodecs.count; ++i) {
+        avifCodec * spareCodec = data->spareCodecs.codec[i];
+        // The options below are given to the underlying decoder once at initialization.
+        if (spareCodec->choice == decoder->codecChoice && spareCodec->codecType == tile->codecType &&
+            spareCodec->operatingPoint == tile->operatingPoint && spareCodec->allLayers == tile->input->allLayers &&
+            spareCodec->maxThreads == decoder->maxThreads && spareCodec->imageSizeLimit == decoder->imageSizeLimit &&
+            spareCodec->imageDimensionLimit == decoder->imageDimensionLimit) {
+            data->spareCodecs.codec[i] = data->spareCodecs.codec[data->spareCodecs.count - 1];
+            --data->spareCodecs.count;
+            *codec = spareCodec;
+            return AVIF_RESULT_OK;
+        }
+    }
+    AVIF_CHECKRES(avifCodecCreateInternal(decoder->codecChoice, tile, &decoder->diag, codec));
+    (*codec)->choice = decoder->codecChoice;
+    (*codec)->codecType = tile->codecType;
+    (*codec)->maxThreads = decoder->maxThreads;
+    (*codec)->imageSizeLimit = decoder->imageSizeLimit;
+    (*codec)->imageDimensionLimit = decoder->imageDimensionLimit;
+    return AVIF_RESULT_OK;
+}
+
 static avifBool avifTilesCanBeDecodedWithSameCodecInstance(const avifDecoderData * data)
 {
     int32_t numImageBuffers = 0, numStolenImageBuffers = 0;
@@ -5428,14 +5667,18 @@ static avifResult avifDecoderCreateCodecs(avifDecoder * decoder)
 {
     avifDecoderData * data = decoder->data;
     avifDecoderDataResetCodec(data);
+    if (!decoder->reuseCodecs) {
+        avifDecoderDataDestroySpareCodecs(data);
+    }
+    data->reuseCodecs = decoder->reuseCodecs;
 
     if (data->source == AVIF_DECODER_SOURCE_TRACKS) {
         // In this case, we will use at most two codec instances (one for the color planes and one for the alpha plane).
         // Gain maps are not supported.
-        AVIF_CHECKRES(avifCodecCreateInternal(decoder->codecChoice, &decoder->data->tiles.tile[0], &decoder->diag, &data->codec));
+        AVIF_CHECKRES(avifDecoderCreateCodec(decoder, &data->tiles.tile[0], &data->codec));
         data->tiles.tile[0].codec = data->codec;
         if (data->tiles.count > 1) {
-            AVIF_CHECKRES(avifCodecCreateInternal(decoder->codecChoice, &decoder->data->tiles.tile[1], &decoder->diag, &data->codecAlpha));
+            AVIF_CHECKRES(avifDecoderCreateCodec(decoder, &data->tiles.tile[1], &data->codecAlpha));
             data->tiles.tile[1].codec = data->codecAlpha;
         }
     } else {
@@ -5456,33 +5699,30 @@ static avifResult avifDecoderCreateCodecs(avifDecoder * decoder)
             ((data->tiles.count == 1) || (decoder->imageCount == 1 && avifTilesCanBeDecodedWithSameCodecInstance(data))) &&
             data->sampleTransformNumInputImageItems == 0;
         if (canUseSingleCodecInstance) {
-            AVIF_CHECKRES(avifCodecCreateInternal(decoder->codecChoice, &decoder->data->tiles.tile[0], &decoder->diag, &data->codec));
+            AVIF_CHECKRES(avifDecoderCreateCodec(decoder, &data->tiles.tile[0], &data->codec));
             for (unsigned int i = 0; i < decoder->data->tiles.count; ++i) {
                 decoder->data->tiles.tile[i].codec = data->codec;
             }
         } else {
             for (unsigned int i = 0; i < decoder->data->tiles.count; ++i) {
                 avifTile * tile = &decoder->data->tiles.tile[i];
-                AVIF_CHECKRES(avifCodecCreateInternal(decoder->codecChoice, tile, &decoder->diag, &tile->codec));
+                AVIF_CHECKRES(avifDecoderCreateCodec(decoder, tile, &tile->codec));
             }
         }
     }
+    // Do not keep the instances that were not needed by this image.
+    avifDecoderDataDestroySpareCodecs(data);
     return AVIF_RESULT_OK;
 }
 
 // Returns the primary color item if found, or NULL.
 static avifDecoderItem * avifMetaFindColorItem(avifMeta * meta)
 {
-    for (uint32_t itemIndex = 0; itemIndex < meta->items.count; ++itemIndex) {
-        avifDecoderItem * item = meta->items.item[itemIndex];
-        if (avifDecoderItemShouldBeSkipped(item)) {
-            continue;
-        }
-        if (item->id == meta->primaryItemID) {
-            return item;
-        }
+    avifDecoderItem * item = avifMetaFindItem(meta, meta->primaryItemID);
+    if (item == NULL || avifDecoderItemShouldBeSkipped(item)) {
+        return NULL;
     }
-    return NULL;
+    return item;
 }
 
 // Returns AVIF_TRUE if item is an alpha auxiliary item of the parent color
@@ -5584,13 +5824,7 @@ static avifResult avifMetaFindAlphaItem(avifMeta * meta,
         avifBool isUsed;
         do {
             ++newItemID;
-            isUsed = AVIF_FALSE;
-            for (uint32_t i = 0; i < meta->items.count; ++i) {
-                if (meta->items.item[i]->id == newItemID) {
-                    isUsed = AVIF_TRUE;
-                    break;
-                }
-            }
+            isUsed = avifMetaFindItem(meta, newItemID) != NULL;
         } while (isUsed && newItemID != 0);
         result = avifMetaFindOrCreateItem(meta, newItemID, alphaItem); // Create new empty item.
     }
@@ -5661,7 +5895,8 @@ static avifResult avifReadColorNclxProperty(const avifPropertyArray * properties
 // This function fails if more than one icc or nclx property is found in
 // |properties|. The output parameters may be populated even in case of failure
 // and must be ignored (and the |icc| object may need to be freed).
-static avifResult avifReadColorProperties(avifIO * io,
+static avifResult avifReadColorProperties(avifDecoderData * data,
+                                          avifIO * io,
                                           const avifPropertyArray * properties,
                                           avifRWData * icc,
                                           avifColorPrimaries * colorPrimaries,
@@ -5681,7 +5916,7 @@ static avifResult avifReadColorProperties(avifIO * io,
             }
             if (icc) {
                 avifROData iccRead;
-                AVIF_CHECKRES(io->read(io, 0, prop->u.colr.iccOffset, prop->u.colr.iccSize, &iccRead));
+                AVIF_CHECKRES(avifDecoderDataRead(data, io, prop->u.colr.iccOffset, prop->u.colr.iccSize, &iccRead));
                 AVIF_CHECKRES(avifRWDataSet(icc, iccRead.data, iccRead.size));
             }
             colrICCSeen = AVIF_TRUE;
@@ -5797,7 +6032,7 @@ static avifResult avifDecoderFindGainMapItem(const avifDecoder * decoder,
 
     // Parse tmap item data (containing the gain map metadata).
     avifROData tmapData;
-    AVIF_CHECKRES(avifDecoderItemRead(toneMappedImageItemTmp, decoder->io, &tmapData, 0, 0, data->diag));
+    AVIF_CHECKRES(avifDecoderItemRead(toneMappedImageItemTmp, data, decoder->io, &tmapData, 0, 0, data->diag));
     // Allocate avifGainMap on the stack instead of using avifGainMapCreate() to simplify error handling.
     avifGainMap gainMapTmp;
     avifGainMapSetDefaults(&gainMapTmp);
@@ -5826,7 +6061,8 @@ static avifResult avifDecoderFindGainMapItem(const avifDecoder * decoder,
     AVIF_CHECKRES(result);
 
     // This may allocate gainMapTmp.altICC which must be freed in case of error.
-    result = avifReadColorProperties(decoder->io,
+    result = avifReadColorProperties(data,
+                                     decoder->io,
                                      &toneMappedImageItemTmp->properties,
                                      decoder->ignoreICC ? NULL : &gainMapTmp.altICC,
                                      &gainMapTmp.altColorPrimaries,
@@ -6463,7 +6699,7 @@ avifResult avifDecoderReset(avifDecoder * decoder)
 
             AVIF_ASSERT_OR_RETURN(data->meta->sampleTransformExpression.tokens == NULL);
             avifROData satoData;
-            AVIF_CHECKRES(avifDecoderItemRead(sampleTransformItem, decoder->io, &satoData, 0, 0, data->diag));
+            AVIF_CHECKRES(avifDecoderItemRead(sampleTransformItem, data, decoder->io, &satoData, 0, 0, data->diag));
             AVIF_CHECKRES(avifParseSampleTransformImageBox(satoData.data,
                                                            satoData.size,
                                                            data->sampleTransformNumInputImageItems,
@@ -6594,7 +6830,8 @@ avifResult avifDecoderReset(avifDecoder * decoder)
         }
     }
 
-    AVIF_CHECKRES(avifReadColorProperties(decoder->io,
+    AVIF_CHECKRES(avifReadColorProperties(data,
+                                          decoder->io,
                                           colorProperties,
                                           decoder->ignoreICC ? NULL : &decoder->image->icc,
                                           &decoder->image->colorPrimaries,
@@ -6774,6 +7011,32 @@ static avifResult avifGetErrorForItemCategory(avifItemCategory itemCategory)
     return avifIsAlpha(itemCategory) ? AVIF_RESULT_DECODE_ALPHA_FAILED : AVIF_RESULT_DECODE_COLOR_FAILED;
 }
 
+static avifResult avifDecoderOutputRows(avifDecoder * decoder, avifBool frameComplete);
+
+// Scales the decoded image of the tile to the tile's output dimensions, with up to decoder->maxThreads threads.
+static avifResult avifDecoderScaleTileImage(avifDecoder * decoder, avifTile * tile)
+{
+    if (avifDimensionsTooLarge(tile->width, tile->height, decoder->imageSizeLimit, decoder->imageDimensionLimit)) {
+        avifDiagnosticsPrintf(&decoder->diag, "Tile dimensions are too large [%ux%u]", tile->width, tile->height);
+        return AVIF_RESULT_NOT_IMPLEMENTED;
+    }
+    avifImage * scaledImage = avifImageCreateEmpty();
+    AVIF_CHECKERR(scaledImage, AVIF_RESULT_OUT_OF_MEMORY);
+    avifImageCopyNoAlloc(scaledImage, tile->image);
+    scaledImage->width = tile->width;
+    scaledImage->height = tile->height;
+    const avifResult result =
+        avifImageScaleInto(tile->image, scaledImage, AVIF_SCALE_FILTER_BILINEAR, decoder->maxThreads, &decoder->diag);
+    if (result == AVIF_RESULT_OK) {
+        // The planes of tile->image may belong to the codec. Replace them by the scaled ones.
+        tile->image->width = tile->width;
+        tile->image->height = tile->height;
+        avifImageStealPlanes(tile->image, scaledImage, AVIF_PLANES_ALL);
+    }
+    avifImageDestroy(scaledImage);
+    return result;
+}
+
 static avifResult avifDecoderDecodeTiles(avifDecoder * decoder, uint32_t nextImageIndex, avifTileInfo * info)
 {
     const unsigned int oldDecodedTileCount = info->decodedTileCount;
@@ -6829,12 +7092,7 @@ static avifResult avifDecoderDecodeTiles(avifDecoder * decoder, uint32_t nextIma
 
         // Scale the decoded image so that it corresponds to this tile's output dimensions
         if ((tile->width != tile->image->width) || (tile->height != tile->image->height)) {
-            if (avifImageScaleWithLimit(tile->image,
-                                        tile->width,
-                                        tile->height,
-                                        decoder->imageSizeLimit,
-                                        decoder->imageDimensionLimit,
-                                        &decoder->diag) != AVIF_RESULT_OK) {
+            if (avifDecoderScaleTileImage(decoder, tile) != AVIF_RESULT_OK) {
                 return avifGetErrorForItemCategory(tile->input->itemCategory);
             }
         }
@@ -6863,7 +7121,22 @@ static avifResult avifDecoderDecodeTiles(avifDecoder * decoder, uint32_t nextIma
             if (tileIndex == 0) {
                 AVIF_CHECKRES(avifDecoderDataAllocateImagePlanes(decoder->data, info, dstImage, &decoder->data->cicpSet));
             }
-            AVIF_CHECKRES(avifDecoderDataCopyTileToImage(decoder->data, info, dstImage, tile, tileIndex));
+            // When each tile has its own codec instance, its samples stay valid while the next tiles are decoded. The tiles
+            // are then copied once their row of the grid is decoded, so that threads copy bands of rows across all of them.
+            // The rows of the grid are only reported as decoded once complete anyway. A codec instance shared by all
+            // tiles overwrites the samples of a tile when decoding the next one, so each tile is copied right away.
+            const avifTile * firstTile = &decoder->data->tiles.tile[info->firstTileIndex];
+            const avifBool sharedCodec = (info->tileCount > 1) && (firstTile[1].codec == firstTile->codec);
+            const unsigned int columns = (isGrid && !sharedCodec) ? info->grid.columns : 1;
+            if (((tileIndex + 1) % columns == 0) || (tileIndex + 1 == info->tileCount)) {
+                const unsigned int rowTileIndex = tileIndex - tileIndex % columns;
+                AVIF_CHECKRES(avifDecoderDataCopyTilesToImage(decoder->data,
+                                                              info,
+                                                              dstImage,
+                                                              rowTileIndex,
+                                                              tileIndex + 1 - rowTileIndex,
+                                                              decoder->maxThreads));
+            }
         } else {
             AVIF_ASSERT_OR_RETURN(info->tileCount == 1);
             AVIF_ASSERT_OR_RETURN(tileIndex == 0);
@@ -6899,6 +7172,9 @@ static avifResult avifDecoderDecodeTiles(avifDecoder * decoder, uint32_t nextIma
                 avifImageStealPlanes(decoder->image, src, AVIF_PLANES_YUV);
             }
         }
+
+        // Convert and report the rows completed by this tile, if any, before decoding the next one.
+        AVIF_CHECKRES(avifDecoderOutputRows(decoder, /*frameComplete=*/AVIF_FALSE));
     }
     return AVIF_RESULT_OK;
 }
@@ -6954,10 +7230,12 @@ static avifResult avifDecoderApplySampleTransformForPlanesImpl(const avifDecoder
                 reconstructedInputImages[i]->height = decoder->image->height;
                 avifBool cicpSet = AVIF_TRUE;
                 AVIF_CHECKRES(avifDecoderDataAllocateImagePlanes(decoder->data, info, reconstructedInputImages[i], &cicpSet));
-                for (unsigned int tileIndex = 0; tileIndex < info->tileCount; ++tileIndex) {
-                    const avifTile * tile = firstTile + tileIndex;
-                    AVIF_CHECKRES(avifDecoderDataCopyTileToImage(decoder->data, info, reconstructedInputImages[i], tile, tileIndex));
-                }
+                AVIF_CHECKRES(avifDecoderDataCopyTilesToImage(decoder->data,
+                                                              info,
+                                                              reconstructedInputImages[i],
+                                                              /*tileIndex=*/0,
+                                                              info->tileCount,
+                                                              decoder->maxThreads));
                 inputImages[i] = reconstructedInputImages[i];
             }
         }
@@ -7032,12 +7310,14 @@ avifResult avifDecoderNextImage(avifDecoder * decoder)
     if (!decoder->io || !decoder->io->read) {
         return AVIF_RESULT_IO_NOT_SET;
     }
+    decoder->data->ioWaiting = AVIF_FALSE;
 
     if (avifDecoderDataFrameFullyDecoded(decoder->data)) {
         // A frame was decoded during the last avifDecoderNextImage() call.
         for (int c = 0; c < AVIF_ITEM_CATEGORY_COUNT; ++c) {
             decoder->data->tileInfos[c].decodedTileCount = 0;
         }
+        decoder->data->outputRowCount = 0;
     }
 
     AVIF_ASSERT_OR_RETURN(decoder->data->tiles.count == (decoder->data->tileInfos[AVIF_ITEM_CATEGORY_COUNT - 1].firstTileIndex +
@@ -7094,6 +7374,7 @@ avifResult avifDecoderNextImage(avifDecoder * decoder)
     if (decoder->data->tileInfos[AVIF_ITEM_COLOR].tileCount != 0 && decoder->data->meta->sampleTransformExpression.count > 0) {
         AVIF_CHECKRES(avifDecoderApplySampleTransform(decoder, decoder->image));
     }
+    AVIF_CHECKRES(avifDecoderOutputRows(decoder, /*frameComplete=*/AVIF_TRUE));
 
     // Only advance decoder->imageIndex once the image is completely decoded, so that
     // avifDecoderNthImage(decoder, decoder->imageIndex + 1) is equivalent to avifDecoderNextImage(decoder)
@@ -7112,6 +7393,15 @@ avifResult avifDecoderNextImage(avifDecoder * decoder)
     return AVIF_RESULT_OK;
 }
 
+avifResult avifDecoderGetIOWaitExtent(const avifDecoder * decoder, avifExtent * outExtent)
+{
+    if (!decoder->data || !decoder->data->ioWaiting) {
+        return AVIF_RESULT_NO_CONTENT;
+    }
+    *outExtent = decoder->data->ioWaitExtent;
+    return AVIF_RESULT_OK;
+}
+
 avifResult avifDecoderNthImageTiming(const avifDecoder * decoder, uint32_t frameIndex, avifImageTiming * outTiming)
 {
     if (!decoder->data) {
@@ -7261,6 +7551,70 @@ static uint32_t avifGetDecodedRowCount(const avifDecoder * decoder, const avifTi
     }
 }
 
+// Converts rows [firstRow, lastRow) of decoder->image to decoder->rgbOutput.
+// decodedRowCount is the number of top rows of decoder->image that are available.
+static avifResult avifDecoderConvertRows(avifDecoder * decoder, uint32_t firstRow, uint32_t lastRow, uint32_t decodedRowCount)
+{
+    const avifImage * image = decoder->image;
+    avifRGBImage * rgb = decoder->rgbOutput;
+    if (!rgb->pixels || rgb->width != image->width || rgb->height != image->height) {
+        avifDiagnosticsPrintf(&decoder->diag, "rgbOutput must be allocated with the dimensions of the image");
+        return AVIF_RESULT_INVALID_ARGUMENT;
+    }
+
+    // Rows below decodedRowCount are not available for chroma upsampling.
+    avifImage decodedView;
+    avifImageSetDefaults(&decodedView);
+    const avifCropRect decodedRect = { 0, 0, image->width, decodedRowCount };
+    AVIF_CHECKRES(avifImageSetViewRect(&decodedView, image, &decodedRect));
+    const avifCropRect rowsRect = { 0, firstRow, image->width, lastRow - firstRow };
+    avifRGBImage rgbView = *rgb;
+    rgbView.height = rowsRect.height;
+    rgbView.pixels = rgb->pixels + (size_t)firstRow * rgb->rowBytes;
+    return avifImageYUVToRGBRect(&decodedView, &rowsRect, &rgbView);
+}
+
+// Converts to decoder->rgbOutput and reports to decoder->rowsReady the rows of the current frame that became
+// available since the last call. If frameComplete is false, the frame is being decoded tile by tile.
+static avifResult avifDecoderOutputRows(avifDecoder * decoder, avifBool frameComplete)
+{
+    avifDecoderData * data = decoder->data;
+    if ((!decoder->rgbOutput && !decoder->rowsReady) || data->tileInfos[AVIF_ITEM_COLOR].tileCount == 0) {
+        return AVIF_RESULT_OK;
+    }
+
+    uint32_t decodedRowCount = decoder->image->height;
+    if (!frameComplete) {
+        if (data->meta->sampleTransformExpression.count > 0) {
+            // The expression is only applied once all tiles are decoded.
+            return AVIF_RESULT_OK;
+        }
+        // The gain map is not needed to access the color and alpha rows.
+        decodedRowCount = AVIF_MIN(avifGetDecodedRowCount(decoder, &data->tileInfos[AVIF_ITEM_COLOR], decoder->image),
+                                   avifGetDecodedRowCount(decoder, &data->tileInfos[AVIF_ITEM_ALPHA], decoder->image));
+    }
+    uint32_t readyRowCount = decodedRowCount;
+    if (decoder->rgbOutput && decodedRowCount != 0 && decodedRowCount < decoder->image->height &&
+        decoder->image->yuvFormat == AVIF_PIXEL_FORMAT_YUV420) {
+        // The last decoded row shares its chroma row with the next row. Depending on the chroma upsampling,
+        // its RGB value may depend on the next chroma row, which is not decoded yet.
+        readyRowCount = decodedRowCount - 1;
+    }
+    if (readyRowCount <= data->outputRowCount) {
+        return AVIF_RESULT_OK;
+    }
+
+    const uint32_t firstRow = data->outputRowCount;
+    if (decoder->rgbOutput) {
+        AVIF_CHECKRES(avifDecoderConvertRows(decoder, firstRow, readyRowCount, decodedRowCount));
+    }
+    data->outputRowCount = readyRowCount;
+    if (decoder->rowsReady) {
+        decoder->rowsReady(decoder, firstRow, readyRowCount - firstRow, decoder->rowsReadyUserData);
+    }
+    return AVIF_RESULT_OK;
+}
+
 uint32_t avifDecoderDecodedRowCount(const avifDecoder * decoder)
 {
     if (decoder->data->tileInfos[AVIF_ITEM_COLOR].tileCount == 0) {
@@ -7312,7 +7666,7 @@ avifResult avifDecoderRead(avifDecoder * decoder, avifImage * image)
     // view, unless some postprocessing is applied (container-level grid reconstruction for
     // example), so the first condition rarely holds.
     // The second condition does not hold either: it is not required by the documentation in avif.h.
-    return avifImageCopy(image, decoder->image, AVIF_PLANES_ALL);
+    return avifImageCopyWithMaxThreads(image, decoder->image, AVIF_PLANES_ALL, decoder->maxThreads);
 }
 
 avifResult avifDecoderReadMemory(avifDecoder * decoder, avifImage * image, const uint8_t * data, size_t size)
@@ -7334,3 +7688,110 @@ avifResult avifDecoderReadFile(avifDecoder * decoder, avifImage * image, const c
     }
     return avifDecoderRead(decoder, image);
 }
+
+typedef struct avifDecodeBatchWorker
+{
+    avifThread * thread;
+    const avifDecoder * settings;
+    avifDecodeBatchItem * items;
+    size_t itemCount;
+    size_t firstItemIndex; // This worker decodes items[firstItemIndex], items[firstItemIndex + itemIndexStep] etc.
+    size_t itemIndexStep;
+    int maxThreads; // Given to the codec instances of this worker
+} avifDecodeBatchWorker;
+
+static avifResult avifDecodeBatchItemRead(avifDecoder * decoder, avifDecodeBatchItem * item)
+{
+    AVIF_CHECKERR(item->image != NULL || item->rgb != NULL, AVIF_RESULT_INVALID_ARGUMENT);
+    AVIF_CHECKRES(avifDecoderSetIOMemory(decoder, item->data, item->size));
+    AVIF_CHECKRES(avifDecoderParse(decoder));
+    AVIF_CHECKRES(avifDecoderNextImage(decoder));
+    if (item->image != NULL) {
+        AVIF_CHECKRES(avifImageCopyWithMaxThreads(item->image, decoder->image, AVIF_PLANES_ALL, decoder->maxThreads));
+    }
+    if (item->rgb != NULL) {
+        item->rgb->width = decoder->image->width;
+        item->rgb->height = decoder->image->height;
+        if (item->rgb->depth == 0) {
+            item->rgb->depth = decoder->image->depth;
+        }
+        AVIF_CHECKRES(avifRGBImageAllocatePixels(item->rgb));
+        AVIF_CHECKRES(avifImageYUVToRGB(decoder->image, item->rgb));
+    }
+    return AVIF_RESULT_OK;
+}
+
+static void avifDecodeBatchWorkerRun(void * userData)
+{
+    avifDecodeBatchWorker * worker = (avifDecodeBatchWorker *)userData;
+    // One decoder per worker. Its codec instances are kept warm from one file to the next.
+    avifDecoder * decoder = avifDecoderCreate();
+    if (decoder != NULL) {
+        const avifDecoder * settings = worker->settings;
+        decoder->codecChoice = settings->codecChoice;
+        decoder->maxThreads = worker->maxThreads;
+        decoder->requestedSource = settings->requestedSource;
+        decoder->allowProgressive = settings->allowProgressive;
+        decoder->ignoreExif = settings->ignoreExif;
+        decoder->ignoreXMP = settings->ignoreXMP;
+        decoder->imageSizeLimit = settings->imageSizeLimit;
+        decoder->imageDimensionLimit = settings->imageDimensionLimit;
+        decoder->imageCountLimit = settings->imageCountLimit;
+        decoder->strictFlags = settings->strictFlags;
+        decoder->imageContentToDecode = settings->imageContentToDecode;
+        decoder->ignoreICC = settings->ignoreICC;
+        decoder->reuseCodecs = AVIF_TRUE;
+    }
+    for (size_t i = worker->firstItemIndex; i < worker->itemCount; i += worker->itemIndexStep) {
+        avifDecodeBatchItem * item = &worker->items[i];
+        item->result = (decoder != NULL) ? avifDecodeBatchItemRead(decoder, item) : AVIF_RESULT_OUT_OF_MEMORY;
+    }
+    if (decoder != NULL) {
+        avifDecoderDestroy(decoder);
+    }
+}
+
+avifResult avifDecoderReadMemoryBatch(const avifDecoder * settings, avifDecodeBatchItem * items, size_t itemCount)
+{
+    AVIF_CHECKERR(settings->maxThreads >= 0, AVIF_RESULT_INVALID_ARGUMENT);
+    if (itemCount == 0) {
+        return AVIF_RESULT_OK;
+    }
+    AVIF_CHECKERR(items != NULL, AVIF_RESULT_INVALID_ARGUMENT);
+
+    // Files are decoded in parallel first. The remaining threads, if any, are given to the codecs.
+    const size_t workerCount = AVIF_MIN((size_t)AVIF_MAX(settings->maxThreads, 1), itemCount);
+    avifDecodeBatchWorker * workers = (avifDecodeBatchWorker *)avifAlloc(sizeof(avifDecodeBatchWorker) * workerCount);
+    AVIF_CHECKERR(workers != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+    memset(workers, 0, sizeof(avifDecodeBatchWorker) * workerCount);
+    for (size_t i = 0; i < workerCount; ++i) {
+        avifDecodeBatchWorker * worker = &workers[i];
+        worker->settings = settings;
+        worker->items = items;
+        worker->itemCount = itemCount;
+        worker->firstItemIndex = i;
+        worker->itemIndexStep = workerCount;
+        worker->maxThreads = AVIF_MAX(settings->maxThreads / (int)workerCount, 1);
+        if (i > 0) {
+            // If the thread cannot be created, the items of this worker are decoded in the current thread below.
+            worker->thread = avifThreadCreate(avifDecodeBatchWorkerRun, worker);
+        }
+    }
+    avifDecodeBatchWorkerRun(&workers[0]);
+    avifResult result = AVIF_RESULT_OK;
+    for (size_t i = 1; i < workerCount; ++i) {
+        avifDecodeBatchWorker * worker = &workers[i];
+        if (worker->thread == NULL) {
+            avifDecodeBatchWorkerRun(worker);
+        } else if (!avifThreadJoin(worker->thread)) {
+            result = AVIF_RESULT_UNKNOWN_ERROR;
+        }
+    }
+    avifFree(workers);
+    AVIF_CHECKRES(result);
+
+    for (size_t i = 0; i < itemCount; ++i) {
+        AVIF_CHECKRES(items[i].result);
+    }
+    return AVIF_RESULT_OK;
+}
@@ -7,11 +7,11 @@
 #include <stdint.h>
 #include <string.h>
 
-#if defined(_WIN32)
-#include <process.h>
-#include <windows.h>
-#else
-#include <pthread.h>
+#if defined(AVIF_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(AVIF_SIMD_AVX2)
+#include <immintrin.h>
 #endif
 
 static void * avifMemset16(void * dest, int val, size_t count)
@@ -29,6 +29,16 @@ struct YUVBlock
     float v;
 };
 
+// This constant comes from libyuv. For details, see here:
+// https://chromium.googlesource.com/libyuv/libyuv/+/2f87e9a7/source/row_common.cc#3537
+#define F16_MULTIPLIER 1.9259299444e-34f
+
+typedef union avifF16
+{
+    float f;
+    uint32_t u32;
+} avifF16;
+
 avifBool avifGetRGBColorSpaceInfo(const avifRGBImage * rgb, avifRGBColorSpaceInfo * info)
 {
     AVIF_CHECK(rgb->depth == 8 || rgb->depth == 10 || rgb->depth == 12 || rgb->depth == 16);
@@ -38,6 +48,9 @@ avifBool avifGetRGBColorSpaceInfo(const avifRGBImage * rgb, avifRGBColorSpaceInf
     if (rgb->format == AVIF_RGB_FORMAT_RGB_565) {
         AVIF_CHECK(rgb->depth == 8);
     }
+    if (rgb->format == AVIF_RGB_FORMAT_RGBA1010102) {
+        AVIF_CHECK(rgb->depth == 10);
+    }
     // Cast to silence "comparison of unsigned expression is always true" warning.
     AVIF_CHECK((int)rgb->format >= AVIF_RGB_FORMAT_RGB && rgb->format < AVIF_RGB_FORMAT_COUNT);
 
@@ -105,6 +118,14 @@ avifBool avifGetRGBColorSpaceInfo(const avifRGBImage * rgb, avifRGBColorSpaceInf
             info->offsetBytesA = info->channelBytes * 0;
             info->offsetBytesGray = info->channelBytes * 1;
             break;
+        case AVIF_RGB_FORMAT_RGBA1010102:
+            // Like RGB_565, the whole pixel is accessed as a uint32_t through
+            // the pointer to the red channel, so all offsets are zero.
+            info->offsetBytesR = 0;
+            info->offsetBytesG = 0;
+            info->offsetBytesB = 0;
+            info->offsetBytesA = 0;
+            break;
 
         case AVIF_RGB_FORMAT_COUNT:
             return AVIF_FALSE;
@@ -190,6 +211,8 @@ static avifBool avifPrepareReformatState(const avifImage * image, const avifRGBI
         state->yuv.kb = 0.0f;
     }
 
+    state->unormFloatTableY = NULL;
+    state->unormFloatTableUV = NULL;
     return AVIF_TRUE;
 }
 
@@ -218,9 +241,133 @@ static int avifYUVColorSpaceInfoUVToUNorm(avifYUVColorSpaceInfo * info, float v)
     return AVIF_CLAMP(unorm, 0, info->maxChannel);
 }
 
+// Converts count half floats at src to 16-bit samples at dst, clamping them to [0, 1].
+static void avifF16RowToUNorm16(const uint16_t * src, uint32_t count, uint16_t * dst)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        // Negative values (with the sign bit set) become 0. Infinities and NaNs are clamped to 1.
+        avifF16 f16;
+        f16.u32 = (uint32_t)(src[i] & 0x7FFF) << 13;
+        const float v = (src[i] & 0x8000) ? 0.0f : f16.f * (65535.0f / F16_MULTIPLIER);
+        dst[i] = (uint16_t)(AVIF_MIN(v, 65535.0f) + 0.5f);
+    }
+}
+
+// Same as avifF16RowToUNorm16() for the leading samples that fill whole vectors. Returns their count.
+typedef uint32_t (*avifF16RowToUNorm16Func)(const uint16_t * src, uint32_t count, uint16_t * dst);
+
+#if defined(AVIF_SIMD_SSE2)
+// Converts the half floats in the low 16 bits of the 32-bit lanes of f16 like avifF16RowToUNorm16(), ignoring the sign.
+static inline __m128i avifF16ToUNorm16SSE2(__m128i f16)
+{
+    const __m128 f = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(f16, _mm_set1_epi32(0x7FFF)), 13));
+    // _mm_min_ps() returns its second operand for NaNs, like AVIF_MIN().
+    const __m128 clamped = _mm_min_ps(_mm_mul_ps(f, _mm_set1_ps(65535.0f / F16_MULTIPLIER)), _mm_set1_ps(65535.0f));
+    return _mm_cvttps_epi32(_mm_add_ps(clamped, _mm_set1_ps(0.5f)));
+}
+
+static uint32_t avifF16RowToUNorm16SSE2(const uint16_t * src, uint32_t count, uint16_t * dst)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i offset = _mm_set1_epi32(32768);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i f16 = _mm_loadu_si128((const __m128i *)&src[i]);
+        const __m128i lo = avifF16ToUNorm16SSE2(_mm_unpacklo_epi16(f16, zero));
+        const __m128i hi = avifF16ToUNorm16SSE2(_mm_unpackhi_epi16(f16, zero));
+        // Offset by -32768 for the signed saturation to keep [0:65535].
+        const __m128i unorm16 = _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(lo, offset), _mm_sub_epi32(hi, offset)),
+                                              _mm_set1_epi16((short)0x8000));
+        // Negative values become 0.
+        _mm_storeu_si128((__m128i *)&dst[i], _mm_andnot_si128(_mm_srai_epi16(f16, 15), unorm16));
+    }
+    return i;
+}
+
+#if defined(AVIF_SIMD_AVX2)
+__attribute__((target("avx2"))) static inline __m256i avifF16ToUNorm16AVX2(__m256i f16)
+{
+    const __m256 f = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(f16, _mm256_set1_epi32(0x7FFF)), 13));
+    const __m256 clamped = _mm256_min_ps(_mm256_mul_ps(f, _mm256_set1_ps(65535.0f / F16_MULTIPLIER)), _mm256_set1_ps(65535.0f));
+    return _mm256_cvttps_epi32(_mm256_add_ps(clamped, _mm256_set1_ps(0.5f)));
+}
+
+__attribute__((target("avx2"))) static uint32_t avifF16RowToUNorm16AVX2(const uint16_t * src, uint32_t count, uint16_t * dst)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i f16 = _mm256_loadu_si256((const __m256i *)&src[i]);
+        // Packing within 128-bit lanes undoes the interleaving of the unpacking.
+        const __m256i unorm16 = _mm256_packus_epi32(avifF16ToUNorm16AVX2(_mm256_unpacklo_epi16(f16, zero)),
+                                                    avifF16ToUNorm16AVX2(_mm256_unpackhi_epi16(f16, zero)));
+        _mm256_storeu_si256((__m256i *)&dst[i], _mm256_andnot_si256(_mm256_srai_epi16(f16, 15), unorm16));
+    }
+    return i;
+}
+#endif // defined(AVIF_SIMD_AVX2)
+#endif // defined(AVIF_SIMD_SSE2)
+
+// The number of rows converted at a time by avifImageRGBF16ToYUV(). Even, so that the bands of 4:2:0 images start on a chroma
+// row, and small enough for the intermediate 16-bit samples to stay in cache.
+#define AVIF_F16_BAND_HEIGHT 32
+
+// Converts the half float samples of rgb to 16-bit integers first, then converts those to YUV, one band of rows at a time.
+static avifResult avifImageRGBF16ToYUV(avifImage * image, const avifRGBImage * rgb)
+{
+    avifF16RowToUNorm16Func simdRow = NULL;
+#if defined(AVIF_SIMD_SSE2)
+    const uint32_t cpuFeatures = avifGetCPUFeatures();
+    if (cpuFeatures & AVIF_CPU_SSE2) {
+        simdRow = avifF16RowToUNorm16SSE2;
+    }
+#if defined(AVIF_SIMD_AVX2)
+    if (cpuFeatures & AVIF_CPU_AVX2) {
+        simdRow = avifF16RowToUNorm16AVX2;
+    }
+#endif
+#endif
+
+    // The bands are converted into views of image, so its planes are allocated upfront.
+    const avifBool hasAlpha = avifRGBFormatHasAlpha(rgb->format) && !rgb->ignoreAlpha;
+    AVIF_CHECKRES(avifImageAllocatePlanes(image, hasAlpha ? AVIF_PLANES_ALL : AVIF_PLANES_YUV));
+
+    // libsharpyuv converts the whole image at once.
+    const avifBool sharpYUV = rgb->chromaDownsampling == AVIF_CHROMA_DOWNSAMPLING_SHARP_YUV &&
+                              image->yuvFormat == AVIF_PIXEL_FORMAT_YUV420 && !avifRGBFormatIsGray(rgb->format);
+    const uint32_t bandHeight = sharpYUV ? rgb->height : AVIF_F16_BAND_HEIGHT;
+    avifRGBImage band = *rgb;
+    band.isFloat = AVIF_FALSE;
+    band.height = AVIF_MIN(rgb->height, bandHeight);
+    band.pixels = NULL;
+    band.rowBytes = 0;
+    AVIF_CHECKRES(avifRGBImageAllocatePixels(&band));
+
+    const uint32_t sampleCount = rgb->width * avifRGBFormatChannelCount(rgb->format);
+    avifResult result = AVIF_RESULT_OK;
+    for (uint32_t y = 0; (y < rgb->height) && (result == AVIF_RESULT_OK); y += bandHeight) {
+        band.height = AVIF_MIN(bandHeight, rgb->height - y);
+        for (uint32_t j = 0; j < band.height; ++j) {
+            const uint16_t * srcRow = (const uint16_t *)&rgb->pixels[(size_t)(y + j) * rgb->rowBytes];
+            uint16_t * dstRow = (uint16_t *)&band.pixels[(size_t)j * band.rowBytes];
+            const uint32_t simdCount = simdRow ? simdRow(srcRow, sampleCount, dstRow) : 0;
+            avifF16RowToUNorm16(&srcRow[simdCount], sampleCount - simdCount, &dstRow[simdCount]);
+        }
+        const avifCropRect rect = { .x = 0, .y = y, .width = image->width, .height = band.height };
+        avifImage view;
+        avifImageSetDefaults(&view);
+        result = avifImageSetViewRect(&view, image, &rect);
+        if (result == AVIF_RESULT_OK) {
+            result = avifImageRGBToYUV(&view, &band);
+        }
+    }
+    avifRGBImageFreePixels(&band);
+    return result;
+}
+
 avifResult avifImageRGBToYUV(avifImage * image, const avifRGBImage * rgb)
 {
-    if (!rgb->pixels || rgb->format == AVIF_RGB_FORMAT_RGB_565) {
+    if (!rgb->pixels || rgb->format == AVIF_RGB_FORMAT_RGB_565 || rgb->format == AVIF_RGB_FORMAT_RGBA1010102) {
         return AVIF_RESULT_REFORMAT_FAILED;
     }
 
@@ -230,7 +377,7 @@ avifResult avifImageRGBToYUV(avifImage * image, const avifRGBImage * rgb)
     }
 
     if (rgb->isFloat) {
-        return AVIF_RESULT_NOT_IMPLEMENTED;
+        return avifImageRGBF16ToYUV(image, rgb);
     }
 
     const avifBool hasAlpha = avifRGBFormatHasAlpha(rgb->format) && !rgb->ignoreAlpha;
@@ -617,6 +764,7 @@ static void avifFreeYUVToRGBLookUpTables(float ** unormFloatTableY, float ** uno
 }
 
 #define RGB565(R, G, B) ((uint16_t)(((B) >> 3) | (((G) >> 2) << 5) | (((R) >> 3) << 11)))
+#define RGBA1010102(R, G, B, A) ((uint32_t)(R) | ((uint32_t)(G) << 10) | ((uint32_t)(B) << 20) | ((uint32_t)(A) << 30))
 
 static void avifStoreRGB8Pixel(avifRGBFormat format, uint8_t R, uint8_t G, uint8_t B, uint8_t * ptrR, uint8_t * ptrG, uint8_t * ptrB)
 {
@@ -656,9 +804,8 @@ static avifResult avifImageYUVAnyToRGBAnySlow(const avifImage * image,
     const float kr = state->yuv.kr;
     const float kg = state->yuv.kg;
     const float kb = state->yuv.kb;
-    float * unormFloatTableY = NULL;
-    float * unormFloatTableUV = NULL;
-    AVIF_CHECKERR(avifCreateYUVToRGBLookUpTables(&unormFloatTableY, &unormFloatTableUV, image->depth, state), AVIF_RESULT_OUT_OF_MEMORY);
+    const float * const unormFloatTableY = state->unormFloatTableY;
+    const float * const unormFloatTableUV = state->unormFloatTableUV;
     const size_t yuvChannelBytes = state->yuv.channelBytes;
     const uint32_t rgbPixelBytes = state->rgb.pixelBytes;
 
@@ -973,7 +1120,6 @@ static avifResult avifImageYUVAnyToRGBAnySlow(const avifImage * image,
             }
         }
     }
-    avifFreeYUVToRGBLookUpTables(&unormFloatTableY, &unormFloatTableUV);
     return AVIF_RESULT_OK;
 }
 
@@ -983,9 +1129,8 @@ static avifResult avifImageYUV16ToRGB16Color(const avifImage * image, avifRGBIma
     const float kg = state->yuv.kg;
     const float kb = state->yuv.kb;
     const uint32_t rgbPixelBytes = state->rgb.pixelBytes;
-    float * unormFloatTableY = NULL;
-    float * unormFloatTableUV = NULL;
-    AVIF_CHECKERR(avifCreateYUVToRGBLookUpTables(&unormFloatTableY, &unormFloatTableUV, image->depth, state), AVIF_RESULT_OUT_OF_MEMORY);
+    const float * const unormFloatTableY = state->unormFloatTableY;
+    const float * const unormFloatTableUV = state->unormFloatTableUV;
 
     const uint16_t yuvMaxChannel = (uint16_t)state->yuv.maxChannel;
     const float rgbMaxChannelF = state->rgb.maxChannelF;
@@ -1027,7 +1172,6 @@ static avifResult avifImageYUV16ToRGB16Color(const avifImage * image, avifRGBIma
             ptrB += rgbPixelBytes;
         }
     }
-    avifFreeYUVToRGBLookUpTables(&unormFloatTableY, &unormFloatTableUV);
     return AVIF_RESULT_OK;
 }
 
@@ -1037,8 +1181,7 @@ static avifResult avifImageYUV16ToRGB16Mono(const avifImage * image, avifRGBImag
     const float kg = state->yuv.kg;
     const float kb = state->yuv.kb;
     const uint32_t rgbPixelBytes = state->rgb.pixelBytes;
-    float * unormFloatTableY = NULL;
-    AVIF_CHECKERR(avifCreateYUVToRGBLookUpTables(&unormFloatTableY, NULL, image->depth, state), AVIF_RESULT_OUT_OF_MEMORY);
+    const float * const unormFloatTableY = state->unormFloatTableY;
 
     const uint16_t maxChannel = (uint16_t)state->yuv.maxChannel;
     const float maxChannelF = state->rgb.maxChannelF;
@@ -1073,7 +1216,6 @@ static avifResult avifImageYUV16ToRGB16Mono(const avifImage * image, avifRGBImag
             ptrB += rgbPixelBytes;
         }
     }
-    avifFreeYUVToRGBLookUpTables(&unormFloatTableY, NULL);
     return AVIF_RESULT_OK;
 }
 
@@ -1083,9 +1225,8 @@ static avifResult avifImageYUV16ToRGB8Color(const avifImage * image, avifRGBImag
     const float kg = state->yuv.kg;
     const float kb = state->yuv.kb;
     const uint32_t rgbPixelBytes = state->rgb.pixelBytes;
-    float * unormFloatTableY = NULL;
-    float * unormFloatTableUV = NULL;
-    AVIF_CHECKERR(avifCreateYUVToRGBLookUpTables(&unormFloatTableY, &unormFloatTableUV, image->depth, state), AVIF_RESULT_OUT_OF_MEMORY);
+    const float * const unormFloatTableY = state->unormFloatTableY;
+    const float * const unormFloatTableUV = state->unormFloatTableUV;
 
     const uint16_t yuvMaxChannel = (uint16_t)state->yuv.maxChannel;
     const float rgbMaxChannelF = state->rgb.maxChannelF;
@@ -1131,7 +1272,6 @@ static avifResult avifImageYUV16ToRGB8Color(const avifImage * image, avifRGBImag
             ptrB += rgbPixelBytes;
         }
     }
-    avifFreeYUVToRGBLookUpTables(&unormFloatTableY, &unormFloatTableUV);
     return AVIF_RESULT_OK;
 }
 
@@ -1141,8 +1281,7 @@ static avifResult avifImageYUV16ToRGB8Mono(const avifImage * image, avifRGBImage
     const float kg = state->yuv.kg;
     const float kb = state->yuv.kb;
     const uint32_t rgbPixelBytes = state->rgb.pixelBytes;
-    float * unormFloatTableY = NULL;
-    AVIF_CHECKERR(avifCreateYUVToRGBLookUpTables(&unormFloatTableY, NULL, image->depth, state), AVIF_RESULT_OUT_OF_MEMORY);
+    const float * const unormFloatTableY = state->unormFloatTableY;
 
     const uint16_t yuvMaxChannel = (uint16_t)state->yuv.maxChannel;
     const float rgbMaxChannelF = state->rgb.maxChannelF;
@@ -1181,7 +1320,6 @@ static avifResult avifImageYUV16ToRGB8Mono(const avifImage * image, avifRGBImage
             ptrB += rgbPixelBytes;
         }
     }
-    avifFreeYUVToRGBLookUpTables(&unormFloatTableY, NULL);
     return AVIF_RESULT_OK;
 }
 
@@ -1191,9 +1329,8 @@ static avifResult avifImageYUV8ToRGB16Color(const avifImage * image, avifRGBImag
     const float kg = state->yuv.kg;
     const float kb = state->yuv.kb;
     const uint32_t rgbPixelBytes = state->rgb.pixelBytes;
-    float * unormFloatTableY = NULL;
-    float * unormFloatTableUV = NULL;
-    AVIF_CHECKERR(avifCreateYUVToRGBLookUpTables(&unormFloatTableY, &unormFloatTableUV, image->depth, state), AVIF_RESULT_OUT_OF_MEMORY);
+    const float * const unormFloatTableY = state->unormFloatTableY;
+    const float * const unormFloatTableUV = state->unormFloatTableUV;
 
     const float rgbMaxChannelF = state->rgb.maxChannelF;
     for (size_t j = 0; j < image->height; ++j) {
@@ -1229,7 +1366,6 @@ static avifResult avifImageYUV8ToRGB16Color(const avifImage * image, avifRGBImag
             ptrB += rgbPixelBytes;
         }
     }
-    avifFreeYUVToRGBLookUpTables(&unormFloatTableY, &unormFloatTableUV);
     return AVIF_RESULT_OK;
 }
 
@@ -1239,8 +1375,7 @@ static avifResult avifImageYUV8ToRGB16Mono(const avifImage * image, avifRGBImage
     const float kg = state->yuv.kg;
     const float kb = state->yuv.kb;
     const uint32_t rgbPixelBytes = state->rgb.pixelBytes;
-    float * unormFloatTableY = NULL;
-    AVIF_CHECKERR(avifCreateYUVToRGBLookUpTables(&unormFloatTableY, NULL, image->depth, state), AVIF_RESULT_OUT_OF_MEMORY);
+    const float * const unormFloatTableY = state->unormFloatTableY;
 
     const float rgbMaxChannelF = state->rgb.maxChannelF;
     for (size_t j = 0; j < image->height; ++j) {
@@ -1271,7 +1406,6 @@ static avifResult avifImageYUV8ToRGB16Mono(const avifImage * image, avifRGBImage
             ptrB += rgbPixelBytes;
         }
     }
-    avifFreeYUVToRGBLookUpTables(&unormFloatTableY, NULL);
     return AVIF_RESULT_OK;
 }
 
@@ -1314,9 +1448,8 @@ static avifResult avifImageYUV8ToRGB8Color(const avifImage * image, avifRGBImage
     const float kg = state->yuv.kg;
     const float kb = state->yuv.kb;
     const uint32_t rgbPixelBytes = state->rgb.pixelBytes;
-    float * unormFloatTableY = NULL;
-    float * unormFloatTableUV = NULL;
-    AVIF_CHECKERR(avifCreateYUVToRGBLookUpTables(&unormFloatTableY, &unormFloatTableUV, image->depth, state), AVIF_RESULT_OUT_OF_MEMORY);
+    const float * const unormFloatTableY = state->unormFloatTableY;
+    const float * const unormFloatTableUV = state->unormFloatTableUV;
 
     const float rgbMaxChannelF = state->rgb.maxChannelF;
     for (size_t j = 0; j < image->height; ++j) {
@@ -1356,7 +1489,6 @@ static avifResult avifImageYUV8ToRGB8Color(const avifImage * image, avifRGBImage
             ptrB += rgbPixelBytes;
         }
     }
-    avifFreeYUVToRGBLookUpTables(&unormFloatTableY, &unormFloatTableUV);
     return AVIF_RESULT_OK;
 }
 
@@ -1366,8 +1498,7 @@ static avifResult avifImageYUV8ToRGB8Mono(const avifImage * image, avifRGBImage
     const float kg = state->yuv.kg;
     const float kb = state->yuv.kb;
     const uint32_t rgbPixelBytes = state->rgb.pixelBytes;
-    float * unormFloatTableY = NULL;
-    AVIF_CHECKERR(avifCreateYUVToRGBLookUpTables(&unormFloatTableY, NULL, image->depth, state), AVIF_RESULT_OUT_OF_MEMORY);
+    const float * const unormFloatTableY = state->unormFloatTableY;
 
     const float rgbMaxChannelF = state->rgb.maxChannelF;
     for (size_t j = 0; j < image->height; ++j) {
@@ -1402,48 +1533,1316 @@ static avifResult avifImageYUV8ToRGB8Mono(const avifImage * image, avifRGBImage
             ptrB += rgbPixelBytes;
         }
     }
-    avifFreeYUVToRGBLookUpTables(&unormFloatTableY, NULL);
     return AVIF_RESULT_OK;
 }
 
-// This constant comes from libyuv. For details, see here:
-// https://chromium.googlesource.com/libyuv/libyuv/+/2f87e9a7/source/row_common.cc#3537
-#define F16_MULTIPLIER 1.9259299444e-34f
+// Converts the first samples of a row of count chroma samples to ((sample - bias) / range) floats, blended with
+// adjacentRow as in avifChromaRowToFloat() if it is not NULL. The samples are 8-bit, or 16-bit and clamped to maxChannel,
+// depending on the function. Returns the number of samples converted.
+typedef uint32_t (*avifChromaRowToFloatSIMDFunc)(const uint8_t * row,
+                                                 const uint8_t * adjacentRow,
+                                                 uint32_t count,
+                                                 float bias,
+                                                 float range,
+                                                 float maxChannel,
+                                                 float * dst);
+
+// Converts count unorm samples of a row to floats using table. If adjacentRow is not NULL, each sample is blended with the
+// sample of adjacentRow at the same column, with the weights of vertical bilinear upsampling (3/4 and 1/4).
+// simdRow is optional and must match the sample size, with the bias and range of table.
+static void avifChromaRowToFloat(const uint8_t * row,
+                                 const uint8_t * adjacentRow,
+                                 uint32_t count,
+                                 const avifReformatState * state,
+                                 const float * table,
+                                 avifChromaRowToFloatSIMDFunc simdRow,
+                                 float * dst)
+{
+    const uint32_t converted =
+        simdRow ? simdRow(row, adjacentRow, count, state->yuv.biasUV, state->yuv.rangeUV, (float)state->yuv.maxChannel, dst) : 0;
+    if (state->yuv.depth == 8) {
+        if (adjacentRow) {
+            for (uint32_t i = converted; i < count; ++i) {
+                dst[i] = (table[row[i]] * 0.75f) + (table[adjacentRow[i]] * 0.25f);
+            }
+        } else {
+            for (uint32_t i = converted; i < count; ++i) {
+                dst[i] = table[row[i]];
+            }
+        }
+    } else {
+        // clamp incoming data to protect against bad LUT lookups
+        const uint16_t yuvMaxChannel = (uint16_t)state->yuv.maxChannel;
+        const uint16_t * row16 = (const uint16_t *)row;
+        const uint16_t * adjacentRow16 = (const uint16_t *)adjacentRow;
+        if (adjacentRow16) {
+            for (uint32_t i = converted; i < count; ++i) {
+                dst[i] = (table[AVIF_MIN(row16[i], yuvMaxChannel)] * 0.75f) +
+                         (table[AVIF_MIN(adjacentRow16[i], yuvMaxChannel)] * 0.25f);
+            }
+        } else {
+            for (uint32_t i = converted; i < count; ++i) {
+                dst[i] = table[AVIF_MIN(row16[i], yuvMaxChannel)];
+            }
+        }
+    }
+}
 
-typedef union avifF16
+// Computes the output pairs [1, returned value) of avifUpsampleChromaRow(), where last is the index of the last sample of
+// src. Pair 0 is left to the caller because it has no sample on its left.
+typedef uint32_t (*avifUpsampleChromaPairsFunc)(const float * src, uint32_t last, float * dst);
+
+// Upsamples a row of horizontally subsampled chroma values to width values, with the weights of horizontal bilinear
+// upsampling (3/4 for the closest sample and 1/4 for the adjacent one). Samples are duplicated at the edges.
+// simdPairs is optional.
+static void avifUpsampleChromaRow(const float * src, uint32_t width, avifUpsampleChromaPairsFunc simdPairs, float * dst)
 {
-    float f;
-    uint32_t u32;
-} avifF16;
+    const uint32_t last = ((width + 1) >> 1) - 1;
+    const uint32_t pairs = width >> 1;
+    for (uint32_t i = 0; i < pairs;) {
+        const float closest = src[i] * 0.75f;
+        dst[2 * i] = closest + (src[(i == 0) ? 0 : (i - 1)] * 0.25f);
+        dst[2 * i + 1] = closest + (src[AVIF_MIN(i + 1, last)] * 0.25f);
+        ++i;
+        if (i == 1 && simdPairs) {
+            i = simdPairs(src, last, dst);
+        }
+    }
+    if (width & 1) {
+        dst[width - 1] = (src[last] * 0.75f) + (src[(last == 0) ? 0 : (last - 1)] * 0.25f);
+    }
+}
+
+#if defined(AVIF_SIMD_SSE2)
 
-static avifResult avifRGBImageToF16(avifRGBImage * rgb)
+// Constants of the conversion of Y and float chroma samples to RGB pixels of 4 samples by the SIMD kernels of
+// avifImageYUVToRGBColorBilinear(). They give the same results as the scalar conversion loop.
+typedef struct avifYUVToRGBAConstants
 {
-    avifResult libyuvResult = AVIF_RESULT_NOT_IMPLEMENTED;
-    if (!rgb->avoidLibYUV) {
-        libyuvResult = avifRGBImageToF16LibYUV(rgb);
+    float biasY;
+    float rangeY;
+    float maxChannelY; // Y samples are clamped to this value, as in the scalar loop.
+    float crToR;       // 2 * (1 - kr)
+    float cbToB;       // 2 * (1 - kb)
+    float crToG;       // kr * (1 - kr)
+    float cbToG;       // kb * (1 - kb)
+    float kg;
+    float maxChannel; // Of the RGB samples.
+    // A pixel is made of one 32-bit word for 8-bit samples, or two for 16-bit samples. shiftR[w] is the bit position of
+    // the R sample in the little-endian word w, or 32 if it is in the other word, which shifts it out.
+    int shiftR[2];
+    int shiftG[2];
+    int shiftB[2];
+    int keepMask[2]; // Bits of each word of the pixel not written by the color conversion (alpha).
+} avifYUVToRGBAConstants;
+
+// Sets the shifts of the channel at offsetBytes in a pixel of avifYUVToRGBAConstants, and clears its bits in keepMask.
+static void avifSetYUVToRGBAChannelShifts(uint32_t offsetBytes, uint32_t channelMask, int shift[2], uint32_t keepMask[2])
+{
+    const uint32_t word = offsetBytes / 4;
+    const uint32_t bitShift = 8 * (offsetBytes % 4);
+    shift[word] = (int)bitShift;
+    shift[1 - word] = 32;
+    keepMask[word] &= ~(channelMask << bitShift);
+}
+
+// Converts the first pixels of a row of Y samples and upsampled chroma samples to dst, leaving the alpha samples
+// untouched. The Y and RGB sample sizes depend on the function. Returns the number of pixels converted.
+typedef uint32_t (*avifYUVToRGBARowFunc)(const uint8_t * ptrY,
+                                         const float * rowCb,
+                                         const float * rowCr,
+                                         uint32_t width,
+                                         const avifYUVToRGBAConstants * constants,
+                                         uint8_t * dst);
+
+// Returns ((min(samples, maxChannel) - bias) / range) as in the look-up tables of avifCreateYUVToRGBLookUpTables().
+static inline __m128 avifUNormToFloatSSE2(__m128i samples, __m128 maxChannel, __m128 bias, __m128 range)
+{
+    return _mm_div_ps(_mm_sub_ps(_mm_min_ps(_mm_cvtepi32_ps(samples), maxChannel), bias), range);
+}
+
+// avifUpsampleChromaPairsFunc computing 4 pairs at a time.
+static uint32_t avifUpsampleChromaPairsSSE2(const float * src, uint32_t last, float * dst)
+{
+    const __m128 closestWeight = _mm_set1_ps(0.75f);
+    const __m128 adjacentWeight = _mm_set1_ps(0.25f);
+    uint32_t i = 1;
+    for (; i + 4 <= last; i += 4) {
+        const __m128 closest = _mm_mul_ps(_mm_loadu_ps(src + i), closestWeight);
+        const __m128 even = _mm_add_ps(closest, _mm_mul_ps(_mm_loadu_ps(src + i - 1), adjacentWeight));
+        const __m128 odd = _mm_add_ps(closest, _mm_mul_ps(_mm_loadu_ps(src + i + 1), adjacentWeight));
+        _mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(even, odd));
+        _mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(even, odd));
     }
-    if (libyuvResult != AVIF_RESULT_NOT_IMPLEMENTED) {
-        return libyuvResult;
+    return i;
+}
+
+// avifChromaRowToFloatSIMDFunc converting 8 samples of 8 bits at a time.
+static uint32_t avifChroma8RowToFloatSSE2(const uint8_t * row,
+                                          const uint8_t * adjacentRow,
+                                          uint32_t count,
+                                          float bias,
+                                          float range,
+                                          float maxChannel,
+                                          float * dst)
+{
+    (void)maxChannel; // 8-bit samples cannot exceed it.
+    const __m128 biasV = _mm_set1_ps(bias);
+    const __m128 rangeV = _mm_set1_ps(range);
+    const __m128 closestWeight = _mm_set1_ps(0.75f);
+    const __m128 adjacentWeight = _mm_set1_ps(0.25f);
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i samples = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(row + i)), zero);
+        __m128 low = _mm_div_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(samples, zero)), biasV), rangeV);
+        __m128 high = _mm_div_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(samples, zero)), biasV), rangeV);
+        if (adjacentRow) {
+            const __m128i adjacent = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(adjacentRow + i)), zero);
+            const __m128 adjacentLow =
+                _mm_div_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(adjacent, zero)), biasV), rangeV);
+            const __m128 adjacentHigh =
+                _mm_div_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(adjacent, zero)), biasV), rangeV);
+            low = _mm_add_ps(_mm_mul_ps(low, closestWeight), _mm_mul_ps(adjacentLow, adjacentWeight));
+            high = _mm_add_ps(_mm_mul_ps(high, closestWeight), _mm_mul_ps(adjacentHigh, adjacentWeight));
+        }
+        _mm_storeu_ps(dst + i, low);
+        _mm_storeu_ps(dst + i + 4, high);
+    }
+    return i;
+}
+
+// avifChromaRowToFloatSIMDFunc converting 8 samples of 16 bits at a time.
+static uint32_t avifChroma16RowToFloatSSE2(const uint8_t * row,
+                                           const uint8_t * adjacentRow,
+                                           uint32_t count,
+                                           float bias,
+                                           float range,
+                                           float maxChannel,
+                                           float * dst)
+{
+    const uint16_t * row16 = (const uint16_t *)row;
+    const uint16_t * adjacentRow16 = (const uint16_t *)adjacentRow;
+    const __m128 biasV = _mm_set1_ps(bias);
+    const __m128 rangeV = _mm_set1_ps(range);
+    const __m128 maxChannelV = _mm_set1_ps(maxChannel);
+    const __m128 closestWeight = _mm_set1_ps(0.75f);
+    const __m128 adjacentWeight = _mm_set1_ps(0.25f);
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i samples = _mm_loadu_si128((const __m128i *)(row16 + i));
+        __m128 low = avifUNormToFloatSSE2(_mm_unpacklo_epi16(samples, zero), maxChannelV, biasV, rangeV);
+        __m128 high = avifUNormToFloatSSE2(_mm_unpackhi_epi16(samples, zero), maxChannelV, biasV, rangeV);
+        if (adjacentRow16) {
+            const __m128i adjacent = _mm_loadu_si128((const __m128i *)(adjacentRow16 + i));
+            const __m128 adjacentLow = avifUNormToFloatSSE2(_mm_unpacklo_epi16(adjacent, zero), maxChannelV, biasV, rangeV);
+            const __m128 adjacentHigh = avifUNormToFloatSSE2(_mm_unpackhi_epi16(adjacent, zero), maxChannelV, biasV, rangeV);
+            low = _mm_add_ps(_mm_mul_ps(low, closestWeight), _mm_mul_ps(adjacentLow, adjacentWeight));
+            high = _mm_add_ps(_mm_mul_ps(high, closestWeight), _mm_mul_ps(adjacentHigh, adjacentWeight));
+        }
+        _mm_storeu_ps(dst + i, low);
+        _mm_storeu_ps(dst + i + 4, high);
+    }
+    return i;
+}
+
+// avifYUVToRGBARowFunc converting 4 pixels at a time, from 8-bit or 16-bit Y samples (y16) to 8-bit or 16-bit RGB
+// samples (rgb16).
+static inline uint32_t avifYUVToRGBARowSSE2Impl(const uint8_t * ptrY,
+                                                const float * rowCb,
+                                                const float * rowCr,
+                                                uint32_t width,
+                                                const avifYUVToRGBAConstants * constants,
+                                                uint8_t * dst,
+                                                avifBool y16,
+                                                avifBool rgb16)
+{
+    const __m128 biasY = _mm_set1_ps(constants->biasY);
+    const __m128 rangeY = _mm_set1_ps(constants->rangeY);
+    const __m128 maxChannelY = _mm_set1_ps(constants->maxChannelY);
+    const __m128 crToR = _mm_set1_ps(constants->crToR);
+    const __m128 cbToB = _mm_set1_ps(constants->cbToB);
+    const __m128 crToG = _mm_set1_ps(constants->crToG);
+    const __m128 cbToG = _mm_set1_ps(constants->cbToG);
+    const __m128 kg = _mm_set1_ps(constants->kg);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 maxChannel = _mm_set1_ps(constants->maxChannel);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i shiftR0 = _mm_cvtsi32_si128(constants->shiftR[0]);
+    const __m128i shiftG0 = _mm_cvtsi32_si128(constants->shiftG[0]);
+    const __m128i shiftB0 = _mm_cvtsi32_si128(constants->shiftB[0]);
+    const __m128i shiftR1 = _mm_cvtsi32_si128(constants->shiftR[1]);
+    const __m128i shiftG1 = _mm_cvtsi32_si128(constants->shiftG[1]);
+    const __m128i shiftB1 = _mm_cvtsi32_si128(constants->shiftB[1]);
+    const __m128i keepMask =
+        _mm_set_epi32(constants->keepMask[1], constants->keepMask[0], constants->keepMask[1], constants->keepMask[0]);
+    const __m128i zeroi = _mm_setzero_si128();
+
+    uint32_t i = 0;
+    for (; i + 4 <= width; i += 4) {
+        __m128i unormY;
+        if (y16) {
+            unormY = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)(ptrY + (size_t)i * 2)), zeroi);
+        } else {
+            int32_t y4;
+            memcpy(&y4, ptrY + i, sizeof(y4));
+            unormY = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(y4), zeroi), zeroi);
+        }
+        const __m128 Y = avifUNormToFloatSSE2(unormY, maxChannelY, biasY, rangeY);
+        const __m128 Cb = _mm_loadu_ps(rowCb + i);
+        const __m128 Cr = _mm_loadu_ps(rowCr + i);
+
+        const __m128 R = _mm_add_ps(Y, _mm_mul_ps(crToR, Cr));
+        const __m128 B = _mm_add_ps(Y, _mm_mul_ps(cbToB, Cb));
+        const __m128 sumG = _mm_add_ps(_mm_mul_ps(crToG, Cr), _mm_mul_ps(cbToG, Cb));
+        const __m128 G = _mm_sub_ps(Y, _mm_div_ps(_mm_mul_ps(two, sumG), kg));
+        const __m128 Rc = _mm_min_ps(_mm_max_ps(R, zero), one);
+        const __m128 Gc = _mm_min_ps(_mm_max_ps(G, zero), one);
+        const __m128 Bc = _mm_min_ps(_mm_max_ps(B, zero), one);
+        const __m128i Ri = _mm_cvttps_epi32(_mm_add_ps(half, _mm_mul_ps(Rc, maxChannel)));
+        const __m128i Gi = _mm_cvttps_epi32(_mm_add_ps(half, _mm_mul_ps(Gc, maxChannel)));
+        const __m128i Bi = _mm_cvttps_epi32(_mm_add_ps(half, _mm_mul_ps(Bc, maxChannel)));
+
+        const __m128i words0 =
+            _mm_or_si128(_mm_or_si128(_mm_sll_epi32(Ri, shiftR0), _mm_sll_epi32(Gi, shiftG0)), _mm_sll_epi32(Bi, shiftB0));
+        if (rgb16) {
+            const __m128i words1 =
+                _mm_or_si128(_mm_or_si128(_mm_sll_epi32(Ri, shiftR1), _mm_sll_epi32(Gi, shiftG1)), _mm_sll_epi32(Bi, shiftB1));
+            __m128i * const dst2 = (__m128i *)(dst + (size_t)i * 8);
+            const __m128i low = _mm_unpacklo_epi32(words0, words1);
+            const __m128i high = _mm_unpackhi_epi32(words0, words1);
+            _mm_storeu_si128(dst2, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(dst2), keepMask), low));
+            _mm_storeu_si128(dst2 + 1, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(dst2 + 1), keepMask), high));
+        } else {
+            __m128i * const dst4 = (__m128i *)(dst + (size_t)i * 4);
+            _mm_storeu_si128(dst4, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(dst4), keepMask), words0));
+        }
+    }
+    return i;
+}
+
+static uint32_t avifYUV8ToRGBA8RowSSE2(const uint8_t * ptrY,
+                                       const float * rowCb,
+                                       const float * rowCr,
+                                       uint32_t width,
+                                       const avifYUVToRGBAConstants * constants,
+                                       uint8_t * dst)
+{
+    return avifYUVToRGBARowSSE2Impl(ptrY, rowCb, rowCr, width, constants, dst, AVIF_FALSE, AVIF_FALSE);
+}
+
+static uint32_t avifYUV8ToRGBA16RowSSE2(const uint8_t * ptrY,
+                                        const float * rowCb,
+                                        const float * rowCr,
+                                        uint32_t width,
+                                        const avifYUVToRGBAConstants * constants,
+                                        uint8_t * dst)
+{
+    return avifYUVToRGBARowSSE2Impl(ptrY, rowCb, rowCr, width, constants, dst, AVIF_FALSE, AVIF_TRUE);
+}
+
+static uint32_t avifYUV16ToRGBA8RowSSE2(const uint8_t * ptrY,
+                                        const float * rowCb,
+                                        const float * rowCr,
+                                        uint32_t width,
+                                        const avifYUVToRGBAConstants * constants,
+                                        uint8_t * dst)
+{
+    return avifYUVToRGBARowSSE2Impl(ptrY, rowCb, rowCr, width, constants, dst, AVIF_TRUE, AVIF_FALSE);
+}
+
+static uint32_t avifYUV16ToRGBA16RowSSE2(const uint8_t * ptrY,
+                                         const float * rowCb,
+                                         const float * rowCr,
+                                         uint32_t width,
+                                         const avifYUVToRGBAConstants * constants,
+                                         uint8_t * dst)
+{
+    return avifYUVToRGBARowSSE2Impl(ptrY, rowCb, rowCr, width, constants, dst, AVIF_TRUE, AVIF_TRUE);
+}
+
+#if defined(AVIF_SIMD_AVX2)
+
+// Same as avifUNormToFloatSSE2() for 8 samples.
+__attribute__((target("avx2"))) static inline __m256 avifUNormToFloatAVX2(__m256i samples,
+                                                                         __m256 maxChannel,
+                                                                         __m256 bias,
+                                                                         __m256 range)
+{
+    return _mm256_div_ps(_mm256_sub_ps(_mm256_min_ps(_mm256_cvtepi32_ps(samples), maxChannel), bias), range);
+}
+
+// avifUpsampleChromaPairsFunc computing 8 pairs at a time.
+__attribute__((target("avx2"))) static uint32_t avifUpsampleChromaPairsAVX2(const float * src, uint32_t last, float * dst)
+{
+    const __m256 closestWeight = _mm256_set1_ps(0.75f);
+    const __m256 adjacentWeight = _mm256_set1_ps(0.25f);
+    uint32_t i = 1;
+    for (; i + 8 <= last; i += 8) {
+        const __m256 closest = _mm256_mul_ps(_mm256_loadu_ps(src + i), closestWeight);
+        const __m256 even = _mm256_add_ps(closest, _mm256_mul_ps(_mm256_loadu_ps(src + i - 1), adjacentWeight));
+        const __m256 odd = _mm256_add_ps(closest, _mm256_mul_ps(_mm256_loadu_ps(src + i + 1), adjacentWeight));
+        // Unpacking interleaves within each 128-bit lane, so gather the lanes back in order.
+        const __m256 low = _mm256_unpacklo_ps(even, odd);
+        const __m256 high = _mm256_unpackhi_ps(even, odd);
+        _mm256_storeu_ps(dst + 2 * i, _mm256_permute2f128_ps(low, high, 0x20));
+        _mm256_storeu_ps(dst + 2 * i + 8, _mm256_permute2f128_ps(low, high, 0x31));
+    }
+    return i;
+}
+
+// avifChromaRowToFloatSIMDFunc converting 8 samples of 8 bits at a time.
+__attribute__((target("avx2"))) static uint32_t avifChroma8RowToFloatAVX2(const uint8_t * row,
+                                                                          const uint8_t * adjacentRow,
+                                                                          uint32_t count,
+                                                                          float bias,
+                                                                          float range,
+                                                                          float maxChannel,
+                                                                          float * dst)
+{
+    (void)maxChannel; // 8-bit samples cannot exceed it.
+    const __m256 biasV = _mm256_set1_ps(bias);
+    const __m256 rangeV = _mm256_set1_ps(range);
+    const __m256 closestWeight = _mm256_set1_ps(0.75f);
+    const __m256 adjacentWeight = _mm256_set1_ps(0.25f);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i samples = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(row + i)));
+        __m256 values = _mm256_div_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(samples), biasV), rangeV);
+        if (adjacentRow) {
+            const __m256i adjacent = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(adjacentRow + i)));
+            const __m256 adjacentValues = _mm256_div_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(adjacent), biasV), rangeV);
+            values = _mm256_add_ps(_mm256_mul_ps(values, closestWeight), _mm256_mul_ps(adjacentValues, adjacentWeight));
+        }
+        _mm256_storeu_ps(dst + i, values);
     }
-    const size_t channelCount = avifRGBFormatChannelCount(rgb->format);
-    const float scale = 1.0f / ((1 << rgb->depth) - 1);
-    const float multiplier = F16_MULTIPLIER * scale;
-    uint16_t * pixelRowBase = (uint16_t *)rgb->pixels;
-    const uint32_t stride = rgb->rowBytes >> 1;
-    for (size_t j = 0; j < rgb->height; ++j) {
-        uint16_t * pixel = pixelRowBase;
-        for (size_t i = 0; i < rgb->width * channelCount; ++i, ++pixel) {
-            avifF16 f16;
-            f16.f = *pixel * multiplier;
-            *pixel = (uint16_t)(f16.u32 >> 13);
+    return i;
+}
+
+// avifChromaRowToFloatSIMDFunc converting 8 samples of 16 bits at a time.
+__attribute__((target("avx2"))) static uint32_t avifChroma16RowToFloatAVX2(const uint8_t * row,
+                                                                           const uint8_t * adjacentRow,
+                                                                           uint32_t count,
+                                                                           float bias,
+                                                                           float range,
+                                                                           float maxChannel,
+                                                                           float * dst)
+{
+    const uint16_t * row16 = (const uint16_t *)row;
+    const uint16_t * adjacentRow16 = (const uint16_t *)adjacentRow;
+    const __m256 biasV = _mm256_set1_ps(bias);
+    const __m256 rangeV = _mm256_set1_ps(range);
+    const __m256 maxChannelV = _mm256_set1_ps(maxChannel);
+    const __m256 closestWeight = _mm256_set1_ps(0.75f);
+    const __m256 adjacentWeight = _mm256_set1_ps(0.25f);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i samples = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(row16 + i)));
+        __m256 values = avifUNormToFloatAVX2(samples, maxChannelV, biasV, rangeV);
+        if (adjacentRow16) {
+            const __m256i adjacent = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(adjacentRow16 + i)));
+            const __m256 adjacentValues = avifUNormToFloatAVX2(adjacent, maxChannelV, biasV, rangeV);
+            values = _mm256_add_ps(_mm256_mul_ps(values, closestWeight), _mm256_mul_ps(adjacentValues, adjacentWeight));
+        }
+        _mm256_storeu_ps(dst + i, values);
+    }
+    return i;
+}
+
+// Same as avifYUVToRGBARowSSE2Impl() with 8 pixels at a time.
+__attribute__((target("avx2"))) static inline uint32_t avifYUVToRGBARowAVX2Impl(const uint8_t * ptrY,
+                                                                                const float * rowCb,
+                                                                                const float * rowCr,
+                                                                                uint32_t width,
+                                                                                const avifYUVToRGBAConstants * constants,
+                                                                                uint8_t * dst,
+                                                                                avifBool y16,
+                                                                                avifBool rgb16)
+{
+    const __m256 biasY = _mm256_set1_ps(constants->biasY);
+    const __m256 rangeY = _mm256_set1_ps(constants->rangeY);
+    const __m256 maxChannelY = _mm256_set1_ps(constants->maxChannelY);
+    const __m256 crToR = _mm256_set1_ps(constants->crToR);
+    const __m256 cbToB = _mm256_set1_ps(constants->cbToB);
+    const __m256 crToG = _mm256_set1_ps(constants->crToG);
+    const __m256 cbToG = _mm256_set1_ps(constants->cbToG);
+    const __m256 kg = _mm256_set1_ps(constants->kg);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 maxChannel = _mm256_set1_ps(constants->maxChannel);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m128i shiftR0 = _mm_cvtsi32_si128(constants->shiftR[0]);
+    const __m128i shiftG0 = _mm_cvtsi32_si128(constants->shiftG[0]);
+    const __m128i shiftB0 = _mm_cvtsi32_si128(constants->shiftB[0]);
+    const __m128i shiftR1 = _mm_cvtsi32_si128(constants->shiftR[1]);
+    const __m128i shiftG1 = _mm_cvtsi32_si128(constants->shiftG[1]);
+    const __m128i shiftB1 = _mm_cvtsi32_si128(constants->shiftB[1]);
+    const __m256i keepMask = _mm256_set_epi32(constants->keepMask[1],
+                                              constants->keepMask[0],
+                                              constants->keepMask[1],
+                                              constants->keepMask[0],
+                                              constants->keepMask[1],
+                                              constants->keepMask[0],
+                                              constants->keepMask[1],
+                                              constants->keepMask[0]);
+
+    uint32_t i = 0;
+    for (; i + 8 <= width; i += 8) {
+        const __m256i unormY = y16 ? _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(ptrY + (size_t)i * 2)))
+                                   : _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(ptrY + i)));
+        const __m256 Y = avifUNormToFloatAVX2(unormY, maxChannelY, biasY, rangeY);
+        const __m256 Cb = _mm256_loadu_ps(rowCb + i);
+        const __m256 Cr = _mm256_loadu_ps(rowCr + i);
+
+        const __m256 R = _mm256_add_ps(Y, _mm256_mul_ps(crToR, Cr));
+        const __m256 B = _mm256_add_ps(Y, _mm256_mul_ps(cbToB, Cb));
+        const __m256 sumG = _mm256_add_ps(_mm256_mul_ps(crToG, Cr), _mm256_mul_ps(cbToG, Cb));
+        const __m256 G = _mm256_sub_ps(Y, _mm256_div_ps(_mm256_mul_ps(two, sumG), kg));
+        const __m256 Rc = _mm256_min_ps(_mm256_max_ps(R, zero), one);
+        const __m256 Gc = _mm256_min_ps(_mm256_max_ps(G, zero), one);
+        const __m256 Bc = _mm256_min_ps(_mm256_max_ps(B, zero), one);
+        const __m256i Ri = _mm256_cvttps_epi32(_mm256_add_ps(half, _mm256_mul_ps(Rc, maxChannel)));
+        const __m256i Gi = _mm256_cvttps_epi32(_mm256_add_ps(half, _mm256_mul_ps(Gc, maxChannel)));
+        const __m256i Bi = _mm256_cvttps_epi32(_mm256_add_ps(half, _mm256_mul_ps(Bc, maxChannel)));
+
+        const __m256i words0 = _mm256_or_si256(_mm256_or_si256(_mm256_sll_epi32(Ri, shiftR0), _mm256_sll_epi32(Gi, shiftG0)),
+                                               _mm256_sll_epi32(Bi, shiftB0));
+        if (rgb16) {
+            const __m256i words1 = _mm256_or_si256(_mm256_or_si256(_mm256_sll_epi32(Ri, shiftR1), _mm256_sll_epi32(Gi, shiftG1)),
+                                                   _mm256_sll_epi32(Bi, shiftB1));
+            // Unpacking interleaves within each 128-bit lane, so gather the lanes back in order.
+            const __m256i low = _mm256_unpacklo_epi32(words0, words1);
+            const __m256i high = _mm256_unpackhi_epi32(words0, words1);
+            __m256i * const dst4 = (__m256i *)(dst + (size_t)i * 8);
+            _mm256_storeu_si256(dst4,
+                                _mm256_or_si256(_mm256_and_si256(_mm256_loadu_si256(dst4), keepMask),
+                                                _mm256_permute2x128_si256(low, high, 0x20)));
+            _mm256_storeu_si256(dst4 + 1,
+                                _mm256_or_si256(_mm256_and_si256(_mm256_loadu_si256(dst4 + 1), keepMask),
+                                                _mm256_permute2x128_si256(low, high, 0x31)));
+        } else {
+            __m256i * const dst8 = (__m256i *)(dst + (size_t)i * 4);
+            _mm256_storeu_si256(dst8, _mm256_or_si256(_mm256_and_si256(_mm256_loadu_si256(dst8), keepMask), words0));
         }
-        pixelRowBase += stride;
     }
+    return i;
+}
+
+__attribute__((target("avx2"))) static uint32_t avifYUV8ToRGBA8RowAVX2(const uint8_t * ptrY,
+                                                                       const float * rowCb,
+                                                                       const float * rowCr,
+                                                                       uint32_t width,
+                                                                       const avifYUVToRGBAConstants * constants,
+                                                                       uint8_t * dst)
+{
+    return avifYUVToRGBARowAVX2Impl(ptrY, rowCb, rowCr, width, constants, dst, AVIF_FALSE, AVIF_FALSE);
+}
+
+__attribute__((target("avx2"))) static uint32_t avifYUV8ToRGBA16RowAVX2(const uint8_t * ptrY,
+                                                                        const float * rowCb,
+                                                                        const float * rowCr,
+                                                                        uint32_t width,
+                                                                        const avifYUVToRGBAConstants * constants,
+                                                                        uint8_t * dst)
+{
+    return avifYUVToRGBARowAVX2Impl(ptrY, rowCb, rowCr, width, constants, dst, AVIF_FALSE, AVIF_TRUE);
+}
+
+__attribute__((target("avx2"))) static uint32_t avifYUV16ToRGBA8RowAVX2(const uint8_t * ptrY,
+                                                                        const float * rowCb,
+                                                                        const float * rowCr,
+                                                                        uint32_t width,
+                                                                        const avifYUVToRGBAConstants * constants,
+                                                                        uint8_t * dst)
+{
+    return avifYUVToRGBARowAVX2Impl(ptrY, rowCb, rowCr, width, constants, dst, AVIF_TRUE, AVIF_FALSE);
+}
+
+__attribute__((target("avx2"))) static uint32_t avifYUV16ToRGBA16RowAVX2(const uint8_t * ptrY,
+                                                                         const float * rowCb,
+                                                                         const float * rowCr,
+                                                                         uint32_t width,
+                                                                         const avifYUVToRGBAConstants * constants,
+                                                                         uint8_t * dst)
+{
+    return avifYUVToRGBARowAVX2Impl(ptrY, rowCb, rowCr, width, constants, dst, AVIF_TRUE, AVIF_TRUE);
+}
+
+#endif // defined(AVIF_SIMD_AVX2)
+#endif // defined(AVIF_SIMD_SSE2)
+
+// Converts subsampled (4:2:0 or 4:2:2) YUV to RGB with bilinear chroma upsampling, matching the weights used by
+// avifImageYUVAnyToRGBAnySlow(). The chroma planes are upsampled one row at a time into float buffers (vertically first,
+// then horizontally), so that each pass is a simple loop without per-pixel edge handling.
+static avifResult avifImageYUVToRGBColorBilinear(const avifImage * image, avifRGBImage * rgb, avifReformatState * state)
+{
+    assert(state->yuv.formatInfo.chromaShiftX == 1);
+    const float kr = state->yuv.kr;
+    const float kg = state->yuv.kg;
+    const float kb = state->yuv.kb;
+    const uint32_t rgbPixelBytes = state->rgb.pixelBytes;
+    const uint32_t chromaShiftY = (uint32_t)state->yuv.formatInfo.chromaShiftY;
+    const uint32_t uvWidth = (image->width + 1) >> 1;
+    const uint32_t uvHeight = (image->height + chromaShiftY) >> chromaShiftY;
+
+    float * rowBuffer = (float *)avifAlloc(sizeof(float) * (2 * (size_t)uvWidth + 3 * (size_t)image->width));
+    AVIF_CHECKERR(rowBuffer, AVIF_RESULT_OUT_OF_MEMORY);
+    const float * const unormFloatTableY = state->unormFloatTableY;
+    const float * const unormFloatTableUV = state->unormFloatTableUV;
+    float * const rowU = rowBuffer;
+    float * const rowV = rowU + uvWidth;
+    float * const rowY = rowV + uvWidth;
+    float * const rowCb = rowY + image->width;
+    float * const rowCr = rowCb + image->width;
+
+    // Pick the SIMD kernels supported by the CPU, if any. They give the same results as the scalar loops.
+    // Formats of 3 RGB samples per pixel only use the chroma kernels.
+    avifChromaRowToFloatSIMDFunc chromaRowToFloat = NULL;
+    avifUpsampleChromaPairsFunc upsampleChromaPairs = NULL;
+#if defined(AVIF_SIMD_SSE2)
+    const avifBool rgba = rgbPixelBytes == ((rgb->depth == 8) ? 4u : 8u);
+    // Indexed by (16-bit Y samples) * 2 + (16-bit RGB samples).
+    static const avifYUVToRGBARowFunc yuvToRGBARowsSSE2[4] = { avifYUV8ToRGBA8RowSSE2,
+                                                               avifYUV8ToRGBA16RowSSE2,
+                                                               avifYUV16ToRGBA8RowSSE2,
+                                                               avifYUV16ToRGBA16RowSSE2 };
+    const int rowKernelIndex = ((image->depth > 8) ? 2 : 0) + ((rgb->depth > 8) ? 1 : 0);
+    avifYUVToRGBARowFunc yuvToRGBARow = NULL;
+    const uint32_t cpuFeatures = avifGetCPUFeatures();
+    if (cpuFeatures & AVIF_CPU_SSE2) {
+        chromaRowToFloat = (image->depth == 8) ? avifChroma8RowToFloatSSE2 : avifChroma16RowToFloatSSE2;
+        upsampleChromaPairs = avifUpsampleChromaPairsSSE2;
+        yuvToRGBARow = rgba ? yuvToRGBARowsSSE2[rowKernelIndex] : NULL;
+    }
+#if defined(AVIF_SIMD_AVX2)
+    static const avifYUVToRGBARowFunc yuvToRGBARowsAVX2[4] = { avifYUV8ToRGBA8RowAVX2,
+                                                               avifYUV8ToRGBA16RowAVX2,
+                                                               avifYUV16ToRGBA8RowAVX2,
+                                                               avifYUV16ToRGBA16RowAVX2 };
+    if (cpuFeatures & AVIF_CPU_AVX2) {
+        chromaRowToFloat = (image->depth == 8) ? avifChroma8RowToFloatAVX2 : avifChroma16RowToFloatAVX2;
+        upsampleChromaPairs = avifUpsampleChromaPairsAVX2;
+        yuvToRGBARow = rgba ? yuvToRGBARowsAVX2[rowKernelIndex] : NULL;
+    }
+#endif
+    avifYUVToRGBAConstants constants = { 0 };
+    if (yuvToRGBARow) {
+        constants.biasY = state->yuv.biasY;
+        constants.rangeY = state->yuv.rangeY;
+        constants.maxChannelY = (float)state->yuv.maxChannel;
+        constants.crToR = 2 * (1 - kr);
+        constants.cbToB = 2 * (1 - kb);
+        constants.crToG = kr * (1 - kr);
+        constants.cbToG = kb * (1 - kb);
+        constants.kg = kg;
+        constants.maxChannel = state->rgb.maxChannelF;
+        const uint32_t channelMask = (rgb->depth == 8) ? 0xFFu : 0xFFFFu;
+        uint32_t keepMask[2] = { 0xFFFFFFFFu, 0xFFFFFFFFu };
+        avifSetYUVToRGBAChannelShifts(state->rgb.offsetBytesR, channelMask, constants.shiftR, keepMask);
+        avifSetYUVToRGBAChannelShifts(state->rgb.offsetBytesG, channelMask, constants.shiftG, keepMask);
+        avifSetYUVToRGBAChannelShifts(state->rgb.offsetBytesB, channelMask, constants.shiftB, keepMask);
+        constants.keepMask[0] = (int)keepMask[0];
+        constants.keepMask[1] = (int)((rgb->depth == 8) ? keepMask[0] : keepMask[1]);
+    }
+#endif
+
+    const float rgbMaxChannelF = state->rgb.maxChannelF;
+    for (uint32_t j = 0; j < image->height; ++j) {
+        // Even rows are blended with the chroma row above, odd rows with the chroma row below. 4:2:2 has no vertical
+        // subsampling, and edge rows have no adjacent chroma row on one side.
+        const uint32_t uvJ = j >> chromaShiftY;
+        uint32_t uvAdjacentJ = uvJ;
+        if (chromaShiftY) {
+            if (j & 1) {
+                uvAdjacentJ = AVIF_MIN(uvJ + 1, uvHeight - 1);
+            } else if (uvJ > 0) {
+                uvAdjacentJ = uvJ - 1;
+            }
+        }
+        for (int c = AVIF_CHAN_U; c <= AVIF_CHAN_V; ++c) {
+            const uint8_t * const plane = image->yuvPlanes[c];
+            const size_t rowBytes = image->yuvRowBytes[c];
+            avifChromaRowToFloat(&plane[uvJ * rowBytes],
+                                 (uvAdjacentJ == uvJ) ? NULL : &plane[uvAdjacentJ * rowBytes],
+                                 uvWidth,
+                                 state,
+                                 unormFloatTableUV,
+                                 chromaRowToFloat,
+                                 (c == AVIF_CHAN_U) ? rowU : rowV);
+        }
+        avifUpsampleChromaRow(rowU, image->width, upsampleChromaPairs, rowCb);
+        avifUpsampleChromaRow(rowV, image->width, upsampleChromaPairs, rowCr);
+
+        // The first pixels may be converted by a SIMD kernel, and the remaining ones by the loop below.
+        const uint8_t * const ptrY = &image->yuvPlanes[AVIF_CHAN_Y][j * (size_t)image->yuvRowBytes[AVIF_CHAN_Y]];
+        uint32_t converted = 0;
+#if defined(AVIF_SIMD_SSE2)
+        if (yuvToRGBARow) {
+            converted = yuvToRGBARow(ptrY, rowCb, rowCr, image->width, &constants, &rgb->pixels[j * (size_t)rgb->rowBytes]);
+        }
+#endif
+        if (image->depth == 8) {
+            for (uint32_t i = converted; i < image->width; ++i) {
+                rowY[i] = unormFloatTableY[ptrY[i]];
+            }
+        } else {
+            // clamp incoming data to protect against bad LUT lookups
+            const uint16_t yuvMaxChannel = (uint16_t)state->yuv.maxChannel;
+            for (uint32_t i = converted; i < image->width; ++i) {
+                rowY[i] = unormFloatTableY[AVIF_MIN(((const uint16_t *)ptrY)[i], yuvMaxChannel)];
+            }
+        }
+
+        const size_t rowOffset = (j * (size_t)rgb->rowBytes) + (converted * (size_t)rgbPixelBytes);
+        uint8_t * ptrR = &rgb->pixels[state->rgb.offsetBytesR + rowOffset];
+        uint8_t * ptrG = &rgb->pixels[state->rgb.offsetBytesG + rowOffset];
+        uint8_t * ptrB = &rgb->pixels[state->rgb.offsetBytesB + rowOffset];
+        for (uint32_t i = converted; i < image->width; ++i) {
+            const float Y = rowY[i];
+            const float Cb = rowCb[i];
+            const float Cr = rowCr[i];
+
+            const float R = Y + (2 * (1 - kr)) * Cr;
+            const float B = Y + (2 * (1 - kb)) * Cb;
+            const float G = Y - ((2 * ((kr * (1 - kr) * Cr) + (kb * (1 - kb) * Cb))) / kg);
+            const float Rc = AVIF_CLAMP(R, 0.0f, 1.0f);
+            const float Gc = AVIF_CLAMP(G, 0.0f, 1.0f);
+            const float Bc = AVIF_CLAMP(B, 0.0f, 1.0f);
+
+            if (rgb->depth == 8) {
+                avifStoreRGB8Pixel(rgb->format,
+                                   (uint8_t)(0.5f + (Rc * rgbMaxChannelF)),
+                                   (uint8_t)(0.5f + (Gc * rgbMaxChannelF)),
+                                   (uint8_t)(0.5f + (Bc * rgbMaxChannelF)),
+                                   ptrR,
+                                   ptrG,
+                                   ptrB);
+            } else {
+                *((uint16_t *)ptrR) = (uint16_t)(0.5f + (Rc * rgbMaxChannelF));
+                *((uint16_t *)ptrG) = (uint16_t)(0.5f + (Gc * rgbMaxChannelF));
+                *((uint16_t *)ptrB) = (uint16_t)(0.5f + (Bc * rgbMaxChannelF));
+            }
+
+            ptrR += rgbPixelBytes;
+            ptrG += rgbPixelBytes;
+            ptrB += rgbPixelBytes;
+        }
+    }
+    avifFree(rowBuffer);
     return AVIF_RESULT_OK;
 }
 
+static inline uint16_t avifUNorm16ToF16(uint16_t v)
+{
+    // F16_MULTIPLIER / 65535 is a subnormal float, which is much slower to multiply by on most CPUs, so normalize first.
+    avifF16 f16;
+    f16.f = (v * (1.0f / 65535.0f)) * F16_MULTIPLIER;
+    return (uint16_t)(f16.u32 >> 13);
+}
+
+// Same as the loops of avifRGBRowToF16Impl() for the leading samples that fill whole vectors. The samples of the channel
+// keepIndex of each pixel of channelCount samples are left untouched, if keepIndex is less than channelCount. Returns the
+// number of samples converted.
+typedef uint32_t (*avifUNorm16RowToF16Func)(const uint16_t * src,
+                                            uint32_t count,
+                                            uint16_t * dst,
+                                            uint32_t channelCount,
+                                            uint32_t keepIndex);
+
+// Converts count 16-bit pixels of the format of the destination avifRGBImage (context) at src to half floats at dst.
+static inline void avifRGBRowToF16Impl(const uint16_t * src,
+                                       uint32_t count,
+                                       uint8_t * dst,
+                                       const void * context,
+                                       avifUNorm16RowToF16Func simdRow)
+{
+    const avifRGBImage * rgb = (const avifRGBImage *)context;
+    const uint32_t channelCount = avifRGBFormatChannelCount(rgb->format);
+    const uint32_t sampleCount = count * channelCount;
+    uint16_t * dstF16 = (uint16_t *)dst;
+    if (avifRGBFormatHasAlpha(rgb->format) && rgb->ignoreAlpha) {
+        // The alpha samples of the band were not written. Leave those of rgb untouched, as for integer pixels.
+        const uint32_t alphaIndex =
+            (rgb->format == AVIF_RGB_FORMAT_ARGB || rgb->format == AVIF_RGB_FORMAT_ABGR || rgb->format == AVIF_RGB_FORMAT_AGRAY)
+                ? 0
+                : channelCount - 1;
+        // The SIMD kernels convert whole pixels.
+        const uint32_t simdCount = simdRow ? simdRow(src, sampleCount, dstF16, channelCount, alphaIndex) : 0;
+        for (uint32_t i = simdCount; i < sampleCount; i += channelCount) {
+            for (uint32_t c = 0; c < channelCount; ++c) {
+                if (c != alphaIndex) {
+                    dstF16[i + c] = avifUNorm16ToF16(src[i + c]);
+                }
+            }
+        }
+        return;
+    }
+    if (!rgb->avoidLibYUV && avifRowToF16LibYUV(src, dstF16, sampleCount) == AVIF_RESULT_OK) {
+        return;
+    }
+    const uint32_t simdCount = simdRow ? simdRow(src, sampleCount, dstF16, channelCount, channelCount) : 0;
+    for (uint32_t i = simdCount; i < sampleCount; ++i) {
+        dstF16[i] = avifUNorm16ToF16(src[i]);
+    }
+}
+
+static void avifRGBRowToF16(const uint16_t * src, uint32_t count, uint8_t * dst, const void * context)
+{
+    avifRGBRowToF16Impl(src, count, dst, context, NULL);
+}
+
+#if defined(AVIF_SIMD_SSE2)
+// Converts the 16-bit samples in the 32-bit lanes of unorm16 like avifUNorm16ToF16(). The half floats are less than 0x8000.
+static inline __m128i avifUNorm16ToF16SSE2(__m128i unorm16)
+{
+    const __m128 f = _mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(unorm16), _mm_set1_ps(1.0f / 65535.0f)), _mm_set1_ps(F16_MULTIPLIER));
+    return _mm_srli_epi32(_mm_castps_si128(f), 13);
+}
+
+static uint32_t avifUNorm16RowToF16SSE2(const uint16_t * src,
+                                        uint32_t count,
+                                        uint16_t * dst,
+                                        uint32_t channelCount,
+                                        uint32_t keepIndex)
+{
+    // 8 is a multiple of the channel count of the formats with alpha, so the kept lanes are the same in each vector.
+    int16_t keepLanes[8];
+    for (uint32_t i = 0; i < 8; ++i) {
+        keepLanes[i] = (i % channelCount == keepIndex) ? -1 : 0;
+    }
+    const __m128i keep = _mm_loadu_si128((const __m128i *)keepLanes);
+    const avifBool keepSamples = keepIndex < channelCount;
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i unorm16 = _mm_loadu_si128((const __m128i *)&src[i]);
+        __m128i f16 = _mm_packs_epi32(avifUNorm16ToF16SSE2(_mm_unpacklo_epi16(unorm16, zero)),
+                                      avifUNorm16ToF16SSE2(_mm_unpackhi_epi16(unorm16, zero)));
+        if (keepSamples) {
+            f16 = _mm_or_si128(_mm_and_si128(keep, _mm_loadu_si128((const __m128i *)&dst[i])), _mm_andnot_si128(keep, f16));
+        }
+        _mm_storeu_si128((__m128i *)&dst[i], f16);
+    }
+    return i;
+}
+
+static void avifRGBRowToF16SSE2(const uint16_t * src, uint32_t count, uint8_t * dst, const void * context)
+{
+    avifRGBRowToF16Impl(src, count, dst, context, avifUNorm16RowToF16SSE2);
+}
+
+#if defined(AVIF_SIMD_AVX2)
+__attribute__((target("avx2"))) static inline __m256i avifUNorm16ToF16AVX2(__m256i unorm16)
+{
+    const __m256 normalized = _mm256_mul_ps(_mm256_cvtepi32_ps(unorm16), _mm256_set1_ps(1.0f / 65535.0f));
+    const __m256 f = _mm256_mul_ps(normalized, _mm256_set1_ps(F16_MULTIPLIER));
+    return _mm256_srli_epi32(_mm256_castps_si256(f), 13);
+}
+
+__attribute__((target("avx2"))) static uint32_t avifUNorm16RowToF16AVX2(const uint16_t * src,
+                                                                        uint32_t count,
+                                                                        uint16_t * dst,
+                                                                        uint32_t channelCount,
+                                                                        uint32_t keepIndex)
+{
+    int16_t keepLanes[16];
+    for (uint32_t i = 0; i < 16; ++i) {
+        keepLanes[i] = (i % channelCount == keepIndex) ? -1 : 0;
+    }
+    const __m256i keep = _mm256_loadu_si256((const __m256i *)keepLanes);
+    const avifBool keepSamples = keepIndex < channelCount;
+    const __m256i zero = _mm256_setzero_si256();
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i unorm16 = _mm256_loadu_si256((const __m256i *)&src[i]);
+        // Packing within 128-bit lanes undoes the interleaving of the unpacking.
+        __m256i f16 = _mm256_packus_epi32(avifUNorm16ToF16AVX2(_mm256_unpacklo_epi16(unorm16, zero)),
+                                          avifUNorm16ToF16AVX2(_mm256_unpackhi_epi16(unorm16, zero)));
+        if (keepSamples) {
+            f16 = _mm256_blendv_epi8(f16, _mm256_loadu_si256((const __m256i *)&dst[i]), keep);
+        }
+        _mm256_storeu_si256((__m256i *)&dst[i], f16);
+    }
+    return i;
+}
+
+static void avifRGBRowToF16AVX2(const uint16_t * src, uint32_t count, uint8_t * dst, const void * context)
+{
+    avifRGBRowToF16Impl(src, count, dst, context, avifUNorm16RowToF16AVX2);
+}
+#endif // defined(AVIF_SIMD_AVX2)
+#endif // defined(AVIF_SIMD_SSE2)
+
+// Extends the range [*start, *start + *size) by two samples on each side, within [0, limit), and aligns its start to the
+// chroma subsampling.
+static void avifExpandRangeForChromaUpsampling(uint32_t * start, uint32_t * size, uint32_t limit)
+{
+    const uint32_t end = AVIF_MIN(*start + *size + 2, limit);
+    *start = (*start >= 2) ? ((*start - 2) & ~1u) : 0;
+    *size = end - *start;
+}
+
+// Packs count 10-bit RGBA pixels into RGBA1010102 pixels. context points to the destination avifRGBImage.
+// If the destination is premultiplied, the color samples must not be, and are premultiplied by the 2-bit alpha, so that
+// unpremultiplying the stored pixels gives back the colors.
+static void avifPackRGBA1010102Row(const uint16_t * src, uint32_t count, uint8_t * dst, const void * context)
+{
+    const avifRGBImage * rgb = (const avifRGBImage *)context;
+    const avifBool ignoreAlpha = rgb->ignoreAlpha;
+    const avifBool premultiply = rgb->alphaPremultiplied && !ignoreAlpha;
+    for (uint32_t i = 0; i < count; ++i, src += 4) {
+        // The alpha samples may not have been clamped to 10 bits, unlike the color samples.
+        const uint32_t A = ignoreAlpha ? 3 : ((AVIF_MIN(src[3], 1023u) * 3 + 511) / 1023);
+        if (premultiply && A != 3) {
+            ((uint32_t *)dst)[i] = RGBA1010102((src[0] * A + 1) / 3, (src[1] * A + 1) / 3, (src[2] * A + 1) / 3, A);
+        } else {
+            ((uint32_t *)dst)[i] = RGBA1010102(src[0], src[1], src[2], A);
+        }
+    }
+}
+
+#if defined(AVIF_SIMD_SSE2)
+// Packs the two 10-bit RGBA pixels of pixels as avifPackRGBA1010102Row() does, into the 32-bit lanes 0 and 2 of the returned
+// vector.
+static inline __m128i avifPackRGBA1010102PixelPairSSE2(__m128i pixels, avifBool ignoreAlpha, avifBool premultiply)
+{
+    __m128i alpha;
+    if (ignoreAlpha) {
+        alpha = _mm_set1_epi16(3);
+    } else {
+        // (AVIF_MIN(A, 1023) * 3 + 511) / 1023 is the number of these thresholds that A is greater than. The samples are
+        // offset by 0x8000 for the signed comparisons to behave as unsigned ones.
+        const __m128i sign = _mm_set1_epi16((short)0x8000);
+        const __m128i offsetPixels = _mm_xor_si128(pixels, sign);
+        const __m128i above1 = _mm_cmpgt_epi16(offsetPixels, _mm_xor_si128(_mm_set1_epi16(170), sign));
+        const __m128i above2 = _mm_cmpgt_epi16(offsetPixels, _mm_xor_si128(_mm_set1_epi16(511), sign));
+        const __m128i above3 = _mm_cmpgt_epi16(offsetPixels, _mm_xor_si128(_mm_set1_epi16(852), sign));
+        // The comparisons give -1 when true. Broadcast the alpha lane of each pixel to its four lanes.
+        alpha = _mm_sub_epi16(_mm_setzero_si128(), _mm_add_epi16(_mm_add_epi16(above1, above2), above3));
+        alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        if (premultiply) {
+            // (C * A + 1) / 3 unless A is 3. The division is a multiplication by 0xAAAB / 2^17, exact for 16-bit values.
+            const __m128i product = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), _mm_set1_epi16(1));
+            const __m128i quotient = _mm_srli_epi16(_mm_mulhi_epu16(product, _mm_set1_epi16((short)0xAAAB)), 1);
+            const __m128i opaque = _mm_cmpeq_epi16(alpha, _mm_set1_epi16(3));
+            pixels = _mm_or_si128(_mm_and_si128(opaque, pixels), _mm_andnot_si128(opaque, quotient));
+        }
+    }
+    const __m128i alphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    pixels = _mm_or_si128(_mm_andnot_si128(alphaLanes, pixels), _mm_and_si128(alphaLanes, alpha));
+    // R + (G << 10) and B + (A << 10) in 32-bit lanes, then R | (G << 10) | (B << 20) | (A << 30) in the even lanes.
+    const __m128i sums = _mm_madd_epi16(pixels, _mm_set1_epi32(1 | (1024 << 16)));
+    return _mm_or_si128(sums, _mm_srli_epi64(_mm_slli_epi32(sums, 20), 32));
+}
+
+static void avifPackRGBA1010102RowSSE2(const uint16_t * src, uint32_t count, uint8_t * dst, const void * context)
+{
+    const avifRGBImage * rgb = (const avifRGBImage *)context;
+    const avifBool ignoreAlpha = rgb->ignoreAlpha;
+    const avifBool premultiply = rgb->alphaPremultiplied && !ignoreAlpha;
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i pixels01 = _mm_loadu_si128((const __m128i *)&src[4 * i]);
+        const __m128i pixels23 = _mm_loadu_si128((const __m128i *)&src[4 * i + 8]);
+        const __m128i packed01 = avifPackRGBA1010102PixelPairSSE2(pixels01, ignoreAlpha, premultiply);
+        const __m128i packed23 = avifPackRGBA1010102PixelPairSSE2(pixels23, ignoreAlpha, premultiply);
+        const __m128i packed = _mm_unpacklo_epi64(_mm_shuffle_epi32(packed01, _MM_SHUFFLE(3, 1, 2, 0)),
+                                                  _mm_shuffle_epi32(packed23, _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm_storeu_si128((__m128i *)&dst[4 * i], packed);
+    }
+    avifPackRGBA1010102Row(&src[4 * i], count - i, &dst[4 * i], context);
+}
+
+#if defined(AVIF_SIMD_AVX2)
+// Same as avifPackRGBA1010102PixelPairSSE2() for the two pixel pairs of pixels.
+__attribute__((target("avx2"))) static inline __m256i avifPackRGBA1010102PixelPairsAVX2(__m256i pixels,
+                                                                                        avifBool ignoreAlpha,
+                                                                                        avifBool premultiply)
+{
+    __m256i alpha;
+    if (ignoreAlpha) {
+        alpha = _mm256_set1_epi16(3);
+    } else {
+        const __m256i sign = _mm256_set1_epi16((short)0x8000);
+        const __m256i offsetPixels = _mm256_xor_si256(pixels, sign);
+        const __m256i above1 = _mm256_cmpgt_epi16(offsetPixels, _mm256_xor_si256(_mm256_set1_epi16(170), sign));
+        const __m256i above2 = _mm256_cmpgt_epi16(offsetPixels, _mm256_xor_si256(_mm256_set1_epi16(511), sign));
+        const __m256i above3 = _mm256_cmpgt_epi16(offsetPixels, _mm256_xor_si256(_mm256_set1_epi16(852), sign));
+        alpha = _mm256_sub_epi16(_mm256_setzero_si256(), _mm256_add_epi16(_mm256_add_epi16(above1, above2), above3));
+        alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        if (premultiply) {
+            const __m256i product = _mm256_add_epi16(_mm256_mullo_epi16(pixels, alpha), _mm256_set1_epi16(1));
+            const __m256i quotient = _mm256_srli_epi16(_mm256_mulhi_epu16(product, _mm256_set1_epi16((short)0xAAAB)), 1);
+            const __m256i opaque = _mm256_cmpeq_epi16(alpha, _mm256_set1_epi16(3));
+            pixels = _mm256_blendv_epi8(quotient, pixels, opaque);
+        }
+    }
+    const __m256i alphaLanes = _mm256_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0);
+    pixels = _mm256_blendv_epi8(pixels, alpha, alphaLanes);
+    const __m256i sums = _mm256_madd_epi16(pixels, _mm256_set1_epi32(1 | (1024 << 16)));
+    return _mm256_or_si256(sums, _mm256_srli_epi64(_mm256_slli_epi32(sums, 20), 32));
+}
+
+__attribute__((target("avx2"))) static void avifPackRGBA1010102RowAVX2(const uint16_t * src,
+                                                                       uint32_t count,
+                                                                       uint8_t * dst,
+                                                                       const void * context)
+{
+    const avifRGBImage * rgb = (const avifRGBImage *)context;
+    const avifBool ignoreAlpha = rgb->ignoreAlpha;
+    const avifBool premultiply = rgb->alphaPremultiplied && !ignoreAlpha;
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i pixels0123 = _mm256_loadu_si256((const __m256i *)&src[4 * i]);
+        const __m256i pixels4567 = _mm256_loadu_si256((const __m256i *)&src[4 * i + 16]);
+        const __m256i packed0123 = avifPackRGBA1010102PixelPairsAVX2(pixels0123, ignoreAlpha, premultiply);
+        const __m256i packed4567 = avifPackRGBA1010102PixelPairsAVX2(pixels4567, ignoreAlpha, premultiply);
+        // The 128-bit lanes hold pixels 0, 1, 4, 5 and 2, 3, 6, 7 after the unpacking.
+        const __m256i packed = _mm256_unpacklo_epi64(_mm256_shuffle_epi32(packed0123, _MM_SHUFFLE(3, 1, 2, 0)),
+                                                     _mm256_shuffle_epi32(packed4567, _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm256_storeu_si256((__m256i *)&dst[4 * i], _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    avifPackRGBA1010102RowSSE2(&src[4 * i], count - i, &dst[4 * i], context);
+}
+#endif // defined(AVIF_SIMD_AVX2)
+#endif // defined(AVIF_SIMD_SSE2)
+
+// The number of rows converted at a time by avifImageYUVToRGBInBands(). Small enough for the intermediate 16-bit samples to
+// stay in cache.
+#define AVIF_RGB_BAND_HEIGHT 32
+
+// Converts a row of count intermediate 16-bit pixels at src to count pixels of the destination format at dst.
+typedef void (*avifRGBBandRowFunc)(const uint16_t * src, uint32_t count, uint8_t * dst, const void * context);
+
+static avifResult avifImageYUVToRGBImpl(const avifImage * image,
+                                        avifRGBImage * rgb,
+                                        avifReformatState * state,
+                                        avifAlphaMultiplyMode alphaMultiplyMode);
+
+// Converts image to rgb by converting bands of rows to bandFormat of the given depth (greater than 8) first with the existing
+// conversion paths, then calling rowFunc on each row of each band.
+static avifResult avifImageYUVToRGBInBands(const avifImage * image,
+                                           avifRGBImage * rgb,
+                                           const avifReformatState * state,
+                                           avifRGBFormat bandFormat,
+                                           uint32_t bandDepth,
+                                           avifBool bandIgnoresAlpha,
+                                           avifAlphaMultiplyMode alphaMultiplyMode,
+                                           avifRGBBandRowFunc rowFunc,
+                                           const void * context)
+{
+    avifRGBImage band = *rgb;
+    band.depth = bandDepth;
+    band.format = bandFormat;
+    band.ignoreAlpha = bandIgnoresAlpha;
+    band.isFloat = AVIF_FALSE;
+    band.toneMapToSDR = AVIF_FALSE;
+    band.pixels = NULL;
+    band.rowBytes = 0;
+    // Bands are too small to be worth (un)multiplying alpha with several threads.
+    band.maxThreads = 1;
+    avifReformatState bandState = *state;
+    AVIF_CHECKERR(avifGetRGBColorSpaceInfo(&band, &bandState.rgb), AVIF_RESULT_REFORMAT_FAILED);
+
+    // 4:2:0 chroma upsampling may read the chroma rows around a band, so each band is converted with two rows of context
+    // on each side, as in avifImageYUVToRGBRect().
+    const avifBool bandsNeedContext = (image->yuvFormat == AVIF_PIXEL_FORMAT_YUV420);
+    band.height = AVIF_MIN(image->height, AVIF_RGB_BAND_HEIGHT + (bandsNeedContext ? 4 : 0));
+    AVIF_CHECKRES(avifRGBImageAllocatePixels(&band));
+
+    // Create the look-up tables once for all bands, unless they were created by an avifYUVToRGBPlan.
+    avifBool ownsTables = AVIF_FALSE;
+    if (!bandState.unormFloatTableY) {
+        if (!avifCreateYUVToRGBLookUpTables(&bandState.unormFloatTableY,
+                                            &bandState.unormFloatTableUV,
+                                            image->depth,
+                                            &bandState)) {
+            avifRGBImageFreePixels(&band);
+            return AVIF_RESULT_OUT_OF_MEMORY;
+        }
+        ownsTables = AVIF_TRUE;
+    }
+
+    avifResult result = AVIF_RESULT_OK;
+    for (uint32_t y = 0; (y < image->height) && (result == AVIF_RESULT_OK); y += AVIF_RGB_BAND_HEIGHT) {
+        const uint32_t height = AVIF_MIN(AVIF_RGB_BAND_HEIGHT, image->height - y);
+        avifCropRect rect = { .x = 0, .y = y, .width = image->width, .height = height };
+        if (bandsNeedContext) {
+            avifExpandRangeForChromaUpsampling(&rect.y, &rect.height, image->height);
+        }
+        avifImage view;
+        avifImageSetDefaults(&view);
+        result = avifImageSetViewRect(&view, image, &rect);
+        if (result != AVIF_RESULT_OK) {
+            break;
+        }
+        band.height = rect.height;
+        result = avifImageYUVToRGBImpl(&view, &band, &bandState, alphaMultiplyMode);
+        if (result != AVIF_RESULT_OK) {
+            break;
+        }
+        for (uint32_t j = 0; j < height; ++j) {
+            rowFunc((const uint16_t *)&band.pixels[(size_t)(y - rect.y + j) * band.rowBytes],
+                    rgb->width,
+                    &rgb->pixels[(size_t)(y + j) * rgb->rowBytes],
+                    context);
+        }
+    }
+
+    if (ownsTables) {
+        avifFreeYUVToRGBLookUpTables(&bandState.unormFloatTableY, &bandState.unormFloatTableUV);
+    }
+    avifRGBImageFreePixels(&band);
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// HDR to SDR tone mapping
+
+// The intermediate 16-bit samples are quantized to this number of bits to index the tone mapping look-up tables.
+#define AVIF_TONE_MAPPING_INDEX_BITS 12
+#define AVIF_TONE_MAPPING_INDEX_SIZE (1 << AVIF_TONE_MAPPING_INDEX_BITS)
+// Number of intervals of the piecewise linear approximation of the sRGB OETF.
+#define AVIF_TONE_MAPPING_SRGB_INTERVALS 4096
+// Assumed peak luminance of PQ images without content light level information, as in ITU-R BT.2408.
+#define AVIF_TONE_MAPPING_DEFAULT_PQ_PEAK_NITS 1000.0f
+#define AVIF_TONE_MAPPING_HLG_PEAK_NITS 1000.0f
+#define AVIF_TONE_MAPPING_SDR_WHITE_NITS 203.0f
+
+typedef struct avifToneMappingContext
+{
+    // Linear extended SDR value (1.0 is SDR white) of each quantized PQ or HLG sample.
+    float toLinear[AVIF_TONE_MAPPING_INDEX_SIZE];
+    // Factor applied to the linear values of a pixel, given its greatest quantized sample, to compress its luminance to
+    // the SDR range.
+    float gain[AVIF_TONE_MAPPING_INDEX_SIZE];
+    // sRGB OETF at linear values i / AVIF_TONE_MAPPING_SRGB_INTERVALS, scaled to the output range. The last entry is
+    // repeated so that interpolation can read one entry past 1.0.
+    float toSRGB[AVIF_TONE_MAPPING_SRGB_INTERVALS + 2];
+    avifBool convertsPrimaries;
+    float primaries[3][3]; // Linear conversion from the image color primaries to BT.709.
+
+    avifRGBColorSpaceInfo info; // Destination layout.
+    avifBool writesAlpha;
+    avifBool premultiplies;
+} avifToneMappingContext;
+
+// Maps the linear extended SDR value to [0, 1] with the EETF of ITU-R BT.2390 (referenced by BT.2408) from a source peak of
+// peak to a target peak of SDR white, in the PQ domain.
+static float avifToneMapEETF(float linear, float peak, avifTransferFunction toPQ, avifTransferFunction fromPQ)
+{
+    if (peak <= 1.0f) {
+        return AVIF_MIN(linear, 1.0f);
+    }
+    const float pqPeak = toPQ(peak);
+    const float e1 = AVIF_MIN(toPQ(linear) / pqPeak, 1.0f);
+    const float maxLum = toPQ(1.0f) / pqPeak;
+    const float ks = 1.5f * maxLum - 0.5f;
+    float e2 = e1;
+    if (e1 > ks) {
+        // Hermite spline from the knee at ks to maxLum.
+        const float t = (e1 - ks) / (1.0f - ks);
+        const float t2 = t * t;
+        const float t3 = t2 * t;
+        e2 = (2.0f * t3 - 3.0f * t2 + 1.0f) * ks + (t3 - 2.0f * t2 + t) * (1.0f - ks) + (-2.0f * t3 + 3.0f * t2) * maxLum;
+    }
+    return AVIF_MIN(fromPQ(e2 * pqPeak), 1.0f);
+}
+
+static avifBool avifToneMappingContextInit(avifToneMappingContext * ctx, const avifImage * image, const avifRGBImage * rgb)
+{
+    AVIF_CHECK(avifGetRGBColorSpaceInfo(rgb, &ctx->info));
+
+    const avifTransferFunction toLinear = avifTransferCharacteristicsGetGammaToLinearFunction(image->transferCharacteristics);
+    const avifTransferFunction toPQ = avifTransferCharacteristicsGetLinearToGammaFunction(AVIF_TRANSFER_CHARACTERISTICS_PQ);
+    const avifTransferFunction fromPQ = avifTransferCharacteristicsGetGammaToLinearFunction(AVIF_TRANSFER_CHARACTERISTICS_PQ);
+    float peakNits = AVIF_TONE_MAPPING_HLG_PEAK_NITS;
+    if (image->transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_PQ) {
+        peakNits = image->clli.maxCLL ? AVIF_MIN((float)image->clli.maxCLL, 10000.0f) : AVIF_TONE_MAPPING_DEFAULT_PQ_PEAK_NITS;
+    }
+    const float peak = peakNits / AVIF_TONE_MAPPING_SDR_WHITE_NITS;
+    for (uint32_t i = 0; i < AVIF_TONE_MAPPING_INDEX_SIZE; ++i) {
+        const float linear = toLinear((float)i / (AVIF_TONE_MAPPING_INDEX_SIZE - 1));
+        ctx->toLinear[i] = linear;
+        // The transfer functions are increasing, so the greatest sample of a pixel is its greatest linear value, and
+        // scaling all linear values by the same factor preserves the hue.
+        ctx->gain[i] = (linear > 0.0f) ? avifToneMapEETF(linear, peak, toPQ, fromPQ) / linear : 1.0f;
+    }
+
+    const avifTransferFunction toSRGB = avifTransferCharacteristicsGetLinearToGammaFunction(AVIF_TRANSFER_CHARACTERISTICS_SRGB);
+    for (uint32_t i = 0; i <= AVIF_TONE_MAPPING_SRGB_INTERVALS; ++i) {
+        ctx->toSRGB[i] = toSRGB((float)i / AVIF_TONE_MAPPING_SRGB_INTERVALS) * ctx->info.maxChannelF;
+    }
+    ctx->toSRGB[AVIF_TONE_MAPPING_SRGB_INTERVALS + 1] = ctx->toSRGB[AVIF_TONE_MAPPING_SRGB_INTERVALS];
+
+    double coeffs[3][3];
+    ctx->convertsPrimaries = image->colorPrimaries != AVIF_COLOR_PRIMARIES_BT709 &&
+                             image->colorPrimaries != AVIF_COLOR_PRIMARIES_UNSPECIFIED &&
+                             avifColorPrimariesComputeRGBToRGBMatrix(image->colorPrimaries, AVIF_COLOR_PRIMARIES_BT709, coeffs);
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            ctx->primaries[i][j] = (float)coeffs[i][j];
+        }
+    }
+
+    ctx->writesAlpha = avifRGBFormatHasAlpha(rgb->format) && !rgb->ignoreAlpha;
+    // The band is not premultiplied, so that the colors are tone mapped before being multiplied by alpha. Images with alpha
+    // are rendered on black when the output has no alpha, as in avifImageYUVToRGBWithState().
+    ctx->premultiplies = image->alphaPlane && (!ctx->writesAlpha || rgb->alphaPremultiplied);
+    return AVIF_TRUE;
+}
+
+// Returns the sRGB encoded value of the linear value v, clamped to [0, 1], in the output range.
+static inline float avifToneMappingToSRGB(const avifToneMappingContext * ctx, float v)
+{
+    v = AVIF_CLAMP(v, 0.0f, 1.0f) * AVIF_TONE_MAPPING_SRGB_INTERVALS;
+    const int i = (int)v;
+    return ctx->toSRGB[i] + (v - (float)i) * (ctx->toSRGB[i + 1] - ctx->toSRGB[i]);
+}
+
+// Tone maps count 16-bit PQ or HLG RGBA pixels to the destination format.
+static void avifToneMapRow(const uint16_t * src, uint32_t count, uint8_t * dst, const void * context)
+{
+    const avifToneMappingContext * ctx = (const avifToneMappingContext *)context;
+    const uint32_t shift = 16 - AVIF_TONE_MAPPING_INDEX_BITS;
+    const float alphaScale = ctx->info.maxChannelF / 65535.0f;
+    for (uint32_t i = 0; i < count; ++i, src += 4, dst += ctx->info.pixelBytes) {
+        const uint16_t maxSample = AVIF_MAX(AVIF_MAX(src[0], src[1]), src[2]);
+        const float gain = ctx->gain[maxSample >> shift];
+        float r = ctx->toLinear[src[0] >> shift] * gain;
+        float g = ctx->toLinear[src[1] >> shift] * gain;
+        float b = ctx->toLinear[src[2] >> shift] * gain;
+        if (ctx->convertsPrimaries) {
+            const float r709 = ctx->primaries[0][0] * r + ctx->primaries[0][1] * g + ctx->primaries[0][2] * b;
+            const float g709 = ctx->primaries[1][0] * r + ctx->primaries[1][1] * g + ctx->primaries[1][2] * b;
+            const float b709 = ctx->primaries[2][0] * r + ctx->primaries[2][1] * g + ctx->primaries[2][2] * b;
+            r = r709;
+            g = g709;
+            b = b709;
+        }
+        r = avifToneMappingToSRGB(ctx, r);
+        g = avifToneMappingToSRGB(ctx, g);
+        b = avifToneMappingToSRGB(ctx, b);
+        if (ctx->premultiplies) {
+            const float alpha = src[3] / 65535.0f;
+            r *= alpha;
+            g *= alpha;
+            b *= alpha;
+        }
+
+        if (ctx->info.channelBytes > 1) {
+            *(uint16_t *)&dst[ctx->info.offsetBytesR] = (uint16_t)(r + 0.5f);
+            *(uint16_t *)&dst[ctx->info.offsetBytesG] = (uint16_t)(g + 0.5f);
+            *(uint16_t *)&dst[ctx->info.offsetBytesB] = (uint16_t)(b + 0.5f);
+            if (ctx->writesAlpha) {
+                *(uint16_t *)&dst[ctx->info.offsetBytesA] = (uint16_t)(src[3] * alphaScale + 0.5f);
+            }
+        } else {
+            dst[ctx->info.offsetBytesR] = (uint8_t)(r + 0.5f);
+            dst[ctx->info.offsetBytesG] = (uint8_t)(g + 0.5f);
+            dst[ctx->info.offsetBytesB] = (uint8_t)(b + 0.5f);
+            if (ctx->writesAlpha) {
+                dst[ctx->info.offsetBytesA] = (uint8_t)(src[3] * alphaScale + 0.5f);
+            }
+        }
+    }
+}
+
+// Converts the PQ or HLG image to SDR rgb with the sRGB transfer characteristics and BT.709 primaries, by converting bands
+// of rows to 16-bit AVIF_RGB_FORMAT_RGBA first with the existing conversion paths, then tone mapping each band into rgb.
+static avifResult avifImageYUVToRGBToneMapped(const avifImage * image, avifRGBImage * rgb, const avifReformatState * state)
+{
+    AVIF_CHECKERR(!rgb->isFloat && rgb->format != AVIF_RGB_FORMAT_RGB_565 && rgb->format != AVIF_RGB_FORMAT_RGBA1010102 &&
+                      rgb->format != AVIF_RGB_FORMAT_GRAY && rgb->format != AVIF_RGB_FORMAT_GRAYA &&
+                      rgb->format != AVIF_RGB_FORMAT_AGRAY,
+                  AVIF_RESULT_REFORMAT_FAILED);
+    avifToneMappingContext * ctx = (avifToneMappingContext *)avifAlloc(sizeof(avifToneMappingContext));
+    AVIF_CHECKERR(ctx, AVIF_RESULT_OUT_OF_MEMORY);
+    avifResult result = AVIF_RESULT_REFORMAT_FAILED;
+    if (avifToneMappingContextInit(ctx, image, rgb)) {
+        const avifAlphaMultiplyMode mode = (image->alphaPlane && image->alphaPremultiplied) ? AVIF_ALPHA_MULTIPLY_MODE_UNMULTIPLY
+                                                                                          : AVIF_ALPHA_MULTIPLY_MODE_NO_OP;
+        result = avifImageYUVToRGBInBands(image,
+                                          rgb,
+                                          state,
+                                          AVIF_RGB_FORMAT_RGBA,
+                                          16,
+                                          /*bandIgnoresAlpha=*/AVIF_FALSE,
+                                          mode,
+                                          avifToneMapRow,
+                                          ctx);
+    }
+    avifFree(ctx);
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+
 static avifResult avifImageYUVToRGBImpl(const avifImage * image, avifRGBImage * rgb, avifReformatState * state, avifAlphaMultiplyMode alphaMultiplyMode)
 {
+    if (rgb->toneMapToSDR && (image->transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_PQ ||
+                              image->transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_HLG)) {
+        return avifImageYUVToRGBToneMapped(image, rgb, state);
+    }
+    if (rgb->format == AVIF_RGB_FORMAT_RGBA1010102) {
+        // Convert to 10-bit RGBA first, then pack each band into rgb. Premultiplication is done by avifPackRGBA1010102Row()
+        // with the 2-bit alpha, so convert unpremultiplied colors in that case.
+        if (rgb->alphaPremultiplied && !rgb->ignoreAlpha) {
+            alphaMultiplyMode = (image->alphaPlane && image->alphaPremultiplied) ? AVIF_ALPHA_MULTIPLY_MODE_UNMULTIPLY
+                                                                                 : AVIF_ALPHA_MULTIPLY_MODE_NO_OP;
+        }
+        avifRGBBandRowFunc packRow = avifPackRGBA1010102Row;
+#if defined(AVIF_SIMD_SSE2)
+        const uint32_t cpuFeatures = avifGetCPUFeatures();
+        if (cpuFeatures & AVIF_CPU_SSE2) {
+            packRow = avifPackRGBA1010102RowSSE2;
+        }
+#if defined(AVIF_SIMD_AVX2)
+        if (cpuFeatures & AVIF_CPU_AVX2) {
+            packRow = avifPackRGBA1010102RowAVX2;
+        }
+#endif
+#endif
+        return avifImageYUVToRGBInBands(image,
+                                        rgb,
+                                        state,
+                                        AVIF_RGB_FORMAT_RGBA,
+                                        10,
+                                        rgb->ignoreAlpha,
+                                        alphaMultiplyMode,
+                                        packRow,
+                                        rgb);
+    }
+    if (rgb->isFloat) {
+        // Convert to 16-bit integers first, then to half floats while each band is still in cache, rather than in a second
+        // pass over the whole image.
+        avifRGBBandRowFunc convertRow = avifRGBRowToF16;
+#if defined(AVIF_SIMD_SSE2)
+        const uint32_t cpuFeatures = avifGetCPUFeatures();
+        if (cpuFeatures & AVIF_CPU_SSE2) {
+            convertRow = avifRGBRowToF16SSE2;
+        }
+#if defined(AVIF_SIMD_AVX2)
+        if (cpuFeatures & AVIF_CPU_AVX2) {
+            convertRow = avifRGBRowToF16AVX2;
+        }
+#endif
+#endif
+        return avifImageYUVToRGBInBands(image,
+                                        rgb,
+                                        state,
+                                        rgb->format,
+                                        16,
+                                        rgb->ignoreAlpha,
+                                        alphaMultiplyMode,
+                                        convertRow,
+                                        rgb);
+    }
+
     avifBool convertedWithLibYUV = AVIF_FALSE;
     // Reformat alpha, if user asks for it, or (un)multiply processing needs it.
     avifBool reformatAlpha = avifRGBFormatHasAlpha(rgb->format) &&
@@ -1493,20 +2892,38 @@ static avifResult avifImageYUVToRGBImpl(const avifImage * image, avifRGBImage *
 
         avifResult convertResult = AVIF_RESULT_NOT_IMPLEMENTED;
 
+        // The look-up tables are shared by all the built-in routines. Create them for this conversion only, unless they were
+        // created once by an avifYUVToRGBPlan.
+        avifReformatState stateWithTables;
+        if (!state->unormFloatTableY) {
+            stateWithTables = *state;
+            AVIF_CHECKERR(avifCreateYUVToRGBLookUpTables(&stateWithTables.unormFloatTableY,
+                                                         &stateWithTables.unormFloatTableUV,
+                                                         image->depth,
+                                                         state),
+                          AVIF_RESULT_OUT_OF_MEMORY);
+            state = &stateWithTables;
+        }
+
         const avifBool hasColor =
             (image->yuvRowBytes[AVIF_CHAN_U] && image->yuvRowBytes[AVIF_CHAN_V] && (image->yuvFormat != AVIF_PIXEL_FORMAT_YUV400));
 
+        // Only avifImageYUVToRGBColorBilinear() supports bilinear upsampling of subsampled chroma.
+        const avifBool bilinearChroma = hasColor && (image->yuvFormat != AVIF_PIXEL_FORMAT_YUV444) &&
+                                        (rgb->chromaUpsampling != AVIF_CHROMA_UPSAMPLING_FASTEST) &&
+                                        (rgb->chromaUpsampling != AVIF_CHROMA_UPSAMPLING_NEAREST);
+
         if (!avifRGBFormatIsGray(rgb->format) &&
-            (!hasColor || (image->yuvFormat == AVIF_PIXEL_FORMAT_YUV444) ||
-             ((rgb->chromaUpsampling == AVIF_CHROMA_UPSAMPLING_FASTEST) || (rgb->chromaUpsampling == AVIF_CHROMA_UPSAMPLING_NEAREST))) &&
             (alphaMultiplyMode == AVIF_ALPHA_MULTIPLY_MODE_NO_OP || avifRGBFormatHasAlpha(rgb->format))) {
             // Explanations on the above conditional:
-            // * None of these fast paths currently support bilinear upsampling, so avoid all of them
-            //   unless the YUV data isn't subsampled or they explicitly requested AVIF_CHROMA_UPSAMPLING_NEAREST.
             // * None of these fast paths currently handle alpha (un)multiply, so avoid all of them
             //   if we can't do alpha (un)multiply as a separated post step (destination format doesn't have alpha).
 
-            if (state->yuv.mode == AVIF_REFORMAT_MODE_IDENTITY) {
+            if (bilinearChroma) {
+                if (state->yuv.mode == AVIF_REFORMAT_MODE_YUV_COEFFICIENTS) {
+                    convertResult = avifImageYUVToRGBColorBilinear(image, rgb, state);
+                }
+            } else if (state->yuv.mode == AVIF_REFORMAT_MODE_IDENTITY) {
                 if ((image->depth == 8) && (rgb->depth == 8) && (image->yuvFormat == AVIF_PIXEL_FORMAT_YUV444) &&
                     (image->yuvRange == AVIF_RANGE_FULL)) {
                     convertResult = avifImageIdentity8ToRGB8ColorFullRange(image, rgb, state);
@@ -1566,6 +2983,9 @@ static avifResult avifImageYUVToRGBImpl(const avifImage * image, avifRGBImage *
             alphaMultiplyMode = AVIF_ALPHA_MULTIPLY_MODE_NO_OP;
         }
 
+        if (state == &stateWithTables) {
+            avifFreeYUVToRGBLookUpTables(&stateWithTables.unormFloatTableY, &stateWithTables.unormFloatTableUV);
+        }
         if (convertResult != AVIF_RESULT_OK) {
             return convertResult;
         }
@@ -1584,81 +3004,28 @@ static avifResult avifImageYUVToRGBImpl(const avifImage * image, avifRGBImage *
         }
     }
 
-    // Convert pixels to half floats (F16), if necessary.
-    if (rgb->isFloat) {
-        return avifRGBImageToF16(rgb);
-    }
-
     return AVIF_RESULT_OK;
 }
 
 typedef struct
 {
-#if defined(_WIN32)
-    HANDLE thread;
-#else
-    pthread_t thread;
-#endif
+    avifThread * thread;
     avifImage image;
     avifRGBImage rgb;
     avifReformatState * state;
     avifAlphaMultiplyMode alphaMultiplyMode;
     avifResult result;
-    avifBool threadCreated;
 } YUVToRGBThreadData;
 
-#if defined(_WIN32)
-static unsigned int __stdcall avifImageYUVToRGBThreadWorker(void * arg)
-#else
-static void * avifImageYUVToRGBThreadWorker(void * arg)
-#endif
+static void avifImageYUVToRGBThreadWorker(void * arg)
 {
     YUVToRGBThreadData * data = (YUVToRGBThreadData *)arg;
     data->result = avifImageYUVToRGBImpl(&data->image, &data->rgb, data->state, data->alphaMultiplyMode);
-#if defined(_WIN32)
-    return 0;
-#else
-    return NULL;
-#endif
-}
-
-static avifBool avifCreateYUVToRGBThread(YUVToRGBThreadData * tdata)
-{
-#if defined(_WIN32)
-    tdata->thread = (HANDLE)_beginthreadex(/*security=*/NULL,
-                                           /*stack_size=*/0,
-                                           &avifImageYUVToRGBThreadWorker,
-                                           tdata,
-                                           /*initflag=*/0,
-                                           /*thrdaddr=*/NULL);
-    return tdata->thread != NULL;
-#else
-    return pthread_create(&tdata->thread, NULL, &avifImageYUVToRGBThreadWorker, tdata) == 0;
-#endif
-}
-
-static avifBool avifJoinYUVToRGBThread(YUVToRGBThreadData * tdata)
-{
-#if defined(_WIN32)
-    return WaitForSingleObject(tdata->thread, INFINITE) == WAIT_OBJECT_0 && CloseHandle(tdata->thread) != 0;
-#else
-    return pthread_join(tdata->thread, NULL) == 0;
-#endif
 }
 
-avifResult avifImageYUVToRGB(const avifImage * image, avifRGBImage * rgb)
+// Converts image to rgb with a state prepared by avifPrepareReformatState() for the same image and rgb properties.
+static avifResult avifImageYUVToRGBWithState(const avifImage * image, avifRGBImage * rgb, avifReformatState * state)
 {
-    // It is okay for rgb->maxThreads to be equal to zero in order to allow clients to zero initialize the avifRGBImage struct
-    // with memset.
-    if (!image->yuvPlanes[AVIF_CHAN_Y] || rgb->maxThreads < 0) {
-        return AVIF_RESULT_REFORMAT_FAILED;
-    }
-
-    avifReformatState state;
-    if (!avifPrepareReformatState(image, rgb, &state)) {
-        return AVIF_RESULT_REFORMAT_FAILED;
-    }
-
     avifAlphaMultiplyMode alphaMultiplyMode = AVIF_ALPHA_MULTIPLY_MODE_NO_OP;
     if (image->alphaPlane) {
         if (!avifRGBFormatHasAlpha(rgb->format) || rgb->ignoreAlpha) {
@@ -1676,6 +3043,19 @@ avifResult avifImageYUVToRGB(const avifImage * image, avifRGBImage * rgb)
         }
     }
 
+    // (Un)multiplying by an opaque alpha plane is a no-op. Scanning the plane is much cheaper than the (un)multiply step,
+    // which also rules out the fast conversion paths. Convert a view without alpha instead, so that the output alpha
+    // channel, if any, is filled rather than copied.
+    avifImage opaqueView;
+    if (alphaMultiplyMode != AVIF_ALPHA_MULTIPLY_MODE_NO_OP && avifImageIsOpaque(image)) {
+        opaqueView = *image;
+        opaqueView.alphaPlane = NULL;
+        opaqueView.alphaRowBytes = 0;
+        opaqueView.imageOwnsAlphaPlane = AVIF_FALSE;
+        image = &opaqueView;
+        alphaMultiplyMode = AVIF_ALPHA_MULTIPLY_MODE_NO_OP;
+    }
+
     // In practice, we rarely need more than 8 threads for YUV to RGB conversion.
     uint32_t jobs = AVIF_CLAMP(rgb->maxThreads, 1, 8);
 
@@ -1689,7 +3069,7 @@ avifResult avifImageYUVToRGB(const avifImage * image, avifRGBImage * rgb)
 
     // Each thread worker needs at least 2 Y rows (to account for potential U/V subsampling).
     if (jobs == 1 || (image->height / 2) < jobs) {
-        return avifImageYUVToRGBImpl(image, rgb, &state, alphaMultiplyMode);
+        return avifImageYUVToRGBImpl(image, rgb, state, alphaMultiplyMode);
     }
 
     const size_t byteCount = sizeof(YUVToRGBThreadData) * jobs;
@@ -1717,13 +3097,15 @@ avifResult avifImageYUVToRGB(const avifImage * image, avifRGBImage * rgb)
         tdata->rgb = *rgb;
         tdata->rgb.pixels += startRow * (size_t)rgb->rowBytes;
         tdata->rgb.height = tdata->image.height;
+        // The jobs already use the allowed threads, so alpha (un)multiplication of each band runs on a single one.
+        tdata->rgb.maxThreads = 1;
 
-        tdata->state = &state;
+        tdata->state = state;
         tdata->alphaMultiplyMode = alphaMultiplyMode;
 
         if (i > 0) {
-            tdata->threadCreated = avifCreateYUVToRGBThread(tdata);
-            if (!tdata->threadCreated) {
+            tdata->thread = avifThreadCreate(avifImageYUVToRGBThreadWorker, tdata);
+            if (tdata->thread == NULL) {
                 tdata->result = AVIF_RESULT_REFORMAT_FAILED;
                 break;
             }
@@ -1736,7 +3118,7 @@ avifResult avifImageYUVToRGB(const avifImage * image, avifRGBImage * rgb)
     avifResult result = AVIF_RESULT_OK;
     for (i = 0; i < jobs; ++i) {
         YUVToRGBThreadData * tdata = &threadData[i];
-        if (tdata->threadCreated && !avifJoinYUVToRGBThread(tdata)) {
+        if (tdata->thread != NULL && !avifThreadJoin(tdata->thread)) {
             result = AVIF_RESULT_REFORMAT_FAILED;
         }
         if (tdata->result != AVIF_RESULT_OK) {
@@ -1747,6 +3129,337 @@ avifResult avifImageYUVToRGB(const avifImage * image, avifRGBImage * rgb)
     return result;
 }
 
+avifResult avifImageYUVToRGB(const avifImage * image, avifRGBImage * rgb)
+{
+    // It is okay for rgb->maxThreads to be equal to zero in order to allow clients to zero initialize the avifRGBImage struct
+    // with memset.
+    if (!image->yuvPlanes[AVIF_CHAN_Y] || rgb->maxThreads < 0) {
+        return AVIF_RESULT_REFORMAT_FAILED;
+    }
+
+    avifReformatState state;
+    if (!avifPrepareReformatState(image, rgb, &state)) {
+        return AVIF_RESULT_REFORMAT_FAILED;
+    }
+
+    return avifImageYUVToRGBWithState(image, rgb, &state);
+}
+
+avifResult avifImageYUVToRGBRect(const avifImage * image, const avifCropRect * rect, avifRGBImage * rgb)
+{
+    AVIF_CHECKERR(rect->width > 0 && rect->height > 0 && rect->width <= image->width && rect->height <= image->height &&
+                      rect->x <= image->width - rect->width && rect->y <= image->height - rect->height,
+                  AVIF_RESULT_INVALID_ARGUMENT);
+    AVIF_CHECKERR(rgb->pixels && rgb->width == rect->width && rgb->height == rect->height, AVIF_RESULT_INVALID_ARGUMENT);
+
+    // Chroma upsampling may read the chroma samples right next to the converted ones, so convert a region including
+    // neighboring pixels and starting at a chroma sample position, and only keep the requested pixels.
+    avifPixelFormatInfo formatInfo;
+    avifGetPixelFormatInfo(image->yuvFormat, &formatInfo);
+    avifCropRect contextRect = *rect;
+    if (!formatInfo.monochrome) {
+        if (formatInfo.chromaShiftX) {
+            avifExpandRangeForChromaUpsampling(&contextRect.x, &contextRect.width, image->width);
+        }
+        if (formatInfo.chromaShiftY) {
+            avifExpandRangeForChromaUpsampling(&contextRect.y, &contextRect.height, image->height);
+        }
+    }
+
+    avifImage view;
+    avifImageSetDefaults(&view);
+    AVIF_CHECKRES(avifImageSetViewRect(&view, image, &contextRect));
+    if (contextRect.width == rect->width && contextRect.height == rect->height) {
+        return avifImageYUVToRGB(&view, rgb);
+    }
+
+    avifRGBImage contextRgb = *rgb;
+    contextRgb.width = contextRect.width;
+    contextRgb.height = contextRect.height;
+    contextRgb.pixels = NULL;
+    contextRgb.rowBytes = 0;
+    AVIF_CHECKRES(avifRGBImageAllocatePixels(&contextRgb));
+    const avifResult result = avifImageYUVToRGB(&view, &contextRgb);
+    if (result == AVIF_RESULT_OK) {
+        const uint32_t pixelSize = avifRGBImagePixelSize(rgb);
+        const uint8_t * src = &contextRgb.pixels[(size_t)(rect->y - contextRect.y) * contextRgb.rowBytes +
+                                                 (size_t)(rect->x - contextRect.x) * pixelSize];
+        for (uint32_t y = 0; y < rect->height; ++y) {
+            memcpy(&rgb->pixels[(size_t)y * rgb->rowBytes],
+                   &src[(size_t)y * contextRgb.rowBytes],
+                   (size_t)rect->width * pixelSize);
+        }
+    }
+    avifRGBImageFreePixels(&contextRgb);
+    return result;
+}
+
+struct avifYUVToRGBPlan
+{
+    avifReformatState state; // Owns the look-up tables.
+
+    // Properties of the avifImage and avifRGBImage the state was prepared for.
+    uint32_t depth;
+    avifPixelFormat yuvFormat;
+    avifRange yuvRange;
+    avifColorPrimaries colorPrimaries;
+    avifMatrixCoefficients matrixCoefficients;
+    uint32_t rgbDepth;
+    avifRGBFormat rgbFormat;
+    avifBool rgbIsFloat;
+};
+
+avifResult avifYUVToRGBPlanCreateWithResult(const avifImage * image, const avifRGBImage * rgb, avifYUVToRGBPlan ** plan)
+{
+    *plan = (avifYUVToRGBPlan *)avifAlloc(sizeof(avifYUVToRGBPlan));
+    AVIF_CHECKERR(*plan != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+    memset(*plan, 0, sizeof(avifYUVToRGBPlan));
+    avifResult result = AVIF_RESULT_OK;
+    if (!avifPrepareReformatState(image, rgb, &(*plan)->state)) {
+        result = AVIF_RESULT_REFORMAT_FAILED;
+    } else if (!avifCreateYUVToRGBLookUpTables(&(*plan)->state.unormFloatTableY,
+                                               &(*plan)->state.unormFloatTableUV,
+                                               image->depth,
+                                               &(*plan)->state)) {
+        result = AVIF_RESULT_OUT_OF_MEMORY;
+    }
+    if (result != AVIF_RESULT_OK) {
+        avifFree(*plan);
+        *plan = NULL;
+        return result;
+    }
+    (*plan)->depth = image->depth;
+    (*plan)->yuvFormat = image->yuvFormat;
+    (*plan)->yuvRange = image->yuvRange;
+    (*plan)->colorPrimaries = image->colorPrimaries;
+    (*plan)->matrixCoefficients = image->matrixCoefficients;
+    (*plan)->rgbDepth = rgb->depth;
+    (*plan)->rgbFormat = rgb->format;
+    (*plan)->rgbIsFloat = rgb->isFloat;
+    return AVIF_RESULT_OK;
+}
+
+avifYUVToRGBPlan * avifYUVToRGBPlanCreate(const avifImage * image, const avifRGBImage * rgb)
+{
+    avifYUVToRGBPlan * plan;
+    if (avifYUVToRGBPlanCreateWithResult(image, rgb, &plan) != AVIF_RESULT_OK) {
+        return NULL;
+    }
+    return plan;
+}
+
+void avifYUVToRGBPlanDestroy(avifYUVToRGBPlan * plan)
+{
+    avifFreeYUVToRGBLookUpTables(&plan->state.unormFloatTableY, &plan->state.unormFloatTableUV);
+    avifFree(plan);
+}
+
+avifResult avifImageYUVToRGBWithPlan(const avifYUVToRGBPlan * plan, const avifImage * image, avifRGBImage * rgb)
+{
+    if (!image->yuvPlanes[AVIF_CHAN_Y] || rgb->maxThreads < 0) {
+        return AVIF_RESULT_REFORMAT_FAILED;
+    }
+    AVIF_CHECKERR(image->depth == plan->depth && image->yuvFormat == plan->yuvFormat && image->yuvRange == plan->yuvRange &&
+                      image->colorPrimaries == plan->colorPrimaries && image->matrixCoefficients == plan->matrixCoefficients &&
+                      rgb->depth == plan->rgbDepth && rgb->format == plan->rgbFormat && rgb->isFloat == plan->rgbIsFloat,
+                  AVIF_RESULT_INVALID_ARGUMENT);
+
+    // The conversion does not modify the state, but takes a mutable one. Work on a copy so that the plan can be used by
+    // several threads at once.
+    avifReformatState state = plan->state;
+    return avifImageYUVToRGBWithState(image, rgb, &state);
+}
+
+// Interleaves count samples of u and v into uv.
+static void avifInterleaveUVRow8(const uint8_t * u, const uint8_t * v, uint32_t count, uint8_t * uv)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        uv[2 * i] = u[i];
+        uv[2 * i + 1] = v[i];
+    }
+}
+
+// Interleaves count samples of u and v into uv, shifted left by shift bits.
+static void avifInterleaveUVRow16(const uint16_t * u, const uint16_t * v, uint32_t count, uint32_t shift, uint16_t * uv)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        uv[2 * i] = (uint16_t)(u[i] << shift);
+        uv[2 * i + 1] = (uint16_t)(v[i] << shift);
+    }
+}
+
+// Copies count samples of src to dst, shifted left by shift bits.
+static void avifShiftRow16(const uint16_t * src, uint32_t count, uint32_t shift, uint16_t * dst)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        dst[i] = (uint16_t)(src[i] << shift);
+    }
+}
+
+typedef void (*avifInterleaveUVRow8Func)(const uint8_t * u, const uint8_t * v, uint32_t count, uint8_t * uv);
+typedef void (*avifInterleaveUVRow16Func)(const uint16_t * u, const uint16_t * v, uint32_t count, uint32_t shift, uint16_t * uv);
+typedef void (*avifShiftRow16Func)(const uint16_t * src, uint32_t count, uint32_t shift, uint16_t * dst);
+
+#if defined(AVIF_SIMD_SSE2)
+static void avifInterleaveUVRow8SSE2(const uint8_t * u, const uint8_t * v, uint32_t count, uint8_t * uv)
+{
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i u16 = _mm_loadu_si128((const __m128i *)&u[i]);
+        const __m128i v16 = _mm_loadu_si128((const __m128i *)&v[i]);
+        _mm_storeu_si128((__m128i *)&uv[2 * i], _mm_unpacklo_epi8(u16, v16));
+        _mm_storeu_si128((__m128i *)&uv[2 * i + 16], _mm_unpackhi_epi8(u16, v16));
+    }
+    avifInterleaveUVRow8(&u[i], &v[i], count - i, &uv[2 * i]);
+}
+
+static void avifInterleaveUVRow16SSE2(const uint16_t * u, const uint16_t * v, uint32_t count, uint32_t shift, uint16_t * uv)
+{
+    const __m128i shiftCount = _mm_cvtsi32_si128((int)shift);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i u8 = _mm_sll_epi16(_mm_loadu_si128((const __m128i *)&u[i]), shiftCount);
+        const __m128i v8 = _mm_sll_epi16(_mm_loadu_si128((const __m128i *)&v[i]), shiftCount);
+        _mm_storeu_si128((__m128i *)&uv[2 * i], _mm_unpacklo_epi16(u8, v8));
+        _mm_storeu_si128((__m128i *)&uv[2 * i + 8], _mm_unpackhi_epi16(u8, v8));
+    }
+    avifInterleaveUVRow16(&u[i], &v[i], count - i, shift, &uv[2 * i]);
+}
+
+static void avifShiftRow16SSE2(const uint16_t * src, uint32_t count, uint32_t shift, uint16_t * dst)
+{
+    const __m128i shiftCount = _mm_cvtsi32_si128((int)shift);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_si128((__m128i *)&dst[i], _mm_sll_epi16(_mm_loadu_si128((const __m128i *)&src[i]), shiftCount));
+    }
+    avifShiftRow16(&src[i], count - i, shift, &dst[i]);
+}
+
+#if defined(AVIF_SIMD_AVX2)
+// The 128-bit lanes of the samples are swapped in the middle first, so that the in-lane unpacking outputs them in order.
+
+__attribute__((target("avx2"))) static void avifInterleaveUVRow8AVX2(const uint8_t * u,
+                                                                     const uint8_t * v,
+                                                                     uint32_t count,
+                                                                     uint8_t * uv)
+{
+    uint32_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        const __m256i u32 = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *)&u[i]), _MM_SHUFFLE(3, 1, 2, 0));
+        const __m256i v32 = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *)&v[i]), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i *)&uv[2 * i], _mm256_unpacklo_epi8(u32, v32));
+        _mm256_storeu_si256((__m256i *)&uv[2 * i + 32], _mm256_unpackhi_epi8(u32, v32));
+    }
+    avifInterleaveUVRow8SSE2(&u[i], &v[i], count - i, &uv[2 * i]);
+}
+
+__attribute__((target("avx2"))) static void avifInterleaveUVRow16AVX2(const uint16_t * u,
+                                                                      const uint16_t * v,
+                                                                      uint32_t count,
+                                                                      uint32_t shift,
+                                                                      uint16_t * uv)
+{
+    const __m128i shiftCount = _mm_cvtsi32_si128((int)shift);
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i u16 = _mm256_sll_epi16(_mm256_loadu_si256((const __m256i *)&u[i]), shiftCount);
+        const __m256i v16 = _mm256_sll_epi16(_mm256_loadu_si256((const __m256i *)&v[i]), shiftCount);
+        const __m256i uOrdered = _mm256_permute4x64_epi64(u16, _MM_SHUFFLE(3, 1, 2, 0));
+        const __m256i vOrdered = _mm256_permute4x64_epi64(v16, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i *)&uv[2 * i], _mm256_unpacklo_epi16(uOrdered, vOrdered));
+        _mm256_storeu_si256((__m256i *)&uv[2 * i + 16], _mm256_unpackhi_epi16(uOrdered, vOrdered));
+    }
+    avifInterleaveUVRow16SSE2(&u[i], &v[i], count - i, shift, &uv[2 * i]);
+}
+
+__attribute__((target("avx2"))) static void avifShiftRow16AVX2(const uint16_t * src,
+                                                               uint32_t count,
+                                                               uint32_t shift,
+                                                               uint16_t * dst)
+{
+    const __m128i shiftCount = _mm_cvtsi32_si128((int)shift);
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        _mm256_storeu_si256((__m256i *)&dst[i], _mm256_sll_epi16(_mm256_loadu_si256((const __m256i *)&src[i]), shiftCount));
+    }
+    avifShiftRow16SSE2(&src[i], count - i, shift, &dst[i]);
+}
+#endif // defined(AVIF_SIMD_AVX2)
+#endif // defined(AVIF_SIMD_SSE2)
+
+avifResult avifImageToSemiPlanar(const avifImage * image,
+                                 uint8_t * yPlane,
+                                 uint32_t yRowBytes,
+                                 uint8_t * uvPlane,
+                                 uint32_t uvRowBytes)
+{
+    AVIF_CHECKERR(image->yuvFormat != AVIF_PIXEL_FORMAT_NONE && image->yuvFormat != AVIF_PIXEL_FORMAT_YUV400 &&
+                      image->yuvPlanes[AVIF_CHAN_Y] && image->yuvPlanes[AVIF_CHAN_U] && image->yuvPlanes[AVIF_CHAN_V],
+                  AVIF_RESULT_INVALID_ARGUMENT);
+    const uint32_t uvWidth = avifImagePlaneWidth(image, AVIF_CHAN_U);
+    const uint32_t uvHeight = avifImagePlaneHeight(image, AVIF_CHAN_U);
+    const size_t sampleBytes = (image->depth > 8) ? 2 : 1;
+    AVIF_CHECKERR(yPlane && uvPlane && yRowBytes >= image->width * sampleBytes && uvRowBytes >= 2 * uvWidth * sampleBytes,
+                  AVIF_RESULT_INVALID_ARGUMENT);
+
+    const avifResult libyuvResult = avifImageToSemiPlanarLibYUV(image, yPlane, yRowBytes, uvPlane, uvRowBytes);
+    if (libyuvResult != AVIF_RESULT_NOT_IMPLEMENTED) {
+        return libyuvResult;
+    }
+
+    avifInterleaveUVRow8Func interleaveUVRow8 = avifInterleaveUVRow8;
+    avifInterleaveUVRow16Func interleaveUVRow16 = avifInterleaveUVRow16;
+    avifShiftRow16Func shiftRow16 = avifShiftRow16;
+#if defined(AVIF_SIMD_SSE2)
+    const uint32_t cpuFeatures = avifGetCPUFeatures();
+    if (cpuFeatures & AVIF_CPU_SSE2) {
+        interleaveUVRow8 = avifInterleaveUVRow8SSE2;
+        interleaveUVRow16 = avifInterleaveUVRow16SSE2;
+        shiftRow16 = avifShiftRow16SSE2;
+    }
+#if defined(AVIF_SIMD_AVX2)
+    if (cpuFeatures & AVIF_CPU_AVX2) {
+        interleaveUVRow8 = avifInterleaveUVRow8AVX2;
+        interleaveUVRow16 = avifInterleaveUVRow16AVX2;
+        shiftRow16 = avifShiftRow16AVX2;
+    }
+#endif
+#endif
+
+    if (image->depth == 8) {
+        for (uint32_t j = 0; j < image->height; ++j) {
+            memcpy(&yPlane[(size_t)j * yRowBytes],
+                   &image->yuvPlanes[AVIF_CHAN_Y][(size_t)j * image->yuvRowBytes[AVIF_CHAN_Y]],
+                   image->width);
+        }
+        for (uint32_t j = 0; j < uvHeight; ++j) {
+            interleaveUVRow8(&image->yuvPlanes[AVIF_CHAN_U][(size_t)j * image->yuvRowBytes[AVIF_CHAN_U]],
+                             &image->yuvPlanes[AVIF_CHAN_V][(size_t)j * image->yuvRowBytes[AVIF_CHAN_V]],
+                             uvWidth,
+                             &uvPlane[(size_t)j * uvRowBytes]);
+        }
+        return AVIF_RESULT_OK;
+    }
+
+    // P010 and similar formats store the samples in the most significant bits.
+    const uint32_t shift = 16 - image->depth;
+    for (uint32_t j = 0; j < image->height; ++j) {
+        shiftRow16((const uint16_t *)&image->yuvPlanes[AVIF_CHAN_Y][(size_t)j * image->yuvRowBytes[AVIF_CHAN_Y]],
+                   image->width,
+                   shift,
+                   (uint16_t *)&yPlane[(size_t)j * yRowBytes]);
+    }
+    for (uint32_t j = 0; j < uvHeight; ++j) {
+        interleaveUVRow16((const uint16_t *)&image->yuvPlanes[AVIF_CHAN_U][(size_t)j * image->yuvRowBytes[AVIF_CHAN_U]],
+                          (const uint16_t *)&image->yuvPlanes[AVIF_CHAN_V][(size_t)j * image->yuvRowBytes[AVIF_CHAN_V]],
+                          uvWidth,
+                          shift,
+                          (uint16_t *)&uvPlane[(size_t)j * uvRowBytes]);
+    }
+    return AVIF_RESULT_OK;
+}
+
 // Limited -> Full
 // Plan: subtract limited offset, then multiply by ratio of FULLSIZE/LIMITEDSIZE (rounding), then clamp.
 // RATIO = (FULLY - 0) / (MAXLIMITEDY - MINLIMITEDY)
@@ -1860,6 +3573,14 @@ void avifGetRGBAPixel(const avifRGBImage * src, uint32_t x, uint32_t y, const av
     assert(src->format != AVIF_RGB_FORMAT_RGB_565 || src->depth == 8);
 
     const uint8_t * const srcPixel = &src->pixels[(size_t)y * src->rowBytes + (size_t)x * info->pixelBytes];
+    if (src->format == AVIF_RGB_FORMAT_RGBA1010102) {
+        const uint32_t pixel = *((const uint32_t *)srcPixel);
+        rgbaPixel[0] = (pixel & 0x3FF) / info->maxChannelF;
+        rgbaPixel[1] = ((pixel >> 10) & 0x3FF) / info->maxChannelF;
+        rgbaPixel[2] = ((pixel >> 20) & 0x3FF) / info->maxChannelF;
+        rgbaPixel[3] = (pixel >> 30) / 3.0f;
+        return;
+    }
     if (info->channelBytes > 1) {
         uint16_t r = *((const uint16_t *)(&srcPixel[info->offsetBytesR]));
         uint16_t g = *((const uint16_t *)(&srcPixel[info->offsetBytesG]));
@@ -1908,7 +3629,12 @@ void avifSetRGBAPixel(const avifRGBImage * dst, uint32_t x, uint32_t y, const av
     uint8_t * const ptrG = &dstPixel[info->offsetBytesG];
     uint8_t * const ptrB = &dstPixel[info->offsetBytesB];
     uint8_t * const ptrA = avifRGBFormatHasAlpha(dst->format) ? &dstPixel[info->offsetBytesA] : NULL;
-    if (dst->depth > 8) {
+    if (dst->format == AVIF_RGB_FORMAT_RGBA1010102) {
+        *((uint32_t *)dstPixel) = RGBA1010102((uint32_t)(0.5f + (rgbaPixel[0] * info->maxChannelF)),
+                                              (uint32_t)(0.5f + (rgbaPixel[1] * info->maxChannelF)),
+                                              (uint32_t)(0.5f + (rgbaPixel[2] * info->maxChannelF)),
+                                              (uint32_t)(0.5f + (rgbaPixel[3] * 3.0f)));
+    } else if (dst->depth > 8) {
         if (dst->isFloat) {
             *((uint16_t *)ptrR) = avifFloatToF16(rgbaPixel[0]);
             *((uint16_t *)ptrG) = avifFloatToF16(rgbaPixel[1]);
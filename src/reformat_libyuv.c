@@ -30,9 +30,24 @@ avifResult avifRGBImageUnpremultiplyAlphaLibYUV(avifRGBImage * rgb)
     (void)rgb;
     return AVIF_RESULT_NOT_IMPLEMENTED;
 }
-avifResult avifRGBImageToF16LibYUV(avifRGBImage * rgb)
+avifResult avifRowToF16LibYUV(const uint16_t * src, uint16_t * dst, uint32_t count)
 {
-    (void)rgb;
+    (void)src;
+    (void)dst;
+    (void)count;
+    return AVIF_RESULT_NOT_IMPLEMENTED;
+}
+avifResult avifImageToSemiPlanarLibYUV(const avifImage * image,
+                                       uint8_t * yPlane,
+                                       uint32_t yRowBytes,
+                                       uint8_t * uvPlane,
+                                       uint32_t uvRowBytes)
+{
+    (void)image;
+    (void)yPlane;
+    (void)yRowBytes;
+    (void)uvPlane;
+    (void)uvRowBytes;
     return AVIF_RESULT_NOT_IMPLEMENTED;
 }
 unsigned int avifLibYUVVersion(void)
@@ -1160,24 +1175,46 @@ avifResult avifRGBImageUnpremultiplyAlphaLibYUV(avifRGBImage * rgb)
     return AVIF_RESULT_NOT_IMPLEMENTED;
 }
 
-avifResult avifRGBImageToF16LibYUV(avifRGBImage * rgb)
+avifResult avifRowToF16LibYUV(const uint16_t * src, uint16_t * dst, uint32_t count)
 {
-    // The width, height, and stride parameters of libyuv functions are all of the int type.
-    if (rgb->width > INT_MAX || rgb->height > INT_MAX || rgb->rowBytes > INT_MAX) {
+    // The width parameter of libyuv functions is of the int type.
+    if (count > INT_MAX) {
         return AVIF_RESULT_NOT_IMPLEMENTED;
     }
-    const float scale = 1.0f / ((1 << rgb->depth) - 1);
     // Note: HalfFloatPlane requires the stride to be in bytes.
-    const int result = HalfFloatPlane((const uint16_t *)rgb->pixels,
-                                      rgb->rowBytes,
-                                      (uint16_t *)rgb->pixels,
-                                      rgb->rowBytes,
-                                      scale,
-                                      rgb->width * avifRGBFormatChannelCount(rgb->format),
-                                      rgb->height);
+    const int rowBytes = (int)(count * sizeof(uint16_t));
+    const int result = HalfFloatPlane(src, rowBytes, dst, rowBytes, 1.0f / 65535.0f, (int)count, 1);
     return (result == 0) ? AVIF_RESULT_OK : AVIF_RESULT_INVALID_ARGUMENT;
 }
 
+avifResult avifImageToSemiPlanarLibYUV(const avifImage * image,
+                                       uint8_t * yPlane,
+                                       uint32_t yRowBytes,
+                                       uint8_t * uvPlane,
+                                       uint32_t uvRowBytes)
+{
+    // Only NV12 and the like are handled: high bit depth samples must be moved to the most significant bits.
+    if (image->depth != 8) {
+        return AVIF_RESULT_NOT_IMPLEMENTED;
+    }
+    // The width, height, and stride parameters of libyuv functions are all of the int type.
+    if (image->width > INT_MAX || image->height > INT_MAX || yRowBytes > INT_MAX || uvRowBytes > INT_MAX ||
+        image->yuvRowBytes[AVIF_CHAN_Y] > INT_MAX || image->yuvRowBytes[AVIF_CHAN_U] > INT_MAX ||
+        image->yuvRowBytes[AVIF_CHAN_V] > INT_MAX) {
+        return AVIF_RESULT_NOT_IMPLEMENTED;
+    }
+    CopyPlane(image->yuvPlanes[AVIF_CHAN_Y], image->yuvRowBytes[AVIF_CHAN_Y], yPlane, yRowBytes, image->width, image->height);
+    MergeUVPlane(image->yuvPlanes[AVIF_CHAN_U],
+                 image->yuvRowBytes[AVIF_CHAN_U],
+                 image->yuvPlanes[AVIF_CHAN_V],
+                 image->yuvRowBytes[AVIF_CHAN_V],
+                 uvPlane,
+                 uvRowBytes,
+                 avifImagePlaneWidth(image, AVIF_CHAN_U),
+                 avifImagePlaneHeight(image, AVIF_CHAN_U));
+    return AVIF_RESULT_OK;
+}
+
 unsigned int avifLibYUVVersion(void)
 {
     return (unsigned int)LIBYUV_VERSION;
@@ -3,6 +3,15 @@
 
 #include "avif/internal.h"
 #include <limits.h>
+#include <math.h>
+#include <string.h>
+
+#if defined(AVIF_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(AVIF_SIMD_AVX2)
+#include <immintrin.h>
+#endif
 
 #if defined(__clang__)
 #pragma clang diagnostic push
@@ -199,3 +208,1070 @@ avifResult avifImageScale(avifImage * image, uint32_t dstWidth, uint32_t dstHeig
     avifDiagnosticsClearError(diag);
     return avifImageScaleWithLimit(image, dstWidth, dstHeight, AVIF_DEFAULT_IMAGE_SIZE_LIMIT, AVIF_DEFAULT_IMAGE_DIMENSION_LIMIT, diag);
 }
+
+// ---------------------------------------------------------------------------
+// Native scaler
+
+// Fixed-point precision of the filter weights of avifImageScaleInto().
+#define AVIF_SCALE_WEIGHT_BITS 14
+#define AVIF_SCALE_WEIGHT_ONE (1 << AVIF_SCALE_WEIGHT_BITS)
+// Number of destination rows filtered at once by each job of avifImageScaleInto().
+#define AVIF_SCALE_CHUNK_HEIGHT 32
+// In practice, we rarely need more than 8 threads for scaling.
+#define AVIF_SCALE_MAX_JOBS 8
+
+#define AVIF_SCALE_PI 3.14159265358979323846
+
+// Returns the half width of the filter at a scaling factor of 1.
+static double avifScaleFilterSupport(avifScaleFilter filter)
+{
+    switch (filter) {
+        case AVIF_SCALE_FILTER_BOX:
+            return 0.5;
+        case AVIF_SCALE_FILTER_BILINEAR:
+            return 1.0;
+        case AVIF_SCALE_FILTER_BICUBIC:
+            return 2.0;
+        default:
+            return 3.0;
+    }
+}
+
+static double avifSinc(double x)
+{
+    if (x == 0.0) {
+        return 1.0;
+    }
+    x *= AVIF_SCALE_PI;
+    return sin(x) / x;
+}
+
+static double avifScaleFilterWeight(avifScaleFilter filter, double x)
+{
+    switch (filter) {
+        case AVIF_SCALE_FILTER_BOX:
+            return (x > -0.5 && x <= 0.5) ? 1.0 : 0.0;
+        case AVIF_SCALE_FILTER_BILINEAR:
+            x = fabs(x);
+            return (x < 1.0) ? 1.0 - x : 0.0;
+        case AVIF_SCALE_FILTER_BICUBIC: {
+            // Keys cubic convolution with a = -0.5.
+            const double a = -0.5;
+            x = fabs(x);
+            if (x < 1.0) {
+                return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+            }
+            if (x < 2.0) {
+                return ((a * x - 5.0 * a) * x + 8.0 * a) * x - 4.0 * a;
+            }
+            return 0.0;
+        }
+        default:
+            return (x > -3.0 && x < 3.0) ? avifSinc(x) * avifSinc(x / 3.0) : 0.0;
+    }
+}
+
+// Contributions of the source samples to each destination sample along one dimension.
+typedef struct avifScaleCoeffs
+{
+    uint32_t maxTaps;  // Number of weights allocated per destination sample.
+    uint32_t * start;  // Index of the first source sample contributing to each destination sample.
+    uint32_t * count;  // Number of source samples contributing to each destination sample.
+    int32_t * weights; // maxTaps weights per destination sample, summing to AVIF_SCALE_WEIGHT_ONE.
+
+    // Used by the SIMD kernels. See avifScaleCoeffsPrepareSIMD().
+    int16_t * weights16; // simdTaps weights per destination sample. May be NULL.
+    uint32_t simdTaps;   // Multiple of AVIF_SCALE_SIMD_TAPS.
+    uint32_t simdCount;  // Number of leading destination samples whose simdTaps source samples are in range.
+} avifScaleCoeffs;
+
+static void avifScaleCoeffsDestroy(avifScaleCoeffs * coeffs)
+{
+    avifFree(coeffs->start);
+    avifFree(coeffs->count);
+    avifFree(coeffs->weights);
+    avifFree(coeffs->weights16);
+    memset(coeffs, 0, sizeof(*coeffs));
+}
+
+static avifResult avifScaleCoeffsCreate(avifScaleCoeffs * coeffs, uint32_t srcSize, uint32_t dstSize, avifScaleFilter filter)
+{
+    const double scale = (double)srcSize / dstSize;
+    // Widen the filter when downscaling so that all source samples contribute.
+    const double filterScale = AVIF_MAX(scale, 1.0);
+    const double support = avifScaleFilterSupport(filter) * filterScale;
+    coeffs->maxTaps = (uint32_t)ceil(support) * 2 + 1;
+    coeffs->start = (uint32_t *)avifAlloc(sizeof(uint32_t) * dstSize);
+    coeffs->count = (uint32_t *)avifAlloc(sizeof(uint32_t) * dstSize);
+    coeffs->weights = (int32_t *)avifAlloc(sizeof(int32_t) * coeffs->maxTaps * dstSize);
+    double * realWeights = (double *)avifAlloc(sizeof(double) * coeffs->maxTaps);
+    if (!coeffs->start || !coeffs->count || !coeffs->weights || !realWeights) {
+        avifFree(realWeights);
+        avifScaleCoeffsDestroy(coeffs);
+        return AVIF_RESULT_OUT_OF_MEMORY;
+    }
+
+    for (uint32_t i = 0; i < dstSize; ++i) {
+        const double center = (i + 0.5) * scale;
+        const int64_t first = AVIF_MAX((int64_t)(center - support + 0.5), 0);
+        const int64_t last = AVIF_MIN((int64_t)(center + support + 0.5), (int64_t)srcSize);
+        uint32_t count = (uint32_t)AVIF_MAX(last - first, 1);
+        count = AVIF_MIN(count, coeffs->maxTaps);
+        double total = 0.0;
+        for (uint32_t k = 0; k < count; ++k) {
+            realWeights[k] = avifScaleFilterWeight(filter, ((double)first + k - center + 0.5) / filterScale);
+            total += realWeights[k];
+        }
+
+        int32_t * weights = &coeffs->weights[(size_t)i * coeffs->maxTaps];
+        uint32_t start = (uint32_t)first;
+        if (total == 0.0) {
+            // Only possible in theory. Use the nearest sample.
+            start = AVIF_MIN((uint32_t)center, srcSize - 1);
+            count = 1;
+            weights[0] = AVIF_SCALE_WEIGHT_ONE;
+        } else {
+            // Normalize the weights in fixed point and add the rounding error to the largest weight, so that flat areas
+            // stay flat.
+            int32_t sum = 0;
+            uint32_t largest = 0;
+            for (uint32_t k = 0; k < count; ++k) {
+                weights[k] = (int32_t)lround(realWeights[k] / total * AVIF_SCALE_WEIGHT_ONE);
+                sum += weights[k];
+                if (weights[k] > weights[largest]) {
+                    largest = k;
+                }
+            }
+            weights[largest] += AVIF_SCALE_WEIGHT_ONE - sum;
+
+            // Skip the samples that do not contribute, such as all but one when the sizes are the same.
+            uint32_t skipped = 0;
+            while (count > 1 && weights[skipped] == 0) {
+                ++skipped;
+                --count;
+            }
+            while (count > 1 && weights[skipped + count - 1] == 0) {
+                --count;
+            }
+            memmove(weights, &weights[skipped], sizeof(int32_t) * count);
+            start += skipped;
+        }
+        coeffs->start[i] = start;
+        coeffs->count[i] = count;
+    }
+    avifFree(realWeights);
+    return AVIF_RESULT_OK;
+}
+
+// Returns sum >> shift clamped to [0:maxValue]. sum includes the rounding offset.
+static inline uint32_t avifScaleNormalize(int32_t sum, uint32_t shift, uint32_t maxValue)
+{
+    return (sum < 0) ? 0 : AVIF_MIN((uint32_t)sum >> shift, maxValue);
+}
+
+// Extends the windows of coeffs with zero weights so that they all have the same number of samples, so that
+// avifScaleRowHorizontal() loops a fixed number of times per destination sample.
+static void avifScaleCoeffsMakeUniform(avifScaleCoeffs * coeffs, uint32_t srcSize, uint32_t dstSize)
+{
+    uint32_t taps = 1;
+    for (uint32_t i = 0; i < dstSize; ++i) {
+        taps = AVIF_MAX(taps, coeffs->count[i]);
+    }
+    for (uint32_t i = 0; i < dstSize; ++i) {
+        const uint32_t start = AVIF_MIN(coeffs->start[i], srcSize - taps);
+        const uint32_t offset = coeffs->start[i] - start;
+        const uint32_t count = coeffs->count[i];
+        int32_t * weights = &coeffs->weights[(size_t)i * coeffs->maxTaps];
+        memmove(&weights[offset], weights, sizeof(int32_t) * count);
+        memset(weights, 0, sizeof(int32_t) * offset);
+        memset(&weights[offset + count], 0, sizeof(int32_t) * (taps - offset - count));
+        coeffs->start[i] = start;
+        coeffs->count[i] = taps;
+    }
+}
+
+// The horizontal SIMD kernels multiply the samples of the windows by groups of AVIF_SCALE_SIMD_TAPS, for windows of up to
+// AVIF_SCALE_SIMD_MAX_TAPS samples, which covers upscaling and downscaling by up to 2 with all filters.
+#define AVIF_SCALE_SIMD_TAPS 8
+#define AVIF_SCALE_SIMD_MAX_TAPS 16
+
+// Returns AVIF_TRUE if the weights of coeffs fit in int16_t, for the signed 16-bit multiplications of the SIMD kernels.
+static avifBool avifScaleCoeffsFitInt16(const avifScaleCoeffs * coeffs, uint32_t dstSize)
+{
+    for (uint32_t i = 0; i < dstSize; ++i) {
+        const int32_t * weights = &coeffs->weights[(size_t)i * coeffs->maxTaps];
+        for (uint32_t k = 0; k < coeffs->count[i]; ++k) {
+            if (weights[k] < -INT16_MAX || weights[k] > INT16_MAX) {
+                return AVIF_FALSE;
+            }
+        }
+    }
+    return AVIF_TRUE;
+}
+
+// Copies the weights of coeffs, made uniform by avifScaleCoeffsMakeUniform(), to weights16 padded with zeros to a
+// multiple of AVIF_SCALE_SIMD_TAPS, if they fit. Leaves weights16 NULL otherwise.
+static avifResult avifScaleCoeffsPrepareSIMD(avifScaleCoeffs * coeffs, uint32_t srcSize, uint32_t dstSize)
+{
+    if (coeffs->count[0] > AVIF_SCALE_SIMD_MAX_TAPS || !avifScaleCoeffsFitInt16(coeffs, dstSize)) {
+        return AVIF_RESULT_OK;
+    }
+    coeffs->simdTaps = (coeffs->count[0] + AVIF_SCALE_SIMD_TAPS - 1) / AVIF_SCALE_SIMD_TAPS * AVIF_SCALE_SIMD_TAPS;
+    const size_t weightCount = (size_t)coeffs->simdTaps * dstSize;
+    coeffs->weights16 = (int16_t *)avifAlloc(sizeof(int16_t) * weightCount);
+    AVIF_CHECKERR(coeffs->weights16, AVIF_RESULT_OUT_OF_MEMORY);
+    memset(coeffs->weights16, 0, sizeof(int16_t) * weightCount);
+    for (uint32_t i = 0; i < dstSize; ++i) {
+        for (uint32_t k = 0; k < coeffs->count[i]; ++k) {
+            coeffs->weights16[(size_t)i * coeffs->simdTaps + k] = (int16_t)coeffs->weights[(size_t)i * coeffs->maxTaps + k];
+        }
+    }
+    // The windows only move forward.
+    coeffs->simdCount = 0;
+    while (coeffs->simdCount < dstSize && coeffs->start[coeffs->simdCount] + coeffs->simdTaps <= srcSize) {
+        ++coeffs->simdCount;
+    }
+    return AVIF_RESULT_OK;
+}
+
+// Filters the row of source samples at src horizontally into the destination samples [firstX:width) of dst, with windows
+// of taps samples. The filtered samples are stored with intermediateBits more bits of precision than the source samples,
+// so that they use the whole uint16_t range.
+static inline void avifScaleRowHorizontalTaps(const uint8_t * src,
+                                              avifBool usesU16,
+                                              const avifScaleCoeffs * coeffs,
+                                              uint32_t firstX,
+                                              uint32_t width,
+                                              uint32_t intermediateBits,
+                                              uint32_t taps,
+                                              uint16_t * dst)
+{
+    const uint32_t shift = AVIF_SCALE_WEIGHT_BITS - intermediateBits;
+    const int32_t * weights = &coeffs->weights[(size_t)firstX * coeffs->maxTaps];
+    if (usesU16) {
+        for (uint32_t x = firstX; x < width; ++x, weights += coeffs->maxTaps) {
+            const uint16_t * samples = &((const uint16_t *)src)[coeffs->start[x]];
+            int32_t sum = 1 << (shift - 1);
+            for (uint32_t k = 0; k < taps; ++k) {
+                sum += (int32_t)samples[k] * weights[k];
+            }
+            dst[x] = (uint16_t)avifScaleNormalize(sum, shift, UINT16_MAX);
+        }
+    } else {
+        for (uint32_t x = firstX; x < width; ++x, weights += coeffs->maxTaps) {
+            const uint8_t * samples = &src[coeffs->start[x]];
+            int32_t sum = 1 << (shift - 1);
+            for (uint32_t k = 0; k < taps; ++k) {
+                sum += (int32_t)samples[k] * weights[k];
+            }
+            dst[x] = (uint16_t)avifScaleNormalize(sum, shift, UINT16_MAX);
+        }
+    }
+}
+
+// Same as avifScaleRowHorizontalTaps() with coefficients made uniform by avifScaleCoeffsMakeUniform().
+static void avifScaleRowHorizontal(const uint8_t * src,
+                                   avifBool usesU16,
+                                   const avifScaleCoeffs * coeffs,
+                                   uint32_t firstX,
+                                   uint32_t width,
+                                   uint32_t intermediateBits,
+                                   uint16_t * dst)
+{
+    // Specialize the window sizes of upscaling and of small downscaling factors.
+    switch (coeffs->count[0]) {
+        case 1:
+            avifScaleRowHorizontalTaps(src, usesU16, coeffs, firstX, width, intermediateBits, 1, dst);
+            break;
+        case 2:
+            avifScaleRowHorizontalTaps(src, usesU16, coeffs, firstX, width, intermediateBits, 2, dst);
+            break;
+        case 3:
+            avifScaleRowHorizontalTaps(src, usesU16, coeffs, firstX, width, intermediateBits, 3, dst);
+            break;
+        case 4:
+            avifScaleRowHorizontalTaps(src, usesU16, coeffs, firstX, width, intermediateBits, 4, dst);
+            break;
+        case 6:
+            avifScaleRowHorizontalTaps(src, usesU16, coeffs, firstX, width, intermediateBits, 6, dst);
+            break;
+        default:
+            avifScaleRowHorizontalTaps(src, usesU16, coeffs, firstX, width, intermediateBits, coeffs->count[0], dst);
+            break;
+    }
+}
+
+// Filters taps rows of width samples output by avifScaleRowHorizontal(), rowStride samples apart starting at rows,
+// vertically into dst.
+static inline void avifScaleRowVerticalTaps(const uint16_t * rows,
+                                            size_t rowStride,
+                                            const int32_t * weights,
+                                            uint32_t taps,
+                                            uint32_t width,
+                                            avifBool usesU16,
+                                            uint32_t intermediateBits,
+                                            uint32_t maxSample,
+                                            uint8_t * dst)
+{
+    const uint32_t shift = AVIF_SCALE_WEIGHT_BITS + intermediateBits;
+    for (uint32_t x = 0; x < width; ++x) {
+        int32_t sum = 1 << (shift - 1);
+        for (uint32_t k = 0; k < taps; ++k) {
+            sum += (int32_t)rows[k * rowStride + x] * weights[k];
+        }
+        if (usesU16) {
+            ((uint16_t *)dst)[x] = (uint16_t)avifScaleNormalize(sum, shift, maxSample);
+        } else {
+            dst[x] = (uint8_t)avifScaleNormalize(sum, shift, maxSample);
+        }
+    }
+}
+
+// Same as avifScaleRowVerticalTaps() with count rows. sums is scratch space for width values. The loops over the
+// columns are vectorizable.
+static void avifScaleRowVertical(const uint16_t * rows,
+                                 size_t rowStride,
+                                 const int32_t * weights,
+                                 uint32_t count,
+                                 uint32_t width,
+                                 int32_t * sums,
+                                 avifBool usesU16,
+                                 uint32_t intermediateBits,
+                                 uint32_t maxSample,
+                                 uint8_t * dst)
+{
+    // Accumulate short windows in registers, and longer ones row by row in sums.
+    switch (count) {
+        case 1:
+            avifScaleRowVerticalTaps(rows, rowStride, weights, 1, width, usesU16, intermediateBits, maxSample, dst);
+            return;
+        case 2:
+            avifScaleRowVerticalTaps(rows, rowStride, weights, 2, width, usesU16, intermediateBits, maxSample, dst);
+            return;
+        case 3:
+            avifScaleRowVerticalTaps(rows, rowStride, weights, 3, width, usesU16, intermediateBits, maxSample, dst);
+            return;
+        case 4:
+            avifScaleRowVerticalTaps(rows, rowStride, weights, 4, width, usesU16, intermediateBits, maxSample, dst);
+            return;
+        default:
+            break;
+    }
+
+    const uint32_t shift = AVIF_SCALE_WEIGHT_BITS + intermediateBits;
+    for (uint32_t x = 0; x < width; ++x) {
+        sums[x] = 1 << (shift - 1);
+    }
+    for (uint32_t k = 0; k < count; ++k) {
+        const uint16_t * row = &rows[k * rowStride];
+        const int32_t weight = weights[k];
+        for (uint32_t x = 0; x < width; ++x) {
+            sums[x] += (int32_t)row[x] * weight;
+        }
+    }
+    if (usesU16) {
+        for (uint32_t x = 0; x < width; ++x) {
+            ((uint16_t *)dst)[x] = (uint16_t)avifScaleNormalize(sums[x], shift, maxSample);
+        }
+    } else {
+        for (uint32_t x = 0; x < width; ++x) {
+            dst[x] = (uint8_t)avifScaleNormalize(sums[x], shift, maxSample);
+        }
+    }
+}
+
+// SIMD kernels that filter the leading destination samples of a row like avifScaleRowHorizontal() and
+// avifScaleRowVertical(), and return their count. The caller filters the remaining samples with the scalar functions.
+typedef uint32_t (*avifScaleRowHorizontalFunc)(const uint8_t * src,
+                                               avifBool usesU16,
+                                               const avifScaleCoeffs * coeffs,
+                                               uint32_t intermediateBits,
+                                               uint16_t * dst);
+typedef uint32_t (*avifScaleRowVerticalFunc)(const uint16_t * rows,
+                                             size_t rowStride,
+                                             const int32_t * weights,
+                                             uint32_t count,
+                                             uint32_t width,
+                                             avifBool usesU16,
+                                             uint32_t intermediateBits,
+                                             uint32_t maxSample,
+                                             uint8_t * dst);
+
+#if defined(AVIF_SIMD_SSE2)
+// The kernels multiply pairs of 16-bit samples and weights with _mm_madd_epi16(), which is signed. 16-bit samples are
+// offset by -32768 to fit in int16_t. Since the weights sum to AVIF_SCALE_WEIGHT_ONE, this offsets the sums by
+// -32768 * AVIF_SCALE_WEIGHT_ONE, which is added back with the rounding offset. The sums wrap around like the scalar
+// ones, so the results are the same.
+#define AVIF_SCALE_SAMPLE_OFFSET_SUM (32768 << AVIF_SCALE_WEIGHT_BITS)
+
+// Returns the sums of the 32-bit lanes of a, b, c and d, in order.
+static inline __m128i avifScaleSums4SSE2(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+    const __m128i ab = _mm_add_epi32(_mm_unpacklo_epi32(a, b), _mm_unpackhi_epi32(a, b));
+    const __m128i cd = _mm_add_epi32(_mm_unpacklo_epi32(c, d), _mm_unpackhi_epi32(c, d));
+    return _mm_add_epi32(_mm_unpacklo_epi64(ab, cd), _mm_unpackhi_epi64(ab, cd));
+}
+
+// Returns the 32-bit lanes of lo and hi clamped to [0:maxSample] as 16-bit lanes.
+static inline __m128i avifScaleClampSSE2(__m128i lo, __m128i hi, uint32_t maxSample)
+{
+    // The signed saturation of the values offset by -32768 clamps them to [0:65535].
+    const __m128i offset = _mm_set1_epi32(32768);
+    const __m128i packed = _mm_packs_epi32(_mm_sub_epi32(lo, offset), _mm_sub_epi32(hi, offset));
+    const __m128i clamped = _mm_min_epi16(packed, _mm_set1_epi16((short)(maxSample - 32768)));
+    return _mm_xor_si128(clamped, _mm_set1_epi16((short)0x8000));
+}
+
+// Returns the products of the simdTaps samples of the window of the destination sample x with its weights, summed by
+// pairs and by groups of AVIF_SCALE_SIMD_TAPS.
+static inline __m128i avifScaleWindowSSE2(const uint8_t * src,
+                                          avifBool usesU16,
+                                          const avifScaleCoeffs * coeffs,
+                                          uint32_t x)
+{
+    const int16_t * weights = &coeffs->weights16[(size_t)x * coeffs->simdTaps];
+    __m128i products = _mm_setzero_si128();
+    for (uint32_t k = 0; k < coeffs->simdTaps; k += AVIF_SCALE_SIMD_TAPS) {
+        const uint32_t first = coeffs->start[x] + k;
+        __m128i samples;
+        if (usesU16) {
+            samples = _mm_loadu_si128((const __m128i *)&((const uint16_t *)src)[first]);
+            samples = _mm_xor_si128(samples, _mm_set1_epi16((short)0x8000));
+        } else {
+            samples = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)&src[first]), _mm_setzero_si128());
+        }
+        products = _mm_add_epi32(products, _mm_madd_epi16(samples, _mm_loadu_si128((const __m128i *)&weights[k])));
+    }
+    return products;
+}
+
+static uint32_t avifScaleRowHorizontalSSE2(const uint8_t * src,
+                                           avifBool usesU16,
+                                           const avifScaleCoeffs * coeffs,
+                                           uint32_t intermediateBits,
+                                           uint16_t * dst)
+{
+    const uint32_t shift = AVIF_SCALE_WEIGHT_BITS - intermediateBits;
+    const __m128i rounding = _mm_set1_epi32((1 << (shift - 1)) + (usesU16 ? AVIF_SCALE_SAMPLE_OFFSET_SUM : 0));
+    const __m128i shiftCount = _mm_cvtsi32_si128((int)shift);
+    uint32_t x = 0;
+    for (; x + 8 <= coeffs->simdCount; x += 8) {
+        __m128i sums[2];
+        for (int i = 0; i < 2; ++i) {
+            const uint32_t x4 = x + 4 * i;
+            sums[i] = avifScaleSums4SSE2(avifScaleWindowSSE2(src, usesU16, coeffs, x4),
+                                         avifScaleWindowSSE2(src, usesU16, coeffs, x4 + 1),
+                                         avifScaleWindowSSE2(src, usesU16, coeffs, x4 + 2),
+                                         avifScaleWindowSSE2(src, usesU16, coeffs, x4 + 3));
+            sums[i] = _mm_sra_epi32(_mm_add_epi32(sums[i], rounding), shiftCount);
+        }
+        _mm_storeu_si128((__m128i *)&dst[x], avifScaleClampSSE2(sums[0], sums[1], UINT16_MAX));
+    }
+    return x;
+}
+
+static uint32_t avifScaleRowVerticalSSE2(const uint16_t * rows,
+                                         size_t rowStride,
+                                         const int32_t * weights,
+                                         uint32_t count,
+                                         uint32_t width,
+                                         avifBool usesU16,
+                                         uint32_t intermediateBits,
+                                         uint32_t maxSample,
+                                         uint8_t * dst)
+{
+    const uint32_t shift = AVIF_SCALE_WEIGHT_BITS + intermediateBits;
+    const __m128i rounding = _mm_set1_epi32((1 << (shift - 1)) + AVIF_SCALE_SAMPLE_OFFSET_SUM);
+    const __m128i shiftCount = _mm_cvtsi32_si128((int)shift);
+    const __m128i sampleOffset = _mm_set1_epi16((short)0x8000);
+    uint32_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i sumLo = rounding;
+        __m128i sumHi = rounding;
+        for (uint32_t k = 0; k < count; k += 2) {
+            // An odd last row is paired with itself and a weight of 0.
+            const uint32_t k1 = (k + 1 < count) ? k + 1 : k;
+            const int32_t weight1 = (k + 1 < count) ? weights[k + 1] : 0;
+            const __m128i weightPair = _mm_set1_epi32((int32_t)((uint32_t)(uint16_t)weights[k] | ((uint32_t)weight1 << 16)));
+            const __m128i row0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&rows[k * rowStride + x]), sampleOffset);
+            const __m128i row1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&rows[k1 * rowStride + x]), sampleOffset);
+            sumLo = _mm_add_epi32(sumLo, _mm_madd_epi16(_mm_unpacklo_epi16(row0, row1), weightPair));
+            sumHi = _mm_add_epi32(sumHi, _mm_madd_epi16(_mm_unpackhi_epi16(row0, row1), weightPair));
+        }
+        const __m128i samples = avifScaleClampSSE2(_mm_sra_epi32(sumLo, shiftCount), _mm_sra_epi32(sumHi, shiftCount), maxSample);
+        if (usesU16) {
+            _mm_storeu_si128((__m128i *)&((uint16_t *)dst)[x], samples);
+        } else {
+            _mm_storel_epi64((__m128i *)&dst[x], _mm_packus_epi16(samples, samples));
+        }
+    }
+    return x;
+}
+
+#if defined(AVIF_SIMD_AVX2)
+// The AVX2 kernels work within 128-bit lanes, the low lanes holding the first half of the destination samples.
+
+__attribute__((target("avx2"))) static inline __m256i avifScaleSums4AVX2(__m256i a, __m256i b, __m256i c, __m256i d)
+{
+    const __m256i ab = _mm256_add_epi32(_mm256_unpacklo_epi32(a, b), _mm256_unpackhi_epi32(a, b));
+    const __m256i cd = _mm256_add_epi32(_mm256_unpacklo_epi32(c, d), _mm256_unpackhi_epi32(c, d));
+    return _mm256_add_epi32(_mm256_unpacklo_epi64(ab, cd), _mm256_unpackhi_epi64(ab, cd));
+}
+
+// Returns the 32-bit lanes of lo and hi clamped to [0:maxSample] as 16-bit lanes, interleaved by groups of four.
+__attribute__((target("avx2"))) static inline __m256i avifScaleClampAVX2(__m256i lo, __m256i hi, uint32_t maxSample)
+{
+    return _mm256_min_epu16(_mm256_packus_epi32(lo, hi), _mm256_set1_epi16((short)maxSample));
+}
+
+// Same as avifScaleWindowSSE2() for the destination samples x and x + 4.
+__attribute__((target("avx2"))) static inline __m256i avifScaleWindowsAVX2(const uint8_t * src,
+                                                                           avifBool usesU16,
+                                                                           const avifScaleCoeffs * coeffs,
+                                                                           uint32_t x)
+{
+    const int16_t * weights = &coeffs->weights16[(size_t)x * coeffs->simdTaps];
+    const size_t weightsOffset = (size_t)4 * coeffs->simdTaps;
+    __m256i products = _mm256_setzero_si256();
+    for (uint32_t k = 0; k < coeffs->simdTaps; k += AVIF_SCALE_SIMD_TAPS) {
+        const uint32_t first = coeffs->start[x] + k;
+        const uint32_t first4 = coeffs->start[x + 4] + k;
+        __m256i samples;
+        if (usesU16) {
+            const uint16_t * src16 = (const uint16_t *)src;
+            samples = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)&src16[first])),
+                                              _mm_loadu_si128((const __m128i *)&src16[first4]),
+                                              1);
+            samples = _mm256_xor_si256(samples, _mm256_set1_epi16((short)0x8000));
+        } else {
+            const __m128i samples8 = _mm_loadl_epi64((const __m128i *)&src[first]);
+            const __m128i samples8x4 = _mm_loadl_epi64((const __m128i *)&src[first4]);
+            samples = _mm256_cvtepu8_epi16(_mm_unpacklo_epi64(samples8, samples8x4));
+        }
+        const __m256i weightPairs = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)&weights[k])),
+                                                            _mm_loadu_si128((const __m128i *)&weights[weightsOffset + k]),
+                                                            1);
+        products = _mm256_add_epi32(products, _mm256_madd_epi16(samples, weightPairs));
+    }
+    return products;
+}
+
+__attribute__((target("avx2"))) static uint32_t avifScaleRowHorizontalAVX2(const uint8_t * src,
+                                                                           avifBool usesU16,
+                                                                           const avifScaleCoeffs * coeffs,
+                                                                           uint32_t intermediateBits,
+                                                                           uint16_t * dst)
+{
+    const uint32_t shift = AVIF_SCALE_WEIGHT_BITS - intermediateBits;
+    const __m256i rounding = _mm256_set1_epi32((1 << (shift - 1)) + (usesU16 ? AVIF_SCALE_SAMPLE_OFFSET_SUM : 0));
+    const __m128i shiftCount = _mm_cvtsi32_si128((int)shift);
+    uint32_t x = 0;
+    for (; x + 16 <= coeffs->simdCount; x += 16) {
+        __m256i sums[2];
+        for (int i = 0; i < 2; ++i) {
+            const uint32_t x8 = x + 8 * i;
+            sums[i] = avifScaleSums4AVX2(avifScaleWindowsAVX2(src, usesU16, coeffs, x8),
+                                         avifScaleWindowsAVX2(src, usesU16, coeffs, x8 + 1),
+                                         avifScaleWindowsAVX2(src, usesU16, coeffs, x8 + 2),
+                                         avifScaleWindowsAVX2(src, usesU16, coeffs, x8 + 3));
+            sums[i] = _mm256_sra_epi32(_mm256_add_epi32(sums[i], rounding), shiftCount);
+        }
+        // The lanes of sums[i] are the destination samples x + 8 * i to x + 8 * i + 7.
+        const __m256i samples = avifScaleClampAVX2(sums[0], sums[1], UINT16_MAX);
+        _mm256_storeu_si256((__m256i *)&dst[x], _mm256_permute4x64_epi64(samples, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    return x;
+}
+
+__attribute__((target("avx2"))) static uint32_t avifScaleRowVerticalAVX2(const uint16_t * rows,
+                                                                         size_t rowStride,
+                                                                         const int32_t * weights,
+                                                                         uint32_t count,
+                                                                         uint32_t width,
+                                                                         avifBool usesU16,
+                                                                         uint32_t intermediateBits,
+                                                                         uint32_t maxSample,
+                                                                         uint8_t * dst)
+{
+    const uint32_t shift = AVIF_SCALE_WEIGHT_BITS + intermediateBits;
+    const __m256i rounding = _mm256_set1_epi32((1 << (shift - 1)) + AVIF_SCALE_SAMPLE_OFFSET_SUM);
+    const __m128i shiftCount = _mm_cvtsi32_si128((int)shift);
+    const __m256i sampleOffset = _mm256_set1_epi16((short)0x8000);
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i sumLo = rounding;
+        __m256i sumHi = rounding;
+        for (uint32_t k = 0; k < count; k += 2) {
+            const uint32_t k1 = (k + 1 < count) ? k + 1 : k;
+            const int32_t weight1 = (k + 1 < count) ? weights[k + 1] : 0;
+            const __m256i weightPair = _mm256_set1_epi32((int32_t)((uint32_t)(uint16_t)weights[k] | ((uint32_t)weight1 << 16)));
+            const __m256i row0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)&rows[k * rowStride + x]), sampleOffset);
+            const __m256i row1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)&rows[k1 * rowStride + x]), sampleOffset);
+            sumLo = _mm256_add_epi32(sumLo, _mm256_madd_epi16(_mm256_unpacklo_epi16(row0, row1), weightPair));
+            sumHi = _mm256_add_epi32(sumHi, _mm256_madd_epi16(_mm256_unpackhi_epi16(row0, row1), weightPair));
+        }
+        // Packing undoes the interleaving of the unpacking.
+        const __m256i samples =
+            avifScaleClampAVX2(_mm256_sra_epi32(sumLo, shiftCount), _mm256_sra_epi32(sumHi, shiftCount), maxSample);
+        if (usesU16) {
+            _mm256_storeu_si256((__m256i *)&((uint16_t *)dst)[x], samples);
+        } else {
+            const __m128i samples8 = _mm_packus_epi16(_mm256_castsi256_si128(samples), _mm256_extracti128_si256(samples, 1));
+            _mm_storeu_si128((__m128i *)&dst[x], samples8);
+        }
+    }
+    return x;
+}
+#endif // defined(AVIF_SIMD_AVX2)
+#endif // defined(AVIF_SIMD_SSE2)
+
+typedef struct avifScalePlane
+{
+    const uint8_t * src;
+    uint32_t srcRowBytes;
+    uint8_t * dst;
+    uint32_t dstRowBytes;
+    uint32_t dstWidth;
+    uint32_t dstHeight;
+    avifScaleCoeffs horizontal;
+    avifScaleCoeffs vertical;
+    avifBool verticalFitsInt16; // AVIF_TRUE if rowVertical can be used.
+} avifScalePlane;
+
+typedef struct avifScaleContext
+{
+    avifScalePlane planes[AVIF_PLANE_COUNT_YUV + 1]; // Indexed by avifChannelIndex. dst is NULL for missing planes.
+    avifBool usesU16;
+    uint32_t intermediateBits; // See avifScaleRowHorizontal().
+    uint32_t maxSample;
+    uint32_t jobCount;
+    // SIMD kernels, or NULL. rowHorizontal is only used if the horizontal weights16 of the plane are not NULL.
+    avifScaleRowHorizontalFunc rowHorizontal;
+    avifScaleRowVerticalFunc rowVertical;
+} avifScaleContext;
+
+typedef struct avifScaleJob
+{
+    avifThread * thread;
+    const avifScaleContext * context;
+    uint32_t jobIndex;
+    avifResult result;
+} avifScaleJob;
+
+// Scales the jobIndex-th band of rows of each plane, AVIF_SCALE_CHUNK_HEIGHT rows at a time. Each chunk is filtered
+// horizontally into a buffer of the source rows it needs, then vertically into the destination plane.
+static void avifScaleJobWorker(void * arg)
+{
+    avifScaleJob * job = (avifScaleJob *)arg;
+    const avifScaleContext * context = job->context;
+    uint16_t * buffer = NULL;
+    size_t bufferCapacity = 0;
+    int32_t * sums = NULL;
+
+    for (int c = 0; c < AVIF_PLANE_COUNT_YUV + 1; ++c) {
+        const avifScalePlane * plane = &context->planes[c];
+        if (!plane->dst) {
+            continue;
+        }
+        avifFree(sums);
+        sums = (int32_t *)avifAlloc(sizeof(int32_t) * plane->dstWidth);
+        if (!sums) {
+            job->result = AVIF_RESULT_OUT_OF_MEMORY;
+            break;
+        }
+        const uint32_t firstRow = (uint32_t)((uint64_t)plane->dstHeight * job->jobIndex / context->jobCount);
+        const uint32_t lastRow = (uint32_t)((uint64_t)plane->dstHeight * (job->jobIndex + 1) / context->jobCount);
+        for (uint32_t chunkRow = firstRow; chunkRow < lastRow; chunkRow += AVIF_SCALE_CHUNK_HEIGHT) {
+            const uint32_t chunkEnd = AVIF_MIN(chunkRow + AVIF_SCALE_CHUNK_HEIGHT, lastRow);
+            uint32_t srcFirstRow = UINT32_MAX;
+            uint32_t srcLastRow = 0;
+            for (uint32_t y = chunkRow; y < chunkEnd; ++y) {
+                srcFirstRow = AVIF_MIN(srcFirstRow, plane->vertical.start[y]);
+                srcLastRow = AVIF_MAX(srcLastRow, plane->vertical.start[y] + plane->vertical.count[y]);
+            }
+
+            const size_t bufferSize = (size_t)(srcLastRow - srcFirstRow) * plane->dstWidth;
+            if (bufferSize > bufferCapacity) {
+                avifFree(buffer);
+                buffer = (uint16_t *)avifAlloc(sizeof(uint16_t) * bufferSize);
+                if (!buffer) {
+                    job->result = AVIF_RESULT_OUT_OF_MEMORY;
+                    break;
+                }
+                bufferCapacity = bufferSize;
+            }
+            for (uint32_t y = srcFirstRow; y < srcLastRow; ++y) {
+                const uint8_t * srcRow = &plane->src[(size_t)y * plane->srcRowBytes];
+                uint16_t * bufferRow = &buffer[(size_t)(y - srcFirstRow) * plane->dstWidth];
+                uint32_t firstX = 0;
+                if (context->rowHorizontal && plane->horizontal.weights16) {
+                    firstX = context->rowHorizontal(srcRow,
+                                                    context->usesU16,
+                                                    &plane->horizontal,
+                                                    context->intermediateBits,
+                                                    bufferRow);
+                }
+                avifScaleRowHorizontal(srcRow,
+                                       context->usesU16,
+                                       &plane->horizontal,
+                                       firstX,
+                                       plane->dstWidth,
+                                       context->intermediateBits,
+                                       bufferRow);
+            }
+            const size_t sampleSize = context->usesU16 ? 2 : 1;
+            for (uint32_t y = chunkRow; y < chunkEnd; ++y) {
+                const uint16_t * rows = &buffer[(size_t)(plane->vertical.start[y] - srcFirstRow) * plane->dstWidth];
+                const int32_t * weights = &plane->vertical.weights[(size_t)y * plane->vertical.maxTaps];
+                uint8_t * dstRow = &plane->dst[(size_t)y * plane->dstRowBytes];
+                uint32_t firstX = 0;
+                if (context->rowVertical && plane->verticalFitsInt16) {
+                    firstX = context->rowVertical(rows,
+                                                  plane->dstWidth,
+                                                  weights,
+                                                  plane->vertical.count[y],
+                                                  plane->dstWidth,
+                                                  context->usesU16,
+                                                  context->intermediateBits,
+                                                  context->maxSample,
+                                                  dstRow);
+                }
+                avifScaleRowVertical(&rows[firstX],
+                                     plane->dstWidth,
+                                     weights,
+                                     plane->vertical.count[y],
+                                     plane->dstWidth - firstX,
+                                     sums,
+                                     context->usesU16,
+                                     context->intermediateBits,
+                                     context->maxSample,
+                                     &dstRow[firstX * sampleSize]);
+            }
+        }
+        if (job->result != AVIF_RESULT_OK) {
+            break;
+        }
+    }
+    avifFree(sums);
+    avifFree(buffer);
+}
+
+avifResult avifImageScaleInto(const avifImage * srcImage,
+                              avifImage * dstImage,
+                              avifScaleFilter filter,
+                              int maxThreads,
+                              avifDiagnostics * diag)
+{
+    if (diag) {
+        avifDiagnosticsClearError(diag);
+    }
+    AVIF_CHECKERR(srcImage != dstImage && filter >= AVIF_SCALE_FILTER_BOX && filter < AVIF_SCALE_FILTER_COUNT && maxThreads >= 0,
+                  AVIF_RESULT_INVALID_ARGUMENT);
+    if (srcImage->width == 0 || srcImage->height == 0 || dstImage->width == 0 || dstImage->height == 0) {
+        avifDiagnosticsPrintf(diag,
+                              "avifImageScaleInto requested invalid dimensions [%ux%u -> %ux%u]",
+                              srcImage->width,
+                              srcImage->height,
+                              dstImage->width,
+                              dstImage->height);
+        return AVIF_RESULT_INVALID_ARGUMENT;
+    }
+    if (dstImage->depth != srcImage->depth || dstImage->yuvFormat != srcImage->yuvFormat) {
+        avifDiagnosticsPrintf(diag, "avifImageScaleInto requires the same depth and YUV format for both images");
+        return AVIF_RESULT_INVALID_ARGUMENT;
+    }
+    if (avifDimensionsTooLarge(dstImage->width,
+                               dstImage->height,
+                               AVIF_DEFAULT_IMAGE_SIZE_LIMIT,
+                               AVIF_DEFAULT_IMAGE_DIMENSION_LIMIT)) {
+        avifDiagnosticsPrintf(diag,
+                              "avifImageScaleInto requested dst dimensions that are too large [%ux%u]",
+                              dstImage->width,
+                              dstImage->height);
+        return AVIF_RESULT_NOT_IMPLEMENTED;
+    }
+
+    avifPixelFormatInfo formatInfo;
+    avifGetPixelFormatInfo(srcImage->yuvFormat, &formatInfo);
+    const avifBool hasYUV = srcImage->yuvPlanes[AVIF_CHAN_Y] != NULL;
+    const avifBool hasChroma = hasYUV && !formatInfo.monochrome;
+    AVIF_CHECKERR(hasYUV || srcImage->alphaPlane, AVIF_RESULT_NO_CONTENT);
+    AVIF_CHECKERR(!hasChroma || (srcImage->yuvPlanes[AVIF_CHAN_U] && srcImage->yuvPlanes[AVIF_CHAN_V]),
+                  AVIF_RESULT_INVALID_ARGUMENT);
+    // avifImageAllocatePlanes() would take ownership of the planes provided by the caller.
+    if (hasYUV && !dstImage->yuvPlanes[AVIF_CHAN_Y]) {
+        AVIF_CHECKERR(!dstImage->yuvPlanes[AVIF_CHAN_U] && !dstImage->yuvPlanes[AVIF_CHAN_V], AVIF_RESULT_INVALID_ARGUMENT);
+        AVIF_CHECKRES(avifImageAllocatePlanes(dstImage, AVIF_PLANES_YUV));
+    }
+    AVIF_CHECKERR(!hasChroma || (dstImage->yuvPlanes[AVIF_CHAN_U] && dstImage->yuvPlanes[AVIF_CHAN_V]),
+                  AVIF_RESULT_INVALID_ARGUMENT);
+    if (srcImage->alphaPlane && !dstImage->alphaPlane) {
+        AVIF_CHECKRES(avifImageAllocatePlanes(dstImage, AVIF_PLANES_A));
+    }
+
+    avifScaleContext context;
+    memset(&context, 0, sizeof(context));
+    context.usesU16 = avifImageUsesU16(srcImage);
+    context.intermediateBits = 16 - srcImage->depth;
+    context.maxSample = (1u << srcImage->depth) - 1;
+#if defined(AVIF_SIMD_SSE2)
+    const uint32_t cpuFeatures = avifGetCPUFeatures();
+    if (cpuFeatures & AVIF_CPU_SSE2) {
+        context.rowHorizontal = avifScaleRowHorizontalSSE2;
+        context.rowVertical = avifScaleRowVerticalSSE2;
+    }
+#if defined(AVIF_SIMD_AVX2)
+    if (cpuFeatures & AVIF_CPU_AVX2) {
+        context.rowHorizontal = avifScaleRowHorizontalAVX2;
+        context.rowVertical = avifScaleRowVerticalAVX2;
+    }
+#endif
+#endif
+    avifResult result = AVIF_RESULT_OK;
+    for (int c = 0; c < AVIF_PLANE_COUNT_YUV + 1 && result == AVIF_RESULT_OK; ++c) {
+        const uint8_t * src = avifImagePlane(srcImage, c);
+        if (!src || (c != AVIF_CHAN_Y && c != AVIF_CHAN_A && !hasChroma)) {
+            continue;
+        }
+        avifScalePlane * plane = &context.planes[c];
+        plane->src = src;
+        plane->srcRowBytes = avifImagePlaneRowBytes(srcImage, c);
+        plane->dst = avifImagePlane(dstImage, c);
+        plane->dstRowBytes = avifImagePlaneRowBytes(dstImage, c);
+        plane->dstWidth = avifImagePlaneWidth(dstImage, c);
+        plane->dstHeight = avifImagePlaneHeight(dstImage, c);
+        const uint32_t srcWidth = avifImagePlaneWidth(srcImage, c);
+        result = avifScaleCoeffsCreate(&plane->horizontal, srcWidth, plane->dstWidth, filter);
+        if (result == AVIF_RESULT_OK) {
+            avifScaleCoeffsMakeUniform(&plane->horizontal, srcWidth, plane->dstWidth);
+            result = avifScaleCoeffsCreate(&plane->vertical, avifImagePlaneHeight(srcImage, c), plane->dstHeight, filter);
+        }
+        if (result == AVIF_RESULT_OK && context.rowHorizontal) {
+            result = avifScaleCoeffsPrepareSIMD(&plane->horizontal, srcWidth, plane->dstWidth);
+            plane->verticalFitsInt16 = avifScaleCoeffsFitInt16(&plane->vertical, plane->dstHeight);
+        }
+    }
+
+    // Give each job at least a chunk of rows of the luma or alpha plane.
+    avifScaleJob jobs[AVIF_SCALE_MAX_JOBS];
+    memset(jobs, 0, sizeof(jobs));
+    context.jobCount = (uint32_t)AVIF_CLAMP(maxThreads, 1, AVIF_SCALE_MAX_JOBS);
+    context.jobCount = AVIF_MAX(1, AVIF_MIN(context.jobCount, dstImage->height / AVIF_SCALE_CHUNK_HEIGHT));
+    if (result == AVIF_RESULT_OK) {
+        for (uint32_t jobIndex = 0; jobIndex < context.jobCount; ++jobIndex) {
+            jobs[jobIndex].context = &context;
+            jobs[jobIndex].jobIndex = jobIndex;
+        }
+        // The calling thread runs the first job.
+        for (uint32_t jobIndex = 1; jobIndex < context.jobCount; ++jobIndex) {
+            jobs[jobIndex].thread = avifThreadCreate(avifScaleJobWorker, &jobs[jobIndex]);
+            if (jobs[jobIndex].thread == NULL) {
+                avifScaleJobWorker(&jobs[jobIndex]);
+            }
+        }
+        avifScaleJobWorker(&jobs[0]);
+        for (uint32_t jobIndex = 0; jobIndex < context.jobCount; ++jobIndex) {
+            if (jobs[jobIndex].thread != NULL && !avifThreadJoin(jobs[jobIndex].thread)) {
+                result = AVIF_RESULT_UNKNOWN_ERROR;
+            }
+            if (jobs[jobIndex].result != AVIF_RESULT_OK) {
+                result = jobs[jobIndex].result;
+            }
+        }
+    }
+
+    for (int c = 0; c < AVIF_PLANE_COUNT_YUV + 1; ++c) {
+        avifScaleCoeffsDestroy(&context.planes[c].horizontal);
+        avifScaleCoeffsDestroy(&context.planes[c].vertical);
+    }
+    return result;
+}
+
+// Number of output rows filtered at once by avifImageYUVToRGBScaled() before being converted to RGB.
+#define AVIF_SCALED_BAND_HEIGHT 16
+
+// Adds the samples of row in [start[i], end[i]) to sums[i] for each i in [0, count).
+static void avifBoxSumRow(const uint8_t * row,
+                          avifBool usesU16,
+                          const uint32_t * start,
+                          const uint32_t * end,
+                          uint32_t count,
+                          uint64_t * sums)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        uint64_t sum = 0;
+        if (usesU16) {
+            for (uint32_t x = start[i]; x < end[i]; ++x) {
+                sum += ((const uint16_t *)row)[x];
+            }
+        } else {
+            for (uint32_t x = start[i]; x < end[i]; ++x) {
+                sum += row[x];
+            }
+        }
+        sums[i] += sum;
+    }
+}
+
+// Sets [*start, *end) to the i-th of dstCount ranges evenly splitting [0, srcCount), with at least one sample. If shift is
+// 1, the range is mapped to the positions of subsampled samples covering it.
+static void avifBoxRange(uint32_t srcCount, uint32_t dstCount, uint32_t i, uint32_t shift, uint32_t * start, uint32_t * end)
+{
+    const uint32_t first = (uint32_t)((uint64_t)i * srcCount / dstCount);
+    const uint32_t last = (uint32_t)((uint64_t)(i + 1) * srcCount / dstCount);
+    *start = first >> shift;
+    *end = AVIF_MAX(*start + 1, (last + shift) >> shift);
+}
+
+// Box filters rows [firstRow, lastRow) of plane into dstRow, with the given column ranges.
+static void avifBoxFilterRow(const uint8_t * plane,
+                             uint32_t rowBytes,
+                             avifBool usesU16,
+                             uint32_t firstRow,
+                             uint32_t lastRow,
+                             const uint32_t * start,
+                             const uint32_t * end,
+                             uint32_t count,
+                             uint64_t * sums,
+                             uint8_t * dstRow)
+{
+    memset(sums, 0, sizeof(uint64_t) * count);
+    for (uint32_t y = firstRow; y < lastRow; ++y) {
+        avifBoxSumRow(&plane[(size_t)y * rowBytes], usesU16, start, end, count, sums);
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint64_t area = (uint64_t)(end[i] - start[i]) * (lastRow - firstRow);
+        const uint64_t value = (sums[i] + area / 2) / area;
+        if (usesU16) {
+            ((uint16_t *)dstRow)[i] = (uint16_t)value;
+        } else {
+            dstRow[i] = (uint8_t)value;
+        }
+    }
+}
+
+avifResult avifImageYUVToRGBScaled(const avifImage * image, avifRGBImage * rgb)
+{
+    if (!image->yuvPlanes[AVIF_CHAN_Y]) {
+        return AVIF_RESULT_REFORMAT_FAILED;
+    }
+    AVIF_CHECKERR(rgb->pixels && rgb->width > 0 && rgb->height > 0 && rgb->width <= image->width && rgb->height <= image->height,
+                  AVIF_RESULT_INVALID_ARGUMENT);
+    if ((rgb->width == image->width) && (rgb->height == image->height)) {
+        return avifImageYUVToRGB(image, rgb);
+    }
+
+    avifPixelFormatInfo formatInfo;
+    avifGetPixelFormatInfo(image->yuvFormat, &formatInfo);
+    const avifBool hasChroma = !formatInfo.monochrome && image->yuvPlanes[AVIF_CHAN_U] && image->yuvPlanes[AVIF_CHAN_V];
+    const avifBool usesU16 = avifImageUsesU16(image);
+    const uint32_t dstWidth = rgb->width;
+
+    // The source rows are filtered band by band into a small image at the destination width, without chroma subsampling
+    // so that no upsampling is needed when converting it to RGB.
+    avifResult result = AVIF_RESULT_OK;
+    avifYUVToRGBPlan * plan = NULL;
+    uint64_t * sums = NULL;
+    uint32_t * ranges = NULL;
+    avifImage * band = avifImageCreate(dstWidth,
+                                       AVIF_MIN(rgb->height, AVIF_SCALED_BAND_HEIGHT),
+                                       image->depth,
+                                       hasChroma ? AVIF_PIXEL_FORMAT_YUV444 : AVIF_PIXEL_FORMAT_YUV400);
+    AVIF_CHECKERR(band, AVIF_RESULT_OUT_OF_MEMORY);
+    band->yuvRange = image->yuvRange;
+    band->colorPrimaries = image->colorPrimaries;
+    band->transferCharacteristics = image->transferCharacteristics;
+    band->matrixCoefficients = image->matrixCoefficients;
+    band->alphaPremultiplied = image->alphaPremultiplied;
+    const uint32_t bandHeight = band->height;
+    result = avifImageAllocatePlanes(band, image->alphaPlane ? AVIF_PLANES_ALL : AVIF_PLANES_YUV);
+    if (result != AVIF_RESULT_OK) {
+        goto cleanup;
+    }
+    result = avifYUVToRGBPlanCreateWithResult(band, rgb, &plan);
+    if (result != AVIF_RESULT_OK) {
+        goto cleanup;
+    }
+    sums = (uint64_t *)avifAlloc(sizeof(uint64_t) * dstWidth);
+    ranges = (uint32_t *)avifAlloc(sizeof(uint32_t) * 4 * (size_t)dstWidth);
+    if (!sums || !ranges) {
+        result = AVIF_RESULT_OUT_OF_MEMORY;
+        goto cleanup;
+    }
+    uint32_t * const start = ranges;
+    uint32_t * const end = start + dstWidth;
+    uint32_t * const uvStart = end + dstWidth;
+    uint32_t * const uvEnd = uvStart + dstWidth;
+    for (uint32_t i = 0; i < dstWidth; ++i) {
+        avifBoxRange(image->width, dstWidth, i, 0, &start[i], &end[i]);
+        avifBoxRange(image->width, dstWidth, i, (uint32_t)formatInfo.chromaShiftX, &uvStart[i], &uvEnd[i]);
+    }
+
+    for (uint32_t bandFirstRow = 0; bandFirstRow < rgb->height; bandFirstRow += bandHeight) {
+        band->height = AVIF_MIN(bandHeight, rgb->height - bandFirstRow);
+        for (uint32_t j = 0; j < band->height; ++j) {
+            uint32_t firstRow, lastRow;
+            avifBoxRange(image->height, rgb->height, bandFirstRow + j, 0, &firstRow, &lastRow);
+            avifBoxFilterRow(image->yuvPlanes[AVIF_CHAN_Y],
+                             image->yuvRowBytes[AVIF_CHAN_Y],
+                             usesU16,
+                             firstRow,
+                             lastRow,
+                             start,
+                             end,
+                             dstWidth,
+                             sums,
+                             &band->yuvPlanes[AVIF_CHAN_Y][(size_t)j * band->yuvRowBytes[AVIF_CHAN_Y]]);
+            if (image->alphaPlane) {
+                avifBoxFilterRow(image->alphaPlane,
+                                 image->alphaRowBytes,
+                                 usesU16,
+                                 firstRow,
+                                 lastRow,
+                                 start,
+                                 end,
+                                 dstWidth,
+                                 sums,
+                                 &band->alphaPlane[(size_t)j * band->alphaRowBytes]);
+            }
+            if (hasChroma) {
+                uint32_t uvFirstRow, uvLastRow;
+                avifBoxRange(image->height,
+                             rgb->height,
+                             bandFirstRow + j,
+                             (uint32_t)formatInfo.chromaShiftY,
+                             &uvFirstRow,
+                             &uvLastRow);
+                for (int c = AVIF_CHAN_U; c <= AVIF_CHAN_V; ++c) {
+                    avifBoxFilterRow(image->yuvPlanes[c],
+                                     image->yuvRowBytes[c],
+                                     usesU16,
+                                     uvFirstRow,
+                                     uvLastRow,
+                                     uvStart,
+                                     uvEnd,
+                                     dstWidth,
+                                     sums,
+                                     &band->yuvPlanes[c][(size_t)j * band->yuvRowBytes[c]]);
+                }
+            }
+        }
+
+        avifRGBImage rgbBand = *rgb;
+        rgbBand.height = band->height;
+        rgbBand.pixels = &rgb->pixels[(size_t)bandFirstRow * rgb->rowBytes];
+        result = avifImageYUVToRGBWithPlan(plan, band, &rgbBand);
+        if (result != AVIF_RESULT_OK) {
+            goto cleanup;
+        }
+    }
+
+cleanup:
+    avifFree(ranges);
+    avifFree(sums);
+    if (plan) {
+        avifYUVToRGBPlanDestroy(plan);
+    }
+    avifImageDestroy(band);
+    return result;
+}
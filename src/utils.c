@@ -297,3 +297,25 @@ avifBool avifDoubleToUnsignedFraction(double v, avifUnsignedFraction * fraction)
 {
     return avifDoubleToUnsignedFractionImpl(v, UINT32_MAX, &fraction->n, &fraction->d);
 }
+
+// Set by avifSetCPUMask().
+static uint32_t avifCPUMask = AVIF_CPU_ALL;
+
+void avifSetCPUMask(uint32_t mask)
+{
+    avifCPUMask = mask;
+}
+
+uint32_t avifGetCPUFeatures(void)
+{
+    uint32_t features = 0;
+#if defined(AVIF_SIMD_SSE2)
+    features |= AVIF_CPU_SSE2;
+#endif
+#if defined(AVIF_SIMD_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        features |= AVIF_CPU_AVX2;
+    }
+#endif
+    return features & avifCPUMask;
+}
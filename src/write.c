@@ -4,6 +4,7 @@
 #include "avif/internal.h"
 
 #include <assert.h>
+#include <math.h>
 #include <stdint.h>
 #include <string.h>
 #include <time.h>
@@ -34,6 +35,14 @@ typedef struct avifOffsetFixup
 } avifOffsetFixup;
 AVIF_ARRAY_DECLARE(avifOffsetFixupArray, avifOffsetFixup, fixup);
 
+// Consecutive samples of a track written at once to avifEncoder::io.
+typedef struct avifEncoderChunk
+{
+    uint64_t offset;
+    uint32_t sampleCount;
+} avifEncoderChunk;
+AVIF_ARRAY_DECLARE(avifEncoderChunkArray, avifEncoderChunk, chunk);
+
 static const char alphaURN[] = AVIF_URN_ALPHA0;
 static const size_t alphaURNSize = sizeof(alphaURN);
 
@@ -195,6 +204,11 @@ typedef struct avifEncoderItem
     uint16_t dimgFromID; // if non-zero, make an iref from dimgFromID -> this id
 
     avifItemPropertyAssociationArray associations; // 'ipma'
+
+    // Only used with avifEncoder::io.
+    uint32_t ioSampleCount;         // encodeOutput->samples[0:ioSampleCount) were written. Only the first payload is kept.
+    uint64_t ioDataOffset;          // Offset of the first sample or of metadataPayload in avifEncoder::io.
+    avifEncoderChunkArray ioChunks; // Where encodeOutput->samples[0:ioSampleCount) were written.
 } avifEncoderItem;
 AVIF_ARRAY_DECLARE(avifEncoderItemArray, avifEncoderItem, item);
 
@@ -214,6 +228,45 @@ typedef struct avifEncoderFrame
 } avifEncoderFrame;
 AVIF_ARRAY_DECLARE(avifEncoderFrameArray, avifEncoderFrame, frame);
 
+// ---------------------------------------------------------------------------
+// avifEncoderSegment
+
+// A frame of an image sequence waiting to be encoded by an avifEncoderSegment.
+typedef struct avifEncoderSegmentFrame
+{
+    avifImage * image;                    // Deep copy of the input image, freed once encoded
+    avifEncoder settings;                 // Shallow copy of the avifEncoder settings when the frame was added
+    avifCodecSpecificOptions * csOptions; // Codec-specific options to apply when encoding this frame
+    avifEncoderChanges encoderChanges;
+    avifAddImageFlags addImageFlags;
+    int quality;
+    int qualityAlpha;
+    int tileRowsLog2;
+    int tileColsLog2;
+} avifEncoderSegmentFrame;
+
+// An image item encoded by an avifEncoderSegment.
+typedef struct avifEncoderSegmentItem
+{
+    avifItemCategory itemCategory; // AVIF_ITEM_COLOR or AVIF_ITEM_ALPHA
+    avifCodec * codec;
+    avifCodecEncodeOutput * encodeOutput;
+} avifEncoderSegmentItem;
+
+// A run of consecutive frames of an image sequence, starting with a keyframe, that is encoded in its own thread with its
+// own codec instances. See avifEncoder::parallelSegments.
+typedef struct avifEncoderSegment
+{
+    avifEncoderSegmentFrame * frames; // Array of avifEncoderData::segmentLength elements
+    uint32_t frameCount;
+    avifEncoderSegmentItem items[2]; // Color, and alpha if itemCount is 2
+    uint32_t itemCount;
+    avifDiagnostics diag;
+    avifThread * thread; // NULL if the segment was encoded in the calling thread
+    avifResult result;
+} avifEncoderSegment;
+AVIF_ARRAY_DECLARE(avifEncoderSegmentArray, avifEncoderSegment *, segment);
+
 // ---------------------------------------------------------------------------
 // avifEncoderData
 
@@ -252,6 +305,20 @@ typedef struct avifEncoderData
     // Fields specific to AV1/AV2
     const char * imageItemType;  // "av01" for AV1 ("av02" for AV2 if AVIF_CODEC_AVM)
     const char * configPropName; // "av1C" for AV1 ("av2C" for AV2 if AVIF_CODEC_AVM)
+    // If not 0, only the first segmentLength frames of the image sequence are encoded by avifEncoderItem::codec.
+    // The following ones are encoded by segments of segmentLength frames. See avifEncoder::parallelSegments.
+    uint32_t segmentLength;
+    avifEncoderSegmentArray segments;
+    uint32_t startedSegmentCount; // segments[0:startedSegmentCount) are being encoded or are encoded
+    uint32_t joinedSegmentCount;  // segments[0:joinedSegmentCount) are encoded
+    // Union of all the codec-specific options set so far, applied to the first frame of each segment.
+    avifCodecSpecificOptions * segmentCsOptions;
+    // Decoding codec instance used by avifEncoderDecodeSatoBaseImage() for all cells. NULL until first needed.
+    avifCodec * satoDecoder;
+    // Offset of the 'mdat' box in avifEncoder::io, or 0 if it was not started yet.
+    uint64_t ioMdatOffset;
+    // End of the bytes written to avifEncoder::io so far.
+    uint64_t ioOffset;
 } avifEncoderData;
 
 static void avifEncoderDataDestroy(avifEncoderData * data);
@@ -281,6 +348,9 @@ static avifEncoderData * avifEncoderDataCreate(void)
     if (!avifArrayCreate(&data->alternativeItemIDs, sizeof(uint16_t), 1)) {
         goto error;
     }
+    if (!avifArrayCreate(&data->segments, sizeof(avifEncoderSegment *), 1)) {
+        goto error;
+    }
     return data;
 
 error:
@@ -310,6 +380,9 @@ static avifEncoderItem * avifEncoderDataCreateItem(avifEncoderData * data, const
     if (!avifArrayCreate(&item->associations, sizeof(avifItemPropertyAssociation), 4)) {
         goto error;
     }
+    if (!avifArrayCreate(&item->ioChunks, sizeof(avifEncoderChunk), 1)) {
+        goto error;
+    }
     return item;
 
 error:
@@ -317,6 +390,7 @@ error:
         avifCodecEncodeOutputDestroy(item->encodeOutput);
     }
     avifArrayDestroy(&item->mdatFixups);
+    avifArrayDestroy(&item->associations);
     --data->lastItemID;
     avifArrayPop(&data->items);
     return NULL;
@@ -324,17 +398,45 @@ error:
 
 static avifEncoderItem * avifEncoderDataFindItemByID(avifEncoderData * data, uint16_t id)
 {
-    for (uint32_t itemIndex = 0; itemIndex < data->items.count; ++itemIndex) {
-        avifEncoderItem * item = &data->items.item[itemIndex];
+    // Items are only ever appended by avifEncoderDataCreateItem() with an ever-increasing ID, so data->items is sorted by ID.
+    // The IDs are consecutive unless entity groups took some of them, so try the matching index first.
+    if (id != 0 && id <= data->items.count && data->items.item[id - 1].id == id) {
+        return &data->items.item[id - 1];
+    }
+    uint32_t low = 0;
+    uint32_t high = data->items.count;
+    while (low < high) {
+        const uint32_t mid = low + (high - low) / 2;
+        avifEncoderItem * item = &data->items.item[mid];
         if (item->id == id) {
             return item;
         }
+        if (item->id < id) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
     }
     return NULL;
 }
 
+static avifResult avifEncoderDataJoinSegments(avifEncoderData * data, uint32_t segmentCount, avifDiagnostics * diag);
+static void avifEncoderSegmentDestroy(avifEncoderSegment * segment);
+
 static void avifEncoderDataDestroy(avifEncoderData * data)
 {
+    // Wait for the segments that are still being encoded, if any.
+    (void)avifEncoderDataJoinSegments(data, data->startedSegmentCount, /*diag=*/NULL);
+    for (uint32_t i = 0; i < data->segments.count; ++i) {
+        avifEncoderSegmentDestroy(data->segments.segment[i]);
+    }
+    avifArrayDestroy(&data->segments);
+    if (data->segmentCsOptions) {
+        avifCodecSpecificOptionsDestroy(data->segmentCsOptions);
+    }
+    if (data->satoDecoder) {
+        avifCodecDestroy(data->satoDecoder);
+    }
     for (uint32_t i = 0; i < data->items.count; ++i) {
         avifEncoderItem * item = &data->items.item[i];
         if (item->codec) {
@@ -344,6 +446,7 @@ static void avifEncoderDataDestroy(avifEncoderData * data)
         avifRWDataFree(&item->metadataPayload);
         avifArrayDestroy(&item->mdatFixups);
         avifArrayDestroy(&item->associations);
+        avifArrayDestroy(&item->ioChunks);
     }
     if (data->imageMetadata) {
         avifImageDestroy(data->imageMetadata);
@@ -373,12 +476,20 @@ typedef struct avifItemProperty
     uint8_t index;
     size_t offset;
     size_t size;
+    uint32_t hash; // See avifItemPropertyHash()
 } avifItemProperty;
 AVIF_ARRAY_DECLARE(avifItemPropertyArray, avifItemProperty, property);
 
+// Capacity of avifItemPropertyDedup::slots. A power of two that keeps the table at most half full,
+// given that there are at most MAX_PROPERTY_INDEX properties.
+#define AVIF_ITEM_PROPERTY_SLOT_COUNT 256
+
 typedef struct avifItemPropertyDedup
 {
     avifItemPropertyArray properties;
+    // Open addressing hash table with linear probing, mapping property bytes to the elements of |properties|.
+    // Each slot is 0 if empty, or the index of the property in |properties| plus one.
+    uint8_t slots[AVIF_ITEM_PROPERTY_SLOT_COUNT];
     avifRWStream s;    // Temporary stream for each new property, checked against already-written boxes for deduplications
     avifRWData buffer; // Temporary storage for 's'
     uint8_t nextIndex; // 1-indexed, incremented every time another unique property is finished
@@ -416,11 +527,22 @@ static void avifItemPropertyDedupStart(avifItemPropertyDedup * dedup)
     avifRWStreamStart(&dedup->s, &dedup->buffer);
 }
 
+// FNV-1a hash of the serialized property.
+static uint32_t avifItemPropertyHash(const uint8_t * data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
 // This compares the newly written item property (in the dedup's temporary storage buffer) to
 // already-written properties (whose offsets/sizes in outputStream are recorded in the dedup). If a
 // match is found, the previous property's index is used. If this new property is unique, it is
 // assigned the next available property index, written to the output stream, and its offset/size in
 // the output stream is recorded in the dedup for future comparisons.
+// Only the already-written properties with the same hash are compared byte by byte.
 //
 // On success, this function adds to the given ipma box a property association linking the reused
 // or newly created property with the item.
@@ -431,10 +553,12 @@ static avifResult avifItemPropertyDedupFinish(avifItemPropertyDedup * dedup,
 {
     uint8_t propertyIndex = 0;
     const size_t newPropertySize = avifRWStreamOffset(&dedup->s);
+    const uint32_t hash = avifItemPropertyHash(dedup->buffer.data, newPropertySize);
 
-    for (size_t i = 0; i < dedup->properties.count; ++i) {
-        avifItemProperty * property = &dedup->properties.property[i];
-        if ((property->size == newPropertySize) &&
+    uint32_t slot = hash & (AVIF_ITEM_PROPERTY_SLOT_COUNT - 1);
+    for (; dedup->slots[slot] != 0; slot = (slot + 1) & (AVIF_ITEM_PROPERTY_SLOT_COUNT - 1)) {
+        avifItemProperty * property = &dedup->properties.property[dedup->slots[slot] - 1];
+        if ((property->hash == hash) && (property->size == newPropertySize) &&
             !memcmp(&outputStream->raw->data[property->offset], dedup->buffer.data, newPropertySize)) {
             // We've already written this exact property, reuse it
             propertyIndex = property->index;
@@ -445,14 +569,18 @@ static avifResult avifItemPropertyDedupFinish(avifItemPropertyDedup * dedup,
 
     if (propertyIndex == 0) {
         // Write a new property, and remember its location in the output stream for future deduplication
+        AVIF_CHECKERR(dedup->nextIndex < MAX_PROPERTY_INDEX, AVIF_RESULT_INVALID_ARGUMENT);
         avifItemProperty * property = (avifItemProperty *)avifArrayPush(&dedup->properties);
         AVIF_CHECKERR(property != NULL, AVIF_RESULT_OUT_OF_MEMORY);
-        AVIF_CHECKERR(dedup->nextIndex < MAX_PROPERTY_INDEX, AVIF_RESULT_INVALID_ARGUMENT);
         property->index = ++dedup->nextIndex; // preincrement so the first new index is 1 (as ipma is 1-indexed)
         property->size = newPropertySize;
         property->offset = avifRWStreamOffset(outputStream);
+        property->hash = hash;
         AVIF_CHECKRES(avifRWStreamWrite(outputStream, dedup->buffer.data, newPropertySize));
         propertyIndex = property->index;
+        // The probing above stopped at an empty slot.
+        AVIF_ASSERT_OR_RETURN(dedup->properties.count < AVIF_ITEM_PROPERTY_SLOT_COUNT);
+        dedup->slots[slot] = (uint8_t)dedup->properties.count;
     }
 
     avifItemPropertyAssociation * association = (avifItemPropertyAssociation *)avifArrayPush(associations);
@@ -511,9 +639,49 @@ void avifEncoderDestroy(avifEncoder * encoder)
     if (encoder->data) {
         avifEncoderDataDestroy(encoder->data);
     }
+    avifIODestroy(encoder->io);
     avifFree(encoder);
 }
 
+avifResult avifEncoderReset(avifEncoder * encoder)
+{
+    avifDiagnosticsClearError(&encoder->diag);
+    avifEncoderData * data = avifEncoderDataCreate();
+    AVIF_CHECKERR(data != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+    avifEncoderData * oldData = encoder->data;
+
+    // The decoding codec instance is flushed before each use anyway.
+    data->satoDecoder = oldData->satoDecoder;
+    oldData->satoDecoder = NULL;
+    avifEncoderDataDestroy(oldData);
+    encoder->data = data;
+    memset(&encoder->ioStats, 0, sizeof(encoder->ioStats));
+    // Writing another file over the previous one would leave its trailing bytes if it was longer.
+    avifIODestroy(encoder->io);
+    encoder->io = NULL;
+    return AVIF_RESULT_OK;
+}
+
+avifResult avifEncoderSetIO(avifEncoder * encoder, avifIO * io)
+{
+    avifDiagnosticsClearError(&encoder->diag);
+    // The destination cannot change once samples were encoded.
+    AVIF_CHECKERR(encoder->data->items.count == 0, AVIF_RESULT_INVALID_ARGUMENT);
+    AVIF_CHECKERR(io == NULL || io->write != NULL, AVIF_RESULT_INVALID_ARGUMENT);
+    avifIODestroy(encoder->io);
+    encoder->io = io;
+    return AVIF_RESULT_OK;
+}
+
+avifResult avifEncoderSetIOFile(avifEncoder * encoder, const char * filename)
+{
+    avifDiagnosticsClearError(&encoder->diag);
+    AVIF_CHECKERR(encoder->data->items.count == 0, AVIF_RESULT_INVALID_ARGUMENT);
+    avifIO * io = avifIOCreateFileWriter(filename);
+    AVIF_CHECKERR(io != NULL, AVIF_RESULT_IO_ERROR);
+    return avifEncoderSetIO(encoder, io);
+}
+
 avifResult avifEncoderSetCodecSpecificOption(avifEncoder * encoder, const char * key, const char * value)
 {
     return avifCodecSpecificOptionsSet(encoder->csOptions, key, value);
@@ -1148,7 +1316,11 @@ static avifResult avifEncoderDataCreateXMPItem(avifEncoderData * data, const avi
 }
 
 // Same as avifImageCopy() but pads the dstImage with border pixel values to reach dstWidth and dstHeight.
-static avifResult avifImageCopyAndPad(avifImage * const dstImage, const avifImage * srcImage, uint32_t dstWidth, uint32_t dstHeight)
+static avifResult avifImageCopyAndPad(avifImage * const dstImage,
+                                      const avifImage * srcImage,
+                                      uint32_t dstWidth,
+                                      uint32_t dstHeight,
+                                      int maxThreads)
 {
     AVIF_ASSERT_OR_RETURN(dstImage);
     AVIF_ASSERT_OR_RETURN(!dstImage->width && !dstImage->height); // dstImage is not set yet.
@@ -1166,45 +1338,7 @@ static avifResult avifImageCopyAndPad(avifImage * const dstImage, const avifImag
     if (srcImage->alphaPlane) {
         AVIF_CHECKRES(avifImageAllocatePlanes(dstImage, AVIF_PLANES_A));
     }
-    const avifBool usesU16 = avifImageUsesU16(srcImage);
-    for (int plane = AVIF_CHAN_Y; plane <= AVIF_CHAN_A; ++plane) {
-        const uint8_t * srcRow = avifImagePlane(srcImage, plane);
-        const uint32_t srcRowBytes = avifImagePlaneRowBytes(srcImage, plane);
-        const uint32_t srcPlaneWidth = avifImagePlaneWidth(srcImage, plane);
-        const uint32_t srcPlaneHeight = avifImagePlaneHeight(srcImage, plane); // 0 for A if no alpha and 0 for UV if 4:0:0.
-        const size_t srcPlaneWidthBytes = (size_t)srcPlaneWidth << usesU16;
-
-        uint8_t * dstRow = avifImagePlane(dstImage, plane);
-        const uint32_t dstRowBytes = avifImagePlaneRowBytes(dstImage, plane);
-        const uint32_t dstPlaneWidth = avifImagePlaneWidth(dstImage, plane);
-        const uint32_t dstPlaneHeight = avifImagePlaneHeight(dstImage, plane); // 0 for A if no alpha and 0 for UV if 4:0:0.
-        const size_t dstPlaneWidthBytes = (size_t)dstPlaneWidth << usesU16;
-
-        for (uint32_t j = 0; j < srcPlaneHeight; ++j) {
-            memcpy(dstRow, srcRow, srcPlaneWidthBytes);
-
-            // Pad columns.
-            if (dstPlaneWidth > srcPlaneWidth) {
-                if (usesU16) {
-                    uint16_t * dstRow16 = (uint16_t *)dstRow;
-                    for (uint32_t x = srcPlaneWidth; x < dstPlaneWidth; ++x) {
-                        dstRow16[x] = dstRow16[srcPlaneWidth - 1];
-                    }
-                } else {
-                    memset(&dstRow[srcPlaneWidth], dstRow[srcPlaneWidth - 1], dstPlaneWidth - srcPlaneWidth);
-                }
-            }
-            srcRow += srcRowBytes;
-            dstRow += dstRowBytes;
-        }
-
-        // Pad rows.
-        for (uint32_t j = srcPlaneHeight; j < dstPlaneHeight; ++j) {
-            memcpy(dstRow, dstRow - dstRowBytes, dstPlaneWidthBytes);
-            dstRow += dstRowBytes;
-        }
-    }
-    return AVIF_RESULT_OK;
+    return avifImageCopyAndPadSamples(dstImage, srcImage, AVIF_PLANES_ALL, maxThreads);
 }
 
 static int avifGetQuality(int quality, int minQuantizer, int maxQuantizer)
@@ -1368,19 +1502,98 @@ static avifResult avifEncoderCreateBitDepthExtensionItems(avifEncoder * encoder,
     return AVIF_RESULT_OK;
 }
 
-// Same as avifImageApplyExpression() but for the expression (inputImageItem [op] constant).
-// Convenience function.
-static avifResult avifImageApplyImgOpConst(avifImage * result,
-                                           const avifImage * inputImageItem,
-                                           avifSampleTransformTokenType op,
-                                           int32_t constant,
-                                           avifPlanesFlags planes)
+// Row kernels of the bit depth extension recipes. These are plain loops without branches so that compilers vectorize them.
+// They are equivalent to avifImageApplyExpression() for the expressions of avifEncoderCreateSatoImage() and 16-bit inputs.
+
+// dst = (((src >> rightShift) & mask) << leftShift) + offset, where dst fits in 8 bits.
+static void avifBitDepthExtensionRow8(const uint16_t * src,
+                                      uint8_t * dst,
+                                      uint32_t width,
+                                      uint32_t rightShift,
+                                      uint32_t mask,
+                                      uint32_t leftShift,
+                                      uint32_t offset)
+{
+    for (uint32_t x = 0; x < width; ++x) {
+        dst[x] = (uint8_t)(((((uint32_t)src[x] >> rightShift) & mask) << leftShift) + offset);
+    }
+}
+
+// dst = src >> rightShift, where dst fits in 12 bits.
+static void avifBitDepthExtensionRow16(const uint16_t * src, uint16_t * dst, uint32_t width, uint32_t rightShift)
 {
-    // Postfix notation.
-    const avifSampleTransformToken tokens[] = { { AVIF_SAMPLE_TRANSFORM_INPUT_IMAGE_ITEM_INDEX, 0, /*inputImageItemIndex=*/1 },
-                                                { AVIF_SAMPLE_TRANSFORM_CONSTANT, constant, 0 },
-                                                { (uint8_t)op, 0, 0 } };
-    return avifImageApplyOperations(result, AVIF_SAMPLE_TRANSFORM_BIT_DEPTH_32, /*numTokens=*/3, tokens, /*numInputImageItems=*/1, &inputImageItem, planes);
+    for (uint32_t x = 0; x < width; ++x) {
+        dst[x] = (uint16_t)(src[x] >> rightShift);
+    }
+}
+
+// dst = clamp_8b(src - base * 16 + 128), where base is a 12-bit sample.
+static void avifBitDepthExtensionResidualRow8(const uint16_t * src, const uint16_t * base, uint8_t * dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; ++x) {
+        const int32_t residual = (int32_t)src[x] - (int32_t)base[x] * 16 + 128;
+        dst[x] = (uint8_t)AVIF_CLAMP(residual, 0, 255);
+    }
+}
+
+// Computes the planes of dstImage from the 16-bit planes of image. If decodedBaseImage is not NULL, the residual
+// clamp_8b(image - decodedBaseImage * 16 + 128) is computed. Otherwise see avifBitDepthExtensionRow8() and
+// avifBitDepthExtensionRow16() for the meaning of the other arguments.
+static avifResult avifImageApplyBitDepthExtension(avifImage * dstImage,
+                                                  const avifImage * image,
+                                                  const avifImage * decodedBaseImage,
+                                                  uint32_t rightShift,
+                                                  uint32_t mask,
+                                                  uint32_t leftShift,
+                                                  uint32_t offset,
+                                                  avifPlanesFlag planes)
+{
+    AVIF_ASSERT_OR_RETURN(avifImageUsesU16(image));
+    AVIF_ASSERT_OR_RETURN(!decodedBaseImage || (avifImageUsesU16(decodedBaseImage) && !avifImageUsesU16(dstImage)));
+    for (int c = AVIF_CHAN_Y; c <= AVIF_CHAN_A; ++c) {
+        if ((c == AVIF_CHAN_A) != (planes == AVIF_PLANES_A)) {
+            continue;
+        }
+        const uint32_t planeWidth = avifImagePlaneWidth(dstImage, c);
+        const uint32_t planeHeight = avifImagePlaneHeight(dstImage, c);
+        if (planeWidth == 0) {
+            continue; // Chroma planes of monochrome images.
+        }
+        AVIF_ASSERT_OR_RETURN(avifImagePlaneWidth(image, c) == planeWidth && avifImagePlaneHeight(image, c) == planeHeight);
+        const uint8_t * srcRow = avifImagePlane(image, c);
+        uint8_t * dstRow = avifImagePlane(dstImage, c);
+        AVIF_ASSERT_OR_RETURN(srcRow != NULL && dstRow != NULL);
+        const size_t srcRowBytes = avifImagePlaneRowBytes(image, c);
+        const size_t dstRowBytes = avifImagePlaneRowBytes(dstImage, c);
+
+        if (decodedBaseImage) {
+            AVIF_CHECKERR(avifImagePlaneWidth(decodedBaseImage, c) == planeWidth &&
+                              avifImagePlaneHeight(decodedBaseImage, c) == planeHeight,
+                          AVIF_RESULT_ENCODE_SAMPLE_TRANSFORM_FAILED);
+            const uint8_t * baseRow = avifImagePlane(decodedBaseImage, c);
+            AVIF_ASSERT_OR_RETURN(baseRow != NULL);
+            const size_t baseRowBytes = avifImagePlaneRowBytes(decodedBaseImage, c);
+            for (uint32_t y = 0; y < planeHeight; ++y) {
+                avifBitDepthExtensionResidualRow8((const uint16_t *)srcRow, (const uint16_t *)baseRow, dstRow, planeWidth);
+                srcRow += srcRowBytes;
+                baseRow += baseRowBytes;
+                dstRow += dstRowBytes;
+            }
+        } else if (avifImageUsesU16(dstImage)) {
+            for (uint32_t y = 0; y < planeHeight; ++y) {
+                avifBitDepthExtensionRow16((const uint16_t *)srcRow, (uint16_t *)dstRow, planeWidth, rightShift);
+                srcRow += srcRowBytes;
+                dstRow += dstRowBytes;
+            }
+        } else {
+            for (uint32_t y = 0; y < planeHeight; ++y) {
+                avifBitDepthExtensionRow8((const uint16_t *)srcRow, dstRow, planeWidth, rightShift, mask, leftShift, offset);
+                srcRow += srcRowBytes;
+                dstRow += dstRowBytes;
+            }
+        }
+    }
+    return AVIF_RESULT_OK;
 }
 
 static avifResult avifImageCreateAllocate(avifImage ** sampleTransformedImage, const avifImage * reference, uint32_t numBits, avifPlanesFlag planes)
@@ -1390,15 +1603,12 @@ static avifResult avifImageCreateAllocate(avifImage ** sampleTransformedImage, c
     return avifImageAllocatePlanes(*sampleTransformedImage, planes);
 }
 
-// Finds the encoded base image and decodes it. Callers of this function must free
-// *codec and *decodedBaseImage if not null, whether the function succeeds or not.
+// Finds the encoded base image and decodes it into decodedBaseImage with encoder->data->satoDecoder. The planes of
+// decodedBaseImage are owned by the codec instance and are only valid until the next call to this function.
 static avifResult avifEncoderDecodeSatoBaseImage(avifEncoder * encoder,
                                                  uint32_t cellIndex,
-                                                 const avifImage * original,
-                                                 uint32_t numBits,
                                                  avifPlanesFlag planes,
-                                                 avifCodec ** codec,
-                                                 avifImage ** decodedBaseImage)
+                                                 avifImage * decodedBaseImage)
 {
     avifDecodeSample sample;
     memset(&sample, 0, sizeof(sample));
@@ -1427,14 +1637,25 @@ static avifResult avifEncoderDecodeSatoBaseImage(avifEncoder * encoder,
     }
     AVIF_ASSERT_OR_RETURN(sample.data.size != 0); // There should be at least one base item.
 
-    AVIF_CHECKRES(avifCodecCreate(AVIF_CODEC_CHOICE_AUTO, AVIF_CODEC_FLAG_CAN_DECODE, codec));
-    (*codec)->diag = &encoder->diag;
-    (*codec)->maxThreads = encoder->maxThreads;
-    (*codec)->imageSizeLimit = AVIF_DEFAULT_IMAGE_SIZE_LIMIT;
-    (*codec)->imageDimensionLimit = AVIF_DEFAULT_IMAGE_DIMENSION_LIMIT;
-    AVIF_CHECKRES(avifImageCreateAllocate(decodedBaseImage, original, numBits, planes));
+    // The same codec instance decodes the base image of all cells, flushed in between.
+    avifCodec * codec = encoder->data->satoDecoder;
+    if (codec != NULL && codec->flush) {
+        codec->flush(codec);
+    } else if (codec != NULL) {
+        avifCodecDestroy(codec);
+        codec = NULL;
+        encoder->data->satoDecoder = NULL;
+    }
+    if (codec == NULL) {
+        AVIF_CHECKRES(avifCodecCreate(AVIF_CODEC_CHOICE_AUTO, AVIF_CODEC_FLAG_CAN_DECODE, &codec));
+        codec->maxThreads = encoder->maxThreads;
+        codec->imageSizeLimit = AVIF_DEFAULT_IMAGE_SIZE_LIMIT;
+        codec->imageDimensionLimit = AVIF_DEFAULT_IMAGE_DIMENSION_LIMIT;
+        encoder->data->satoDecoder = codec;
+    }
+    codec->diag = &encoder->diag;
     avifBool isLimitedRangeAlpha = AVIF_FALSE; // Ignored.
-    AVIF_CHECKERR((*codec)->getNextImage(*codec, &sample, planes == AVIF_PLANES_A, &isLimitedRangeAlpha, *decodedBaseImage),
+    AVIF_CHECKERR(codec->getNextImage(codec, &sample, planes == AVIF_PLANES_A, &isLimitedRangeAlpha, decodedBaseImage),
                   AVIF_RESULT_ENCODE_SAMPLE_TRANSFORM_FAILED);
     return AVIF_RESULT_OK;
 }
@@ -1455,76 +1676,55 @@ static avifResult avifEncoderCreateSatoImage(avifEncoder * encoder,
     }
 
     if (encoder->sampleTransformRecipe == AVIF_SAMPLE_TRANSFORM_BIT_DEPTH_EXTENSION_8B_8B) {
+        AVIF_CHECKRES(avifImageCreateAllocate(sampleTransformedImage, image, 8, planes));
         if (isBase) {
-            AVIF_CHECKRES(avifImageCreateAllocate(sampleTransformedImage, image, 8, planes));
-            AVIF_CHECKRES(avifImageApplyImgOpConst(*sampleTransformedImage, image, AVIF_SAMPLE_TRANSFORM_QUOTIENT, 256, planes));
+            // image / 256
+            AVIF_CHECKRES(avifImageApplyBitDepthExtension(*sampleTransformedImage, image, NULL, 8, 0xFF, 0, 0, planes));
         } else {
-            AVIF_CHECKRES(avifImageCreateAllocate(sampleTransformedImage, image, 8, planes));
-            AVIF_CHECKRES(avifImageApplyImgOpConst(*sampleTransformedImage, image, AVIF_SAMPLE_TRANSFORM_AND, 255, planes));
+            // image & 255
+            AVIF_CHECKRES(avifImageApplyBitDepthExtension(*sampleTransformedImage, image, NULL, 0, 0xFF, 0, 0, planes));
         }
     } else if (encoder->sampleTransformRecipe == AVIF_SAMPLE_TRANSFORM_BIT_DEPTH_EXTENSION_12B_4B) {
         if (isBase) {
+            // image / 16
             AVIF_CHECKRES(avifImageCreateAllocate(sampleTransformedImage, image, 12, planes));
-            AVIF_CHECKRES(avifImageApplyImgOpConst(*sampleTransformedImage, image, AVIF_SAMPLE_TRANSFORM_QUOTIENT, 16, planes));
+            AVIF_CHECKRES(avifImageApplyBitDepthExtension(*sampleTransformedImage, image, NULL, 4, 0xFFF, 0, 0, planes));
         } else {
-            AVIF_CHECKRES(avifImageCreateAllocate(sampleTransformedImage, image, 8, planes));
-            AVIF_CHECKRES(avifImageApplyImgOpConst(*sampleTransformedImage, image, AVIF_SAMPLE_TRANSFORM_AND, 15, planes));
             // AVIF only supports 8, 10 or 12-bit image items. Scale the samples to fit the range.
             // Note: The samples could be encoded as is without being shifted left before encoding,
             //       but they would not be shifted right after decoding either. Right shifting after
             //       decoding provides a guarantee on the range of values and on the lack of integer
             //       overflow, so it is safer to do these extra steps.
             //       It also makes more sense from a compression point-of-view to use the full range.
-            // Transform in-place.
-            AVIF_CHECKRES(
-                avifImageApplyImgOpConst(*sampleTransformedImage, *sampleTransformedImage, AVIF_SAMPLE_TRANSFORM_PRODUCT, 16, planes));
-            if (!itemWillBeEncodedLosslessly) {
-                // Small loss at encoding could be amplified by the truncation caused by the right
-                // shift after decoding. Offset sample values now, before encoding, to round rather
-                // than floor the samples shifted after decoding.
-                // Note: Samples were just left shifted by numShiftedBits, so adding less than
-                //       (1<<numShiftedBits) will not trigger any integer overflow.
-                // Transform in-place.
-                AVIF_CHECKRES(
-                    avifImageApplyImgOpConst(*sampleTransformedImage, *sampleTransformedImage, AVIF_SAMPLE_TRANSFORM_SUM, 7, planes));
-            }
+            // Small loss at encoding could be amplified by the truncation caused by the right
+            // shift after decoding. Offset sample values before encoding, to round rather
+            // than floor the samples shifted after decoding.
+            // Note: Samples are left shifted by numShiftedBits, so adding less than
+            //       (1<<numShiftedBits) will not trigger any integer overflow.
+            // (image & 15) * 16 + offset
+            const uint32_t offset = itemWillBeEncodedLosslessly ? 0 : 7;
+            AVIF_CHECKRES(avifImageCreateAllocate(sampleTransformedImage, image, 8, planes));
+            AVIF_CHECKRES(avifImageApplyBitDepthExtension(*sampleTransformedImage, image, NULL, 0, 0xF, 4, offset, planes));
         }
     } else {
         AVIF_CHECKERR(encoder->sampleTransformRecipe == AVIF_SAMPLE_TRANSFORM_BIT_DEPTH_EXTENSION_12B_8B_OVERLAP_4B,
                       AVIF_RESULT_NOT_IMPLEMENTED);
         if (isBase) {
+            // image / 16
             AVIF_CHECKRES(avifImageCreateAllocate(sampleTransformedImage, image, 12, planes));
-            AVIF_CHECKRES(avifImageApplyImgOpConst(*sampleTransformedImage, image, AVIF_SAMPLE_TRANSFORM_QUOTIENT, 16, planes));
+            AVIF_CHECKRES(avifImageApplyBitDepthExtension(*sampleTransformedImage, image, NULL, 4, 0xFFF, 0, 0, planes));
         } else {
             AVIF_CHECKRES(avifImageCreateAllocate(sampleTransformedImage, image, 8, planes));
-            avifCodec * codec = NULL;
-            avifImage * decodedBaseImage = NULL;
-            avifResult result = avifEncoderDecodeSatoBaseImage(encoder, item->cellIndex, image, 12, planes, &codec, &decodedBaseImage);
+            // The planes are set by avifEncoderDecodeSatoBaseImage() without any allocation.
+            avifImage * decodedBaseImage = avifImageCreateEmpty();
+            AVIF_CHECKERR(decodedBaseImage != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+            avifResult result = avifEncoderDecodeSatoBaseImage(encoder, item->cellIndex, planes, decodedBaseImage);
             if (result == AVIF_RESULT_OK) {
-                // decoded = main*16+hidden-128 so hidden = clamp_8b(original-main*16+128). Postfix notation.
-                const avifSampleTransformToken tokens[] = { { AVIF_SAMPLE_TRANSFORM_INPUT_IMAGE_ITEM_INDEX, 0, /*inputImageItemIndex=*/1 },
-                                                            { AVIF_SAMPLE_TRANSFORM_INPUT_IMAGE_ITEM_INDEX, 0, /*inputImageItemIndex=*/2 },
-                                                            { AVIF_SAMPLE_TRANSFORM_CONSTANT, /*constant=*/16, 0 },
-                                                            { AVIF_SAMPLE_TRANSFORM_PRODUCT, 0, 0 },
-                                                            { AVIF_SAMPLE_TRANSFORM_DIFFERENCE, 0, 0 },
-                                                            { AVIF_SAMPLE_TRANSFORM_CONSTANT, /*constant=*/128, 0 },
-                                                            { AVIF_SAMPLE_TRANSFORM_SUM, 0, 0 } };
-                // image is "original" (index 1) and decodedBaseImage is "main" (index 2) in the formula above.
-                const avifImage * inputImageItems[] = { image, decodedBaseImage };
-                result = avifImageApplyOperations(*sampleTransformedImage,
-                                                  AVIF_SAMPLE_TRANSFORM_BIT_DEPTH_32,
-                                                  /*numTokens=*/7,
-                                                  tokens,
-                                                  /*numInputImageItems=*/2,
-                                                  inputImageItems,
-                                                  planes);
-            }
-            if (decodedBaseImage) {
-                avifImageDestroy(decodedBaseImage);
-            }
-            if (codec) {
-                avifCodecDestroy(codec);
+                // decoded = main*16+hidden-128 so hidden = clamp_8b(original-main*16+128).
+                // image is "original" and decodedBaseImage is "main" in the formula above.
+                result = avifImageApplyBitDepthExtension(*sampleTransformedImage, image, decodedBaseImage, 0, 0, 0, 0, planes);
             }
+            avifImageDestroy(decodedBaseImage);
             AVIF_CHECKRES(result);
         }
     }
@@ -1699,6 +1899,705 @@ static avifResult avifValidateGrid(uint32_t gridCols,
     return AVIF_RESULT_OK;
 }
 
+// ---------------------------------------------------------------------------
+// avifEncoderSegment functions
+
+static void avifEncoderSegmentFreeFrames(avifEncoderSegment * segment)
+{
+    for (uint32_t frameIndex = 0; frameIndex < segment->frameCount; ++frameIndex) {
+        avifEncoderSegmentFrame * frame = &segment->frames[frameIndex];
+        if (frame->image) {
+            avifImageDestroy(frame->image);
+            frame->image = NULL;
+        }
+        if (frame->csOptions) {
+            avifCodecSpecificOptionsDestroy(frame->csOptions);
+            frame->csOptions = NULL;
+        }
+    }
+}
+
+static void avifEncoderSegmentDestroy(avifEncoderSegment * segment)
+{
+    avifEncoderSegmentFreeFrames(segment);
+    avifFree(segment->frames);
+    for (uint32_t itemIndex = 0; itemIndex < segment->itemCount; ++itemIndex) {
+        avifEncoderSegmentItem * item = &segment->items[itemIndex];
+        if (item->codec) {
+            avifCodecDestroy(item->codec);
+        }
+        if (item->encodeOutput) {
+            avifCodecEncodeOutputDestroy(item->encodeOutput);
+        }
+    }
+    avifFree(segment);
+}
+
+// Encodes all the frames of the segment with new codec instances. Mirrors the encoding loop of avifEncoderAddImageInternal()
+// and the checks of avifEncoderFinish() for a single cell without gain map nor sample transform.
+static avifResult avifEncoderSegmentEncodeFrames(avifEncoderSegment * segment)
+{
+    for (uint32_t itemIndex = 0; itemIndex < segment->itemCount; ++itemIndex) {
+        avifEncoderSegmentItem * item = &segment->items[itemIndex];
+        AVIF_CHECKRES(avifCodecCreate(segment->frames[0].settings.codecChoice, AVIF_CODEC_FLAG_CAN_ENCODE, &item->codec));
+        item->codec->diag = &segment->diag;
+        item->encodeOutput = avifCodecEncodeOutputCreate();
+        AVIF_CHECKERR(item->encodeOutput != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+    }
+    const avifBool alphaPresent = segment->itemCount > 1;
+
+    for (uint32_t frameIndex = 0; frameIndex < segment->frameCount; ++frameIndex) {
+        avifEncoderSegmentFrame * frame = &segment->frames[frameIndex];
+        // Each segment starts with a keyframe so that it can be decoded independently of the previous ones.
+        avifAddImageFlags addImageFlags = frame->addImageFlags;
+        if (frameIndex == 0) {
+            addImageFlags |= AVIF_ADD_IMAGE_FLAG_FORCE_KEYFRAME;
+        }
+        for (uint32_t itemIndex = 0; itemIndex < segment->itemCount; ++itemIndex) {
+            avifEncoderSegmentItem * item = &segment->items[itemIndex];
+            const avifBool isAlpha = avifIsAlpha(item->itemCategory);
+            item->codec->csOptions = frame->csOptions;
+            avifResult encodeResult = item->codec->encodeImage(item->codec,
+                                                               &frame->settings,
+                                                               frame->image,
+                                                               isAlpha,
+                                                               frame->tileRowsLog2,
+                                                               frame->tileColsLog2,
+                                                               isAlpha ? frame->qualityAlpha : frame->quality,
+                                                               frame->encoderChanges,
+                                                               /*disableLaggedOutput=*/alphaPresent,
+                                                               addImageFlags,
+                                                               item->encodeOutput);
+            if (encodeResult == AVIF_RESULT_UNKNOWN_ERROR) {
+                encodeResult = avifGetErrorForItemCategory(item->itemCategory);
+            }
+            AVIF_CHECKRES(encodeResult);
+            // Same as avifEncoderDataShouldForceKeyframeForAlpha() with frame counts local to the segment.
+            if (itemIndex == 0 && alphaPresent && frameIndex > 0 && item->encodeOutput->samples.count == frameIndex + 1 &&
+                item->encodeOutput->samples.sample[frameIndex].sync) {
+                addImageFlags |= AVIF_ADD_IMAGE_FLAG_FORCE_KEYFRAME;
+            }
+        }
+    }
+
+    for (uint32_t itemIndex = 0; itemIndex < segment->itemCount; ++itemIndex) {
+        avifEncoderSegmentItem * item = &segment->items[itemIndex];
+        AVIF_CHECKERR(item->codec->encodeFinish(item->codec, item->encodeOutput),
+                      avifGetErrorForItemCategory(item->itemCategory));
+        AVIF_CHECKERR(item->encodeOutput->samples.count == segment->frameCount, avifGetErrorForItemCategory(item->itemCategory));
+    }
+    return AVIF_RESULT_OK;
+}
+
+static void avifEncoderSegmentThreadWorker(void * userData)
+{
+    avifEncoderSegment * segment = (avifEncoderSegment *)userData;
+    segment->result = avifEncoderSegmentEncodeFrames(segment);
+    // The input images are not needed anymore.
+    avifEncoderSegmentFreeFrames(segment);
+}
+
+// Waits for segments[joinedSegmentCount:segmentCount) to be encoded. Returns the error of the first failed segment, if any,
+// and copies its diagnostics to diag if not NULL.
+static avifResult avifEncoderDataJoinSegments(avifEncoderData * data, uint32_t segmentCount, avifDiagnostics * diag)
+{
+    avifResult result = AVIF_RESULT_OK;
+    for (; data->joinedSegmentCount < segmentCount; ++data->joinedSegmentCount) {
+        avifEncoderSegment * segment = data->segments.segment[data->joinedSegmentCount];
+        if (segment->thread) {
+            if (!avifThreadJoin(segment->thread) && segment->result == AVIF_RESULT_OK) {
+                segment->result = AVIF_RESULT_UNKNOWN_ERROR;
+            }
+            segment->thread = NULL;
+        }
+        if (segment->result != AVIF_RESULT_OK && result == AVIF_RESULT_OK) {
+            result = segment->result;
+            if (diag) {
+                *diag = segment->diag;
+            }
+        }
+    }
+    return result;
+}
+
+// Starts encoding the last segment, once at most maxThreads segments are still being encoded.
+static avifResult avifEncoderStartLastSegment(avifEncoder * encoder)
+{
+    avifEncoderData * data = encoder->data;
+    AVIF_ASSERT_OR_RETURN(data->startedSegmentCount + 1 == data->segments.count);
+    const uint32_t maxSegmentsInFlight = (uint32_t)AVIF_MAX(encoder->maxThreads, 1);
+    if (data->startedSegmentCount - data->joinedSegmentCount >= maxSegmentsInFlight) {
+        AVIF_CHECKRES(avifEncoderDataJoinSegments(data, data->startedSegmentCount + 1 - maxSegmentsInFlight, &encoder->diag));
+    }
+    avifEncoderSegment * segment = data->segments.segment[data->startedSegmentCount];
+    ++data->startedSegmentCount;
+    segment->thread = avifThreadCreate(avifEncoderSegmentThreadWorker, segment);
+    if (segment->thread == NULL) {
+        // Fall back to encoding the segment in the calling thread.
+        avifEncoderSegmentThreadWorker(segment);
+    }
+    return AVIF_RESULT_OK;
+}
+
+// Copies the frame and the current settings to the last segment instead of encoding it with avifEncoderItem::codec.
+// The segment is started when full.
+static avifResult avifEncoderAddSegmentFrame(avifEncoder * encoder,
+                                             const avifImage * image,
+                                             avifEncoderChanges encoderChanges,
+                                             avifAddImageFlags addImageFlags)
+{
+    avifEncoderData * data = encoder->data;
+    if (data->startedSegmentCount == data->segments.count) {
+        avifEncoderSegment * segment = (avifEncoderSegment *)avifAlloc(sizeof(avifEncoderSegment));
+        AVIF_CHECKERR(segment != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+        memset(segment, 0, sizeof(avifEncoderSegment));
+        segment->frames = (avifEncoderSegmentFrame *)avifAlloc(sizeof(avifEncoderSegmentFrame) * data->segmentLength);
+        avifEncoderSegment ** segmentPtr = segment->frames ? (avifEncoderSegment **)avifArrayPush(&data->segments) : NULL;
+        if (segmentPtr == NULL) {
+            avifEncoderSegmentDestroy(segment);
+            return AVIF_RESULT_OUT_OF_MEMORY;
+        }
+        *segmentPtr = segment;
+        segment->items[segment->itemCount++].itemCategory = AVIF_ITEM_COLOR;
+        if (data->alphaPresent) {
+            segment->items[segment->itemCount++].itemCategory = AVIF_ITEM_ALPHA;
+        }
+    }
+    avifEncoderSegment * segment = data->segments.segment[data->segments.count - 1];
+    AVIF_ASSERT_OR_RETURN(segment->frameCount < data->segmentLength);
+
+    avifEncoderSegmentFrame * frame = &segment->frames[segment->frameCount];
+    memset(frame, 0, sizeof(avifEncoderSegmentFrame));
+    ++segment->frameCount; // Freed by avifEncoderSegmentDestroy() from now on, even if partially initialized.
+    frame->image = avifImageCreateEmpty();
+    AVIF_CHECKERR(frame->image != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+    AVIF_CHECKRES(avifImageCopyWithMaxThreads(frame->image, image, AVIF_PLANES_ALL, encoder->maxThreads));
+    frame->csOptions = avifCodecSpecificOptionsCreate();
+    AVIF_CHECKERR(frame->csOptions != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+    // A new codec instance is initialized with all the options set so far. Later frames only carry the changes.
+    const avifCodecSpecificOptions * csOptions = (segment->frameCount == 1) ? data->segmentCsOptions : encoder->csOptions;
+    for (uint32_t i = 0; i < csOptions->count; ++i) {
+        AVIF_CHECKRES(avifCodecSpecificOptionsSet(frame->csOptions, csOptions->entries[i].key, csOptions->entries[i].value));
+    }
+    frame->settings = *encoder;
+    // The codecs only read the settings of the avifEncoder. Make sure no state is shared with the calling thread.
+    frame->settings.data = NULL;
+    frame->settings.csOptions = frame->csOptions;
+    frame->settings.maxThreads = 1;
+    frame->encoderChanges = encoderChanges;
+    frame->addImageFlags = addImageFlags;
+    frame->quality = data->quality;
+    frame->qualityAlpha = data->qualityAlpha;
+    frame->tileRowsLog2 = data->tileRowsLog2;
+    frame->tileColsLog2 = data->tileColsLog2;
+
+    if (segment->frameCount == data->segmentLength) {
+        AVIF_CHECKRES(avifEncoderStartLastSegment(encoder));
+    }
+    return AVIF_RESULT_OK;
+}
+
+// Waits for all segments and appends their samples to the ones encoded by avifEncoderItem::codec.
+static avifResult avifEncoderFinishSegments(avifEncoder * encoder)
+{
+    avifEncoderData * data = encoder->data;
+    if (data->startedSegmentCount < data->segments.count) {
+        AVIF_CHECKRES(avifEncoderStartLastSegment(encoder));
+    }
+    AVIF_CHECKRES(avifEncoderDataJoinSegments(data, data->startedSegmentCount, &encoder->diag));
+    for (uint32_t segmentIndex = 0; segmentIndex < data->segments.count; ++segmentIndex) {
+        avifEncoderSegment * segment = data->segments.segment[segmentIndex];
+        if (segment->result != AVIF_RESULT_OK) {
+            encoder->diag = segment->diag;
+            return segment->result;
+        }
+        for (uint32_t itemIndex = 0; itemIndex < segment->itemCount; ++itemIndex) {
+            avifEncoderSegmentItem * segmentItem = &segment->items[itemIndex];
+            avifEncoderItem * item = NULL;
+            for (uint32_t i = 0; i < data->items.count; ++i) {
+                if (data->items.item[i].codec && data->items.item[i].itemCategory == segmentItem->itemCategory) {
+                    item = &data->items.item[i];
+                    break;
+                }
+            }
+            AVIF_ASSERT_OR_RETURN(item != NULL);
+            // Move the samples.
+            avifEncodeSampleArray * samples = &segmentItem->encodeOutput->samples;
+            for (uint32_t sampleIndex = 0; sampleIndex < samples->count; ++sampleIndex) {
+                avifEncodeSample * sample = (avifEncodeSample *)avifArrayPush(&item->encodeOutput->samples);
+                AVIF_CHECKERR(sample != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+                *sample = samples->sample[sampleIndex];
+                memset(&samples->sample[sampleIndex], 0, sizeof(avifEncodeSample));
+            }
+            samples->count = 0;
+        }
+    }
+    return AVIF_RESULT_OK;
+}
+
+// Sets *cellImage to the cell of cellImages corresponding to the item, or its gain map. If the cell has to be padded,
+// *cellImagePlaceholder is set to the padded copy to be destroyed by the caller, and is left as NULL otherwise.
+static avifResult avifEncoderGetCellImage(const avifEncoderItem * item,
+                                          const avifImage * const * cellImages,
+                                          const avifImage * firstCell,
+                                          const avifImage ** cellImage,
+                                          avifImage ** cellImagePlaceholder,
+                                          int maxThreads)
+{
+    *cellImage = cellImages[item->cellIndex];
+    *cellImagePlaceholder = NULL;
+    const avifImage * firstCellImage = firstCell;
+
+    if (item->itemCategory == AVIF_ITEM_GAIN_MAP) {
+        AVIF_ASSERT_OR_RETURN((*cellImage)->gainMap && (*cellImage)->gainMap->image);
+        *cellImage = (*cellImage)->gainMap->image;
+        AVIF_ASSERT_OR_RETURN(firstCell->gainMap && firstCell->gainMap->image);
+        firstCellImage = firstCell->gainMap->image;
+    }
+
+    if (((*cellImage)->width != firstCellImage->width) || ((*cellImage)->height != firstCellImage->height)) {
+        // Pad the right-most and/or bottom-most tiles so that all tiles share the same dimensions.
+        avifImage * paddedCellImage = avifImageCreateEmpty();
+        AVIF_CHECKERR(paddedCellImage, AVIF_RESULT_OUT_OF_MEMORY);
+        const avifResult result =
+            avifImageCopyAndPad(paddedCellImage, *cellImage, firstCellImage->width, firstCellImage->height, maxThreads);
+        if (result != AVIF_RESULT_OK) {
+            avifImageDestroy(paddedCellImage);
+            return result;
+        }
+        *cellImage = paddedCellImage;
+        *cellImagePlaceholder = paddedCellImage;
+    }
+    return AVIF_RESULT_OK;
+}
+
+static int avifEncoderDataGetItemQuality(const avifEncoderData * data, avifItemCategory itemCategory)
+{
+    return avifIsAlpha(itemCategory)              ? data->qualityAlpha
+           : (itemCategory == AVIF_ITEM_GAIN_MAP) ? data->qualityGainMap
+                                                  : data->quality;
+}
+
+// Encodes the cell of cellImages corresponding to the item, or its gain map. If not NULL, sampleTransformedImage is used
+// instead of the input to the Sample Transform derived image item that would be computed from the cell otherwise.
+static avifResult avifEncoderEncodeItem(avifEncoder * encoder,
+                                        avifEncoderItem * item,
+                                        const avifImage * const * cellImages,
+                                        const avifImage * firstCell,
+                                        const avifImage * sampleTransformedImage,
+                                        avifEncoderChanges * encoderChanges,
+                                        avifAddImageFlags addImageFlags)
+{
+    const avifImage * cellImage = sampleTransformedImage;
+    avifImage * cellImagePlaceholder = NULL; // May be used as a temporary, modified cellImage. Left as NULL otherwise.
+    if (cellImage == NULL) {
+        AVIF_CHECKRES(
+            avifEncoderGetCellImage(item, cellImages, firstCell, &cellImage, &cellImagePlaceholder, encoder->maxThreads));
+    }
+
+    const avifBool isAlpha = avifIsAlpha(item->itemCategory);
+    int quality = avifEncoderDataGetItemQuality(encoder->data, item->itemCategory);
+
+    // Remember original quantizer values in case they change, to reset them afterwards.
+    int * encoderMinQuantizer = isAlpha ? &encoder->minQuantizerAlpha : &encoder->minQuantizer;
+    int * encoderMaxQuantizer = isAlpha ? &encoder->maxQuantizerAlpha : &encoder->maxQuantizer;
+    const int originalMinQuantizer = *encoderMinQuantizer;
+    const int originalMaxQuantizer = *encoderMaxQuantizer;
+
+    if (encoder->sampleTransformRecipe != AVIF_SAMPLE_TRANSFORM_NONE) {
+        if ((encoder->sampleTransformRecipe == AVIF_SAMPLE_TRANSFORM_BIT_DEPTH_EXTENSION_8B_8B ||
+             encoder->sampleTransformRecipe == AVIF_SAMPLE_TRANSFORM_BIT_DEPTH_EXTENSION_12B_4B) &&
+            (item->itemCategory == AVIF_ITEM_COLOR || item->itemCategory == AVIF_ITEM_ALPHA)) {
+            // Encoding the least significant bits of a sample does not make any sense if the
+            // other bits are lossily compressed. Encode the most significant bits losslessly.
+            quality = AVIF_QUALITY_LOSSLESS;
+            *encoderMinQuantizer = AVIF_QUANTIZER_LOSSLESS;
+            *encoderMaxQuantizer = AVIF_QUANTIZER_LOSSLESS;
+            if (!avifEncoderDetectChanges(encoder, encoderChanges)) {
+                assert(AVIF_FALSE);
+            }
+        }
+
+        if (sampleTransformedImage == NULL) {
+            // Replace cellImage by the first or second input to the AVIF_ITEM_SAMPLE_TRANSFORM derived image item.
+            const avifBool itemWillBeEncodedLosslessly = (quality == AVIF_QUALITY_LOSSLESS);
+            avifImage * createdImage = NULL;
+            const avifResult result =
+                avifEncoderCreateBitDepthExtensionImage(encoder, item, itemWillBeEncodedLosslessly, cellImage, &createdImage);
+            if (cellImagePlaceholder) {
+                avifImageDestroy(cellImagePlaceholder); // Replaced by createdImage.
+            }
+            AVIF_CHECKRES(result);
+            cellImagePlaceholder = createdImage; // Transfer ownership.
+            cellImage = cellImagePlaceholder;
+        }
+    }
+
+    // If alpha channel is present, set disableLaggedOutput to AVIF_TRUE. If the encoder supports it, this enables
+    // avifEncoderDataShouldForceKeyframeForAlpha to force a keyframe in the alpha channel whenever a keyframe has been
+    // encoded in the color channel for animated images.
+    avifResult encodeResult = item->codec->encodeImage(item->codec,
+                                                       encoder,
+                                                       cellImage,
+                                                       isAlpha,
+                                                       encoder->data->tileRowsLog2,
+                                                       encoder->data->tileColsLog2,
+                                                       quality,
+                                                       *encoderChanges,
+                                                       /*disableLaggedOutput=*/encoder->data->alphaPresent,
+                                                       addImageFlags,
+                                                       item->encodeOutput);
+    // Revert quality settings if they changed.
+    if (*encoderMinQuantizer != originalMinQuantizer || *encoderMaxQuantizer != originalMaxQuantizer) {
+        avifEncoderBackupSettings(encoder); // Remember last encoding settings for next avifEncoderDetectChanges().
+        *encoderMinQuantizer = originalMinQuantizer;
+        *encoderMaxQuantizer = originalMaxQuantizer;
+    }
+    if (cellImagePlaceholder) {
+        avifImageDestroy(cellImagePlaceholder);
+    }
+    if (encodeResult == AVIF_RESULT_UNKNOWN_ERROR) {
+        encodeResult = avifGetErrorForItemCategory(item->itemCategory);
+    }
+    return encodeResult;
+}
+
+// Still image items do not depend on each other, so the grid cells can be encoded concurrently.
+static avifBool avifEncoderCanEncodeItemsInParallel(const avifEncoder * encoder,
+                                                    uint32_t cellCount,
+                                                    avifAddImageFlags addImageFlags)
+{
+    return (encoder->maxThreads > 1) && (cellCount > 1) && (addImageFlags & AVIF_ADD_IMAGE_FLAG_SINGLE) &&
+           (encoder->sampleTransformRecipe == AVIF_SAMPLE_TRANSFORM_NONE);
+}
+
+// A share of the image items to encode in one thread.
+typedef struct avifEncoderItemsJob
+{
+    avifEncoder settings; // Shallow copy of the avifEncoder with a share of maxThreads
+    const avifImage * const * cellImages;
+    const avifImage * firstCell;
+    avifEncoderChanges encoderChanges;
+    avifAddImageFlags addImageFlags;
+    uint32_t jobIndex; // Encodes the jobIndex-th image item with a codec, then every jobCount-th one.
+    uint32_t jobCount;
+    avifDiagnostics diag;
+    avifThread * thread; // NULL if the job ran in the calling thread
+    avifResult result;
+} avifEncoderItemsJob;
+
+static void avifEncoderItemsJobWorker(void * userData)
+{
+    avifEncoderItemsJob * job = (avifEncoderItemsJob *)userData;
+    avifEncoderData * data = job->settings.data;
+    uint32_t codecItemIndex = 0;
+    job->result = AVIF_RESULT_OK;
+    for (uint32_t itemIndex = 0; itemIndex < data->items.count && job->result == AVIF_RESULT_OK; ++itemIndex) {
+        avifEncoderItem * item = &data->items.item[itemIndex];
+        if (!item->codec || (codecItemIndex++ % job->jobCount) != job->jobIndex) {
+            continue;
+        }
+        avifDiagnostics * diag = item->codec->diag;
+        item->codec->diag = &job->diag;
+        job->result = avifEncoderEncodeItem(&job->settings,
+                                            item,
+                                            job->cellImages,
+                                            job->firstCell,
+                                            /*sampleTransformedImage=*/NULL,
+                                            &job->encoderChanges,
+                                            job->addImageFlags);
+        item->codec->diag = diag;
+    }
+}
+
+static avifResult avifEncoderEncodeItemsInParallel(avifEncoder * encoder,
+                                                   const avifImage * const * cellImages,
+                                                   const avifImage * firstCell,
+                                                   avifEncoderChanges encoderChanges,
+                                                   avifAddImageFlags addImageFlags)
+{
+    uint32_t codecItemCount = 0;
+    for (uint32_t itemIndex = 0; itemIndex < encoder->data->items.count; ++itemIndex) {
+        if (encoder->data->items.item[itemIndex].codec) {
+            ++codecItemCount;
+        }
+    }
+    const uint32_t jobCount = AVIF_MIN((uint32_t)encoder->maxThreads, codecItemCount);
+    if (jobCount == 0) {
+        return AVIF_RESULT_OK;
+    }
+    avifEncoderItemsJob * jobs = (avifEncoderItemsJob *)avifAlloc(sizeof(avifEncoderItemsJob) * jobCount);
+    AVIF_CHECKERR(jobs != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+    memset(jobs, 0, sizeof(avifEncoderItemsJob) * jobCount);
+    for (uint32_t jobIndex = 0; jobIndex < jobCount; ++jobIndex) {
+        avifEncoderItemsJob * job = &jobs[jobIndex];
+        job->settings = *encoder;
+        // Each codec instance gets its share of the threads.
+        job->settings.maxThreads = AVIF_MAX(encoder->maxThreads / (int)jobCount, 1);
+        job->cellImages = cellImages;
+        job->firstCell = firstCell;
+        job->encoderChanges = encoderChanges;
+        job->addImageFlags = addImageFlags;
+        job->jobIndex = jobIndex;
+        job->jobCount = jobCount;
+    }
+
+    // The calling thread runs the first job.
+    for (uint32_t jobIndex = 1; jobIndex < jobCount; ++jobIndex) {
+        jobs[jobIndex].thread = avifThreadCreate(avifEncoderItemsJobWorker, &jobs[jobIndex]);
+        if (jobs[jobIndex].thread == NULL) {
+            avifEncoderItemsJobWorker(&jobs[jobIndex]);
+        }
+    }
+    avifEncoderItemsJobWorker(&jobs[0]);
+
+    avifResult result = AVIF_RESULT_OK;
+    for (uint32_t jobIndex = 0; jobIndex < jobCount; ++jobIndex) {
+        avifEncoderItemsJob * job = &jobs[jobIndex];
+        if (job->thread && !avifThreadJoin(job->thread) && job->result == AVIF_RESULT_OK) {
+            job->result = AVIF_RESULT_UNKNOWN_ERROR;
+        }
+        if (job->result != AVIF_RESULT_OK && result == AVIF_RESULT_OK) {
+            result = job->result;
+            encoder->diag = job->diag;
+        }
+    }
+    avifFree(jobs);
+    return result;
+}
+
+// The inputs to the Sample Transform derived image item of a still image can be computed while other image items are encoded.
+static avifBool avifEncoderCanPipelineSampleTransform(const avifEncoder * encoder, avifAddImageFlags addImageFlags)
+{
+    return (encoder->maxThreads > 1) && (addImageFlags & AVIF_ADD_IMAGE_FLAG_SINGLE) &&
+           (encoder->sampleTransformRecipe != AVIF_SAMPLE_TRANSFORM_NONE);
+}
+
+// The computation of the input image of an AVIF_ITEM_SAMPLE_TRANSFORM_INPUT_0_* item in another thread.
+typedef struct avifEncoderSatoJob
+{
+    avifEncoder settings; // Shallow copy of the avifEncoder with its own diag
+    const avifEncoderItem * item;
+    const avifImage * const * cellImages;
+    const avifImage * firstCell;
+    avifImage * sampleTransformedImage; // Output
+    avifThread * thread;                // NULL if the job ran in the calling thread or was joined
+    avifResult result;
+} avifEncoderSatoJob;
+
+static void avifEncoderSatoJobWorker(void * userData)
+{
+    avifEncoderSatoJob * job = (avifEncoderSatoJob *)userData;
+    const avifImage * cellImage;
+    avifImage * cellImagePlaceholder;
+    job->result = avifEncoderGetCellImage(job->item,
+                                          job->cellImages,
+                                          job->firstCell,
+                                          &cellImage,
+                                          &cellImagePlaceholder,
+                                          job->settings.maxThreads);
+    if (job->result != AVIF_RESULT_OK) {
+        return;
+    }
+    const avifBool itemWillBeEncodedLosslessly =
+        avifEncoderDataGetItemQuality(job->settings.data, job->item->itemCategory) == AVIF_QUALITY_LOSSLESS;
+    job->result = avifEncoderCreateBitDepthExtensionImage(&job->settings,
+                                                          job->item,
+                                                          itemWillBeEncodedLosslessly,
+                                                          cellImage,
+                                                          &job->sampleTransformedImage);
+    if (cellImagePlaceholder) {
+        avifImageDestroy(cellImagePlaceholder);
+    }
+}
+
+static void avifEncoderSatoJobJoin(avifEncoderSatoJob * job)
+{
+    if (job->thread && !avifThreadJoin(job->thread) && job->result == AVIF_RESULT_OK) {
+        job->result = AVIF_RESULT_UNKNOWN_ERROR;
+    }
+    job->thread = NULL;
+}
+
+// Same as encoding the image items one after the other, except that the input image of each
+// AVIF_ITEM_SAMPLE_TRANSFORM_INPUT_0_* item is computed in another thread as soon as the base image item of the same cell
+// is encoded, while the next base image item is encoded. At most one job runs at a time because they share
+// avifEncoderData::satoDecoder.
+static avifResult avifEncoderEncodeItemsWithSampleTransformPipeline(avifEncoder * encoder,
+                                                                    const avifImage * const * cellImages,
+                                                                    const avifImage * firstCell,
+                                                                    avifEncoderChanges encoderChanges,
+                                                                    avifAddImageFlags addImageFlags)
+{
+    avifEncoderData * data = encoder->data;
+    // Indexed by item index. Only the jobs of the AVIF_ITEM_SAMPLE_TRANSFORM_INPUT_0_* items are used.
+    avifEncoderSatoJob * jobs = (avifEncoderSatoJob *)avifAlloc(sizeof(avifEncoderSatoJob) * data->items.count);
+    AVIF_CHECKERR(jobs != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+    memset(jobs, 0, sizeof(avifEncoderSatoJob) * data->items.count);
+    avifEncoderSatoJob * runningJob = NULL;
+    // The AVIF_ITEM_SAMPLE_TRANSFORM_INPUT_0_* items are in the same cell order as the base image items.
+    uint32_t inputItemSearchStart[2] = { 0, 0 }; // Color, alpha
+
+    avifResult result = AVIF_RESULT_OK;
+    for (uint32_t itemIndex = 0; itemIndex < data->items.count && result == AVIF_RESULT_OK; ++itemIndex) {
+        avifEncoderItem * item = &data->items.item[itemIndex];
+        if (!item->codec) {
+            continue;
+        }
+        const avifBool isBase = item->itemCategory == AVIF_ITEM_COLOR || item->itemCategory == AVIF_ITEM_ALPHA;
+        if (!isBase && runningJob != NULL) {
+            // The running job may be the one of this item.
+            avifEncoderSatoJobJoin(runningJob);
+            runningJob = NULL;
+        }
+
+        avifEncoderSatoJob * job = &jobs[itemIndex];
+        if (job->item != NULL) {
+            result = job->result;
+            if (result != AVIF_RESULT_OK) {
+                encoder->diag = job->settings.diag;
+                continue;
+            }
+            result = avifEncoderEncodeItem(encoder,
+                                           item,
+                                           cellImages,
+                                           firstCell,
+                                           job->sampleTransformedImage,
+                                           &encoderChanges,
+                                           addImageFlags);
+            avifImageDestroy(job->sampleTransformedImage); // Not needed anymore.
+            job->sampleTransformedImage = NULL;
+            continue;
+        }
+        result = avifEncoderEncodeItem(encoder,
+                                       item,
+                                       cellImages,
+                                       firstCell,
+                                       /*sampleTransformedImage=*/NULL,
+                                       &encoderChanges,
+                                       addImageFlags);
+        if (result != AVIF_RESULT_OK || !isBase) {
+            continue;
+        }
+
+        const int inputCategoryIndex = avifIsAlpha(item->itemCategory) ? 1 : 0;
+        const avifItemCategory inputCategory = inputCategoryIndex ? AVIF_ITEM_SAMPLE_TRANSFORM_INPUT_0_ALPHA
+                                                                  : AVIF_ITEM_SAMPLE_TRANSFORM_INPUT_0_COLOR;
+        for (uint32_t inputItemIndex = inputItemSearchStart[inputCategoryIndex]; inputItemIndex < data->items.count;
+             ++inputItemIndex) {
+            const avifEncoderItem * inputItem = &data->items.item[inputItemIndex];
+            if (!inputItem->codec || inputItem->itemCategory != inputCategory || inputItem->cellIndex != item->cellIndex) {
+                continue;
+            }
+            inputItemSearchStart[inputCategoryIndex] = inputItemIndex + 1;
+            if (runningJob != NULL) {
+                avifEncoderSatoJobJoin(runningJob);
+                runningJob = NULL;
+            }
+            avifEncoderSatoJob * inputJob = &jobs[inputItemIndex];
+            inputJob->settings = *encoder;
+            avifDiagnosticsClearError(&inputJob->settings.diag);
+            inputJob->item = inputItem;
+            inputJob->cellImages = cellImages;
+            inputJob->firstCell = firstCell;
+            inputJob->thread = avifThreadCreate(avifEncoderSatoJobWorker, inputJob);
+            if (inputJob->thread == NULL) {
+                avifEncoderSatoJobWorker(inputJob);
+            } else {
+                runningJob = inputJob;
+            }
+            break;
+        }
+    }
+
+    if (runningJob != NULL) {
+        avifEncoderSatoJobJoin(runningJob);
+    }
+    for (uint32_t itemIndex = 0; itemIndex < data->items.count; ++itemIndex) {
+        if (jobs[itemIndex].sampleTransformedImage) {
+            avifImageDestroy(jobs[itemIndex].sampleTransformedImage);
+        }
+    }
+    avifFree(jobs);
+    return result;
+}
+
+// avifEncoderFinish() writes the 'ftyp' box at the beginning of avifEncoder::io, once the brands are known. Reserve
+// enough bytes for the largest one (major_brand, minor_version and up to 9 compatible_brands), followed by the
+// smallest 'free' box to fill the remaining bytes, if any.
+#define AVIF_IO_FILE_TYPE_BOX_MAX_SIZE (8 + 4 + 4 + 9 * 4)
+#define AVIF_IO_MDAT_OFFSET (AVIF_IO_FILE_TYPE_BOX_MAX_SIZE + 8)
+
+// Appends size bytes to avifEncoder::io.
+static avifResult avifEncoderIOWrite(avifEncoder * encoder, const uint8_t * data, size_t size)
+{
+    AVIF_CHECKRES(encoder->io->write(encoder->io, /*writeFlags=*/0, encoder->data->ioOffset, data, size));
+    encoder->data->ioOffset += size;
+    return AVIF_RESULT_OK;
+}
+
+// Writes the samples encoded since the last call to the 'mdat' box of avifEncoder::io, and frees their payloads.
+// The payload of the first sample of each item is kept because avifEncoderFinish() parses its sequence header.
+static avifResult avifEncoderWriteSamplesToIO(avifEncoder * encoder)
+{
+    avifEncoderData * data = encoder->data;
+    // The layers would have to be interleaved, see avifEncoderWriteMediaDataBox().
+    AVIF_CHECKERR(encoder->extraLayerCount == 0, AVIF_RESULT_NOT_IMPLEMENTED);
+
+    if (data->ioMdatOffset == 0) {
+        // The size of the 'mdat' box is only known in avifEncoderFinish(). Use a 64-bit largesize field to rewrite it then.
+        static const uint8_t mdatHeader[16] = { 0, 0, 0, 1, 'm', 'd', 'a', 't' }; // largesize is 0 for now
+        data->ioMdatOffset = AVIF_IO_MDAT_OFFSET;
+        data->ioOffset = data->ioMdatOffset;
+        AVIF_CHECKRES(avifEncoderIOWrite(encoder, mdatHeader, sizeof(mdatHeader)));
+        encoder->ioStats.colorOBUSize = 0;
+        encoder->ioStats.alphaOBUSize = 0;
+        data->gainMapSizeBytes = 0;
+
+        // All metadata payloads are set by the first avifEncoderAddImage() call. As in avifEncoderWriteMediaDataBox(),
+        // they are packed before the samples.
+        for (uint32_t itemIndex = 0; itemIndex < data->items.count; ++itemIndex) {
+            avifEncoderItem * item = &data->items.item[itemIndex];
+            if (item->codec == NULL && item->metadataPayload.size > 0) {
+                item->ioDataOffset = data->ioOffset;
+                AVIF_CHECKRES(avifEncoderIOWrite(encoder, item->metadataPayload.data, item->metadataPayload.size));
+            }
+        }
+    }
+
+    for (uint32_t itemIndex = 0; itemIndex < data->items.count; ++itemIndex) {
+        avifEncoderItem * item = &data->items.item[itemIndex];
+        avifEncodeSampleArray * samples = &item->encodeOutput->samples;
+        if (item->ioSampleCount == samples->count) {
+            continue;
+        }
+        avifEncoderChunk * chunk = (avifEncoderChunk *)avifArrayPush(&item->ioChunks);
+        AVIF_CHECKERR(chunk != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+        chunk->offset = data->ioOffset;
+        chunk->sampleCount = samples->count - item->ioSampleCount;
+        if (item->ioSampleCount == 0) {
+            item->ioDataOffset = data->ioOffset;
+        }
+        for (; item->ioSampleCount < samples->count; ++item->ioSampleCount) {
+            avifEncodeSample * sample = &samples->sample[item->ioSampleCount];
+            AVIF_CHECKRES(avifEncoderIOWrite(encoder, sample->data.data, sample->data.size));
+            if (avifIsAlpha(item->itemCategory)) {
+                encoder->ioStats.alphaOBUSize += sample->data.size;
+            } else if (item->itemCategory == AVIF_ITEM_COLOR) {
+                encoder->ioStats.colorOBUSize += sample->data.size;
+            } else if (item->itemCategory == AVIF_ITEM_GAIN_MAP) {
+                data->gainMapSizeBytes += sample->data.size;
+            }
+            if (item->ioSampleCount > 0) {
+                // Keep data.size for the sample tables written by avifEncoderFinish().
+                avifFree(sample->data.data);
+                sample->data.data = NULL;
+            }
+        }
+    }
+    return AVIF_RESULT_OK;
+}
+
 static avifResult avifEncoderAddImageInternal(avifEncoder * encoder,
                                               uint32_t gridCols,
                                               uint32_t gridRows,
@@ -1972,6 +2871,14 @@ static avifResult avifEncoderAddImageInternal(avifEncoder * encoder,
             AVIF_CHECKERR(encoder->sampleTransformRecipe == AVIF_SAMPLE_TRANSFORM_NONE, AVIF_RESULT_NOT_IMPLEMENTED);
         }
 
+        if (encoder->parallelSegments && encoder->keyframeInterval > 0 && !(addImageFlags & AVIF_ADD_IMAGE_FLAG_SINGLE) &&
+            cellCount == 1 && encoder->extraLayerCount == 0 && !hasGainMap &&
+            encoder->sampleTransformRecipe == AVIF_SAMPLE_TRANSFORM_NONE) {
+            encoder->data->segmentLength = (uint32_t)encoder->keyframeInterval;
+            encoder->data->segmentCsOptions = avifCodecSpecificOptionsCreate();
+            AVIF_CHECKERR(encoder->data->segmentCsOptions != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+        }
+
         // -----------------------------------------------------------------------
         // Create metadata items (Exif, XMP)
 
@@ -2029,104 +2936,44 @@ static avifResult avifEncoderAddImageInternal(avifEncoder * encoder,
         AVIF_CHECKERR(imageMetadata->width <= 65535 && imageMetadata->height <= 65535, AVIF_RESULT_INVALID_ARGUMENT);
     }
 
+    if (encoder->data->segmentLength != 0) {
+        for (uint32_t i = 0; i < encoder->csOptions->count; ++i) {
+            const avifCodecSpecificOption * entry = &encoder->csOptions->entries[i];
+            AVIF_CHECKRES(avifCodecSpecificOptionsSet(encoder->data->segmentCsOptions, entry->key, entry->value));
+        }
+        if (encoder->data->frames.count >= encoder->data->segmentLength) {
+            // The frames after the first segment are encoded in parallel by other codec instances.
+            AVIF_CHECKRES(avifEncoderAddSegmentFrame(encoder, firstCell, encoderChanges, addImageFlags));
+            avifEncoderFrame * frame = (avifEncoderFrame *)avifArrayPush(&encoder->data->frames);
+            AVIF_CHECKERR(frame != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+            frame->durationInTimescales = durationInTimescales;
+            avifCodecSpecificOptionsClear(encoder->csOptions);
+            return AVIF_RESULT_OK;
+        }
+    }
+
     // -----------------------------------------------------------------------
     // Encode AV1 OBUs
 
-    for (uint32_t itemIndex = 0; itemIndex < encoder->data->items.count; ++itemIndex) {
-        avifEncoderItem * item = &encoder->data->items.item[itemIndex];
-        if (item->codec) {
-            const avifImage * cellImage = cellImages[item->cellIndex];
-            avifImage * cellImagePlaceholder = NULL; // May be used as a temporary, modified cellImage. Left as NULL otherwise.
-            const avifImage * firstCellImage = firstCell;
-
-            if (item->itemCategory == AVIF_ITEM_GAIN_MAP) {
-                AVIF_ASSERT_OR_RETURN(cellImage->gainMap && cellImage->gainMap->image);
-                cellImage = cellImage->gainMap->image;
-                AVIF_ASSERT_OR_RETURN(firstCell->gainMap && firstCell->gainMap->image);
-                firstCellImage = firstCell->gainMap->image;
-            }
-
-            if ((cellImage->width != firstCellImage->width) || (cellImage->height != firstCellImage->height)) {
-                // Pad the right-most and/or bottom-most tiles so that all tiles share the same dimensions.
-                cellImagePlaceholder = avifImageCreateEmpty();
-                AVIF_CHECKERR(cellImagePlaceholder, AVIF_RESULT_OUT_OF_MEMORY);
-                const avifResult result =
-                    avifImageCopyAndPad(cellImagePlaceholder, cellImage, firstCellImage->width, firstCellImage->height);
-                if (result != AVIF_RESULT_OK) {
-                    avifImageDestroy(cellImagePlaceholder);
-                    return result;
-                }
-                cellImage = cellImagePlaceholder;
-            }
-
-            const avifBool isAlpha = avifIsAlpha(item->itemCategory);
-            int quality = isAlpha                                      ? encoder->data->qualityAlpha
-                          : (item->itemCategory == AVIF_ITEM_GAIN_MAP) ? encoder->data->qualityGainMap
-                                                                       : encoder->data->quality;
-
-            // Remember original quantizer values in case they change, to reset them afterwards.
-            int * encoderMinQuantizer = isAlpha ? &encoder->minQuantizerAlpha : &encoder->minQuantizer;
-            int * encoderMaxQuantizer = isAlpha ? &encoder->maxQuantizerAlpha : &encoder->maxQuantizer;
-            const int originalMinQuantizer = *encoderMinQuantizer;
-            const int originalMaxQuantizer = *encoderMaxQuantizer;
-
-            if (encoder->sampleTransformRecipe != AVIF_SAMPLE_TRANSFORM_NONE) {
-                if ((encoder->sampleTransformRecipe == AVIF_SAMPLE_TRANSFORM_BIT_DEPTH_EXTENSION_8B_8B ||
-                     encoder->sampleTransformRecipe == AVIF_SAMPLE_TRANSFORM_BIT_DEPTH_EXTENSION_12B_4B) &&
-                    (item->itemCategory == AVIF_ITEM_COLOR || item->itemCategory == AVIF_ITEM_ALPHA)) {
-                    // Encoding the least significant bits of a sample does not make any sense if the
-                    // other bits are lossily compressed. Encode the most significant bits losslessly.
-                    quality = AVIF_QUALITY_LOSSLESS;
-                    *encoderMinQuantizer = AVIF_QUANTIZER_LOSSLESS;
-                    *encoderMaxQuantizer = AVIF_QUANTIZER_LOSSLESS;
-                    if (!avifEncoderDetectChanges(encoder, &encoderChanges)) {
-                        assert(AVIF_FALSE);
-                    }
-                }
-
-                // Replace cellImage by the first or second input to the AVIF_ITEM_SAMPLE_TRANSFORM derived image item.
-                const avifBool itemWillBeEncodedLosslessly = (quality == AVIF_QUALITY_LOSSLESS);
-                avifImage * sampleTransformedImage = NULL;
-                if (cellImagePlaceholder) {
-                    avifImageDestroy(cellImagePlaceholder); // Replaced by sampleTransformedImage.
-                    cellImagePlaceholder = NULL;
+    if (avifEncoderCanEncodeItemsInParallel(encoder, cellCount, addImageFlags)) {
+        AVIF_CHECKRES(avifEncoderEncodeItemsInParallel(encoder, cellImages, firstCell, encoderChanges, addImageFlags));
+    } else if (avifEncoderCanPipelineSampleTransform(encoder, addImageFlags)) {
+        AVIF_CHECKRES(
+            avifEncoderEncodeItemsWithSampleTransformPipeline(encoder, cellImages, firstCell, encoderChanges, addImageFlags));
+    } else {
+        for (uint32_t itemIndex = 0; itemIndex < encoder->data->items.count; ++itemIndex) {
+            avifEncoderItem * item = &encoder->data->items.item[itemIndex];
+            if (item->codec) {
+                AVIF_CHECKRES(avifEncoderEncodeItem(encoder,
+                                                    item,
+                                                    cellImages,
+                                                    firstCell,
+                                                    /*sampleTransformedImage=*/NULL,
+                                                    &encoderChanges,
+                                                    addImageFlags));
+                if (itemIndex == 0 && avifEncoderDataShouldForceKeyframeForAlpha(encoder->data, item, addImageFlags)) {
+                    addImageFlags |= AVIF_ADD_IMAGE_FLAG_FORCE_KEYFRAME;
                 }
-                AVIF_CHECKRES(
-                    avifEncoderCreateBitDepthExtensionImage(encoder, item, itemWillBeEncodedLosslessly, cellImage, &sampleTransformedImage));
-                assert(cellImagePlaceholder == NULL);
-                cellImagePlaceholder = sampleTransformedImage; // Transfer ownership.
-                cellImage = cellImagePlaceholder;
-            }
-
-            // If alpha channel is present, set disableLaggedOutput to AVIF_TRUE. If the encoder supports it, this enables
-            // avifEncoderDataShouldForceKeyframeForAlpha to force a keyframe in the alpha channel whenever a keyframe has been
-            // encoded in the color channel for animated images.
-            avifResult encodeResult = item->codec->encodeImage(item->codec,
-                                                               encoder,
-                                                               cellImage,
-                                                               isAlpha,
-                                                               encoder->data->tileRowsLog2,
-                                                               encoder->data->tileColsLog2,
-                                                               quality,
-                                                               encoderChanges,
-                                                               /*disableLaggedOutput=*/encoder->data->alphaPresent,
-                                                               addImageFlags,
-                                                               item->encodeOutput);
-            // Revert quality settings if they changed.
-            if (*encoderMinQuantizer != originalMinQuantizer || *encoderMaxQuantizer != originalMaxQuantizer) {
-                avifEncoderBackupSettings(encoder); // Remember last encoding settings for next avifEncoderDetectChanges().
-                *encoderMinQuantizer = originalMinQuantizer;
-                *encoderMaxQuantizer = originalMaxQuantizer;
-            }
-            if (cellImagePlaceholder) {
-                avifImageDestroy(cellImagePlaceholder);
-            }
-            if (encodeResult == AVIF_RESULT_UNKNOWN_ERROR) {
-                encodeResult = avifGetErrorForItemCategory(item->itemCategory);
-            }
-            AVIF_CHECKRES(encodeResult);
-            if (itemIndex == 0 && avifEncoderDataShouldForceKeyframeForAlpha(encoder->data, item, addImageFlags)) {
-                addImageFlags |= AVIF_ADD_IMAGE_FLAG_FORCE_KEYFRAME;
             }
         }
     }
@@ -2135,12 +2982,131 @@ static avifResult avifEncoderAddImageInternal(avifEncoder * encoder,
     AVIF_CHECKERR(frame != NULL, AVIF_RESULT_OUT_OF_MEMORY);
     frame->durationInTimescales = durationInTimescales;
     avifCodecSpecificOptionsClear(encoder->csOptions);
+    if (encoder->io) {
+        AVIF_CHECKRES(avifEncoderWriteSamplesToIO(encoder));
+    }
     return AVIF_RESULT_OK;
 }
 
+// Cells of automatic grids are at most that many pixels wide and tall, and are only made smaller than
+// that to give each thread a cell if they stay at least AVIF_AUTO_GRID_MIN_CELL_SIZE pixels wide and tall.
+#define AVIF_AUTO_GRID_MAX_CELL_SIZE 4096
+#define AVIF_AUTO_GRID_MIN_CELL_SIZE 1024
+
+static uint32_t avifAutoGridCellSize(uint32_t imageSize, uint32_t cellCount, avifBool isSubsampled)
+{
+    uint32_t cellSize = (imageSize + cellCount - 1) / cellCount;
+    if (isSubsampled && (cellSize & 1)) {
+        ++cellSize;
+    }
+    return cellSize;
+}
+
+// Chooses the grid used by avifEncoder::autoGrid. Returns AVIF_FALSE if the image should be encoded as a single cell.
+static avifBool avifEncoderChooseAutoGrid(const avifEncoder * encoder,
+                                          const avifImage * image,
+                                          uint32_t * gridCols,
+                                          uint32_t * gridRows,
+                                          uint32_t * cellWidth,
+                                          uint32_t * cellHeight)
+{
+    avifPixelFormatInfo formatInfo;
+    avifGetPixelFormatInfo(image->yuvFormat, &formatInfo);
+    const avifBool isSubsampledX = !formatInfo.monochrome && formatInfo.chromaShiftX;
+    const avifBool isSubsampledY = !formatInfo.monochrome && formatInfo.chromaShiftY;
+
+    uint32_t cols = (image->width + AVIF_AUTO_GRID_MAX_CELL_SIZE - 1) / AVIF_AUTO_GRID_MAX_CELL_SIZE;
+    uint32_t rows = (image->height + AVIF_AUTO_GRID_MAX_CELL_SIZE - 1) / AVIF_AUTO_GRID_MAX_CELL_SIZE;
+    const uint32_t threads = (uint32_t)AVIF_MAX(encoder->maxThreads, 1);
+    while ((uint64_t)cols * rows < threads) {
+        // Split along the longest cell side first.
+        const avifBool canSplitX = (image->width / (cols + 1)) >= AVIF_AUTO_GRID_MIN_CELL_SIZE;
+        const avifBool canSplitY = (image->height / (rows + 1)) >= AVIF_AUTO_GRID_MIN_CELL_SIZE;
+        if (canSplitX && (!canSplitY || (image->width / cols >= image->height / rows))) {
+            ++cols;
+        } else if (canSplitY) {
+            ++rows;
+        } else {
+            break;
+        }
+    }
+    cols = AVIF_MIN(cols, 256);
+    rows = AVIF_MIN(rows, 256);
+
+    // Recompute the cell counts in case rounding the cell dimensions to even numbers left an empty row or column.
+    *cellWidth = avifAutoGridCellSize(image->width, cols, isSubsampledX);
+    *cellHeight = avifAutoGridCellSize(image->height, rows, isSubsampledY);
+    *gridCols = (image->width + *cellWidth - 1) / *cellWidth;
+    *gridRows = (image->height + *cellHeight - 1) / *cellHeight;
+    if (*gridCols * *gridRows <= 1 || *gridCols > 256 || *gridRows > 256) {
+        return AVIF_FALSE;
+    }
+    return avifAreGridDimensionsValid(image->yuvFormat, image->width, image->height, *cellWidth, *cellHeight, /*diag=*/NULL);
+}
+
+// Encodes the image as a grid of views into its planes. See avifEncoder::autoGrid.
+static avifResult avifEncoderAddImageAutoGrid(avifEncoder * encoder,
+                                              const avifImage * image,
+                                              uint32_t gridCols,
+                                              uint32_t gridRows,
+                                              uint32_t cellWidth,
+                                              uint32_t cellHeight,
+                                              avifAddImageFlags addImageFlags)
+{
+    const uint32_t cellCount = gridCols * gridRows;
+    avifImage ** cellImages = (avifImage **)avifAlloc(sizeof(avifImage *) * cellCount);
+    AVIF_CHECKERR(cellImages != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+    memset(cellImages, 0, sizeof(avifImage *) * cellCount);
+
+    avifResult result = AVIF_RESULT_OK;
+    for (uint32_t cellIndex = 0; cellIndex < cellCount && result == AVIF_RESULT_OK; ++cellIndex) {
+        cellImages[cellIndex] = avifImageCreateEmpty();
+        if (cellImages[cellIndex] == NULL) {
+            result = AVIF_RESULT_OUT_OF_MEMORY;
+            break;
+        }
+        if (cellIndex == 0) {
+            // The properties of the whole image are taken from the first cell.
+            result = avifImageCopy(cellImages[cellIndex], image, /*planes=*/0);
+            if (result != AVIF_RESULT_OK) {
+                break;
+            }
+        }
+        const uint32_t cellX = (cellIndex % gridCols) * cellWidth;
+        const uint32_t cellY = (cellIndex / gridCols) * cellHeight;
+        // The right-most and bottom-most cells may be smaller.
+        const uint32_t width = AVIF_MIN(cellWidth, image->width - cellX);
+        const uint32_t height = AVIF_MIN(cellHeight, image->height - cellY);
+        const avifCropRect cellRect = { cellX, cellY, width, height };
+        result = avifImageSetViewRect(cellImages[cellIndex], image, &cellRect);
+    }
+    if (result == AVIF_RESULT_OK) {
+        result = avifEncoderAddImageInternal(encoder,
+                                             gridCols,
+                                             gridRows,
+                                             (const avifImage * const *)cellImages,
+                                             /*durationInTimescales=*/1,
+                                             addImageFlags);
+    }
+    for (uint32_t cellIndex = 0; cellIndex < cellCount; ++cellIndex) {
+        if (cellImages[cellIndex] != NULL) {
+            avifImageDestroy(cellImages[cellIndex]);
+        }
+    }
+    avifFree(cellImages);
+    return result;
+}
+
 avifResult avifEncoderAddImage(avifEncoder * encoder, const avifImage * image, uint64_t durationInTimescales, avifAddImageFlags addImageFlags)
 {
     avifDiagnosticsClearError(&encoder->diag);
+    if (encoder->autoGrid && (addImageFlags & AVIF_ADD_IMAGE_FLAG_SINGLE) && (encoder->extraLayerCount == 0) &&
+        (image->gainMap == NULL || image->gainMap->image == NULL) && (encoder->data->items.count == 0)) {
+        uint32_t gridCols, gridRows, cellWidth, cellHeight;
+        if (avifEncoderChooseAutoGrid(encoder, image, &gridCols, &gridRows, &cellWidth, &cellHeight)) {
+            return avifEncoderAddImageAutoGrid(encoder, image, gridCols, gridRows, cellWidth, cellHeight, addImageFlags);
+        }
+    }
     return avifEncoderAddImageInternal(encoder, 1, 1, &image, durationInTimescales, addImageFlags);
 }
 
@@ -2859,11 +3825,12 @@ static avifResult avifEncoderWriteMiniBox(avifEncoder * encoder, avifRWStream *
 }
 #endif // AVIF_ENABLE_EXPERIMENTAL_MINI
 
-static avifResult avifRWStreamWriteProperties(avifItemPropertyDedup * const dedup,
-                                              avifRWStream * const s,
-                                              const avifEncoder * const encoder,
-                                              const avifImage * const imageMetadata,
-                                              const avifImage * const altImageMetadata)
+static avifResult avifRWStreamWriteItemProperties(avifItemPropertyDedup * const dedup,
+                                                  avifRWStream * const s,
+                                                  const avifEncoder * const encoder,
+                                                  const avifImage * const imageMetadata,
+                                                  const avifImage * const altImageMetadata,
+                                                  uint32_t * const firstCellIndices)
 {
     for (uint32_t itemIndex = 0; itemIndex < encoder->data->items.count; ++itemIndex) {
         avifEncoderItem * item = &encoder->data->items.item[itemIndex];
@@ -2889,26 +3856,24 @@ static avifResult avifRWStreamWriteProperties(avifItemPropertyDedup * const dedu
                 // All image cells from a grid should share the exact same properties unless they are
                 // layered image which have different al1x, so see if we've already written properties
                 // out for another cell in this grid, and if so, just steal their ipma and move on.
-                // This is a sneaky way to provide iprp deduplication.
-
-                avifBool foundPreviousCell = AVIF_FALSE;
-                for (uint32_t dedupIndex = 0; dedupIndex < itemIndex; ++dedupIndex) {
-                    avifEncoderItem * dedupItem = &encoder->data->items.item[dedupIndex];
-                    if ((item->dimgFromID == dedupItem->dimgFromID) && (dedupItem->extraLayerCount == 0)) {
-                        // We've already written dedup's items out. Steal their ipma indices and move on!
-                        item->associations.count = 0;
-                        for (uint32_t associationIndex = 0; associationIndex < dedupItem->associations.count; ++associationIndex) {
-                            avifItemPropertyAssociation * association = (avifItemPropertyAssociation *)avifArrayPush(&item->associations);
-                            AVIF_CHECKERR(association != NULL, AVIF_RESULT_OUT_OF_MEMORY);
-                            *association = dedupItem->associations.association[associationIndex];
-                        }
-                        foundPreviousCell = AVIF_TRUE;
-                        break;
+                // This is a sneaky way to provide iprp deduplication, which also avoids serializing the same
+                // ispe, pixi, av1C etc. once per cell.
+                // firstCellIndices is indexed by grid item index and contains the index of the first cell plus one.
+                const size_t parentItemIndex = (size_t)(parentItem - encoder->data->items.item);
+                if (firstCellIndices[parentItemIndex] != 0) {
+                    avifEncoderItem * dedupItem = &encoder->data->items.item[firstCellIndices[parentItemIndex] - 1];
+                    // We've already written dedup's items out. Steal their ipma indices and move on!
+                    item->associations.count = 0;
+                    for (uint32_t associationIndex = 0; associationIndex < dedupItem->associations.count; ++associationIndex) {
+                        avifItemPropertyAssociation * association =
+                            (avifItemPropertyAssociation *)avifArrayPush(&item->associations);
+                        AVIF_CHECKERR(association != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+                        *association = dedupItem->associations.association[associationIndex];
                     }
-                }
-                if (foundPreviousCell) {
                     continue;
                 }
+                // The properties of this cell are written below, before the next item is processed.
+                firstCellIndices[parentItemIndex] = itemIndex + 1;
             }
         }
 
@@ -3151,6 +4116,106 @@ static avifResult avifRWStreamWriteProperties(avifItemPropertyDedup * const dedu
     return AVIF_RESULT_OK;
 }
 
+static avifResult avifRWStreamWriteProperties(avifItemPropertyDedup * const dedup,
+                                              avifRWStream * const s,
+                                              const avifEncoder * const encoder,
+                                              const avifImage * const imageMetadata,
+                                              const avifImage * const altImageMetadata)
+{
+    uint32_t * firstCellIndices = (uint32_t *)avifAlloc(sizeof(uint32_t) * encoder->data->items.count);
+    AVIF_CHECKERR(firstCellIndices != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+    memset(firstCellIndices, 0, sizeof(uint32_t) * encoder->data->items.count);
+    const avifResult result =
+        avifRWStreamWriteItemProperties(dedup, s, encoder, imageMetadata, altImageMetadata, firstCellIndices);
+    avifFree(firstCellIndices);
+    return result;
+}
+
+// Writes the 'stsc' box of a track whose samples were written to avifEncoder::io, in as many chunks as calls to
+// avifEncoderWriteSamplesToIO() that output some.
+static avifResult avifEncoderItemWriteIOSampleToChunkBox(const avifEncoderItem * item, avifRWStream * s)
+{
+    avifBoxMarker stsc;
+    AVIF_CHECKRES(avifRWStreamWriteFullBox(s, "stsc", AVIF_BOX_SIZE_TBD, 0, 0, &stsc));
+    const size_t stscEntryCountOffset = avifRWStreamOffset(s);
+    uint32_t stscEntryCount = 0;
+    AVIF_CHECKRES(avifRWStreamWriteU32(s, 0)); // unsigned int(32) entry_count;
+    for (uint32_t chunkIndex = 0; chunkIndex < item->ioChunks.count; ++chunkIndex) {
+        const avifEncoderChunk * chunk = &item->ioChunks.chunk[chunkIndex];
+        if (chunkIndex > 0 && chunk->sampleCount == item->ioChunks.chunk[chunkIndex - 1].sampleCount) {
+            continue; // Same run of chunks.
+        }
+        AVIF_CHECKRES(avifRWStreamWriteU32(s, chunkIndex + 1));      // unsigned int(32) first_chunk;
+        AVIF_CHECKRES(avifRWStreamWriteU32(s, chunk->sampleCount)); // unsigned int(32) samples_per_chunk;
+        AVIF_CHECKRES(avifRWStreamWriteU32(s, 1));                  // unsigned int(32) sample_description_index;
+        ++stscEntryCount;
+    }
+    const size_t prevOffset = avifRWStreamOffset(s);
+    avifRWStreamSetOffset(s, stscEntryCountOffset);
+    AVIF_CHECKRES(avifRWStreamWriteU32(s, stscEntryCount));
+    avifRWStreamSetOffset(s, prevOffset);
+    return avifRWStreamFinishBox(s, stsc);
+}
+
+// Writes the 'stco' box of a track whose samples were written to avifEncoder::io, or the 'co64' box if some chunks
+// are beyond 4 GB.
+static avifResult avifEncoderItemWriteIOChunkOffsetBox(const avifEncoderItem * item, avifRWStream * s)
+{
+    AVIF_ASSERT_OR_RETURN(item->ioChunks.count > 0);
+    // The chunks are written in increasing offset order.
+    const avifBool largeOffsets = item->ioChunks.chunk[item->ioChunks.count - 1].offset > UINT32_MAX;
+    avifBoxMarker stco;
+    AVIF_CHECKRES(avifRWStreamWriteFullBox(s, largeOffsets ? "co64" : "stco", AVIF_BOX_SIZE_TBD, 0, 0, &stco));
+    AVIF_CHECKRES(avifRWStreamWriteU32(s, item->ioChunks.count)); // unsigned int(32) entry_count;
+    for (uint32_t chunkIndex = 0; chunkIndex < item->ioChunks.count; ++chunkIndex) {
+        const uint64_t offset = item->ioChunks.chunk[chunkIndex].offset;
+        if (largeOffsets) {
+            AVIF_CHECKRES(avifRWStreamWriteU64(s, offset)); // unsigned int(64) chunk_offset;
+        } else {
+            AVIF_CHECKRES(avifRWStreamWriteU32(s, (uint32_t)offset)); // unsigned int(32) chunk_offset;
+        }
+    }
+    return avifRWStreamFinishBox(s, stco);
+}
+
+// Completes the file written to avifEncoder::io. s contains the 'ftyp' box (ftypSize bytes) followed by the 'meta' box
+// and the optional 'moov' box, whose item locations are fixed up here. The contents of s are freed.
+static avifResult avifEncoderFinishIO(avifEncoder * encoder, avifRWStream * s, size_t ftypSize)
+{
+    avifEncoderData * data = encoder->data;
+    avifIO * io = encoder->io;
+
+    const size_t endOffset = avifRWStreamOffset(s);
+    for (uint32_t itemIndex = 0; itemIndex < data->items.count; ++itemIndex) {
+        const avifEncoderItem * item = &data->items.item[itemIndex];
+        for (uint32_t fixupIndex = 0; fixupIndex < item->mdatFixups.count; ++fixupIndex) {
+            // The metadata payloads and the first samples are at the beginning of the 'mdat' box.
+            AVIF_ASSERT_OR_RETURN(item->ioDataOffset <= UINT32_MAX);
+            avifRWStreamSetOffset(s, item->mdatFixups.fixup[fixupIndex].offset);
+            AVIF_CHECKRES(avifRWStreamWriteU32(s, (uint32_t)item->ioDataOffset));
+        }
+    }
+    avifRWStreamSetOffset(s, endOffset);
+    avifRWStreamFinishWrite(s);
+    const avifRWData * raw = s->raw;
+    AVIF_ASSERT_OR_RETURN(ftypSize + 8 <= AVIF_IO_MDAT_OFFSET && ftypSize <= raw->size);
+
+    // Append the 'meta' and 'moov' boxes after the 'mdat' box.
+    AVIF_CHECKRES(io->write(io, /*writeFlags=*/0, data->ioOffset, raw->data + ftypSize, raw->size - ftypSize));
+    // Finish the 'mdat' box now that its size is known.
+    const uint64_t mdatSize = avifHTON64(data->ioOffset - data->ioMdatOffset);
+    AVIF_CHECKRES(io->write(io, /*writeFlags=*/0, data->ioMdatOffset + 8, (const uint8_t *)&mdatSize, sizeof(mdatSize)));
+    // Last, write the 'ftyp' box, which makes the file valid, and fill the rest of the reserved bytes with a 'free' box.
+    uint8_t header[AVIF_IO_MDAT_OFFSET] = { 0 };
+    memcpy(header, raw->data, ftypSize);
+    const uint32_t freeSize = avifHTONL((uint32_t)(sizeof(header) - ftypSize));
+    memcpy(header + ftypSize, &freeSize, sizeof(freeSize));
+    memcpy(header + ftypSize + sizeof(freeSize), "free", 4);
+    AVIF_CHECKRES(io->write(io, /*writeFlags=*/0, 0, header, sizeof(header)));
+    avifRWDataFree(s->raw);
+    return AVIF_RESULT_OK;
+}
+
 avifResult avifEncoderFinish(avifEncoder * encoder, avifRWData * output)
 {
     avifDiagnosticsClearError(&encoder->diag);
@@ -3172,7 +4237,17 @@ avifResult avifEncoderFinish(avifEncoder * encoder, avifRWData * output)
             if (!item->codec->encodeFinish(item->codec, item->encodeOutput)) {
                 return avifGetErrorForItemCategory(item->itemCategory);
             }
-
+        }
+    }
+    if (encoder->data->segments.count > 0) {
+        AVIF_CHECKRES(avifEncoderFinishSegments(encoder));
+    }
+    if (encoder->io) {
+        AVIF_CHECKRES(avifEncoderWriteSamplesToIO(encoder));
+    }
+    for (uint32_t itemIndex = 0; itemIndex < encoder->data->items.count; ++itemIndex) {
+        avifEncoderItem * item = &encoder->data->items.item[itemIndex];
+        if (item->codec) {
             if (item->encodeOutput->samples.count != encoder->data->frames.count) {
                 return avifGetErrorForItemCategory(item->itemCategory);
             }
@@ -3207,7 +4282,7 @@ avifResult avifEncoderFinish(avifEncoder * encoder, avifRWData * output)
 
 #if defined(AVIF_ENABLE_EXPERIMENTAL_MINI)
     // Decide whether to go for a reduced MinimizedImageBox or a full regular MetaBox.
-    if ((encoder->headerFormat & AVIF_HEADER_MINI) && avifEncoderIsMiniCompatible(encoder)) {
+    if (!encoder->io && (encoder->headerFormat & AVIF_HEADER_MINI) && avifEncoderIsMiniCompatible(encoder)) {
         AVIF_CHECKRES(avifEncoderWriteFileTypeBoxAndMiniBox(encoder, output));
         return AVIF_RESULT_OK;
     }
@@ -3318,6 +4393,7 @@ avifResult avifEncoderFinish(avifEncoder * encoder, avifRWData * output)
         }
     }
     AVIF_CHECKRES(avifRWStreamFinishBox(&s, ftyp));
+    const size_t ftypSize = avifRWStreamOffset(&s);
 
     // -----------------------------------------------------------------------
     // Start meta
@@ -3770,13 +4846,17 @@ avifResult avifEncoderFinish(avifEncoder * encoder, avifRWData * output)
             avifRWStreamSetOffset(&s, prevOffset);
             AVIF_CHECKRES(avifRWStreamFinishBox(&s, stts));
 
-            avifBoxMarker stsc;
-            AVIF_CHECKRES(avifRWStreamWriteFullBox(&s, "stsc", AVIF_BOX_SIZE_TBD, 0, 0, &stsc));
-            AVIF_CHECKRES(avifRWStreamWriteU32(&s, 1));                                 // unsigned int(32) entry_count;
-            AVIF_CHECKRES(avifRWStreamWriteU32(&s, 1));                                 // unsigned int(32) first_chunk;
-            AVIF_CHECKRES(avifRWStreamWriteU32(&s, item->encodeOutput->samples.count)); // unsigned int(32) samples_per_chunk;
-            AVIF_CHECKRES(avifRWStreamWriteU32(&s, 1)); // unsigned int(32) sample_description_index;
-            AVIF_CHECKRES(avifRWStreamFinishBox(&s, stsc));
+            if (encoder->io) {
+                AVIF_CHECKRES(avifEncoderItemWriteIOSampleToChunkBox(item, &s));
+            } else {
+                avifBoxMarker stsc;
+                AVIF_CHECKRES(avifRWStreamWriteFullBox(&s, "stsc", AVIF_BOX_SIZE_TBD, 0, 0, &stsc));
+                AVIF_CHECKRES(avifRWStreamWriteU32(&s, 1)); // unsigned int(32) entry_count;
+                AVIF_CHECKRES(avifRWStreamWriteU32(&s, 1)); // unsigned int(32) first_chunk;
+                AVIF_CHECKRES(avifRWStreamWriteU32(&s, item->encodeOutput->samples.count)); // unsigned int(32) samples_per_chunk;
+                AVIF_CHECKRES(avifRWStreamWriteU32(&s, 1)); // unsigned int(32) sample_description_index;
+                AVIF_CHECKRES(avifRWStreamFinishBox(&s, stsc));
+            }
 
             avifBoxMarker stsz;
             AVIF_CHECKRES(avifRWStreamWriteFullBox(&s, "stsz", AVIF_BOX_SIZE_TBD, 0, 0, &stsz));
@@ -3788,12 +4868,16 @@ avifResult avifEncoderFinish(avifEncoder * encoder, avifRWData * output)
             }
             AVIF_CHECKRES(avifRWStreamFinishBox(&s, stsz));
 
-            avifBoxMarker stco;
-            AVIF_CHECKRES(avifRWStreamWriteFullBox(&s, "stco", AVIF_BOX_SIZE_TBD, 0, 0, &stco));
-            AVIF_CHECKRES(avifRWStreamWriteU32(&s, 1));           // unsigned int(32) entry_count;
-            AVIF_CHECKRES(avifEncoderItemAddMdatFixup(item, &s)); //
-            AVIF_CHECKRES(avifRWStreamWriteU32(&s, 1));           // unsigned int(32) chunk_offset; (set later)
-            AVIF_CHECKRES(avifRWStreamFinishBox(&s, stco));
+            if (encoder->io) {
+                AVIF_CHECKRES(avifEncoderItemWriteIOChunkOffsetBox(item, &s));
+            } else {
+                avifBoxMarker stco;
+                AVIF_CHECKRES(avifRWStreamWriteFullBox(&s, "stco", AVIF_BOX_SIZE_TBD, 0, 0, &stco));
+                AVIF_CHECKRES(avifRWStreamWriteU32(&s, 1));           // unsigned int(32) entry_count;
+                AVIF_CHECKRES(avifEncoderItemAddMdatFixup(item, &s)); //
+                AVIF_CHECKRES(avifRWStreamWriteU32(&s, 1));           // unsigned int(32) chunk_offset; (set later)
+                AVIF_CHECKRES(avifRWStreamFinishBox(&s, stco));
+            }
 
             avifBool hasNonSyncSample = AVIF_FALSE;
             for (uint32_t sampleIndex = 0; sampleIndex < item->encodeOutput->samples.count; ++sampleIndex) {
@@ -3830,6 +4914,11 @@ avifResult avifEncoderFinish(avifEncoder * encoder, avifRWData * output)
         AVIF_CHECKRES(avifRWStreamFinishBox(&s, moov));
     }
 
+    if (encoder->io) {
+        // The 'mdat' box was written by avifEncoderWriteSamplesToIO().
+        return avifEncoderFinishIO(encoder, &s, ftypSize);
+    }
+
     // -----------------------------------------------------------------------
     // Write mdat
 
@@ -3860,8 +4949,181 @@ avifResult avifEncoderFinish(avifEncoder * encoder, avifRWData * output)
     return AVIF_RESULT_OK;
 }
 
+// Encodes image with the settings of encoder at the given quality, with a new avifEncoder instance.
+static avifResult avifEncoderWriteTrial(const avifEncoder * encoder, const avifImage * image, int quality, avifEncoder ** trial, avifRWData * output)
+{
+    *trial = avifEncoderCreate();
+    AVIF_CHECKERR(*trial != NULL, AVIF_RESULT_OUT_OF_MEMORY);
+    struct avifEncoderData * data = (*trial)->data;
+    avifCodecSpecificOptions * csOptions = (*trial)->csOptions;
+    **trial = *encoder;
+    (*trial)->data = data;
+    (*trial)->csOptions = csOptions;
+    (*trial)->io = NULL; // The trials are written to memory.
+    memset(&(*trial)->ioStats, 0, sizeof((*trial)->ioStats));
+    avifDiagnosticsClearError(&(*trial)->diag);
+    for (uint32_t i = 0; i < encoder->csOptions->count; ++i) {
+        const avifCodecSpecificOption * entry = &encoder->csOptions->entries[i];
+        AVIF_CHECKRES(avifCodecSpecificOptionsSet(csOptions, entry->key, entry->value));
+    }
+    (*trial)->targetSize = 0;
+    (*trial)->quality = quality;
+    (*trial)->qualityAlpha = quality;
+    (*trial)->qualityGainMap = quality;
+    AVIF_CHECKRES(avifEncoderAddImage(*trial, image, 1, AVIF_ADD_IMAGE_FLAG_SINGLE));
+    return avifEncoderFinish(*trial, output);
+}
+
+// Predicts the quality giving an output of targetSize bytes, assuming that the logarithm of the output size is
+// linear in quality (which is close to the behavior of AV1 encoders, the quality being linear in quantizer).
+// (quality0, size0) and (quality1, size1) are previous trials, quality0 may be AVIF_QUALITY_DEFAULT if there is
+// only one. Returns a value in [minQuality:maxQuality].
+static int avifPredictQualityForSize(int quality0, size_t size0, int quality1, size_t size1, size_t targetSize, int minQuality, int maxQuality)
+{
+    // By default, assume that the size doubles every 10 quality points.
+    double qualityPerLog2Size = 10.0;
+    if (quality0 != AVIF_QUALITY_DEFAULT && quality0 != quality1 && size0 != size1) {
+        qualityPerLog2Size = (quality1 - quality0) / (log2((double)size1) - log2((double)size0));
+        // Avoid extreme steps caused by noise in the measurements.
+        qualityPerLog2Size = AVIF_CLAMP(qualityPerLog2Size, 2.0, 50.0);
+    }
+    const double quality = quality1 + qualityPerLog2Size * (log2((double)targetSize) - log2((double)size1));
+    if (quality <= minQuality) {
+        return minQuality;
+    }
+    if (quality >= maxQuality) {
+        return maxQuality;
+    }
+    return (int)(quality + 0.5);
+}
+
+// Replaces *encoder and *output by trial and trialOutput.
+static void avifEncoderTrialReplace(avifEncoder ** encoder, avifRWData * output, avifEncoder * trial, avifRWData * trialOutput)
+{
+    if (*encoder != NULL) {
+        avifEncoderDestroy(*encoder);
+    }
+    avifRWDataFree(output);
+    *encoder = trial;
+    *output = *trialOutput;
+    memset(trialOutput, 0, sizeof(avifRWData));
+}
+
+// Searches the highest quality for which the output fits in encoder->targetSize bytes.
+// Instead of a plain binary search over the quality range, the next quality to try is predicted from the
+// sizes of the previous trials, which usually converges in a few encodes.
+static avifResult avifEncoderWriteWithTargetSize(avifEncoder * encoder, const avifImage * image, avifRWData * output)
+{
+    avifResult result = AVIF_RESULT_OK;
+    // The highest quality known to fit and the lowest quality known to be too large, with their trials.
+    int fittingQuality = AVIF_QUALITY_WORST - 1, tooLargeQuality = AVIF_QUALITY_BEST + 1;
+    size_t fittingSize = 0, tooLargeSize = 0;
+    avifEncoder * fittingEncoder = NULL;
+    avifEncoder * tooLargeEncoder = NULL;
+    avifRWData fittingOutput = AVIF_DATA_EMPTY;
+    avifRWData tooLargeOutput = AVIF_DATA_EMPTY;
+    int previousQuality = AVIF_QUALITY_DEFAULT;
+    size_t previousSize = 0;
+    avifBool bisect = AVIF_FALSE;
+
+    int quality = (encoder->quality == AVIF_QUALITY_DEFAULT) ? 60 : AVIF_CLAMP(encoder->quality, AVIF_QUALITY_WORST, AVIF_QUALITY_BEST);
+    for (;;) {
+        avifEncoder * trial = NULL;
+        avifRWData trialOutput = AVIF_DATA_EMPTY;
+        result = avifEncoderWriteTrial(encoder, image, quality, &trial, &trialOutput);
+        if (result != AVIF_RESULT_OK) {
+            if (trial != NULL) {
+                encoder->diag = trial->diag;
+                avifEncoderDestroy(trial);
+            }
+            avifRWDataFree(&trialOutput);
+            goto cleanup;
+        }
+        const size_t size = trialOutput.size;
+        const int bracketWidth = tooLargeQuality - fittingQuality;
+        if (size <= encoder->targetSize) {
+            fittingQuality = quality;
+            fittingSize = size;
+            avifEncoderTrialReplace(&fittingEncoder, &fittingOutput, trial, &trialOutput);
+        } else {
+            tooLargeQuality = quality;
+            tooLargeSize = size;
+            avifEncoderTrialReplace(&tooLargeEncoder, &tooLargeOutput, trial, &trialOutput);
+        }
+        if (size == encoder->targetSize || tooLargeQuality - fittingQuality <= 1) {
+            break;
+        }
+
+        if (fittingEncoder != NULL && tooLargeEncoder != NULL) {
+            // Interpolate between both sides of the target, unless the last interpolation did not halve the search
+            // range, in which case bisect to guarantee a logarithmic number of trials.
+            bisect = !bisect && (tooLargeQuality - fittingQuality) * 2 > bracketWidth;
+            if (bisect) {
+                quality = (fittingQuality + tooLargeQuality) / 2;
+            } else {
+                quality = avifPredictQualityForSize(fittingQuality,
+                                                    fittingSize,
+                                                    tooLargeQuality,
+                                                    tooLargeSize,
+                                                    encoder->targetSize,
+                                                    fittingQuality + 1,
+                                                    tooLargeQuality - 1);
+            }
+        } else {
+            // Extrapolate from the last two trials, which are on the same side of the target.
+            const int nextQuality = avifPredictQualityForSize(previousQuality,
+                                                              previousSize,
+                                                              quality,
+                                                              size,
+                                                              encoder->targetSize,
+                                                              fittingQuality + 1,
+                                                              tooLargeQuality - 1);
+            previousQuality = quality;
+            previousSize = size;
+            quality = nextQuality;
+        }
+    }
+
+    {
+        // If no quality fits, return the smallest output.
+        avifEncoder * best = (fittingEncoder != NULL) ? fittingEncoder : tooLargeEncoder;
+        avifRWData * bestOutput = (fittingEncoder != NULL) ? &fittingOutput : &tooLargeOutput;
+        avifRWDataFree(output);
+        *output = *bestOutput;
+        memset(bestOutput, 0, sizeof(avifRWData));
+        // Leave encoder in the same state as if it had encoded the image at that quality itself.
+        struct avifEncoderData * data = encoder->data;
+        encoder->data = best->data;
+        best->data = data;
+        encoder->quality = best->quality;
+        encoder->qualityAlpha = best->qualityAlpha;
+        encoder->qualityGainMap = best->qualityGainMap;
+        encoder->ioStats = best->ioStats;
+    }
+
+cleanup:
+    if (fittingEncoder != NULL) {
+        avifEncoderDestroy(fittingEncoder);
+    }
+    if (tooLargeEncoder != NULL) {
+        avifEncoderDestroy(tooLargeEncoder);
+    }
+    avifRWDataFree(&fittingOutput);
+    avifRWDataFree(&tooLargeOutput);
+    return result;
+}
+
 avifResult avifEncoderWrite(avifEncoder * encoder, const avifImage * image, avifRWData * output)
 {
+    if (encoder->targetSize != 0) {
+        AVIF_CHECKRES(avifEncoderWriteWithTargetSize(encoder, image, output));
+        if (encoder->io) {
+            // The chosen trial was written to memory.
+            AVIF_CHECKRES(encoder->io->write(encoder->io, /*writeFlags=*/0, /*offset=*/0, output->data, output->size));
+            avifRWDataFree(output);
+        }
+        return AVIF_RESULT_OK;
+    }
     avifResult addImageResult = avifEncoderAddImage(encoder, image, 1, AVIF_ADD_IMAGE_FLAG_SINGLE);
     if (addImageResult != AVIF_RESULT_OK) {
         return addImageResult;
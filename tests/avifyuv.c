@@ -46,6 +46,8 @@ static const char * rgbFormatToString(avifRGBFormat format)
             return "RGB_GRAYA";
         case AVIF_RGB_FORMAT_AGRAY:
             return "RGB_AGRAY";
+        case AVIF_RGB_FORMAT_RGBA1010102:
+            return "RGBA1010102";
         case AVIF_RGB_FORMAT_COUNT:
             break;
     }
@@ -4,6 +4,8 @@
 #include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <tuple>
+#include <vector>
 
 #include "avif/avif.h"
 #include "avif/avif_cxx.h"
@@ -456,6 +458,87 @@ TEST(Avif16bitTest, SampleTransformWithOtherBitDepths) {
 
 //------------------------------------------------------------------------------
 
+class SampleTransformThreadsTest
+    : public testing::TestWithParam<
+          std::tuple<avifSampleTransformRecipe, /*max_threads=*/int>> {};
+
+// The inputs to the 'sato' item are computed while the other cells are
+// encoded when maxThreads is greater than 1.
+TEST_P(SampleTransformThreadsTest, LosslessGrid) {
+  if (!testutil::Av1EncoderAvailable() || !testutil::Av1DecoderAvailable()) {
+    GTEST_SKIP() << "AV1 Codec unavailable, skip test.";
+  }
+  const avifSampleTransformRecipe recipe = std::get<0>(GetParam());
+  const int max_threads = std::get<1>(GetParam());
+
+  const ImagePtr image =
+      testutil::ReadImage(data_path, "weld_16bit.png", AVIF_PIXEL_FORMAT_YUV444,
+                          /*requested_depth=*/16);
+  ASSERT_NE(image, nullptr);
+  // Simulate alpha plane with a view on luma.
+  image->alphaPlane = image->yuvPlanes[AVIF_CHAN_Y];
+  image->alphaRowBytes = image->yuvRowBytes[AVIF_CHAN_Y];
+  image->imageOwnsAlphaPlane = false;
+
+  constexpr uint32_t kGridCols = 2, kGridRows = 2;
+  const uint32_t cell_width = (image->width + kGridCols - 1) / kGridCols;
+  const uint32_t cell_height = (image->height + kGridRows - 1) / kGridRows;
+  std::vector<ImagePtr> cells;
+  std::vector<const avifImage*> cell_pointers;
+  for (uint32_t row = 0; row < kGridRows; ++row) {
+    for (uint32_t col = 0; col < kGridCols; ++col) {
+      // The right-most and bottom-most cells are smaller and padded.
+      const avifCropRect rect{
+          col * cell_width, row * cell_height,
+          col + 1 == kGridCols ? image->width - col * cell_width : cell_width,
+          row + 1 == kGridRows ? image->height - row * cell_height
+                               : cell_height};
+      cells.emplace_back(avifImageCreateEmpty());
+      ASSERT_NE(cells.back(), nullptr);
+      ASSERT_EQ(avifImageSetViewRect(cells.back().get(), image.get(), &rect),
+                AVIF_RESULT_OK);
+      cell_pointers.push_back(cells.back().get());
+    }
+  }
+
+  EncoderPtr encoder(avifEncoderCreate());
+  ASSERT_NE(encoder, nullptr);
+  encoder->speed = AVIF_SPEED_FASTEST;
+  encoder->quality = AVIF_QUALITY_LOSSLESS;
+  encoder->qualityAlpha = AVIF_QUALITY_LOSSLESS;
+  encoder->sampleTransformRecipe = recipe;
+  encoder->maxThreads = max_threads;
+  ASSERT_EQ(avifEncoderAddImageGrid(encoder.get(), kGridCols, kGridRows,
+                                    cell_pointers.data(),
+                                    AVIF_ADD_IMAGE_FLAG_SINGLE),
+            AVIF_RESULT_OK);
+  testutil::AvifRwData encoded;
+  ASSERT_EQ(avifEncoderFinish(encoder.get(), &encoded), AVIF_RESULT_OK);
+
+  ImagePtr decoded(avifImageCreateEmpty());
+  ASSERT_NE(decoded, nullptr);
+  DecoderPtr decoder(avifDecoderCreate());
+  ASSERT_NE(decoder, nullptr);
+  decoder->imageContentToDecode =
+      AVIF_IMAGE_CONTENT_COLOR_AND_ALPHA | AVIF_IMAGE_CONTENT_SAMPLE_TRANSFORMS;
+  ASSERT_EQ(avifDecoderReadMemory(decoder.get(), decoded.get(), encoded.data,
+                                  encoded.size),
+            AVIF_RESULT_OK);
+  ASSERT_EQ(decoded->depth, 16u);
+  EXPECT_TRUE(testutil::AreImagesEqual(*image, *decoded));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    All, SampleTransformThreadsTest,
+    testing::Combine(
+        testing::Values(
+            AVIF_SAMPLE_TRANSFORM_BIT_DEPTH_EXTENSION_8B_8B,
+            AVIF_SAMPLE_TRANSFORM_BIT_DEPTH_EXTENSION_12B_4B,
+            AVIF_SAMPLE_TRANSFORM_BIT_DEPTH_EXTENSION_12B_8B_OVERLAP_4B),
+        /*max_threads=*/testing::Values(1, 2, 8)));
+
+//------------------------------------------------------------------------------
+
 }  // namespace
 }  // namespace avif
 
@@ -36,14 +36,17 @@ void Convert(ImagePtr image, int rgb_depth, int rgb_format,
   const avifResult expected_yuv_to_rgb_result =
       (rgb_format == AVIF_RGB_FORMAT_RGB_565 && rgb_depth != 8)
           ? AVIF_RESULT_REFORMAT_FAILED
+      : (rgb_format == AVIF_RGB_FORMAT_RGBA1010102 && rgb_depth != 10)
+          ? AVIF_RESULT_REFORMAT_FAILED
       : (is_float && rgb_depth != 16) ? AVIF_RESULT_REFORMAT_FAILED
       : (max_threads < 0)             ? AVIF_RESULT_REFORMAT_FAILED
                                       : AVIF_RESULT_OK;
   const avifResult expected_rgb_to_yuv_result =
-      (rgb_format == AVIF_RGB_FORMAT_RGB_565) ? AVIF_RESULT_REFORMAT_FAILED
-      : (is_float && rgb_depth != 16)         ? AVIF_RESULT_REFORMAT_FAILED
-      : (is_float)                            ? AVIF_RESULT_NOT_IMPLEMENTED
-                                              : AVIF_RESULT_OK;
+      (rgb_format == AVIF_RGB_FORMAT_RGB_565 ||
+       rgb_format == AVIF_RGB_FORMAT_RGBA1010102)
+          ? AVIF_RESULT_REFORMAT_FAILED
+      : (is_float && rgb_depth != 16) ? AVIF_RESULT_REFORMAT_FAILED
+                                      : AVIF_RESULT_OK;
 
   ASSERT_EQ(avifImageYUVToRGB(image.get(), &rgb), expected_yuv_to_rgb_result);
   if (expected_yuv_to_rgb_result != AVIF_RESULT_OK) {
@@ -14,15 +14,6 @@ namespace {
 
 TEST(AlphaMultiplyTest, OpaqueIsNoOp) {
   for (bool premultiplied_input : {false, true}) {
-    if (!premultiplied_input) {
-      // avifPrepareReformatState() will result in different YUV(A)-to-RGB
-      // conversion algorithm choices (built-in or libyuv) depending on the
-      // presence of an alpha channel, no matter if it is opaque or not, because
-      // it considers that unpremultiplied YUVA samples should be premultiplied
-      // before discarding alpha and converting to RGB. Skip the test.
-      continue;
-    }
-
     // YUVA.
     ImagePtr opaque_alpha = testutil::CreateImage(
         1024, 1024, /*depth=*/8, AVIF_PIXEL_FORMAT_YUV444, AVIF_PLANES_ALL);
@@ -0,0 +1,192 @@
+// Copyright 2026 Google LLC
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "avif/avif.h"
+#include "avif/internal.h"
+#include "aviftest_helpers.h"
+#include "gtest/gtest.h"
+
+namespace avif {
+namespace {
+
+// Used to pass the data folder path to the GoogleTest suites.
+const char* data_path = nullptr;
+
+//------------------------------------------------------------------------------
+
+bool Dav1dAvailable() {
+  return avifCodecName(AVIF_CODEC_CHOICE_DAV1D, AVIF_CODEC_FLAG_CAN_DECODE) !=
+         nullptr;
+}
+
+// Decodes all files one after the other with the same decoder and compares
+// the frames with the ones decoded by a new decoder for each file.
+TEST(CodecReuseTest, SameAsNewDecoder) {
+  if (!Dav1dAvailable()) {
+    GTEST_SKIP() << "dav1d unavailable, skip test.";
+  }
+  const std::vector<std::string> file_names = {
+      "white_1x1.avif",
+      "sofa_grid1x5_420.avif",
+      "paris_icc_exif_xmp.avif",
+      "color_grid_alpha_nogrid.avif",
+      "colors-animated-8bpc-alpha-exif-xmp.avif",
+      "white_1x1.avif",
+      "colors-animated-8bpc.avif"};
+
+  DecoderPtr decoder(avifDecoderCreate());
+  ASSERT_NE(decoder, nullptr);
+  decoder->codecChoice = AVIF_CODEC_CHOICE_DAV1D;
+  decoder->reuseCodecs = AVIF_TRUE;
+  for (const std::string& file_name : file_names) {
+    SCOPED_TRACE(file_name);
+    const std::string path = std::string(data_path) + file_name;
+    DecoderPtr reference(avifDecoderCreate());
+    ASSERT_NE(reference, nullptr);
+    reference->codecChoice = AVIF_CODEC_CHOICE_DAV1D;
+    ASSERT_EQ(avifDecoderSetIOFile(reference.get(), path.c_str()),
+              AVIF_RESULT_OK);
+    ASSERT_EQ(avifDecoderParse(reference.get()), AVIF_RESULT_OK);
+
+    ASSERT_EQ(avifDecoderSetIOFile(decoder.get(), path.c_str()),
+              AVIF_RESULT_OK);
+    ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK);
+    ASSERT_EQ(decoder->imageCount, reference->imageCount);
+    for (int i = 0; i < reference->imageCount; ++i) {
+      ASSERT_EQ(avifDecoderNextImage(reference.get()), AVIF_RESULT_OK);
+      ASSERT_EQ(avifDecoderNextImage(decoder.get()), AVIF_RESULT_OK);
+      EXPECT_TRUE(
+          testutil::AreImagesEqual(*decoder->image, *reference->image));
+    }
+  }
+}
+
+// Seeking back to a keyframe resets the codec instances instead of creating
+// new ones.
+TEST(CodecReuseTest, Seek) {
+  if (!Dav1dAvailable()) {
+    GTEST_SKIP() << "dav1d unavailable, skip test.";
+  }
+  const std::string path =
+      std::string(data_path) + "colors-animated-12bpc-keyframes-0-2-3.avif";
+  DecoderPtr reference(avifDecoderCreate());
+  ASSERT_NE(reference, nullptr);
+  reference->codecChoice = AVIF_CODEC_CHOICE_DAV1D;
+  ASSERT_EQ(avifDecoderSetIOFile(reference.get(), path.c_str()),
+            AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderParse(reference.get()), AVIF_RESULT_OK);
+  std::vector<ImagePtr> frames;
+  for (int i = 0; i < reference->imageCount; ++i) {
+    ASSERT_EQ(avifDecoderNextImage(reference.get()), AVIF_RESULT_OK);
+    frames.emplace_back(avifImageCreateEmpty());
+    ASSERT_NE(frames.back(), nullptr);
+    ASSERT_EQ(avifImageCopy(frames.back().get(), reference->image,
+                            AVIF_PLANES_ALL),
+              AVIF_RESULT_OK);
+  }
+
+  DecoderPtr decoder(avifDecoderCreate());
+  ASSERT_NE(decoder, nullptr);
+  decoder->codecChoice = AVIF_CODEC_CHOICE_DAV1D;
+  decoder->reuseCodecs = AVIF_TRUE;
+  ASSERT_EQ(avifDecoderSetIOFile(decoder.get(), path.c_str()), AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK);
+  for (uint32_t frame_index : {3u, 1u, 0u, 4u, 2u}) {
+    if (frame_index >= frames.size()) continue;
+    ASSERT_EQ(avifDecoderNthImage(decoder.get(), frame_index), AVIF_RESULT_OK);
+    EXPECT_TRUE(
+        testutil::AreImagesEqual(*decoder->image, *frames[frame_index]));
+  }
+}
+
+// The second decode takes the codec instance flushed after the first one
+// instead of creating a new one, and gives the same pixels.
+TEST(CodecReuseTest, SecondDecodeReusesCodec) {
+  if (!Dav1dAvailable()) {
+    GTEST_SKIP() << "dav1d unavailable, skip test.";
+  }
+  const testutil::AvifRwData file =
+      testutil::ReadFile(std::string(data_path) + "paris_icc_exif_xmp.avif");
+  ASSERT_NE(file.size, 0u);
+  DecoderPtr decoder(avifDecoderCreate());
+  ASSERT_NE(decoder, nullptr);
+  decoder->codecChoice = AVIF_CODEC_CHOICE_DAV1D;
+  decoder->reuseCodecs = AVIF_TRUE;
+  ASSERT_EQ(avifDecoderSetIOMemory(decoder.get(), file.data, file.size),
+            AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderNextImage(decoder.get()), AVIF_RESULT_OK);
+  EXPECT_EQ(avifDecoderSpareCodecCount(decoder.get()), 0u);
+  ImagePtr first(avifImageCreateEmpty());
+  ASSERT_NE(first, nullptr);
+  ASSERT_EQ(avifImageCopy(first.get(), decoder->image, AVIF_PLANES_ALL),
+            AVIF_RESULT_OK);
+
+  // Parsing a new file flushes the codec instance and keeps it.
+  ASSERT_EQ(avifDecoderSetIOMemory(decoder.get(), file.data, file.size),
+            AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK);
+  EXPECT_EQ(avifDecoderSpareCodecCount(decoder.get()), 1u);
+  ASSERT_EQ(avifDecoderNextImage(decoder.get()), AVIF_RESULT_OK);
+  EXPECT_EQ(avifDecoderSpareCodecCount(decoder.get()), 0u);
+  EXPECT_TRUE(testutil::AreImagesEqual(*decoder->image, *first));
+
+  // Without reuseCodecs, nothing is kept.
+  decoder->reuseCodecs = AVIF_FALSE;
+  ASSERT_EQ(avifDecoderSetIOMemory(decoder.get(), file.data, file.size),
+            AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderNextImage(decoder.get()), AVIF_RESULT_OK);
+  EXPECT_EQ(avifDecoderSpareCodecCount(decoder.get()), 0u);
+  EXPECT_TRUE(testutil::AreImagesEqual(*decoder->image, *first));
+}
+
+TEST(DISABLED_CodecReuseBenchmark, ManySmallFiles) {
+  if (!Dav1dAvailable()) {
+    GTEST_SKIP() << "dav1d unavailable, skip test.";
+  }
+  const testutil::AvifRwData file =
+      testutil::ReadFile(std::string(data_path) + "white_1x1.avif");
+  ASSERT_NE(file.size, 0u);
+  constexpr int kNumFiles = 200;
+  for (avifBool reuse_codecs : {AVIF_FALSE, AVIF_TRUE}) {
+    DecoderPtr decoder(avifDecoderCreate());
+    ASSERT_NE(decoder, nullptr);
+    decoder->codecChoice = AVIF_CODEC_CHOICE_DAV1D;
+    decoder->maxThreads = 4;
+    decoder->reuseCodecs = reuse_codecs;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kNumFiles; ++i) {
+      ASSERT_EQ(avifDecoderSetIOMemory(decoder.get(), file.data, file.size),
+                AVIF_RESULT_OK);
+      ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK);
+      ASSERT_EQ(avifDecoderNextImage(decoder.get()), AVIF_RESULT_OK);
+    }
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << kNumFiles << " files decoded in " << elapsed.count()
+              << " ms with reuseCodecs=" << reuse_codecs << std::endl;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace
+}  // namespace avif
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  if (argc != 2) {
+    std::cerr << "There must be exactly one argument containing the path to "
+                 "the test data folder"
+              << std::endl;
+    return 1;
+  }
+  avif::data_path = argv[1];
+  return RUN_ALL_TESTS();
+}
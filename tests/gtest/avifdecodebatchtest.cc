@@ -0,0 +1,195 @@
+// Copyright 2026 Google LLC
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "avif/avif.h"
+#include "aviftest_helpers.h"
+#include "gtest/gtest.h"
+
+namespace avif {
+namespace {
+
+// Used to pass the data folder path to the GoogleTest suites.
+const char* data_path = nullptr;
+
+//------------------------------------------------------------------------------
+
+std::vector<testutil::AvifRwData> ReadFiles(
+    const std::vector<std::string>& file_names) {
+  std::vector<testutil::AvifRwData> files;
+  for (const std::string& file_name : file_names) {
+    files.push_back(testutil::ReadFile(std::string(data_path) + file_name));
+  }
+  return files;
+}
+
+TEST(DecodeBatchTest, Empty) {
+  DecoderPtr settings(avifDecoderCreate());
+  ASSERT_NE(settings, nullptr);
+  EXPECT_EQ(avifDecoderReadMemoryBatch(settings.get(), nullptr, 0),
+            AVIF_RESULT_OK);
+}
+
+// Each item gets its own result.
+TEST(DecodeBatchTest, PerItemErrors) {
+  const uint8_t garbage[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+  const testutil::AvifRwData file =
+      testutil::ReadFile(std::string(data_path) + "white_1x1.avif");
+  ASSERT_NE(file.size, 0u);
+  ImagePtr image(avifImageCreateEmpty());
+  ASSERT_NE(image, nullptr);
+
+  std::vector<avifDecodeBatchItem> items(3);
+  items[0].data = garbage;
+  items[0].size = sizeof(garbage);
+  items[0].image = image.get();
+  // No output.
+  items[1].data = file.data;
+  items[1].size = file.size;
+  // Truncated.
+  items[2].data = file.data;
+  items[2].size = 20;
+  items[2].image = image.get();
+
+  DecoderPtr settings(avifDecoderCreate());
+  ASSERT_NE(settings, nullptr);
+  settings->maxThreads = 2;
+  EXPECT_NE(avifDecoderReadMemoryBatch(settings.get(), items.data(),
+                                       items.size()),
+            AVIF_RESULT_OK);
+  EXPECT_NE(items[0].result, AVIF_RESULT_OK);
+  EXPECT_EQ(items[1].result, AVIF_RESULT_INVALID_ARGUMENT);
+  EXPECT_EQ(items[2].result, AVIF_RESULT_TRUNCATED_DATA);
+}
+
+class DecodeBatchThreadsTest : public testing::TestWithParam<int> {};
+
+TEST_P(DecodeBatchThreadsTest, SameAsReadMemory) {
+  if (!testutil::Av1DecoderAvailable()) {
+    GTEST_SKIP() << "AV1 Codec unavailable, skip test.";
+  }
+  const std::vector<testutil::AvifRwData> files =
+      ReadFiles({"white_1x1.avif", "paris_icc_exif_xmp.avif",
+                 "sofa_grid1x5_420.avif", "color_grid_alpha_nogrid.avif",
+                 "colors-animated-8bpc.avif", "white_1x1.avif"});
+  std::vector<ImagePtr> images;
+  std::vector<testutil::AvifRgbImage> rgbs;
+  std::vector<avifDecodeBatchItem> items(files.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    ASSERT_NE(files[i].size, 0u);
+    images.emplace_back(avifImageCreateEmpty());
+    ASSERT_NE(images.back(), nullptr);
+    items[i].data = files[i].data;
+    items[i].size = files[i].size;
+    items[i].image = images.back().get();
+  }
+  // Leave the rgb dimensions and depth to avifDecoderReadMemoryBatch().
+  rgbs.reserve(files.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    rgbs.emplace_back(images[i].get(), 8, AVIF_RGB_FORMAT_RGBA);
+    avifRGBImageFreePixels(&rgbs.back());
+    rgbs.back().depth = 0;
+    items[i].rgb = &rgbs.back();
+  }
+
+  DecoderPtr settings(avifDecoderCreate());
+  ASSERT_NE(settings, nullptr);
+  settings->maxThreads = GetParam();
+  ASSERT_EQ(avifDecoderReadMemoryBatch(settings.get(), items.data(),
+                                       items.size()),
+            AVIF_RESULT_OK);
+
+  for (size_t i = 0; i < files.size(); ++i) {
+    SCOPED_TRACE(i);
+    EXPECT_EQ(items[i].result, AVIF_RESULT_OK);
+    DecoderPtr decoder(avifDecoderCreate());
+    ASSERT_NE(decoder, nullptr);
+    ImagePtr reference(avifImageCreateEmpty());
+    ASSERT_NE(reference, nullptr);
+    ASSERT_EQ(avifDecoderReadMemory(decoder.get(), reference.get(),
+                                    files[i].data, files[i].size),
+              AVIF_RESULT_OK);
+    EXPECT_TRUE(testutil::AreImagesEqual(*images[i], *reference));
+
+    testutil::AvifRgbImage reference_rgb(reference.get(), reference->depth,
+                                         AVIF_RGB_FORMAT_RGBA);
+    ASSERT_EQ(avifImageYUVToRGB(reference.get(), &reference_rgb),
+              AVIF_RESULT_OK);
+    EXPECT_TRUE(testutil::AreImagesEqual(rgbs[i], reference_rgb));
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(All, DecodeBatchThreadsTest,
+                         testing::Values(1, 2, 4, 16));
+
+// Compares avifDecoderReadMemoryBatch() with a loop of avifDecoderCreate()
+// and avifDecoderReadMemory() calls. Only prints timings, so it is disabled by
+// default. Run it with --gtest_also_run_disabled_tests.
+TEST(DISABLED_DecodeBatchBenchmark, BatchVersusLoop) {
+  if (!testutil::Av1DecoderAvailable()) {
+    GTEST_SKIP() << "AV1 Codec unavailable, skip test.";
+  }
+  const testutil::AvifRwData file =
+      testutil::ReadFile(std::string(data_path) + "white_1x1.avif");
+  ASSERT_NE(file.size, 0u);
+  constexpr size_t kNumFiles = 1000;
+  constexpr int kMaxThreads = 4;
+  std::vector<ImagePtr> images;
+  for (size_t i = 0; i < kNumFiles; ++i) {
+    images.emplace_back(avifImageCreateEmpty());
+    ASSERT_NE(images.back(), nullptr);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kNumFiles; ++i) {
+    DecoderPtr decoder(avifDecoderCreate());
+    ASSERT_NE(decoder, nullptr);
+    decoder->maxThreads = kMaxThreads;
+    ASSERT_EQ(avifDecoderReadMemory(decoder.get(), images[i].get(), file.data,
+                                    file.size),
+              AVIF_RESULT_OK);
+  }
+  const std::chrono::duration<double, std::milli> loop_duration =
+      std::chrono::steady_clock::now() - start;
+
+  std::vector<avifDecodeBatchItem> items(kNumFiles);
+  for (size_t i = 0; i < kNumFiles; ++i) {
+    items[i].data = file.data;
+    items[i].size = file.size;
+    items[i].image = images[i].get();
+  }
+  DecoderPtr settings(avifDecoderCreate());
+  ASSERT_NE(settings, nullptr);
+  settings->maxThreads = kMaxThreads;
+  start = std::chrono::steady_clock::now();
+  ASSERT_EQ(avifDecoderReadMemoryBatch(settings.get(), items.data(),
+                                       items.size()),
+            AVIF_RESULT_OK);
+  const std::chrono::duration<double, std::milli> batch_duration =
+      std::chrono::steady_clock::now() - start;
+
+  std::cout << kNumFiles << " files decoded in " << loop_duration.count()
+            << " ms with avifDecoderReadMemory(), " << batch_duration.count()
+            << " ms with avifDecoderReadMemoryBatch()" << std::endl;
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace
+}  // namespace avif
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  if (argc != 2) {
+    std::cerr << "There must be exactly one argument containing the path to "
+                 "the test data folder"
+              << std::endl;
+    return 1;
+  }
+  avif::data_path = argv[1];
+  return RUN_ALL_TESTS();
+}
@@ -110,6 +110,40 @@ TEST(AvifDecodeTest, Idat) {
   }
 }
 
+// The tiles of a grid are copied into the decoded image by up to
+// avifDecoder::maxThreads threads, which must not change the samples.
+TEST(AvifDecodeTest, GridSameWithAnyThreadCount) {
+  if (!testutil::Av1DecoderAvailable()) {
+    GTEST_SKIP() << "AV1 Codec unavailable, skip test.";
+  }
+  for (const std::string file_name :
+       {"sofa_grid1x5_420.avif", "color_grid_alpha_nogrid.avif",
+        "color_grid_alpha_grid_gainmap_nogrid.avif",
+        "color_grid_alpha_grid_tile_shared_in_dimg.avif"}) {
+    SCOPED_TRACE(file_name);
+    ImagePtr images[2];
+    for (int max_threads : {1, 8}) {
+      DecoderPtr decoder(avifDecoderCreate());
+      ASSERT_NE(decoder, nullptr);
+      decoder->maxThreads = max_threads;
+      ASSERT_EQ(
+          avifDecoderSetIOFile(decoder.get(),
+                               (std::string(data_path) + file_name).c_str()),
+          AVIF_RESULT_OK);
+      ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK)
+          << decoder->diag.error;
+      ASSERT_EQ(avifDecoderNextImage(decoder.get()), AVIF_RESULT_OK)
+          << decoder->diag.error;
+      ImagePtr& image = images[max_threads == 1 ? 0 : 1];
+      image.reset(avifImageCreateEmpty());
+      ASSERT_NE(image, nullptr);
+      ASSERT_EQ(avifImageCopy(image.get(), decoder->image, AVIF_PLANES_ALL),
+                AVIF_RESULT_OK);
+    }
+    EXPECT_TRUE(testutil::AreImagesEqual(*images[0], *images[1]));
+  }
+}
+
 // From https://crbug.com/334281983.
 TEST(AvifDecodeTest, PeekCompatibleFileTypeBad1) {
   constexpr uint8_t kData[] = {0x00, 0x00, 0x00, 0x1c, 0x66,
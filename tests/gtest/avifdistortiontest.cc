@@ -0,0 +1,260 @@
+// Copyright 2026 Google LLC
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include "avif/avif.h"
+#include "avif/internal.h"
+#include "aviftest_helpers.h"
+#include "gtest/gtest.h"
+
+namespace avif {
+namespace {
+
+//------------------------------------------------------------------------------
+
+// Adds uniform noise in [-amplitude:amplitude] to all the samples of image.
+void AddNoise(avifImage* image, uint32_t amplitude, uint32_t seed) {
+  std::mt19937 engine(seed);
+  std::uniform_int_distribution<int32_t> distribution(
+      -static_cast<int32_t>(amplitude), static_cast<int32_t>(amplitude));
+  const int32_t max_value = (1 << image->depth) - 1;
+  for (int c : {AVIF_CHAN_Y, AVIF_CHAN_U, AVIF_CHAN_V, AVIF_CHAN_A}) {
+    uint8_t* row = avifImagePlane(image, c);
+    if (row == nullptr) continue;
+    const uint32_t row_bytes = avifImagePlaneRowBytes(image, c);
+    for (uint32_t y = 0; y < avifImagePlaneHeight(image, c); ++y) {
+      for (uint32_t x = 0; x < avifImagePlaneWidth(image, c); ++x) {
+        if (avifImageUsesU16(image)) {
+          uint16_t* sample = reinterpret_cast<uint16_t*>(row) + x;
+          *sample = static_cast<uint16_t>(std::clamp(
+              *sample + distribution(engine), 0, max_value));
+        } else {
+          row[x] = static_cast<uint8_t>(
+              std::clamp(row[x] + distribution(engine), 0, max_value));
+        }
+      }
+      row += row_bytes;
+    }
+  }
+}
+
+ImagePtr CreateNoisyCopy(const avifImage& image, uint32_t amplitude) {
+  ImagePtr copy(avifImageCreateEmpty());
+  if (copy == nullptr ||
+      avifImageCopy(copy.get(), &image, AVIF_PLANES_ALL) != AVIF_RESULT_OK) {
+    return nullptr;
+  }
+  AddNoise(copy.get(), amplitude, /*seed=*/amplitude);
+  return copy;
+}
+
+class DistortionParamTest
+    : public testing::TestWithParam<std::tuple<int, avifPixelFormat, int>> {};
+
+TEST_P(DistortionParamTest, Identical) {
+  const int depth = std::get<0>(GetParam());
+  const avifPixelFormat format = std::get<1>(GetParam());
+  const int max_threads = std::get<2>(GetParam());
+  ImagePtr image = testutil::CreateImage(67, 45, depth, format,
+                                         AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  testutil::FillImageGradient(image.get());
+  ImagePtr copy = CreateNoisyCopy(*image, /*amplitude=*/0);
+  ASSERT_NE(copy, nullptr);
+
+  avifImageDistortion distortion;
+  ASSERT_EQ(avifImageComputeDistortion(image.get(), copy.get(),
+                                       AVIF_PLANES_ALL, max_threads,
+                                       &distortion),
+            AVIF_RESULT_OK);
+  for (int c : {AVIF_CHAN_Y, AVIF_CHAN_U, AVIF_CHAN_V, AVIF_CHAN_A}) {
+    if (avifImagePlane(image.get(), c) == nullptr) {
+      EXPECT_EQ(distortion.psnr[c], 0.0);
+      EXPECT_EQ(distortion.ssim[c], 0.0);
+    } else {
+      EXPECT_EQ(distortion.psnr[c], 99.0);
+      EXPECT_DOUBLE_EQ(distortion.ssim[c], 1.0);
+    }
+  }
+  EXPECT_EQ(distortion.psnrAll, 99.0);
+  EXPECT_DOUBLE_EQ(distortion.ssimAll, 1.0);
+}
+
+TEST_P(DistortionParamTest, SameAsTestHelper) {
+  const int depth = std::get<0>(GetParam());
+  const avifPixelFormat format = std::get<1>(GetParam());
+  const int max_threads = std::get<2>(GetParam());
+  ImagePtr image = testutil::CreateImage(67, 45, depth, format,
+                                         AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  testutil::FillImageGradient(image.get());
+
+  double previous_psnr = 99.0, previous_ssim = 1.0;
+  for (uint32_t amplitude : {1u, 8u, 64u}) {
+    SCOPED_TRACE(amplitude);
+    ImagePtr noisy = CreateNoisyCopy(*image, amplitude << (depth - 8));
+    ASSERT_NE(noisy, nullptr);
+
+    avifImageDistortion distortion;
+    ASSERT_EQ(avifImageComputeDistortion(image.get(), noisy.get(),
+                                         AVIF_PLANES_ALL, max_threads,
+                                         &distortion),
+              AVIF_RESULT_OK);
+    EXPECT_DOUBLE_EQ(distortion.psnrAll,
+                     testutil::GetPsnr(*image, *noisy, /*ignore_alpha=*/false));
+    EXPECT_LT(distortion.psnrAll, previous_psnr);
+    EXPECT_LT(distortion.ssimAll, previous_ssim);
+    EXPECT_GT(distortion.ssimAll, 0.0);
+    previous_psnr = distortion.psnrAll;
+    previous_ssim = distortion.ssimAll;
+
+    ASSERT_EQ(avifImageComputeDistortion(image.get(), noisy.get(),
+                                         AVIF_PLANES_YUV, max_threads,
+                                         &distortion),
+              AVIF_RESULT_OK);
+    EXPECT_DOUBLE_EQ(distortion.psnrAll,
+                     testutil::GetPsnr(*image, *noisy, /*ignore_alpha=*/true));
+    EXPECT_EQ(distortion.psnr[AVIF_CHAN_A], 0.0);
+
+    // The number of threads does not change the results, besides rounding.
+    avifImageDistortion single_thread_distortion;
+    ASSERT_EQ(avifImageComputeDistortion(image.get(), noisy.get(),
+                                         AVIF_PLANES_YUV, /*maxThreads=*/1,
+                                         &single_thread_distortion),
+              AVIF_RESULT_OK);
+    EXPECT_EQ(distortion.psnrAll, single_thread_distortion.psnrAll);
+    EXPECT_NEAR(distortion.ssimAll, single_thread_distortion.ssimAll, 1e-9);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    All, DistortionParamTest,
+    testing::Combine(testing::Values(8, 10, 12, 16),
+                     testing::Values(AVIF_PIXEL_FORMAT_YUV444,
+                                     AVIF_PIXEL_FORMAT_YUV420,
+                                     AVIF_PIXEL_FORMAT_YUV400),
+                     testing::Values(1, 8)));
+
+// A missing alpha plane is considered opaque.
+TEST(DistortionTest, MissingAlpha) {
+  ImagePtr alpha = testutil::CreateImage(16, 16, 8, AVIF_PIXEL_FORMAT_YUV444,
+                                         AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+  ImagePtr no_alpha = testutil::CreateImage(
+      16, 16, 8, AVIF_PIXEL_FORMAT_YUV444, AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(alpha, nullptr);
+  ASSERT_NE(no_alpha, nullptr);
+  const uint32_t yuva[] = {10, 128, 128, 255};
+  testutil::FillImagePlain(alpha.get(), yuva);
+  testutil::FillImagePlain(no_alpha.get(), yuva);
+
+  avifImageDistortion distortion;
+  ASSERT_EQ(avifImageComputeDistortion(alpha.get(), no_alpha.get(),
+                                       AVIF_PLANES_ALL, /*maxThreads=*/1,
+                                       &distortion),
+            AVIF_RESULT_OK);
+  EXPECT_EQ(distortion.psnr[AVIF_CHAN_A], 99.0);
+
+  const uint32_t translucent[] = {10, 128, 128, 0};
+  testutil::FillImagePlain(alpha.get(), translucent);
+  ASSERT_EQ(avifImageComputeDistortion(no_alpha.get(), alpha.get(),
+                                       AVIF_PLANES_ALL, /*maxThreads=*/1,
+                                       &distortion),
+            AVIF_RESULT_OK);
+  EXPECT_EQ(distortion.psnr[AVIF_CHAN_Y], 99.0);
+  EXPECT_LT(distortion.psnr[AVIF_CHAN_A], 1.0);
+  EXPECT_LT(distortion.ssim[AVIF_CHAN_A], 0.01);
+}
+
+// The SIMD kernels give the same sums as the scalar loops, including for the
+// largest differences and for rows longer than the 32-bit accumulation blocks.
+TEST(DistortionTest, SIMDMatchesScalar) {
+  for (int depth : {8, 10, 12}) {
+    for (uint32_t width : {67u, 1100u}) {
+      SCOPED_TRACE("depth " + std::to_string(depth) + " width " +
+                   std::to_string(width));
+      ImagePtr image = testutil::CreateImage(width, 21, depth,
+                                             AVIF_PIXEL_FORMAT_YUV420,
+                                             AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+      ASSERT_NE(image, nullptr);
+      testutil::FillImageGradient(image.get());
+      ImagePtr noisy = CreateNoisyCopy(*image, 40u << (depth - 8));
+      ASSERT_NE(noisy, nullptr);
+      ImagePtr black = testutil::CreateImage(width, 21, depth,
+                                             AVIF_PIXEL_FORMAT_YUV420,
+                                             AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+      ImagePtr white = testutil::CreateImage(width, 21, depth,
+                                             AVIF_PIXEL_FORMAT_YUV420,
+                                             AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+      ASSERT_NE(black, nullptr);
+      ASSERT_NE(white, nullptr);
+      const uint32_t max_value = (1u << depth) - 1;
+      const uint32_t zeros[] = {0, 0, 0, 0};
+      const uint32_t maxima[] = {max_value, max_value, max_value, max_value};
+      testutil::FillImagePlain(black.get(), zeros);
+      testutil::FillImagePlain(white.get(), maxima);
+
+      for (auto [image1, image2] :
+           {std::make_pair(image.get(), noisy.get()),
+            std::make_pair(black.get(), white.get())}) {
+        avifSetCPUMask(0);
+        avifImageDistortion expected;
+        ASSERT_EQ(avifImageComputeDistortion(image1, image2, AVIF_PLANES_ALL,
+                                             /*maxThreads=*/1, &expected),
+                  AVIF_RESULT_OK);
+        for (uint32_t mask : {AVIF_CPU_SSE2, AVIF_CPU_ALL}) {
+          avifSetCPUMask(mask);
+          avifImageDistortion distortion;
+          ASSERT_EQ(
+              avifImageComputeDistortion(image1, image2, AVIF_PLANES_ALL,
+                                         /*maxThreads=*/1, &distortion),
+              AVIF_RESULT_OK);
+          for (int c : {AVIF_CHAN_Y, AVIF_CHAN_U, AVIF_CHAN_V, AVIF_CHAN_A}) {
+            EXPECT_EQ(distortion.psnr[c], expected.psnr[c]) << mask;
+            EXPECT_EQ(distortion.ssim[c], expected.ssim[c]) << mask;
+          }
+        }
+        avifSetCPUMask(AVIF_CPU_ALL);
+      }
+    }
+  }
+}
+
+TEST(DistortionTest, InvalidArguments) {
+  ImagePtr image = testutil::CreateImage(16, 16, 8, AVIF_PIXEL_FORMAT_YUV444,
+                                         AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ImagePtr other_size = testutil::CreateImage(
+      16, 15, 8, AVIF_PIXEL_FORMAT_YUV444, AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ImagePtr other_format = testutil::CreateImage(
+      16, 16, 8, AVIF_PIXEL_FORMAT_YUV420, AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ImagePtr other_depth = testutil::CreateImage(
+      16, 16, 10, AVIF_PIXEL_FORMAT_YUV444, AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ImagePtr empty(avifImageCreateEmpty());
+  ASSERT_NE(image, nullptr);
+  ASSERT_NE(other_size, nullptr);
+  ASSERT_NE(other_format, nullptr);
+  ASSERT_NE(other_depth, nullptr);
+  ASSERT_NE(empty, nullptr);
+
+  avifImageDistortion distortion;
+  for (const avifImage* other :
+       {other_size.get(), other_format.get(), other_depth.get()}) {
+    EXPECT_EQ(avifImageComputeDistortion(image.get(), other, AVIF_PLANES_ALL,
+                                         /*maxThreads=*/1, &distortion),
+              AVIF_RESULT_INVALID_ARGUMENT);
+  }
+  EXPECT_EQ(avifImageComputeDistortion(empty.get(), empty.get(),
+                                       AVIF_PLANES_ALL, /*maxThreads=*/1,
+                                       &distortion),
+            AVIF_RESULT_INVALID_ARGUMENT);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace
+}  // namespace avif
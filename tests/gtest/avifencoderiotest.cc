@@ -0,0 +1,259 @@
+// Copyright 2026 Google LLC
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "avif/avif.h"
+#include "aviftest_helpers.h"
+#include "gtest/gtest.h"
+
+namespace avif {
+namespace {
+
+//------------------------------------------------------------------------------
+
+// Writes to a growing buffer and records the size of the written data after
+// each avifEncoderAddImage() call.
+struct MemoryWriter {
+  avifIO io;
+  std::vector<uint8_t> bytes;
+  size_t num_writes = 0;
+};
+
+avifResult MemoryWriterWrite(avifIO* io, uint32_t write_flags, uint64_t offset,
+                             const uint8_t* data, size_t size) {
+  if (write_flags != 0) return AVIF_RESULT_IO_ERROR;
+  MemoryWriter* writer = reinterpret_cast<MemoryWriter*>(io->data);
+  if (offset + size > writer->bytes.size()) {
+    writer->bytes.resize(offset + size);
+  }
+  std::memcpy(writer->bytes.data() + offset, data, size);
+  ++writer->num_writes;
+  return AVIF_RESULT_OK;
+}
+
+// Encodes num_frames frames with the given encoder settings, either to memory
+// or to writer if not null.
+void EncodeSequence(int num_frames, bool alpha, int max_threads,
+                    MemoryWriter* writer, testutil::AvifRwData* output,
+                    std::vector<size_t>* written_sizes) {
+  EncoderPtr encoder(avifEncoderCreate());
+  ASSERT_NE(encoder, nullptr);
+  encoder->speed = AVIF_SPEED_FASTEST;
+  encoder->timescale = 30;
+  encoder->maxThreads = max_threads;
+  if (writer != nullptr) {
+    ASSERT_EQ(avifEncoderSetIO(encoder.get(), &writer->io), AVIF_RESULT_OK);
+  }
+  ImagePtr image = testutil::CreateImage(
+      64, 48, 8, AVIF_PIXEL_FORMAT_YUV420,
+      alpha ? AVIF_PLANES_ALL : AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  const uint8_t exif[] = {'I', 'I', 42, 0, 8, 0, 0, 0, 0, 0};
+  ASSERT_EQ(avifImageSetMetadataExif(image.get(), exif, sizeof(exif)),
+            AVIF_RESULT_OK);
+  for (int i = 0; i < num_frames; ++i) {
+    testutil::FillImageGradient(image.get(), /*offset=*/i * 8);
+    ASSERT_EQ(avifEncoderAddImage(encoder.get(), image.get(),
+                                  /*durationInTimescales=*/1 + i % 2,
+                                  AVIF_ADD_IMAGE_FLAG_NONE),
+              AVIF_RESULT_OK);
+    if (writer != nullptr) written_sizes->push_back(writer->bytes.size());
+  }
+  ASSERT_EQ(avifEncoderFinish(encoder.get(), output), AVIF_RESULT_OK);
+}
+
+void ExpectSameSequence(const uint8_t* data, size_t size,
+                        const testutil::AvifRwData& reference) {
+  DecoderPtr decoder(avifDecoderCreate());
+  ASSERT_NE(decoder, nullptr);
+  ASSERT_EQ(avifDecoderSetIOMemory(decoder.get(), data, size), AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK)
+      << decoder->diag.error;
+  DecoderPtr reference_decoder(avifDecoderCreate());
+  ASSERT_NE(reference_decoder, nullptr);
+  ASSERT_EQ(avifDecoderSetIOMemory(reference_decoder.get(), reference.data,
+                                   reference.size),
+            AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderParse(reference_decoder.get()), AVIF_RESULT_OK);
+
+  ASSERT_EQ(decoder->imageCount, reference_decoder->imageCount);
+  EXPECT_EQ(decoder->alphaPresent, reference_decoder->alphaPresent);
+  EXPECT_EQ(decoder->image->exif.size, reference_decoder->image->exif.size);
+  for (int i = 0; i < reference_decoder->imageCount; ++i) {
+    SCOPED_TRACE(i);
+    EXPECT_EQ(avifDecoderIsKeyframe(decoder.get(), i),
+              avifDecoderIsKeyframe(reference_decoder.get(), i));
+    ASSERT_EQ(avifDecoderNextImage(decoder.get()), AVIF_RESULT_OK);
+    ASSERT_EQ(avifDecoderNextImage(reference_decoder.get()), AVIF_RESULT_OK);
+    EXPECT_EQ(decoder->imageTiming.pts, reference_decoder->imageTiming.pts);
+    EXPECT_EQ(decoder->imageTiming.duration,
+              reference_decoder->imageTiming.duration);
+    EXPECT_TRUE(
+        testutil::AreImagesEqual(*decoder->image, *reference_decoder->image));
+  }
+}
+
+TEST(EncoderIOTest, InvalidArguments) {
+  EncoderPtr encoder(avifEncoderCreate());
+  ASSERT_NE(encoder, nullptr);
+  avifIO reader = {};
+  EXPECT_EQ(avifEncoderSetIO(encoder.get(), &reader),
+            AVIF_RESULT_INVALID_ARGUMENT);
+  EXPECT_EQ(avifEncoderSetIOFile(encoder.get(),
+                                 (testing::TempDir() + "/no/such/dir.avif")
+                                     .c_str()),
+            AVIF_RESULT_IO_ERROR);
+  EXPECT_EQ(avifEncoderSetIO(encoder.get(), nullptr), AVIF_RESULT_OK);
+}
+
+void SetDestroyed(avifIO* io) { *reinterpret_cast<bool*>(io->data) = true; }
+
+// avifEncoderReset() releases the avifIO.
+TEST(EncoderIOTest, ReleasedByReset) {
+  EncoderPtr encoder(avifEncoderCreate());
+  ASSERT_NE(encoder, nullptr);
+  bool destroyed = false;
+  avifIO io = {};
+  io.destroy = SetDestroyed;
+  io.write = MemoryWriterWrite;
+  io.data = &destroyed;
+  ASSERT_EQ(avifEncoderSetIO(encoder.get(), &io), AVIF_RESULT_OK);
+  ASSERT_EQ(avifEncoderReset(encoder.get()), AVIF_RESULT_OK);
+  EXPECT_TRUE(destroyed);
+  EXPECT_EQ(encoder->io, nullptr);
+}
+
+class EncoderIOSequenceTest
+    : public testing::TestWithParam<std::tuple<int, bool, int>> {};
+
+TEST_P(EncoderIOSequenceTest, SameAsMemory) {
+  if (!testutil::Av1EncoderAvailable() || !testutil::Av1DecoderAvailable()) {
+    GTEST_SKIP() << "AV1 Codec unavailable, skip test.";
+  }
+  const int num_frames = std::get<0>(GetParam());
+  const bool alpha = std::get<1>(GetParam());
+  const int max_threads = std::get<2>(GetParam());
+
+  testutil::AvifRwData reference;
+  ASSERT_NO_FATAL_FAILURE(EncodeSequence(num_frames, alpha, max_threads,
+                                         /*writer=*/nullptr, &reference,
+                                         /*written_sizes=*/nullptr));
+
+  MemoryWriter writer;
+  writer.io.write = MemoryWriterWrite;
+  writer.io.data = &writer;
+  testutil::AvifRwData output;
+  std::vector<size_t> written_sizes;
+  ASSERT_NO_FATAL_FAILURE(EncodeSequence(num_frames, alpha, max_threads,
+                                         &writer, &output, &written_sizes));
+  EXPECT_EQ(output.size, 0u);
+  // The samples reach the avifIO while encoding.
+  ASSERT_EQ(written_sizes.size(), static_cast<size_t>(num_frames));
+  EXPECT_LT(written_sizes.front(), written_sizes.back());
+  EXPECT_LT(written_sizes.back(), writer.bytes.size());
+
+  ASSERT_NO_FATAL_FAILURE(
+      ExpectSameSequence(writer.bytes.data(), writer.bytes.size(), reference));
+}
+
+INSTANTIATE_TEST_SUITE_P(All, EncoderIOSequenceTest,
+                         testing::Combine(testing::Values(1, 2, 24),
+                                          testing::Bool(),
+                                          testing::Values(1, 4)));
+
+TEST(EncoderIOTest, File) {
+  if (!testutil::Av1EncoderAvailable() || !testutil::Av1DecoderAvailable()) {
+    GTEST_SKIP() << "AV1 Codec unavailable, skip test.";
+  }
+  testutil::AvifRwData reference;
+  ASSERT_NO_FATAL_FAILURE(EncodeSequence(
+      /*num_frames=*/12, /*alpha=*/true, /*max_threads=*/1,
+      /*writer=*/nullptr, &reference, /*written_sizes=*/nullptr));
+
+  const std::string path = testing::TempDir() + "/avifencoderiotest.avif";
+  EncoderPtr encoder(avifEncoderCreate());
+  ASSERT_NE(encoder, nullptr);
+  encoder->speed = AVIF_SPEED_FASTEST;
+  encoder->timescale = 30;
+  ASSERT_EQ(avifEncoderSetIOFile(encoder.get(), path.c_str()), AVIF_RESULT_OK);
+  ImagePtr image = testutil::CreateImage(64, 48, 8, AVIF_PIXEL_FORMAT_YUV420,
+                                         AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  const uint8_t exif[] = {'I', 'I', 42, 0, 8, 0, 0, 0, 0, 0};
+  ASSERT_EQ(avifImageSetMetadataExif(image.get(), exif, sizeof(exif)),
+            AVIF_RESULT_OK);
+  for (int i = 0; i < 12; ++i) {
+    testutil::FillImageGradient(image.get(), /*offset=*/i * 8);
+    ASSERT_EQ(avifEncoderAddImage(encoder.get(), image.get(), 1 + i % 2,
+                                  AVIF_ADD_IMAGE_FLAG_NONE),
+              AVIF_RESULT_OK);
+  }
+  testutil::AvifRwData output;
+  ASSERT_EQ(avifEncoderFinish(encoder.get(), &output), AVIF_RESULT_OK);
+  EXPECT_EQ(output.size, 0u);
+  encoder.reset();  // Closes the file.
+
+  const testutil::AvifRwData file = testutil::ReadFile(path);
+  ASSERT_NE(file.size, 0u);
+  ASSERT_NO_FATAL_FAILURE(ExpectSameSequence(file.data, file.size, reference));
+}
+
+// A shorter sequence written to the same file after avifEncoderReset() does
+// not keep the trailing bytes of the previous one.
+TEST(EncoderIOTest, FileAfterReset) {
+  if (!testutil::Av1EncoderAvailable() || !testutil::Av1DecoderAvailable()) {
+    GTEST_SKIP() << "AV1 Codec unavailable, skip test.";
+  }
+  const std::string path =
+      testing::TempDir() + "/avifencoderiotest_reset.avif";
+  EncoderPtr encoder(avifEncoderCreate());
+  ASSERT_NE(encoder, nullptr);
+  encoder->speed = AVIF_SPEED_FASTEST;
+  encoder->timescale = 30;
+  ImagePtr image = testutil::CreateImage(64, 48, 8, AVIF_PIXEL_FORMAT_YUV420,
+                                         AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  testutil::FillImageGradient(image.get());
+  testutil::AvifRwData output;
+  size_t previous_file_size = 0;
+  for (int num_frames : {12, 1}) {
+    ASSERT_EQ(avifEncoderSetIOFile(encoder.get(), path.c_str()),
+              AVIF_RESULT_OK);
+    for (int i = 0; i < num_frames; ++i) {
+      ASSERT_EQ(avifEncoderAddImage(encoder.get(), image.get(), 1,
+                                    AVIF_ADD_IMAGE_FLAG_NONE),
+                AVIF_RESULT_OK);
+    }
+    ASSERT_EQ(avifEncoderFinish(encoder.get(), &output), AVIF_RESULT_OK);
+    ASSERT_EQ(avifEncoderReset(encoder.get()), AVIF_RESULT_OK);  // Closes it.
+    const size_t file_size = testutil::ReadFile(path).size;
+    if (previous_file_size != 0) {
+      EXPECT_LT(file_size, previous_file_size);
+    }
+    previous_file_size = file_size;
+  }
+
+  // Without avifEncoderSetIO(), the next image goes to the output.
+  ASSERT_EQ(avifEncoderAddImage(encoder.get(), image.get(), 1,
+                                AVIF_ADD_IMAGE_FLAG_NONE),
+            AVIF_RESULT_OK);
+  ASSERT_EQ(avifEncoderFinish(encoder.get(), &output), AVIF_RESULT_OK);
+  ASSERT_NE(output.size, 0u);
+
+  const testutil::AvifRwData file = testutil::ReadFile(path);
+  DecoderPtr decoder(avifDecoderCreate());
+  ASSERT_NE(decoder, nullptr);
+  ASSERT_EQ(avifDecoderSetIOMemory(decoder.get(), file.data, file.size),
+            AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK);
+  EXPECT_EQ(decoder->imageCount, 1);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace
+}  // namespace avif
@@ -1,7 +1,9 @@
 // Copyright 2023 Google LLC
 // SPDX-License-Identifier: BSD-2-Clause
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -1251,6 +1253,68 @@ TEST(ToneMapTest, ToneMapImageSameHeadroom) {
   }
 }
 
+// The tone mapped image must not depend on the number of threads used to
+// upscale the gain map.
+TEST(ToneMapTest, ToneMapMultithreadedGainMapScaling) {
+  // Tall enough for the rows of the upscaled gain map to be split across
+  // threads.
+  constexpr uint32_t kWidth = 64;
+  constexpr uint32_t kHeight = 160;
+  ImagePtr image(avifImageCreate(kWidth, kHeight, 8, AVIF_PIXEL_FORMAT_YUV444));
+  ASSERT_NE(image, nullptr);
+  image->colorPrimaries = AVIF_COLOR_PRIMARIES_BT709;
+  image->transferCharacteristics = AVIF_TRANSFER_CHARACTERISTICS_SRGB;
+  image->matrixCoefficients = AVIF_MATRIX_COEFFICIENTS_BT601;
+  ASSERT_EQ(avifImageAllocatePlanes(image.get(), AVIF_PLANES_YUV),
+            AVIF_RESULT_OK);
+  testutil::FillImageGradient(image.get());
+
+  // A smooth gain map a quarter of the size of the base image, so that it has
+  // to be upscaled.
+  image->gainMap = avifGainMapCreate();
+  ASSERT_NE(image->gainMap, nullptr);
+  image->gainMap->image = avifImageCreate(kWidth / 4, kHeight / 4, 8,
+                                          AVIF_PIXEL_FORMAT_YUV400);
+  ASSERT_NE(image->gainMap->image, nullptr);
+  ASSERT_EQ(avifImageAllocatePlanes(image->gainMap->image, AVIF_PLANES_YUV),
+            AVIF_RESULT_OK);
+  testutil::FillImageGradient(image->gainMap->image);
+  for (int c = 0; c < 3; ++c) {
+    image->gainMap->gainMapMin[c] = {0, 1};
+    image->gainMap->gainMapMax[c] = {2, 1};
+    image->gainMap->gainMapGamma[c] = {1, 1};
+    image->gainMap->baseOffset[c] = {1, 64};
+    image->gainMap->alternateOffset[c] = {1, 64};
+  }
+  image->gainMap->baseHdrHeadroom = {0, 1};
+  image->gainMap->alternateHdrHeadroom = {2, 1};
+  image->gainMap->useBaseColorSpace = AVIF_TRUE;
+
+  const float headroom = 2.0f;
+  testutil::AvifRgbImage single_threaded(image.get(), 8, AVIF_RGB_FORMAT_RGBA);
+  testutil::AvifRgbImage multithreaded(image.get(), 8, AVIF_RGB_FORMAT_RGBA);
+  multithreaded.maxThreads = 4;
+  for (avifRGBImage* rgb : {static_cast<avifRGBImage*>(&single_threaded),
+                            static_cast<avifRGBImage*>(&multithreaded)}) {
+    avifDiagnostics diag;
+    const avifResult result = avifImageApplyGainMap(
+        image.get(), image->gainMap, headroom, image->colorPrimaries,
+        image->transferCharacteristics, rgb, /*clli=*/nullptr, &diag);
+    ASSERT_EQ(result, AVIF_RESULT_OK)
+        << avifResultToString(result) << " " << diag.error;
+  }
+
+  // The gain map is upscaled by the same scaler whatever the thread count.
+  for (uint32_t y = 0; y < single_threaded.height; ++y) {
+    const uint8_t* row1 =
+        single_threaded.pixels + (size_t)y * single_threaded.rowBytes;
+    const uint8_t* row2 =
+        multithreaded.pixels + (size_t)y * multithreaded.rowBytes;
+    ASSERT_EQ(std::memcmp(row1, row2, single_threaded.width * 4), 0)
+        << "row " << y;
+  }
+}
+
 // avifRGBImage::rowBytes only has to be at least width * pixelSize, so a base
 // image with row padding is a legal input. Check that the "nothing to tone map"
 // early exit honours the source stride instead of assuming it is tight.
@@ -0,0 +1,529 @@
+// Copyright 2026 Google LLC
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "avif/avif.h"
+#include "avif/internal.h"
+#include "aviftest_helpers.h"
+#include "gtest/gtest.h"
+
+using ::testing::Bool;
+using ::testing::Combine;
+using ::testing::Values;
+
+namespace avif {
+namespace {
+
+//------------------------------------------------------------------------------
+// AVIF_RGB_FORMAT_RGBA1010102
+
+class RGBA1010102Test
+    : public testing::TestWithParam<
+          std::tuple</*yuv_depth=*/int, avifPixelFormat, avifChromaUpsampling,
+                     /*has_alpha=*/bool, /*premultiply=*/bool,
+                     /*max_threads=*/int>> {};
+
+// RGBA1010102 pixels are the packed 10-bit RGBA pixels.
+TEST_P(RGBA1010102Test, SameAsRGBA10) {
+  const int yuv_depth = std::get<0>(GetParam());
+  const avifPixelFormat yuv_format = std::get<1>(GetParam());
+  const avifChromaUpsampling upsampling = std::get<2>(GetParam());
+  const bool has_alpha = std::get<3>(GetParam());
+  const bool premultiply = std::get<4>(GetParam());
+  const int max_threads = std::get<5>(GetParam());
+
+  // Taller than a few bands of rows converted at a time.
+  ImagePtr image = testutil::CreateImage(
+      23, 75, yuv_depth, yuv_format,
+      has_alpha ? AVIF_PLANES_ALL : AVIF_PLANES_YUV, AVIF_RANGE_LIMITED);
+  ASSERT_NE(image, nullptr);
+  testutil::FillImageGradient(image.get());
+
+  testutil::AvifRgbImage reference(image.get(), 10, AVIF_RGB_FORMAT_RGBA);
+  reference.chromaUpsampling = upsampling;
+  ASSERT_EQ(avifImageYUVToRGB(image.get(), &reference), AVIF_RESULT_OK);
+
+  testutil::AvifRgbImage rgb(image.get(), 10, AVIF_RGB_FORMAT_RGBA1010102);
+  ASSERT_EQ(avifRGBImagePixelSize(&rgb), 4u);
+  rgb.chromaUpsampling = upsampling;
+  rgb.alphaPremultiplied = premultiply;
+  rgb.maxThreads = max_threads;
+  ASSERT_EQ(avifImageYUVToRGB(image.get(), &rgb), AVIF_RESULT_OK);
+
+  for (uint32_t y = 0; y < rgb.height; ++y) {
+    const uint16_t* expected =
+        reinterpret_cast<const uint16_t*>(reference.pixels +
+                                          y * reference.rowBytes);
+    const uint32_t* actual =
+        reinterpret_cast<const uint32_t*>(rgb.pixels + y * rgb.rowBytes);
+    for (uint32_t x = 0; x < rgb.width; ++x, expected += 4) {
+      const uint32_t alpha = (expected[3] * 3u + 511u) / 1023u;
+      // Premultiplied colors are premultiplied by the stored 2-bit alpha.
+      uint32_t rgb_samples[3];
+      for (int c = 0; c < 3; ++c) {
+        rgb_samples[c] =
+            premultiply ? (expected[c] * alpha + 1) / 3 : expected[c];
+      }
+      ASSERT_EQ(actual[x], rgb_samples[0] | (rgb_samples[1] << 10) |
+                               (rgb_samples[2] << 20) | (alpha << 30))
+          << "at " << x << "," << y;
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    All, RGBA1010102Test,
+    Combine(/*yuv_depth=*/Values(8, 10, 12),
+            Values(AVIF_PIXEL_FORMAT_YUV444, AVIF_PIXEL_FORMAT_YUV422,
+                   AVIF_PIXEL_FORMAT_YUV420, AVIF_PIXEL_FORMAT_YUV400),
+            Values(AVIF_CHROMA_UPSAMPLING_AUTOMATIC,
+                   AVIF_CHROMA_UPSAMPLING_NEAREST),
+            /*has_alpha=*/Bool(), /*premultiply=*/Bool(),
+            /*max_threads=*/Values(1, 3)));
+
+// Unpremultiplying the stored pixels gives back the colors, also when the
+// image is premultiplied.
+TEST(RGBA1010102FormatTest, PremultipliedByStoredAlpha) {
+  ImagePtr image = testutil::CreateImage(
+      8, 8, 10, AVIF_PIXEL_FORMAT_YUV444, AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  // The 10-bit alpha 400 is stored as the 2-bit alpha 1.
+  const uint32_t yuva[] = {300, 512, 512, 400};
+  testutil::FillImagePlain(image.get(), yuva);
+  for (bool image_premultiplied : {false, true}) {
+    SCOPED_TRACE(image_premultiplied);
+    image->alphaPremultiplied = image_premultiplied;
+    testutil::AvifRgbImage reference(image.get(), 10, AVIF_RGB_FORMAT_RGBA);
+    ASSERT_EQ(avifImageYUVToRGB(image.get(), &reference), AVIF_RESULT_OK);
+    const uint16_t gray =
+        reinterpret_cast<const uint16_t*>(reference.pixels)[0];
+
+    testutil::AvifRgbImage rgb(image.get(), 10, AVIF_RGB_FORMAT_RGBA1010102);
+    rgb.alphaPremultiplied = AVIF_TRUE;
+    ASSERT_EQ(avifImageYUVToRGB(image.get(), &rgb), AVIF_RESULT_OK);
+    const uint32_t pixel = reinterpret_cast<const uint32_t*>(rgb.pixels)[0];
+    EXPECT_EQ(pixel >> 30, 1u);
+    EXPECT_EQ(pixel & 0x3FF, (gray + 1u) / 3u);
+    EXPECT_NEAR((pixel & 0x3FF) * 3.0, gray, 1.5);
+  }
+}
+
+TEST(RGBA1010102FormatTest, IgnoreAlphaAndInvalid) {
+  ImagePtr image = testutil::CreateImage(
+      8, 8, 10, AVIF_PIXEL_FORMAT_YUV420, AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  const uint32_t yuva[] = {512, 512, 512, 0};
+  testutil::FillImagePlain(image.get(), yuva);
+
+  testutil::AvifRgbImage rgb(image.get(), 10, AVIF_RGB_FORMAT_RGBA1010102);
+  rgb.ignoreAlpha = AVIF_TRUE;
+  ASSERT_EQ(avifImageYUVToRGB(image.get(), &rgb), AVIF_RESULT_OK);
+  // The image is rendered on black and the alpha bits are all 1.
+  EXPECT_EQ(reinterpret_cast<const uint32_t*>(rgb.pixels)[0], 3u << 30);
+
+  // Only 10-bit conversions to RGB are supported.
+  EXPECT_EQ(avifImageRGBToYUV(image.get(), &rgb),
+            AVIF_RESULT_REFORMAT_FAILED);
+  rgb.depth = 8;
+  EXPECT_EQ(avifImageYUVToRGB(image.get(), &rgb),
+            AVIF_RESULT_REFORMAT_FAILED);
+}
+
+// The SIMD kernels pack the same pixels as the scalar loop, for alpha values
+// around the 2-bit thresholds and for any row length.
+TEST(RGBA1010102FormatTest, SIMDMatchesScalar) {
+  for (int depth : {10, 12}) {
+    for (uint32_t width : {1u, 3u, 4u, 7u, 8u, 9u, 17u, 67u}) {
+      ImagePtr image = testutil::CreateImage(width, 5, depth,
+                                             AVIF_PIXEL_FORMAT_YUV444,
+                                             AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+      ASSERT_NE(image, nullptr);
+      std::mt19937 engine(width);
+      std::uniform_int_distribution<uint32_t> distribution(
+          0, (1u << depth) - 1);
+      // 10-bit alpha values on both sides of the 2-bit alpha thresholds.
+      const uint16_t kAlphas[] = {0, 170, 171, 511, 512, 852, 853, 1023};
+      for (int c : {AVIF_CHAN_Y, AVIF_CHAN_U, AVIF_CHAN_V, AVIF_CHAN_A}) {
+        for (uint32_t y = 0; y < image->height; ++y) {
+          uint16_t* row = reinterpret_cast<uint16_t*>(
+              avifImagePlane(image.get(), c) +
+              y * avifImagePlaneRowBytes(image.get(), c));
+          for (uint32_t x = 0; x < image->width; ++x) {
+            row[x] = (c == AVIF_CHAN_A && depth == 10)
+                         ? kAlphas[(x + y) % 8]
+                         : static_cast<uint16_t>(distribution(engine));
+          }
+        }
+      }
+      for (bool ignore_alpha : {false, true}) {
+        for (bool premultiply : {false, true}) {
+          SCOPED_TRACE("depth " + std::to_string(depth) + " width " +
+                       std::to_string(width) + " ignore_alpha " +
+                       std::to_string(ignore_alpha) + " premultiply " +
+                       std::to_string(premultiply));
+          testutil::AvifRgbImage expected(image.get(), 10,
+                                          AVIF_RGB_FORMAT_RGBA1010102);
+          expected.ignoreAlpha = ignore_alpha;
+          expected.alphaPremultiplied = premultiply;
+          avifSetCPUMask(0);
+          ASSERT_EQ(avifImageYUVToRGB(image.get(), &expected),
+                    AVIF_RESULT_OK);
+          for (uint32_t mask : {AVIF_CPU_SSE2, AVIF_CPU_ALL}) {
+            testutil::AvifRgbImage rgb(image.get(), 10,
+                                       AVIF_RGB_FORMAT_RGBA1010102);
+            rgb.ignoreAlpha = ignore_alpha;
+            rgb.alphaPremultiplied = premultiply;
+            avifSetCPUMask(mask);
+            ASSERT_EQ(avifImageYUVToRGB(image.get(), &rgb), AVIF_RESULT_OK);
+            for (uint32_t y = 0; y < rgb.height; ++y) {
+              ASSERT_EQ(std::memcmp(rgb.pixels + y * rgb.rowBytes,
+                                    expected.pixels + y * expected.rowBytes,
+                                    rgb.width * 4),
+                        0)
+                  << "mask " << mask << " row " << y;
+            }
+          }
+          avifSetCPUMask(AVIF_CPU_ALL);
+        }
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// avifImageToSemiPlanar()
+
+class SemiPlanarTest
+    : public testing::TestWithParam<std::tuple<
+          /*depth=*/int, avifPixelFormat, /*width=*/uint32_t,
+          /*cpu_mask=*/uint32_t>> {
+ protected:
+  void TearDown() override { avifSetCPUMask(AVIF_CPU_ALL); }
+};
+
+TEST_P(SemiPlanarTest, Samples) {
+  const int depth = std::get<0>(GetParam());
+  const avifPixelFormat yuv_format = std::get<1>(GetParam());
+  const uint32_t width = std::get<2>(GetParam());
+  avifSetCPUMask(std::get<3>(GetParam()));
+  ImagePtr image = testutil::CreateImage(width, 9, depth, yuv_format,
+                                         AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  testutil::FillImageGradient(image.get());
+  // Make the V samples differ from the U samples.
+  for (uint32_t y = 0; y < avifImagePlaneHeight(image.get(), AVIF_CHAN_V);
+       ++y) {
+    uint8_t* row = avifImagePlane(image.get(), AVIF_CHAN_V) +
+                   y * avifImagePlaneRowBytes(image.get(), AVIF_CHAN_V);
+    for (uint32_t x = 0; x < avifImagePlaneWidth(image.get(), AVIF_CHAN_V);
+         ++x) {
+      if (depth > 8) {
+        uint16_t* sample = reinterpret_cast<uint16_t*>(row) + x;
+        *sample = static_cast<uint16_t>((1u << depth) - 1u - *sample);
+      } else {
+        row[x] = static_cast<uint8_t>(255 - row[x]);
+      }
+    }
+  }
+
+  const uint32_t sample_size = depth > 8 ? 2 : 1;
+  const uint32_t uv_width = avifImagePlaneWidth(image.get(), AVIF_CHAN_U);
+  const uint32_t uv_height = avifImagePlaneHeight(image.get(), AVIF_CHAN_U);
+  // Padded rows.
+  const uint32_t y_row_bytes = (image->width + 3) * sample_size;
+  const uint32_t uv_row_bytes = (uv_width * 2 + 5) * sample_size;
+  std::vector<uint8_t> y_plane(y_row_bytes * image->height);
+  std::vector<uint8_t> uv_plane(uv_row_bytes * uv_height);
+  ASSERT_EQ(avifImageToSemiPlanar(image.get(), y_plane.data(), y_row_bytes,
+                                  uv_plane.data(), uv_row_bytes),
+            AVIF_RESULT_OK);
+
+  // Samples are in the most significant bits of high bit depth formats.
+  const uint32_t shift = depth > 8 ? 16 - depth : 0;
+  auto sample = [&](const uint8_t* row, uint32_t x) -> uint32_t {
+    return sample_size == 1 ? row[x]
+                            : reinterpret_cast<const uint16_t*>(row)[x];
+  };
+  for (uint32_t y = 0; y < image->height; ++y) {
+    const uint8_t* src = avifImagePlane(image.get(), AVIF_CHAN_Y) +
+                         y * avifImagePlaneRowBytes(image.get(), AVIF_CHAN_Y);
+    for (uint32_t x = 0; x < image->width; ++x) {
+      ASSERT_EQ(sample(&y_plane[y * y_row_bytes], x), sample(src, x) << shift);
+    }
+  }
+  for (uint32_t y = 0; y < uv_height; ++y) {
+    const uint8_t* u = avifImagePlane(image.get(), AVIF_CHAN_U) +
+                       y * avifImagePlaneRowBytes(image.get(), AVIF_CHAN_U);
+    const uint8_t* v = avifImagePlane(image.get(), AVIF_CHAN_V) +
+                       y * avifImagePlaneRowBytes(image.get(), AVIF_CHAN_V);
+    for (uint32_t x = 0; x < uv_width; ++x) {
+      ASSERT_EQ(sample(&uv_plane[y * uv_row_bytes], 2 * x),
+                sample(u, x) << shift);
+      ASSERT_EQ(sample(&uv_plane[y * uv_row_bytes], 2 * x + 1),
+                sample(v, x) << shift);
+    }
+  }
+}
+
+// The widths cover the SIMD kernels and their tails.
+INSTANTIATE_TEST_SUITE_P(
+    All, SemiPlanarTest,
+    Combine(/*depth=*/Values(8, 10, 12, 16),
+            Values(AVIF_PIXEL_FORMAT_YUV444, AVIF_PIXEL_FORMAT_YUV422,
+                   AVIF_PIXEL_FORMAT_YUV420),
+            /*width=*/Values(13u, 70u),
+            /*cpu_mask=*/Values(0u, uint32_t{AVIF_CPU_SSE2},
+                                uint32_t{AVIF_CPU_ALL})));
+
+TEST(SemiPlanarInvalidTest, Arguments) {
+  ImagePtr image = testutil::CreateImage(
+      16, 16, 10, AVIF_PIXEL_FORMAT_YUV420, AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  std::vector<uint8_t> y_plane(16 * 16 * 2);
+  std::vector<uint8_t> uv_plane(16 * 8 * 2);
+  EXPECT_EQ(avifImageToSemiPlanar(image.get(), y_plane.data(), 32,
+                                  uv_plane.data(), 32),
+            AVIF_RESULT_OK);
+  // Rows too small for 16-bit samples.
+  EXPECT_EQ(avifImageToSemiPlanar(image.get(), y_plane.data(), 16,
+                                  uv_plane.data(), 32),
+            AVIF_RESULT_INVALID_ARGUMENT);
+  EXPECT_EQ(avifImageToSemiPlanar(image.get(), y_plane.data(), 32,
+                                  uv_plane.data(), 16),
+            AVIF_RESULT_INVALID_ARGUMENT);
+
+  ImagePtr gray = testutil::CreateImage(
+      16, 16, 10, AVIF_PIXEL_FORMAT_YUV400, AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(gray, nullptr);
+  EXPECT_EQ(avifImageToSemiPlanar(gray.get(), y_plane.data(), 32,
+                                  uv_plane.data(), 32),
+            AVIF_RESULT_INVALID_ARGUMENT);
+}
+
+//------------------------------------------------------------------------------
+// Half floats (avifRGBImage::isFloat)
+
+// Returns the value of the half float f16. Negative values are not handled.
+float F16ToFloat(uint16_t f16) {
+  const int exponent = (f16 >> 10) & 0x1F;
+  const int mantissa = f16 & 0x3FF;
+  return exponent == 0 ? std::ldexp(static_cast<float>(mantissa), -24)
+                       : std::ldexp(static_cast<float>(mantissa | 0x400),
+                                    exponent - 25);
+}
+
+class F16Test
+    : public testing::TestWithParam<
+          std::tuple</*yuv_depth=*/int, avifPixelFormat, avifRGBFormat,
+                     /*premultiply=*/bool, /*max_threads=*/int>> {};
+
+// Half float pixels have the values of the 16-bit integer pixels, normalized.
+TEST_P(F16Test, SameAsRGB16) {
+  const int yuv_depth = std::get<0>(GetParam());
+  const avifPixelFormat yuv_format = std::get<1>(GetParam());
+  const avifRGBFormat format = std::get<2>(GetParam());
+  const bool premultiply = std::get<3>(GetParam());
+  const int max_threads = std::get<4>(GetParam());
+
+  // Taller than a few bands of rows converted at a time.
+  ImagePtr image = testutil::CreateImage(23, 75, yuv_depth, yuv_format,
+                                         AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  testutil::FillImageGradient(image.get());
+
+  testutil::AvifRgbImage reference(image.get(), 16, format);
+  reference.alphaPremultiplied = premultiply;
+  ASSERT_EQ(avifImageYUVToRGB(image.get(), &reference), AVIF_RESULT_OK);
+
+  testutil::AvifRgbImage rgb(image.get(), 16, format);
+  rgb.isFloat = AVIF_TRUE;
+  rgb.alphaPremultiplied = premultiply;
+  rgb.maxThreads = max_threads;
+  ASSERT_EQ(avifImageYUVToRGB(image.get(), &rgb), AVIF_RESULT_OK);
+
+  const uint32_t sample_count =
+      rgb.width * avifRGBFormatChannelCount(rgb.format);
+  for (uint32_t y = 0; y < rgb.height; ++y) {
+    const uint16_t* expected = reinterpret_cast<const uint16_t*>(
+        reference.pixels + y * reference.rowBytes);
+    const uint16_t* actual =
+        reinterpret_cast<const uint16_t*>(rgb.pixels + y * rgb.rowBytes);
+    for (uint32_t i = 0; i < sample_count; ++i) {
+      // Half floats have 11 significant bits.
+      const float value = expected[i] / 65535.0f;
+      ASSERT_NEAR(F16ToFloat(actual[i]), value, value / 1024 + 1e-7f)
+          << "at sample " << i << " of row " << y;
+    }
+  }
+
+  // The half floats are converted back to the 16-bit values they represent.
+  ImagePtr from_rgb = testutil::CreateImage(23, 75, yuv_depth, yuv_format,
+                                            AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+  ASSERT_NE(from_rgb, nullptr);
+  ASSERT_EQ(avifImageRGBToYUV(from_rgb.get(), &rgb), AVIF_RESULT_OK);
+  testutil::AvifRgbImage rounded(image.get(), 16, format);
+  rounded.alphaPremultiplied = premultiply;
+  for (uint32_t y = 0; y < rgb.height; ++y) {
+    const uint16_t* f16 =
+        reinterpret_cast<const uint16_t*>(rgb.pixels + y * rgb.rowBytes);
+    uint16_t* row =
+        reinterpret_cast<uint16_t*>(rounded.pixels + y * rounded.rowBytes);
+    for (uint32_t i = 0; i < sample_count; ++i) {
+      row[i] = static_cast<uint16_t>(std::lround(F16ToFloat(f16[i]) * 65535));
+    }
+  }
+  ImagePtr from_rounded = testutil::CreateImage(
+      23, 75, yuv_depth, yuv_format, AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+  ASSERT_NE(from_rounded, nullptr);
+  ASSERT_EQ(avifImageRGBToYUV(from_rounded.get(), &rounded), AVIF_RESULT_OK);
+  EXPECT_TRUE(testutil::AreImagesEqual(*from_rgb, *from_rounded));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    All, F16Test,
+    Combine(/*yuv_depth=*/Values(8, 10, 12),
+            Values(AVIF_PIXEL_FORMAT_YUV444, AVIF_PIXEL_FORMAT_YUV420,
+                   AVIF_PIXEL_FORMAT_YUV400),
+            Values(AVIF_RGB_FORMAT_RGBA, AVIF_RGB_FORMAT_BGR,
+                   AVIF_RGB_FORMAT_GRAYA),
+            /*premultiply=*/Bool(), /*max_threads=*/Values(1, 3)));
+
+// The alpha samples are left untouched with ignoreAlpha.
+TEST(F16IgnoreAlphaTest, AlphaUntouched) {
+  ImagePtr image = testutil::CreateImage(37, 45, 10, AVIF_PIXEL_FORMAT_YUV420,
+                                         AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  testutil::FillImageGradient(image.get());
+  for (avifRGBFormat format : {AVIF_RGB_FORMAT_RGBA, AVIF_RGB_FORMAT_ARGB,
+                               AVIF_RGB_FORMAT_AGRAY}) {
+    SCOPED_TRACE(format);
+    testutil::AvifRgbImage reference(image.get(), 16, format);
+    reference.ignoreAlpha = AVIF_TRUE;
+    ASSERT_EQ(avifImageYUVToRGB(image.get(), &reference), AVIF_RESULT_OK);
+
+    testutil::AvifRgbImage rgb(image.get(), 16, format);
+    rgb.isFloat = AVIF_TRUE;
+    rgb.ignoreAlpha = AVIF_TRUE;
+    constexpr uint16_t kAlpha = 0x1234;
+    const uint32_t channel_count = avifRGBFormatChannelCount(format);
+    const uint32_t alpha_index =
+        (format == AVIF_RGB_FORMAT_RGBA) ? channel_count - 1 : 0;
+    const uint32_t sample_count = rgb.width * channel_count;
+    for (uint32_t y = 0; y < rgb.height; ++y) {
+      uint16_t* row =
+          reinterpret_cast<uint16_t*>(rgb.pixels + y * rgb.rowBytes);
+      for (uint32_t i = 0; i < sample_count; ++i) row[i] = kAlpha;
+    }
+    ASSERT_EQ(avifImageYUVToRGB(image.get(), &rgb), AVIF_RESULT_OK);
+
+    for (uint32_t y = 0; y < rgb.height; ++y) {
+      const uint16_t* expected = reinterpret_cast<const uint16_t*>(
+          reference.pixels + y * reference.rowBytes);
+      const uint16_t* actual =
+          reinterpret_cast<const uint16_t*>(rgb.pixels + y * rgb.rowBytes);
+      for (uint32_t i = 0; i < sample_count; ++i) {
+        if (i % channel_count == alpha_index) {
+          ASSERT_EQ(actual[i], kAlpha) << "at sample " << i << " of row " << y;
+        } else {
+          const float value = expected[i] / 65535.0f;
+          ASSERT_NEAR(F16ToFloat(actual[i]), value, value / 1024 + 1e-7f)
+              << "at sample " << i << " of row " << y;
+        }
+      }
+    }
+  }
+}
+
+// Half floats outside of [0, 1] are clamped when converting to YUV.
+TEST(F16RangeTest, Clamped) {
+  ImagePtr image = testutil::CreateImage(4, 1, 10, AVIF_PIXEL_FORMAT_YUV444,
+                                         AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  testutil::AvifRgbImage rgb(image.get(), 16, AVIF_RGB_FORMAT_GRAY);
+  rgb.isFloat = AVIF_TRUE;
+  // -1, 0, 2 and infinity.
+  const uint16_t pixels[4] = {0xBC00, 0x0000, 0x4000, 0x7C00};
+  std::memcpy(rgb.pixels, pixels, sizeof(pixels));
+  ASSERT_EQ(avifImageRGBToYUV(image.get(), &rgb), AVIF_RESULT_OK);
+  const uint16_t* y_row =
+      reinterpret_cast<const uint16_t*>(image->yuvPlanes[AVIF_CHAN_Y]);
+  EXPECT_EQ(y_row[0], 0u);
+  EXPECT_EQ(y_row[1], 0u);
+  EXPECT_EQ(y_row[2], 1023u);
+  EXPECT_EQ(y_row[3], 1023u);
+}
+
+// The SIMD kernels give the same half floats as the scalar code.
+TEST(F16SIMDTest, MatchesScalar) {
+  ImagePtr image = testutil::CreateImage(37, 20, 12, AVIF_PIXEL_FORMAT_YUV444,
+                                         AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  testutil::FillImageGradient(image.get());
+  for (avifRGBFormat format :
+       {AVIF_RGB_FORMAT_RGBA, AVIF_RGB_FORMAT_ARGB, AVIF_RGB_FORMAT_RGB,
+        AVIF_RGB_FORMAT_GRAYA, AVIF_RGB_FORMAT_AGRAY}) {
+    for (bool ignore_alpha : {false, true}) {
+      SCOPED_TRACE(testing::Message() << "format " << format
+                                      << " ignore_alpha " << ignore_alpha);
+      avifSetCPUMask(0);
+      testutil::AvifRgbImage reference(image.get(), 16, format);
+      reference.isFloat = AVIF_TRUE;
+      reference.ignoreAlpha = ignore_alpha;
+      reference.avoidLibYUV = AVIF_TRUE;
+      std::memset(reference.pixels, 0x5A,
+                  reference.rowBytes * reference.height);
+      ASSERT_EQ(avifImageYUVToRGB(image.get(), &reference), AVIF_RESULT_OK);
+      for (uint32_t cpu_mask : {AVIF_CPU_SSE2, AVIF_CPU_ALL}) {
+        avifSetCPUMask(cpu_mask);
+        testutil::AvifRgbImage rgb(image.get(), 16, format);
+        rgb.isFloat = AVIF_TRUE;
+        rgb.ignoreAlpha = ignore_alpha;
+        rgb.avoidLibYUV = AVIF_TRUE;
+        std::memset(rgb.pixels, 0x5A, rgb.rowBytes * rgb.height);
+        ASSERT_EQ(avifImageYUVToRGB(image.get(), &rgb), AVIF_RESULT_OK);
+        EXPECT_TRUE(testutil::AreImagesEqual(reference, rgb))
+            << "cpu_mask " << cpu_mask;
+      }
+    }
+  }
+
+  // All half floats, including negative values, subnormals, infinities and
+  // NaNs, give the same 16-bit gray samples.
+  ImagePtr reference = testutil::CreateImage(
+      256, 256, 16, AVIF_PIXEL_FORMAT_YUV400, AVIF_PLANES_YUV,
+      AVIF_RANGE_FULL);
+  ASSERT_NE(reference, nullptr);
+  testutil::AvifRgbImage rgb(reference.get(), 16, AVIF_RGB_FORMAT_GRAY);
+  rgb.isFloat = AVIF_TRUE;
+  for (uint32_t y = 0; y < rgb.height; ++y) {
+    uint16_t* row = reinterpret_cast<uint16_t*>(rgb.pixels + y * rgb.rowBytes);
+    for (uint32_t x = 0; x < rgb.width; ++x) {
+      row[x] = static_cast<uint16_t>(y * rgb.width + x);
+    }
+  }
+  avifSetCPUMask(0);
+  ASSERT_EQ(avifImageRGBToYUV(reference.get(), &rgb), AVIF_RESULT_OK);
+  for (uint32_t cpu_mask : {AVIF_CPU_SSE2, AVIF_CPU_ALL}) {
+    avifSetCPUMask(cpu_mask);
+    ImagePtr image16 = testutil::CreateImage(256, 256, 16,
+                                             AVIF_PIXEL_FORMAT_YUV400,
+                                             AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+    ASSERT_NE(image16, nullptr);
+    ASSERT_EQ(avifImageRGBToYUV(image16.get(), &rgb), AVIF_RESULT_OK);
+    EXPECT_TRUE(testutil::AreImagesEqual(*reference, *image16))
+        << "cpu_mask " << cpu_mask;
+  }
+  avifSetCPUMask(AVIF_CPU_ALL);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace
+}  // namespace avif
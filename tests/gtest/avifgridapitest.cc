@@ -1,6 +1,8 @@
 // Copyright 2022 Google LLC
 // SPDX-License-Identifier: BSD-2-Clause
 
+#include <chrono>
+#include <iostream>
 #include <vector>
 
 #include "avif/avif.h"
@@ -277,5 +279,71 @@ TEST(GridApiTest, DifferentMatrixCoefficients) {
       AVIF_RESULT_INVALID_IMAGE_GRID);
 }
 
+constexpr uint32_t kManyCellsGridCols = 32, kManyCellsGridRows = 32;
+constexpr uint32_t kManyCellsCellSize = 64;
+
+// Adds a grid of kManyCellsGridCols by kManyCellsGridRows cells with alpha to
+// the encoder.
+avifResult AddManyCellsGrid(avifEncoder* encoder) {
+  ImagePtr cell = testutil::CreateImage(kManyCellsCellSize, kManyCellsCellSize,
+                                        /*depth=*/8, AVIF_PIXEL_FORMAT_YUV420,
+                                        AVIF_PLANES_ALL);
+  if (cell == nullptr) return AVIF_RESULT_OUT_OF_MEMORY;
+  testutil::FillImageGradient(cell.get());
+  const std::vector<const avifImage*> cell_image_ptrs(
+      kManyCellsGridCols * kManyCellsGridRows, cell.get());
+  encoder->speed = AVIF_SPEED_FASTEST;
+  encoder->maxThreads = 4;
+  return avifEncoderAddImageGrid(encoder, kManyCellsGridCols,
+                                 kManyCellsGridRows, cell_image_ptrs.data(),
+                                 AVIF_ADD_IMAGE_FLAG_SINGLE);
+}
+
+// A grid with many cells with alpha, whose identical cell properties are
+// shared in the 'ipco' box, is written and decoded correctly.
+TEST(GridApiTest, ManyCellsWithAlpha) {
+  if (!testutil::Av1EncoderAvailable()) {
+    GTEST_SKIP() << "AV1 Codec unavailable, skip test.";
+  }
+  EncoderPtr encoder(avifEncoderCreate());
+  ASSERT_NE(encoder, nullptr);
+  ASSERT_EQ(AddManyCellsGrid(encoder.get()), AVIF_RESULT_OK);
+  testutil::AvifRwData encoded_avif;
+  ASSERT_EQ(avifEncoderFinish(encoder.get(), &encoded_avif), AVIF_RESULT_OK);
+
+  if (!testutil::Av1DecoderAvailable()) {
+    GTEST_SKIP() << "AV1 Codec unavailable, skip the rest of the test.";
+  }
+  DecoderPtr decoder(avifDecoderCreate());
+  ASSERT_NE(decoder, nullptr);
+  ImagePtr decoded(avifImageCreateEmpty());
+  ASSERT_NE(decoded, nullptr);
+  ASSERT_EQ(avifDecoderReadMemory(decoder.get(), decoded.get(),
+                                  encoded_avif.data, encoded_avif.size),
+            AVIF_RESULT_OK);
+  EXPECT_EQ(decoded->width, kManyCellsGridCols * kManyCellsCellSize);
+  EXPECT_EQ(decoded->height, kManyCellsGridRows * kManyCellsCellSize);
+  EXPECT_NE(decoded->alphaPlane, nullptr);
+}
+
+// Measures avifEncoderFinish() on a grid with many cells. Only prints timings,
+// so it is disabled by default. Run it with --gtest_also_run_disabled_tests.
+TEST(DISABLED_GridApiBenchmark, Finish) {
+  if (!testutil::Av1EncoderAvailable()) {
+    GTEST_SKIP() << "AV1 Codec unavailable, skip test.";
+  }
+  EncoderPtr encoder(avifEncoderCreate());
+  ASSERT_NE(encoder, nullptr);
+  ASSERT_EQ(AddManyCellsGrid(encoder.get()), AVIF_RESULT_OK);
+  testutil::AvifRwData encoded_avif;
+  const auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(avifEncoderFinish(encoder.get(), &encoded_avif), AVIF_RESULT_OK);
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << "avifEncoderFinish() took " << elapsed.count() << " ms for "
+            << kManyCellsGridCols * kManyCellsGridRows << " cells with alpha"
+            << std::endl;
+}
+
 }  // namespace
 }  // namespace avif
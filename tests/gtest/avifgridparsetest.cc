@@ -0,0 +1,238 @@
+// Copyright 2026 Google LLC
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+#include "avif/avif.h"
+#include "avif/internal.h"
+#include "aviftest_helpers.h"
+#include "gtest/gtest.h"
+
+namespace avif {
+namespace {
+
+constexpr uint32_t kCellSize = 64;
+
+// Writes an AVIF file made of a grid of rows*columns 8-bit 4:2:0 cells. The
+// cell payloads are not valid AV1 so the file can be parsed but not decoded.
+// All item payloads are stored in an idat box.
+avifResult WriteGridFile(uint32_t rows, uint32_t columns, avifRWData* output) {
+  AVIF_CHECKERR(rows >= 1 && rows <= 256 && columns >= 1 && columns <= 256,
+                AVIF_RESULT_INVALID_ARGUMENT);
+  const uint32_t num_cells = rows * columns;
+  AVIF_CHECKERR(num_cells < UINT16_MAX, AVIF_RESULT_INVALID_ARGUMENT);
+  const uint16_t grid_item_id = 1;  // Cells have the IDs 2 to num_cells+1.
+  constexpr uint32_t kGridPayloadSize = 8;
+  constexpr uint32_t kCellPayloadSize = 4;
+
+  avifRWStream s;
+  avifRWStreamStart(&s, output);
+  avifBoxMarker ftyp;
+  AVIF_CHECKRES(avifRWStreamWriteBox(&s, "ftyp", AVIF_BOX_SIZE_TBD, &ftyp));
+  AVIF_CHECKRES(avifRWStreamWriteChars(&s, "avif", 4));
+  AVIF_CHECKRES(avifRWStreamWriteU32(&s, 0));
+  AVIF_CHECKRES(avifRWStreamWriteChars(&s, "avifmif1miaf", 12));
+  AVIF_CHECKRES(avifRWStreamFinishBox(&s, ftyp));
+
+  avifBoxMarker meta;
+  AVIF_CHECKRES(
+      avifRWStreamWriteFullBox(&s, "meta", AVIF_BOX_SIZE_TBD, 0, 0, &meta));
+
+  avifBoxMarker hdlr;
+  AVIF_CHECKRES(
+      avifRWStreamWriteFullBox(&s, "hdlr", AVIF_BOX_SIZE_TBD, 0, 0, &hdlr));
+  AVIF_CHECKRES(avifRWStreamWriteU32(&s, 0));  // pre_defined
+  AVIF_CHECKRES(avifRWStreamWriteChars(&s, "pict", 4));
+  AVIF_CHECKRES(avifRWStreamWriteZeros(&s, 3 * 4 + 1));  // reserved and name
+  AVIF_CHECKRES(avifRWStreamFinishBox(&s, hdlr));
+
+  avifBoxMarker pitm;
+  AVIF_CHECKRES(
+      avifRWStreamWriteFullBox(&s, "pitm", AVIF_BOX_SIZE_TBD, 0, 0, &pitm));
+  AVIF_CHECKRES(avifRWStreamWriteU16(&s, grid_item_id));
+  AVIF_CHECKRES(avifRWStreamFinishBox(&s, pitm));
+
+  avifBoxMarker iloc;
+  AVIF_CHECKRES(
+      avifRWStreamWriteFullBox(&s, "iloc", AVIF_BOX_SIZE_TBD, 1, 0, &iloc));
+  AVIF_CHECKRES(avifRWStreamWriteU8(&s, 0x44));  // offset_size, length_size
+  AVIF_CHECKRES(avifRWStreamWriteU8(&s, 0));  // base_offset_size, index_size
+  AVIF_CHECKRES(avifRWStreamWriteU16(&s, (uint16_t)(num_cells + 1)));
+  for (uint32_t i = 0; i <= num_cells; ++i) {
+    AVIF_CHECKRES(avifRWStreamWriteU16(&s, (uint16_t)(grid_item_id + i)));
+    AVIF_CHECKRES(avifRWStreamWriteU16(&s, 1));  // construction_method: idat
+    AVIF_CHECKRES(avifRWStreamWriteU16(&s, 0));  // data_reference_index
+    AVIF_CHECKRES(avifRWStreamWriteU16(&s, 1));  // extent_count
+    const uint32_t offset =
+        i == 0 ? 0 : kGridPayloadSize + (i - 1) * kCellPayloadSize;
+    AVIF_CHECKRES(avifRWStreamWriteU32(&s, offset));
+    AVIF_CHECKRES(
+        avifRWStreamWriteU32(&s, i == 0 ? kGridPayloadSize : kCellPayloadSize));
+  }
+  AVIF_CHECKRES(avifRWStreamFinishBox(&s, iloc));
+
+  avifBoxMarker iinf;
+  AVIF_CHECKRES(
+      avifRWStreamWriteFullBox(&s, "iinf", AVIF_BOX_SIZE_TBD, 0, 0, &iinf));
+  AVIF_CHECKRES(avifRWStreamWriteU16(&s, (uint16_t)(num_cells + 1)));
+  for (uint32_t i = 0; i <= num_cells; ++i) {
+    avifBoxMarker infe;
+    AVIF_CHECKRES(avifRWStreamWriteFullBox(&s, "infe", AVIF_BOX_SIZE_TBD, 2,
+                                           i == 0 ? 0 : 1, &infe));
+    AVIF_CHECKRES(avifRWStreamWriteU16(&s, (uint16_t)(grid_item_id + i)));
+    AVIF_CHECKRES(avifRWStreamWriteU16(&s, 0));  // item_protection_index
+    AVIF_CHECKRES(avifRWStreamWriteChars(&s, i == 0 ? "grid" : "av01", 4));
+    AVIF_CHECKRES(avifRWStreamWriteU8(&s, 0));  // item_name
+    AVIF_CHECKRES(avifRWStreamFinishBox(&s, infe));
+  }
+  AVIF_CHECKRES(avifRWStreamFinishBox(&s, iinf));
+
+  avifBoxMarker iref;
+  AVIF_CHECKRES(
+      avifRWStreamWriteFullBox(&s, "iref", AVIF_BOX_SIZE_TBD, 0, 0, &iref));
+  avifBoxMarker dimg;
+  AVIF_CHECKRES(avifRWStreamWriteBox(&s, "dimg", AVIF_BOX_SIZE_TBD, &dimg));
+  AVIF_CHECKRES(avifRWStreamWriteU16(&s, grid_item_id));
+  AVIF_CHECKRES(avifRWStreamWriteU16(&s, (uint16_t)num_cells));
+  for (uint32_t i = 1; i <= num_cells; ++i) {
+    AVIF_CHECKRES(avifRWStreamWriteU16(&s, (uint16_t)(grid_item_id + i)));
+  }
+  AVIF_CHECKRES(avifRWStreamFinishBox(&s, dimg));
+  AVIF_CHECKRES(avifRWStreamFinishBox(&s, iref));
+
+  avifBoxMarker iprp;
+  AVIF_CHECKRES(avifRWStreamWriteBox(&s, "iprp", AVIF_BOX_SIZE_TBD, &iprp));
+  avifBoxMarker ipco;
+  AVIF_CHECKRES(avifRWStreamWriteBox(&s, "ipco", AVIF_BOX_SIZE_TBD, &ipco));
+  avifBoxMarker prop;
+  // 1: ispe of the grid
+  AVIF_CHECKRES(
+      avifRWStreamWriteFullBox(&s, "ispe", AVIF_BOX_SIZE_TBD, 0, 0, &prop));
+  AVIF_CHECKRES(avifRWStreamWriteU32(&s, columns * kCellSize));
+  AVIF_CHECKRES(avifRWStreamWriteU32(&s, rows * kCellSize));
+  AVIF_CHECKRES(avifRWStreamFinishBox(&s, prop));
+  // 2: ispe of the cells
+  AVIF_CHECKRES(
+      avifRWStreamWriteFullBox(&s, "ispe", AVIF_BOX_SIZE_TBD, 0, 0, &prop));
+  AVIF_CHECKRES(avifRWStreamWriteU32(&s, kCellSize));
+  AVIF_CHECKRES(avifRWStreamWriteU32(&s, kCellSize));
+  AVIF_CHECKRES(avifRWStreamFinishBox(&s, prop));
+  // 3: av1C, 8-bit 4:2:0
+  AVIF_CHECKRES(avifRWStreamWriteBox(&s, "av1C", AVIF_BOX_SIZE_TBD, &prop));
+  const uint8_t av1c[] = {0x81, 0x00, 0x0C, 0x00};
+  AVIF_CHECKRES(avifRWStreamWrite(&s, av1c, sizeof(av1c)));
+  AVIF_CHECKRES(avifRWStreamFinishBox(&s, prop));
+  // 4: colr nclx, so that the cell payloads are not searched for CICP
+  AVIF_CHECKRES(avifRWStreamWriteBox(&s, "colr", AVIF_BOX_SIZE_TBD, &prop));
+  AVIF_CHECKRES(avifRWStreamWriteChars(&s, "nclx", 4));
+  AVIF_CHECKRES(avifRWStreamWriteU16(&s, AVIF_COLOR_PRIMARIES_BT709));
+  AVIF_CHECKRES(avifRWStreamWriteU16(&s, AVIF_TRANSFER_CHARACTERISTICS_SRGB));
+  AVIF_CHECKRES(avifRWStreamWriteU16(&s, AVIF_MATRIX_COEFFICIENTS_BT601));
+  AVIF_CHECKRES(avifRWStreamWriteU8(&s, 0x80));  // full_range_flag
+  AVIF_CHECKRES(avifRWStreamFinishBox(&s, prop));
+  // 5: pixi
+  AVIF_CHECKRES(
+      avifRWStreamWriteFullBox(&s, "pixi", AVIF_BOX_SIZE_TBD, 0, 0, &prop));
+  const uint8_t pixi[] = {3, 8, 8, 8};
+  AVIF_CHECKRES(avifRWStreamWrite(&s, pixi, sizeof(pixi)));
+  AVIF_CHECKRES(avifRWStreamFinishBox(&s, prop));
+  AVIF_CHECKRES(avifRWStreamFinishBox(&s, ipco));
+
+  avifBoxMarker ipma;
+  AVIF_CHECKRES(
+      avifRWStreamWriteFullBox(&s, "ipma", AVIF_BOX_SIZE_TBD, 0, 0, &ipma));
+  AVIF_CHECKRES(avifRWStreamWriteU32(&s, num_cells + 1));
+  const uint8_t grid_associations[] = {1, 4, 5};
+  const uint8_t cell_associations[] = {2, 0x80 | 3, 4, 5};
+  for (uint32_t i = 0; i <= num_cells; ++i) {
+    AVIF_CHECKRES(avifRWStreamWriteU16(&s, (uint16_t)(grid_item_id + i)));
+    if (i == 0) {
+      AVIF_CHECKRES(avifRWStreamWriteU8(&s, sizeof(grid_associations)));
+      AVIF_CHECKRES(avifRWStreamWrite(&s, grid_associations,
+                                      sizeof(grid_associations)));
+    } else {
+      AVIF_CHECKRES(avifRWStreamWriteU8(&s, sizeof(cell_associations)));
+      AVIF_CHECKRES(avifRWStreamWrite(&s, cell_associations,
+                                      sizeof(cell_associations)));
+    }
+  }
+  AVIF_CHECKRES(avifRWStreamFinishBox(&s, ipma));
+  AVIF_CHECKRES(avifRWStreamFinishBox(&s, iprp));
+
+  avifBoxMarker idat;
+  AVIF_CHECKRES(avifRWStreamWriteBox(&s, "idat", AVIF_BOX_SIZE_TBD, &idat));
+  AVIF_CHECKRES(avifRWStreamWriteU8(&s, 0));  // version
+  AVIF_CHECKRES(avifRWStreamWriteU8(&s, 0));  // flags: 16-bit dimensions
+  AVIF_CHECKRES(avifRWStreamWriteU8(&s, (uint8_t)(rows - 1)));
+  AVIF_CHECKRES(avifRWStreamWriteU8(&s, (uint8_t)(columns - 1)));
+  AVIF_CHECKRES(avifRWStreamWriteU16(&s, (uint16_t)(columns * kCellSize)));
+  AVIF_CHECKRES(avifRWStreamWriteU16(&s, (uint16_t)(rows * kCellSize)));
+  AVIF_CHECKRES(avifRWStreamWriteZeros(&s, num_cells * kCellPayloadSize));
+  AVIF_CHECKRES(avifRWStreamFinishBox(&s, idat));
+
+  AVIF_CHECKRES(avifRWStreamFinishBox(&s, meta));
+  avifRWStreamFinishWrite(&s);
+  return AVIF_RESULT_OK;
+}
+
+TEST(GridParseTest, SmallGrid) {
+  testutil::AvifRwData file;
+  ASSERT_EQ(WriteGridFile(/*rows=*/2, /*columns=*/3, &file), AVIF_RESULT_OK);
+  DecoderPtr decoder(avifDecoderCreate());
+  ASSERT_NE(decoder, nullptr);
+  ASSERT_EQ(avifDecoderSetIOMemory(decoder.get(), file.data, file.size),
+            AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK)
+      << decoder->diag.error;
+  EXPECT_EQ(decoder->image->width, 3 * kCellSize);
+  EXPECT_EQ(decoder->image->height, 2 * kCellSize);
+  EXPECT_EQ(decoder->image->depth, 8u);
+  EXPECT_EQ(decoder->image->yuvFormat, AVIF_PIXEL_FORMAT_YUV420);
+}
+
+// Each cell is looked up by item ID several times during parsing, which used
+// to be quadratic in the number of cells.
+TEST(GridParseTest, ThousandCells) {
+  testutil::AvifRwData file;
+  ASSERT_EQ(WriteGridFile(/*rows=*/25, /*columns=*/40, &file), AVIF_RESULT_OK);
+  DecoderPtr decoder(avifDecoderCreate());
+  ASSERT_NE(decoder, nullptr);
+  ASSERT_EQ(avifDecoderSetIOMemory(decoder.get(), file.data, file.size),
+            AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK)
+      << decoder->diag.error;
+  EXPECT_EQ(decoder->image->width, 40 * kCellSize);
+  EXPECT_EQ(decoder->image->height, 25 * kCellSize);
+  // Parsing again gives the same result.
+  ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK)
+      << decoder->diag.error;
+  EXPECT_EQ(decoder->image->width, 40 * kCellSize);
+  EXPECT_EQ(decoder->image->height, 25 * kCellSize);
+}
+
+// Parse-time benchmark of a 1000-cell grid. Only prints timings, so it is
+// disabled by default. Run it with --gtest_also_run_disabled_tests.
+TEST(DISABLED_GridParseBenchmark, ThousandCells) {
+  testutil::AvifRwData file;
+  ASSERT_EQ(WriteGridFile(/*rows=*/25, /*columns=*/40, &file), AVIF_RESULT_OK);
+  DecoderPtr decoder(avifDecoderCreate());
+  ASSERT_NE(decoder, nullptr);
+  ASSERT_EQ(avifDecoderSetIOMemory(decoder.get(), file.data, file.size),
+            AVIF_RESULT_OK);
+
+  constexpr int kNumIterations = 20;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kNumIterations; ++i) {
+    ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK)
+        << decoder->diag.error;
+  }
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << "avifDecoderParse() of a 1000-cell grid took "
+            << elapsed.count() / kNumIterations << " ms" << std::endl;
+}
+
+}  // namespace
+}  // namespace avif
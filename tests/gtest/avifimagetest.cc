@@ -1,13 +1,20 @@
 // Copyright 2023 Google LLC
 // SPDX-License-Identifier: BSD-2-Clause
 
+#include <algorithm>
 #include <cstdint>
 #include <limits>
+#include <tuple>
+#include <vector>
 
 #include "avif/avif.h"
+#include "avif/internal.h"
 #include "aviftest_helpers.h"
 #include "gtest/gtest.h"
 
+using ::testing::Combine;
+using ::testing::Values;
+
 namespace avif {
 namespace {
 
@@ -49,5 +56,190 @@ TEST(AvifImageTest, WriteImage) {
       image.get(), (testing::TempDir() + "/avifimagetest.png").c_str()));
 }
 
+//------------------------------------------------------------------------------
+
+class AvifImageCopyTest
+    : public testing::TestWithParam<
+          std::tuple</*depth=*/int, avifPixelFormat, /*max_threads=*/int>> {};
+
+uint32_t GetSample(const avifImage& image, int channel, uint32_t x,
+                   uint32_t y) {
+  const uint8_t* row = avifImagePlane(&image, channel) +
+                       y * avifImagePlaneRowBytes(&image, channel);
+  return avifImageUsesU16(&image)
+             ? reinterpret_cast<const uint16_t*>(row)[x]
+             : row[x];
+}
+
+TEST_P(AvifImageCopyTest, SameAsSingleThreaded) {
+  const int depth = std::get<0>(GetParam());
+  const avifPixelFormat format = std::get<1>(GetParam());
+  const int max_threads = std::get<2>(GetParam());
+  // Large enough to be split into several jobs.
+  ImagePtr image = testutil::CreateImage(1500, 1001, depth, format,
+                                         AVIF_PLANES_ALL);
+  ASSERT_NE(image, nullptr);
+  testutil::FillImageGradient(image.get());
+
+  ImagePtr copy(avifImageCreateEmpty());
+  ASSERT_NE(copy, nullptr);
+  ASSERT_EQ(avifImageCopyWithMaxThreads(copy.get(), image.get(),
+                                        AVIF_PLANES_ALL, max_threads),
+            AVIF_RESULT_OK);
+  EXPECT_TRUE(testutil::AreImagesEqual(*image, *copy));
+
+  // Views have row strides larger than their widths.
+  ImagePtr view(avifImageCreateEmpty());
+  ASSERT_NE(view, nullptr);
+  const avifCropRect rect = {14, 10, 1000, 700};
+  ASSERT_EQ(avifImageSetViewRect(view.get(), image.get(), &rect),
+            AVIF_RESULT_OK);
+  ImagePtr view_copy(avifImageCreateEmpty());
+  ASSERT_NE(view_copy, nullptr);
+  ASSERT_EQ(avifImageCopyWithMaxThreads(view_copy.get(), view.get(),
+                                        AVIF_PLANES_ALL, max_threads),
+            AVIF_RESULT_OK);
+  EXPECT_TRUE(testutil::AreImagesEqual(*view, *view_copy));
+}
+
+TEST_P(AvifImageCopyTest, Pad) {
+  const int depth = std::get<0>(GetParam());
+  const avifPixelFormat format = std::get<1>(GetParam());
+  const int max_threads = std::get<2>(GetParam());
+  ImagePtr image = testutil::CreateImage(1233, 1001, depth, format,
+                                         AVIF_PLANES_ALL);
+  ASSERT_NE(image, nullptr);
+  testutil::FillImageGradient(image.get());
+  ImagePtr padded = testutil::CreateImage(1280, 1088, depth, format,
+                                          AVIF_PLANES_ALL);
+  ASSERT_NE(padded, nullptr);
+  ASSERT_EQ(avifImageCopyAndPadSamples(padded.get(), image.get(),
+                                       AVIF_PLANES_ALL, max_threads),
+            AVIF_RESULT_OK);
+
+  for (int c = AVIF_CHAN_Y; c <= AVIF_CHAN_A; ++c) {
+    if (avifImagePlane(image.get(), c) == nullptr) continue;
+    const uint32_t src_width = avifImagePlaneWidth(image.get(), c);
+    const uint32_t src_height = avifImagePlaneHeight(image.get(), c);
+    for (uint32_t y = 0; y < avifImagePlaneHeight(padded.get(), c); ++y) {
+      for (uint32_t x = 0; x < avifImagePlaneWidth(padded.get(), c); ++x) {
+        const uint32_t expected =
+            GetSample(*image, c, std::min(x, src_width - 1),
+                      std::min(y, src_height - 1));
+        if (GetSample(*padded, c, x, y) != expected) {
+          FAIL() << "channel " << c << " x " << x << " y " << y;
+        }
+      }
+    }
+  }
+}
+
+// Copies the tiles of each row of a grid at once, like the decoder, with a
+// cropped last column and row of tiles.
+TEST_P(AvifImageCopyTest, GridRows) {
+  const int depth = std::get<0>(GetParam());
+  const avifPixelFormat format = std::get<1>(GetParam());
+  const int max_threads = std::get<2>(GetParam());
+  constexpr uint32_t kColumns = 4, kRows = 3;
+  constexpr uint32_t kTileWidth = 512, kTileHeight = 256;
+  ImagePtr grid =
+      testutil::CreateImage(1900, 700, depth, format, AVIF_PLANES_ALL);
+  ASSERT_NE(grid, nullptr);
+  std::vector<ImagePtr> tiles;
+  for (uint32_t i = 0; i < kColumns * kRows; ++i) {
+    tiles.push_back(testutil::CreateImage(kTileWidth, kTileHeight, depth,
+                                          format, AVIF_PLANES_ALL));
+    ASSERT_NE(tiles.back(), nullptr);
+    testutil::FillImageGradient(tiles.back().get(), /*offset=*/i * 7);
+  }
+
+  for (uint32_t row = 0; row < kRows; ++row) {
+    ImagePtr dst_views[kColumns], src_views[kColumns];
+    avifImage* dst_view_ptrs[kColumns];
+    const avifImage* src_view_ptrs[kColumns];
+    for (uint32_t column = 0; column < kColumns; ++column) {
+      const uint32_t x = column * kTileWidth, y = row * kTileHeight;
+      const avifCropRect rect = {x, y, std::min(kTileWidth, grid->width - x),
+                                 std::min(kTileHeight, grid->height - y)};
+      const avifCropRect tile_rect = {0, 0, rect.width, rect.height};
+      dst_views[column].reset(avifImageCreateEmpty());
+      src_views[column].reset(avifImageCreateEmpty());
+      ASSERT_NE(dst_views[column], nullptr);
+      ASSERT_NE(src_views[column], nullptr);
+      ASSERT_EQ(avifImageSetViewRect(dst_views[column].get(), grid.get(),
+                                     &rect),
+                AVIF_RESULT_OK);
+      ASSERT_EQ(
+          avifImageSetViewRect(src_views[column].get(),
+                               tiles[row * kColumns + column].get(),
+                               &tile_rect),
+          AVIF_RESULT_OK);
+      dst_view_ptrs[column] = dst_views[column].get();
+      src_view_ptrs[column] = src_views[column].get();
+    }
+    ASSERT_EQ(avifImagesCopyAndPadSamples(dst_view_ptrs, src_view_ptrs,
+                                          kColumns, grid.get(),
+                                          AVIF_PLANES_ALL, max_threads),
+              AVIF_RESULT_OK);
+  }
+
+  for (int c = AVIF_CHAN_Y; c <= AVIF_CHAN_A; ++c) {
+    if (avifImagePlane(grid.get(), c) == nullptr) continue;
+    const uint32_t tile_width = avifImagePlaneWidth(tiles[0].get(), c);
+    const uint32_t tile_height = avifImagePlaneHeight(tiles[0].get(), c);
+    for (uint32_t y = 0; y < avifImagePlaneHeight(grid.get(), c); ++y) {
+      for (uint32_t x = 0; x < avifImagePlaneWidth(grid.get(), c); ++x) {
+        const avifImage& tile =
+            *tiles[(y / tile_height) * kColumns + x / tile_width];
+        if (GetSample(*grid, c, x, y) !=
+            GetSample(tile, c, x % tile_width, y % tile_height)) {
+          FAIL() << "channel " << c << " x " << x << " y " << y;
+        }
+      }
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    All, AvifImageCopyTest,
+    Combine(/*depth=*/Values(8, 12),
+            Values(AVIF_PIXEL_FORMAT_YUV444, AVIF_PIXEL_FORMAT_YUV420,
+                   AVIF_PIXEL_FORMAT_YUV400),
+            /*max_threads=*/Values(1, 4)));
+
+// Copies larger than 64 MiB use non-temporal stores when available. The
+// padded width is not a multiple of 32 so that rows start at any alignment.
+class AvifImageCopyStreamTest : public testing::Test {
+ protected:
+  void TearDown() override { avifSetCPUMask(AVIF_CPU_ALL); }
+};
+
+TEST_F(AvifImageCopyStreamTest, SameAsWithoutSIMD) {
+  ImagePtr image = testutil::CreateImage(5999, 5601, 8,
+                                         AVIF_PIXEL_FORMAT_YUV400,
+                                         AVIF_PLANES_ALL);
+  ASSERT_NE(image, nullptr);
+  testutil::FillImageGradient(image.get());
+  ImagePtr reference = testutil::CreateImage(6001, 5603, 8,
+                                             AVIF_PIXEL_FORMAT_YUV400,
+                                             AVIF_PLANES_ALL);
+  ASSERT_NE(reference, nullptr);
+  avifSetCPUMask(0);
+  ASSERT_EQ(avifImageCopyAndPadSamples(reference.get(), image.get(),
+                                       AVIF_PLANES_ALL, 2),
+            AVIF_RESULT_OK);
+  avifSetCPUMask(AVIF_CPU_ALL);
+  ImagePtr padded = testutil::CreateImage(6001, 5603, 8,
+                                          AVIF_PIXEL_FORMAT_YUV400,
+                                          AVIF_PLANES_ALL);
+  ASSERT_NE(padded, nullptr);
+  ASSERT_EQ(avifImageCopyAndPadSamples(padded.get(), image.get(),
+                                       AVIF_PLANES_ALL, 2),
+            AVIF_RESULT_OK);
+  EXPECT_TRUE(testutil::AreImagesEqual(*reference, *padded));
+}
+
+//------------------------------------------------------------------------------
+
 }  // namespace
 }  // namespace avif
@@ -0,0 +1,174 @@
+// Copyright 2026 Google LLC
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "avif/avif.h"
+#include "aviftest_helpers.h"
+#include "gtest/gtest.h"
+
+namespace avif {
+namespace {
+
+// Used to pass the data folder path to the GoogleTest suites.
+const char* data_path = nullptr;
+
+//------------------------------------------------------------------------------
+
+// Simulates a network stream where only the first available_size bytes were
+// received.
+struct StreamingData {
+  const avifRWData* file;
+  size_t available_size;
+  uint32_t num_reads;
+};
+
+avifResult StreamingRead(avifIO* io, uint32_t read_flags, uint64_t offset,
+                         size_t size, avifROData* out) {
+  StreamingData* data = reinterpret_cast<StreamingData*>(io->data);
+  if (read_flags != 0 || offset > data->file->size) {
+    return AVIF_RESULT_IO_ERROR;
+  }
+  ++data->num_reads;
+  size = std::min(size, static_cast<size_t>(data->file->size - offset));
+  if (offset + size > data->available_size) {
+    return AVIF_RESULT_WAITING_ON_IO;
+  }
+  out->data = data->file->data + offset;
+  out->size = size;
+  return AVIF_RESULT_OK;
+}
+
+// Parses file_name by only providing the bytes reported by
+// avifDecoderGetIOWaitExtent() after each AVIF_RESULT_WAITING_ON_IO.
+void ParseByRequestedExtents(const std::string& file_name) {
+  const testutil::AvifRwData file =
+      testutil::ReadFile(std::string(data_path) + file_name);
+  ASSERT_NE(file.size, 0u);
+
+  DecoderPtr reference(avifDecoderCreate());
+  ASSERT_NE(reference, nullptr);
+  ASSERT_EQ(avifDecoderSetIOMemory(reference.get(), file.data, file.size),
+            AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderParse(reference.get()), AVIF_RESULT_OK);
+
+  StreamingData data = {&file, file.size, 0};
+  avifIO io = {};
+  io.read = StreamingRead;
+  io.sizeHint = file.size;
+  io.persistent = AVIF_TRUE;
+  io.data = &data;
+  DecoderPtr decoder(avifDecoderCreate());
+  ASSERT_NE(decoder, nullptr);
+  avifDecoderSetIO(decoder.get(), &io);
+  ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK);
+  const uint32_t num_reads_without_wait = data.num_reads;
+
+  data.available_size = 0;
+  data.num_reads = 0;
+
+  avifExtent extent;
+  avifResult result;
+  uint32_t num_waits = 0;
+  while ((result = avifDecoderParse(decoder.get())) ==
+         AVIF_RESULT_WAITING_ON_IO) {
+    ASSERT_EQ(avifDecoderGetIOWaitExtent(decoder.get(), &extent),
+              AVIF_RESULT_OK);
+    // The size may be truncated to the end of the file.
+    const size_t new_available_size = static_cast<size_t>(std::min<uint64_t>(
+        file.size, extent.offset + std::min<size_t>(extent.size, file.size)));
+    // The requested bytes must not be available already.
+    ASSERT_GT(new_available_size, data.available_size);
+    data.available_size = new_available_size;
+    ++num_waits;
+  }
+  ASSERT_EQ(result, AVIF_RESULT_OK) << avifResultToString(result);
+  EXPECT_GT(num_waits, 0u);
+  EXPECT_EQ(avifDecoderGetIOWaitExtent(decoder.get(), &extent),
+            AVIF_RESULT_NO_CONTENT);
+  // Each wait only costs the failed read and reading the header of the box it
+  // happened in again. Already parsed boxes are not read again.
+  EXPECT_LE(data.num_reads, num_reads_without_wait + 2 * num_waits);
+
+  EXPECT_EQ(decoder->image->width, reference->image->width);
+  EXPECT_EQ(decoder->image->height, reference->image->height);
+  EXPECT_EQ(decoder->image->depth, reference->image->depth);
+  EXPECT_EQ(decoder->image->yuvFormat, reference->image->yuvFormat);
+  EXPECT_EQ(decoder->image->icc.size, reference->image->icc.size);
+  EXPECT_EQ(decoder->image->exif.size, reference->image->exif.size);
+  EXPECT_EQ(decoder->image->xmp.size, reference->image->xmp.size);
+  EXPECT_EQ(decoder->imageCount, reference->imageCount);
+
+  decoder->io = nullptr;  // io is owned by this function.
+}
+
+TEST(IoWaitTest, Grid) { ParseByRequestedExtents("sofa_grid1x5_420.avif"); }
+
+TEST(IoWaitTest, Metadata) {
+  ParseByRequestedExtents("paris_icc_exif_xmp.avif");
+}
+
+TEST(IoWaitTest, Sequence) {
+  ParseByRequestedExtents("colors-animated-8bpc-alpha-exif-xmp.avif");
+}
+
+TEST(IoWaitTest, NoWait) {
+  const testutil::AvifRwData file =
+      testutil::ReadFile(std::string(data_path) + "white_1x1.avif");
+  DecoderPtr decoder(avifDecoderCreate());
+  ASSERT_NE(decoder, nullptr);
+  avifExtent extent;
+  EXPECT_EQ(avifDecoderGetIOWaitExtent(decoder.get(), &extent),
+            AVIF_RESULT_NO_CONTENT);
+  ASSERT_EQ(avifDecoderSetIOMemory(decoder.get(), file.data, file.size),
+            AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK);
+  EXPECT_EQ(avifDecoderGetIOWaitExtent(decoder.get(), &extent),
+            AVIF_RESULT_NO_CONTENT);
+}
+
+// Changing the avifIO discards the parsing progress.
+TEST(IoWaitTest, SetIODiscardsProgress) {
+  const testutil::AvifRwData file =
+      testutil::ReadFile(std::string(data_path) + "white_1x1.avif");
+  StreamingData data = {&file, 32, 0};
+  avifIO io = {};
+  io.read = StreamingRead;
+  io.sizeHint = file.size;
+  io.persistent = AVIF_TRUE;
+  io.data = &data;
+  DecoderPtr decoder(avifDecoderCreate());
+  ASSERT_NE(decoder, nullptr);
+  avifDecoderSetIO(decoder.get(), &io);
+  ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_WAITING_ON_IO);
+  avifExtent extent;
+  ASSERT_EQ(avifDecoderGetIOWaitExtent(decoder.get(), &extent),
+            AVIF_RESULT_OK);
+  EXPECT_GT(extent.offset + extent.size, 32u);
+  decoder->io = nullptr;  // io is owned by this function.
+
+  ASSERT_EQ(avifDecoderSetIOMemory(decoder.get(), file.data, file.size),
+            AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK);
+  EXPECT_EQ(decoder->image->width, 1u);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace
+}  // namespace avif
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  if (argc != 2) {
+    std::cerr << "There must be exactly one argument containing the path to "
+                 "the test data folder"
+              << std::endl;
+    return 1;
+  }
+  avif::data_path = argv[1];
+  return RUN_ALL_TESTS();
+}
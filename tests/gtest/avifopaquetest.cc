@@ -1,7 +1,10 @@
 // Copyright 2022 Google LLC
 // SPDX-License-Identifier: BSD-2-Clause
 
+#include <string>
+
 #include "avif/avif.h"
+#include "avif/internal.h"
 #include "aviftest_helpers.h"
 #include "gtest/gtest.h"
 
@@ -27,5 +30,57 @@ TEST(OpaqueTest, AlphaAndNoAlpha) {
   }
 }
 
+void SetAlpha(avifImage* image, uint32_t x, uint32_t y, uint32_t value) {
+  uint8_t* row = image->alphaPlane + y * image->alphaRowBytes;
+  if (avifImageUsesU16(image)) {
+    reinterpret_cast<uint16_t*>(row)[x] = static_cast<uint16_t>(value);
+  } else {
+    row[x] = static_cast<uint8_t>(value);
+  }
+}
+
+// Each sample of the alpha plane is checked, whatever its position relative to
+// the words or vectors compared by avifImageIsOpaque(), and the row padding is
+// ignored, with and without the SIMD kernels.
+TEST(OpaqueTest, EverySample) {
+  for (uint32_t cpu_mask : {0, AVIF_CPU_SSE2, AVIF_CPU_ALL}) {
+    avifSetCPUMask(cpu_mask);
+    for (int depth : {8, 10}) {
+      for (uint32_t width : {1, 7, 8, 13, 33, 70, 150}) {
+        SCOPED_TRACE("mask " + std::to_string(cpu_mask) + " depth " +
+                     std::to_string(depth) + " width " +
+                     std::to_string(width));
+        ImagePtr image = testutil::CreateImage(
+            width + 3, 3, depth, AVIF_PIXEL_FORMAT_YUV444, AVIF_PLANES_ALL);
+        ASSERT_NE(image, nullptr);
+        const uint32_t max_value = (1u << depth) - 1;
+        const uint32_t yuva[] = {0, 0, 0, max_value};
+        testutil::FillImagePlain(image.get(), yuva);
+        // The samples on the right of the view are part of its row padding.
+        for (uint32_t y = 0; y < image->height; ++y) {
+          for (uint32_t x = width; x < image->width; ++x) {
+            SetAlpha(image.get(), x, y, 0);
+          }
+        }
+        ImagePtr view(avifImageCreateEmpty());
+        ASSERT_NE(view, nullptr);
+        const avifCropRect rect = {0, 0, width, image->height};
+        ASSERT_EQ(avifImageSetViewRect(view.get(), image.get(), &rect),
+                  AVIF_RESULT_OK);
+        EXPECT_TRUE(avifImageIsOpaque(view.get()));
+
+        for (uint32_t y = 0; y < view->height; ++y) {
+          for (uint32_t x = 0; x < view->width; ++x) {
+            SetAlpha(image.get(), x, y, max_value - 1);
+            EXPECT_FALSE(avifImageIsOpaque(view.get())) << x << "," << y;
+            SetAlpha(image.get(), x, y, max_value);
+          }
+        }
+      }
+    }
+  }
+  avifSetCPUMask(AVIF_CPU_ALL);
+}
+
 }  // namespace
 }  // namespace avif
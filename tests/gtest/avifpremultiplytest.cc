@@ -0,0 +1,261 @@
+// Copyright 2026 Google LLC
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+
+#include "avif/avif.h"
+#include "avif/internal.h"
+#include "aviftest_helpers.h"
+#include "gtest/gtest.h"
+
+using ::testing::Combine;
+using ::testing::Values;
+
+namespace avif {
+namespace {
+
+//------------------------------------------------------------------------------
+
+// The float implementation that the integer kernels replaced.
+uint32_t PremultiplyFloat(uint32_t color, uint32_t alpha, uint32_t max) {
+  if (alpha >= max) return color;
+  if (alpha == 0) return 0;
+  const float max_f = static_cast<float>(max);
+  return static_cast<uint32_t>(std::floor(
+      static_cast<float>(color) * static_cast<float>(alpha) / max_f + 0.5f));
+}
+
+uint32_t UnpremultiplyFloat(uint32_t color, uint32_t alpha, uint32_t max) {
+  if (alpha >= max) return color;
+  if (alpha == 0) return 0;
+  const float max_f = static_cast<float>(max);
+  const float c = std::floor(static_cast<float>(color) * max_f /
+                                 static_cast<float>(alpha) +
+                             0.5f);
+  return static_cast<uint32_t>(std::min(c, max_f));
+}
+
+// Float is not precise enough for 16-bit samples, which are exactly rounded.
+uint32_t PremultiplyExact(uint32_t color, uint32_t alpha, uint32_t max) {
+  if (alpha >= max) return color;
+  return static_cast<uint32_t>((uint64_t{color} * alpha + max / 2) / max);
+}
+
+uint32_t UnpremultiplyExact(uint32_t color, uint32_t alpha, uint32_t max) {
+  if (alpha >= max) return color;
+  if (alpha == 0) return 0;
+  return static_cast<uint32_t>(std::min<uint64_t>(
+      (uint64_t{color} * max + alpha / 2) / alpha, max));
+}
+
+class AlphaMultiplyTest
+    : public testing::TestWithParam<std::tuple</*depth=*/int, avifRGBFormat,
+                                               /*max_threads=*/int,
+                                               /*cpu_mask=*/int>> {
+ protected:
+  void TearDown() override { avifSetCPUMask(AVIF_CPU_ALL); }
+};
+
+// Compares avifRGBImagePremultiplyAlpha() and avifRGBImageUnpremultiplyAlpha()
+// to the reference for all pairs of color and alpha samples up to 10 bits,
+// and for pseudo-random pairs otherwise.
+TEST_P(AlphaMultiplyTest, BitExact) {
+  const int depth = std::get<0>(GetParam());
+  const avifRGBFormat format = std::get<1>(GetParam());
+  const int max_threads = std::get<2>(GetParam());
+  avifSetCPUMask(static_cast<uint32_t>(std::get<3>(GetParam())));
+  if (depth == 8 && avifLibYUVVersion() != 0 &&
+      (format == AVIF_RGB_FORMAT_RGBA || format == AVIF_RGB_FORMAT_BGRA)) {
+    GTEST_SKIP() << "libyuv is used instead of the built-in kernels.";
+  }
+
+  const uint32_t max = (1u << depth) - 1;
+  const bool exhaustive = depth <= 10;
+  const uint32_t pixel_count = exhaustive ? (max + 1) * (max + 1) : 1u << 18;
+  constexpr uint32_t kWidth = 1024;
+  ImagePtr image(avifImageCreate(kWidth, pixel_count / kWidth, 8,
+                                 AVIF_PIXEL_FORMAT_YUV444));
+  ASSERT_NE(image, nullptr);
+  testutil::AvifRgbImage original(image.get(), depth, format);
+  const uint32_t channel_count = avifRGBFormatChannelCount(format);
+  const uint32_t alpha_index = (format == AVIF_RGB_FORMAT_ARGB ||
+                                 format == AVIF_RGB_FORMAT_ABGR ||
+                                 format == AVIF_RGB_FORMAT_AGRAY)
+                                    ? 0
+                                    : channel_count - 1;
+
+  const size_t sample_size = depth > 8 ? 2 : 1;
+  auto sample = [&](const avifRGBImage& rgb, uint32_t i, uint32_t channel) {
+    return rgb.pixels + (i / kWidth) * rgb.rowBytes +
+           ((i % kWidth) * channel_count + channel) * sample_size;
+  };
+  auto get = [&](const avifRGBImage& rgb, uint32_t i,
+                 uint32_t channel) -> uint32_t {
+    const uint8_t* s = sample(rgb, i, channel);
+    return depth > 8 ? *reinterpret_cast<const uint16_t*>(s) : *s;
+  };
+  auto set = [&](const avifRGBImage& rgb, uint32_t i, uint32_t channel,
+                 uint32_t value) {
+    uint8_t* s = sample(rgb, i, channel);
+    if (depth > 8) {
+      *reinterpret_cast<uint16_t*>(s) = static_cast<uint16_t>(value);
+    } else {
+      *s = static_cast<uint8_t>(value);
+    }
+  };
+
+  uint32_t seed = 12345;
+  for (uint32_t i = 0; i < pixel_count; ++i) {
+    uint32_t color = i % (max + 1);
+    uint32_t alpha = i / (max + 1);
+    if (!exhaustive) {
+      seed = seed * 1664525u + 1013904223u;
+      color = (seed >> 8) & max;
+      seed = seed * 1664525u + 1013904223u;
+      alpha = (seed >> 8) & max;
+      // Include the extreme alpha values.
+      if (i % 64 == 0) alpha = (i % 128 == 0) ? 0 : max;
+    }
+    for (uint32_t channel = 0; channel < channel_count; ++channel) {
+      // The other color channels get other values.
+      set(original, i, channel,
+          channel == alpha_index ? alpha : (color + channel * 97) & max);
+    }
+  }
+
+  for (bool unpremultiply : {false, true}) {
+    SCOPED_TRACE(unpremultiply ? "unpremultiply" : "premultiply");
+    testutil::AvifRgbImage rgb(image.get(), depth, format);
+    rgb.maxThreads = max_threads;
+    for (uint32_t y = 0; y < rgb.height; ++y) {
+      std::memcpy(rgb.pixels + y * rgb.rowBytes,
+                  original.pixels + y * original.rowBytes, rgb.rowBytes);
+    }
+    ASSERT_EQ(unpremultiply ? avifRGBImageUnpremultiplyAlpha(&rgb)
+                            : avifRGBImagePremultiplyAlpha(&rgb),
+              AVIF_RESULT_OK);
+
+    for (uint32_t i = 0; i < pixel_count; ++i) {
+      const uint32_t alpha = get(original, i, alpha_index);
+      ASSERT_EQ(get(rgb, i, alpha_index), alpha);
+      for (uint32_t channel = 0; channel < channel_count; ++channel) {
+        if (channel == alpha_index) continue;
+        const uint32_t color = get(original, i, channel);
+        uint32_t expected;
+        if (depth == 16) {
+          expected = unpremultiply ? UnpremultiplyExact(color, alpha, max)
+                                   : PremultiplyExact(color, alpha, max);
+        } else {
+          expected = unpremultiply ? UnpremultiplyFloat(color, alpha, max)
+                                   : PremultiplyFloat(color, alpha, max);
+        }
+        ASSERT_EQ(get(rgb, i, channel), expected)
+            << "color " << color << " alpha " << alpha;
+      }
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    All, AlphaMultiplyTest,
+    Combine(/*depth=*/Values(8, 10, 12, 16),
+            Values(AVIF_RGB_FORMAT_RGBA, AVIF_RGB_FORMAT_BGRA,
+                   AVIF_RGB_FORMAT_ARGB, AVIF_RGB_FORMAT_ABGR,
+                   AVIF_RGB_FORMAT_GRAYA, AVIF_RGB_FORMAT_AGRAY),
+            /*max_threads=*/Values(1, 4),
+            /*cpu_mask=*/Values(0, AVIF_CPU_SSE2, AVIF_CPU_ALL)));
+
+// Compares the SIMD kernels to the scalar ones on rows that do not fill whole
+// vectors, with color samples above alpha.
+TEST(AlphaMultiplySIMDTest, MatchesScalar) {
+  constexpr uint32_t kWidth = 67;
+  constexpr uint32_t kHeight = 64;
+  for (int depth : {8, 10, 12, 16}) {
+    for (avifRGBFormat format :
+         {AVIF_RGB_FORMAT_RGBA, AVIF_RGB_FORMAT_ARGB, AVIF_RGB_FORMAT_GRAYA,
+          AVIF_RGB_FORMAT_AGRAY}) {
+      for (bool unpremultiply : {false, true}) {
+        SCOPED_TRACE(testing::Message()
+                     << "depth " << depth << " format " << format
+                     << (unpremultiply ? " unpremultiply" : " premultiply"));
+        ImagePtr image(avifImageCreate(kWidth, kHeight, 8,
+                                       AVIF_PIXEL_FORMAT_YUV444));
+        ASSERT_NE(image, nullptr);
+        const uint32_t max = (1u << depth) - 1;
+        testutil::AvifRgbImage reference(image.get(), depth, format);
+        uint32_t seed = 4321;
+        for (uint32_t y = 0; y < kHeight; ++y) {
+          for (uint32_t x = 0; x < reference.rowBytes; x += 2) {
+            seed = seed * 1664525u + 1013904223u;
+            uint32_t value = (seed >> 8) & max;
+            // Include the extreme samples.
+            if ((seed >> 28) == 0) value = (seed & 1) ? max : 0;
+            uint8_t* s = reference.pixels + y * reference.rowBytes + x;
+            if (depth > 8) {
+              *reinterpret_cast<uint16_t*>(s) = static_cast<uint16_t>(value);
+            } else {
+              s[0] = static_cast<uint8_t>(value);
+              s[1] = static_cast<uint8_t>(value * 7);
+            }
+          }
+        }
+        testutil::AvifRgbImage rgb(image.get(), depth, format);
+        for (uint32_t y = 0; y < kHeight; ++y) {
+          std::memcpy(rgb.pixels + y * rgb.rowBytes,
+                      reference.pixels + y * reference.rowBytes, rgb.rowBytes);
+        }
+
+        avifSetCPUMask(0);
+        ASSERT_EQ(unpremultiply ? avifRGBImageUnpremultiplyAlpha(&reference)
+                                : avifRGBImagePremultiplyAlpha(&reference),
+                  AVIF_RESULT_OK);
+        for (uint32_t cpu_mask : {AVIF_CPU_SSE2, AVIF_CPU_ALL}) {
+          testutil::AvifRgbImage simd(image.get(), depth, format);
+          for (uint32_t y = 0; y < kHeight; ++y) {
+            std::memcpy(simd.pixels + y * simd.rowBytes,
+                        rgb.pixels + y * rgb.rowBytes, simd.rowBytes);
+          }
+          avifSetCPUMask(cpu_mask);
+          ASSERT_EQ(unpremultiply ? avifRGBImageUnpremultiplyAlpha(&simd)
+                                  : avifRGBImagePremultiplyAlpha(&simd),
+                    AVIF_RESULT_OK);
+          EXPECT_TRUE(testutil::AreImagesEqual(reference, simd))
+              << "cpu_mask " << cpu_mask;
+        }
+        avifSetCPUMask(AVIF_CPU_ALL);
+      }
+    }
+  }
+}
+
+// Unpremultiplying a few pixels uses divisions rather than reciprocals.
+TEST(AlphaMultiplySmallImageTest, Unpremultiply) {
+  ImagePtr image(avifImageCreate(3, 2, 8, AVIF_PIXEL_FORMAT_YUV444));
+  ASSERT_NE(image, nullptr);
+  testutil::AvifRgbImage rgb(image.get(), 12, AVIF_RGB_FORMAT_RGBA);
+  const uint16_t pixels[6][4] = {{100, 200, 300, 4095}, {100, 200, 300, 0},
+                                 {100, 200, 300, 1},    {1, 2, 3, 2048},
+                                 {4095, 0, 7, 4094},    {3, 30, 300, 3000}};
+  for (uint32_t i = 0; i < 6; ++i) {
+    std::memcpy(rgb.pixels + (i / 3) * rgb.rowBytes + (i % 3) * 8, pixels[i],
+                8);
+  }
+  ASSERT_EQ(avifRGBImageUnpremultiplyAlpha(&rgb), AVIF_RESULT_OK);
+  for (uint32_t i = 0; i < 6; ++i) {
+    const uint16_t* pixel = reinterpret_cast<const uint16_t*>(
+        rgb.pixels + (i / 3) * rgb.rowBytes + (i % 3) * 8);
+    for (int c = 0; c < 3; ++c) {
+      EXPECT_EQ(pixel[c], UnpremultiplyFloat(pixels[i][c], pixels[i][3], 4095));
+    }
+    EXPECT_EQ(pixel[3], pixels[i][3]);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace
+}  // namespace avif
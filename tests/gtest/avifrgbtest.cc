@@ -56,7 +56,10 @@ TEST_P(SetGetRGBATest, SetGetTest) {
       EXPECT_NEAR(pixel_read[0], pixel_to_write[0], epsilon);
       EXPECT_NEAR(pixel_read[1], pixel_to_write[1], epsilon);
       EXPECT_NEAR(pixel_read[2], pixel_to_write[2], epsilon);
-      if (avifRGBFormatHasAlpha(rgb_format)) {
+      if (rgb_format == AVIF_RGB_FORMAT_RGBA1010102) {
+        // Only 2 bits of alpha.
+        EXPECT_NEAR(pixel_read[3], pixel_to_write[3], 1.0f / 6);
+      } else if (avifRGBFormatHasAlpha(rgb_format)) {
         EXPECT_NEAR(pixel_read[3], pixel_to_write[3], epsilon);
       } else {
         EXPECT_EQ(pixel_read[3], 1.0f);
@@ -125,6 +128,11 @@ INSTANTIATE_TEST_SUITE_P(Rgb565, SetGetRGBATest,
                                  Values(AVIF_RGB_FORMAT_RGB_565),
                                  /*is_float=*/Values(false)));
 
+INSTANTIATE_TEST_SUITE_P(Rgba1010102, SetGetRGBATest,
+                         Combine(/*rgb_depth=*/Values(10),
+                                 Values(AVIF_RGB_FORMAT_RGBA1010102),
+                                 /*is_float=*/Values(false)));
+
 INSTANTIATE_TEST_SUITE_P(
     Float, SetGetRGBATest,
     Combine(/*rgb_depth=*/Values(16),
@@ -5,8 +5,10 @@
 #include <cmath>
 #include <cstring>
 #include <memory>
+#include <string>
 #include <tuple>
 
+#include "avif/internal.h"
 #include "aviftest_helpers.h"
 #include "gtest/gtest.h"
 
@@ -520,6 +522,185 @@ TEST(RGBToYUVTest, ZeroWidthOrHeight) {
   avifRGBImageFreePixels(&rgb);
 }
 
+// Compares the built-in bilinear chroma upsampling fast path to the slow path,
+// which is used as a reference.
+TEST(YUVToRGBTest, BilinearUpsamplingMatchesSlowPath) {
+  for (int yuv_depth : {8, 10, 12}) {
+    for (avifPixelFormat yuv_format :
+         {AVIF_PIXEL_FORMAT_YUV420, AVIF_PIXEL_FORMAT_YUV422}) {
+      for (avifRange yuv_range : {AVIF_RANGE_LIMITED, AVIF_RANGE_FULL}) {
+        for (int rgb_depth : {8, 16}) {
+          for (uint32_t width : {1u, 2u, 13u}) {
+            for (uint32_t height : {1u, 2u, 7u}) {
+              SCOPED_TRACE("yuv_depth " + std::to_string(yuv_depth) +
+                           " yuv_format " + std::to_string(yuv_format) +
+                           " rgb_depth " + std::to_string(rgb_depth) +
+                           " size " + std::to_string(width) + "x" +
+                           std::to_string(height));
+              ImagePtr image = testutil::CreateImage(
+                  width, height, yuv_depth, yuv_format, AVIF_PLANES_ALL,
+                  yuv_range);
+              ASSERT_NE(image, nullptr);
+              testutil::FillImageGradient(image.get());
+              image->matrixCoefficients = AVIF_MATRIX_COEFFICIENTS_BT601;
+              ImagePtr no_alpha(avifImageCreateEmpty());
+              ASSERT_NE(no_alpha, nullptr);
+              ASSERT_EQ(avifImageCopy(no_alpha.get(), image.get(),
+                                      AVIF_PLANES_YUV),
+                        AVIF_RESULT_OK);
+
+              // Converting a non-opaque image to a format without alpha
+              // requires premultiplication, which only the slow path handles.
+              // Make all pixels but the first one opaque, so that the others
+              // are left unchanged by the premultiplication.
+              const uint32_t max_channel = (1u << yuv_depth) - 1;
+              for (uint32_t y = 0; y < height; ++y) {
+                uint8_t* row =
+                    image->alphaPlane + (size_t)y * image->alphaRowBytes;
+                for (uint32_t x = 0; x < width; ++x) {
+                  const uint32_t alpha = (x == 0 && y == 0) ? 0 : max_channel;
+                  if (yuv_depth == 8) {
+                    row[x] = static_cast<uint8_t>(alpha);
+                  } else {
+                    reinterpret_cast<uint16_t*>(row)[x] =
+                        static_cast<uint16_t>(alpha);
+                  }
+                }
+              }
+
+              testutil::AvifRgbImage reference(image.get(), rgb_depth,
+                                               AVIF_RGB_FORMAT_RGB);
+              reference.avoidLibYUV = AVIF_TRUE;
+              ASSERT_EQ(avifImageYUVToRGB(image.get(), &reference),
+                        AVIF_RESULT_OK);
+              testutil::AvifRgbImage rgb(no_alpha.get(), rgb_depth,
+                                         AVIF_RGB_FORMAT_RGB);
+              rgb.avoidLibYUV = AVIF_TRUE;
+              ASSERT_EQ(avifImageYUVToRGB(no_alpha.get(), &rgb),
+                        AVIF_RESULT_OK);
+
+              // The fast path upsamples vertically then horizontally, so
+              // rounding may differ slightly.
+              int max_diff = 0;
+              for (uint32_t y = 0; y < height; ++y) {
+                for (uint32_t x = (y == 0) ? 1 : 0; x < width; ++x) {
+                  for (uint32_t c = 0; c < 3; ++c) {
+                    const size_t offset = (size_t)y * rgb.rowBytes +
+                                          (x * 3 + c) * (rgb_depth / 8);
+                    const int a =
+                        (rgb_depth == 8)
+                            ? reference.pixels[offset]
+                            : *reinterpret_cast<uint16_t*>(reference.pixels +
+                                                           offset);
+                    const int b =
+                        (rgb_depth == 8)
+                            ? rgb.pixels[offset]
+                            : *reinterpret_cast<uint16_t*>(rgb.pixels + offset);
+                    max_diff = std::max(max_diff, std::abs(a - b));
+                  }
+                }
+              }
+              EXPECT_LE(max_diff, 1);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// Returns the sample at index in row, of rgb.depth bits.
+int GetRgbSample(const avifRGBImage& rgb, uint32_t y, uint32_t index) {
+  const uint8_t* row = rgb.pixels + (size_t)y * rgb.rowBytes;
+  return (rgb.depth > 8) ? reinterpret_cast<const uint16_t*>(row)[index]
+                         : row[index];
+}
+
+// Compares the SIMD kernels of the bilinear chroma upsampling path, if any, to
+// its scalar code. The widths cover the tails of the 4 and 8 pixel loops. The
+// formats of 3 RGB samples per pixel only use the chroma kernels.
+TEST(YUVToRGBTest, BilinearUpsamplingSIMDMatchesScalar) {
+  for (int yuv_depth : {8, 10, 12}) {
+    for (int rgb_depth : {8, 10, 16}) {
+      for (avifPixelFormat yuv_format :
+           {AVIF_PIXEL_FORMAT_YUV420, AVIF_PIXEL_FORMAT_YUV422}) {
+        for (avifRange yuv_range : {AVIF_RANGE_LIMITED, AVIF_RANGE_FULL}) {
+          for (avifRGBFormat rgb_format :
+               {AVIF_RGB_FORMAT_RGBA, AVIF_RGB_FORMAT_ARGB,
+                AVIF_RGB_FORMAT_BGRA, AVIF_RGB_FORMAT_ABGR,
+                AVIF_RGB_FORMAT_RGB}) {
+            for (uint32_t width : {1u, 4u, 7u, 8u, 9u, 17u, 18u, 33u, 67u}) {
+              constexpr uint32_t kHeight = 5;
+              SCOPED_TRACE("yuv_depth " + std::to_string(yuv_depth) +
+                           " rgb_depth " + std::to_string(rgb_depth) +
+                           " yuv_format " + std::to_string(yuv_format) +
+                           " yuv_range " + std::to_string(yuv_range) +
+                           " rgb_format " + std::to_string(rgb_format) +
+                           " width " + std::to_string(width));
+              ImagePtr image =
+                  testutil::CreateImage(width, kHeight, yuv_depth, yuv_format,
+                                        AVIF_PLANES_YUV, yuv_range);
+              ASSERT_NE(image, nullptr);
+              testutil::FillImageGradient(image.get());
+              image->matrixCoefficients = AVIF_MATRIX_COEFFICIENTS_BT601;
+
+              testutil::AvifRgbImage scalar(image.get(), rgb_depth,
+                                            rgb_format);
+              scalar.avoidLibYUV = AVIF_TRUE;
+              scalar.chromaUpsampling = AVIF_CHROMA_UPSAMPLING_BILINEAR;
+              avifSetCPUMask(0);
+              const avifResult scalar_result =
+                  avifImageYUVToRGB(image.get(), &scalar);
+              for (uint32_t mask : {AVIF_CPU_SSE2, AVIF_CPU_ALL}) {
+                testutil::AvifRgbImage simd(image.get(), rgb_depth,
+                                            rgb_format);
+                simd.avoidLibYUV = AVIF_TRUE;
+                simd.chromaUpsampling = AVIF_CHROMA_UPSAMPLING_BILINEAR;
+                avifSetCPUMask(mask);
+                const avifResult simd_result =
+                    avifImageYUVToRGB(image.get(), &simd);
+                avifSetCPUMask(AVIF_CPU_ALL);
+                ASSERT_EQ(scalar_result, AVIF_RESULT_OK);
+                ASSERT_EQ(simd_result, AVIF_RESULT_OK);
+
+                // Both use the same float operations, but the scalar code may
+                // be compiled with fused multiply-adds.
+                const uint32_t channel_count =
+                    avifRGBFormatChannelCount(rgb_format);
+                const int max_alpha = (1 << rgb_depth) - 1;
+                int max_diff = 0;
+                for (uint32_t y = 0; y < kHeight; ++y) {
+                  for (uint32_t i = 0; i < width * channel_count; ++i) {
+                    max_diff = std::max(
+                        max_diff, std::abs(GetRgbSample(scalar, y, i) -
+                                           GetRgbSample(simd, y, i)));
+                  }
+                }
+                EXPECT_LE(max_diff, 1) << "mask " << mask;
+                if (avifRGBFormatHasAlpha(rgb_format)) {
+                  // The kernels leave the alpha samples to the opaque fill.
+                  const uint32_t alpha_offset =
+                      (rgb_format == AVIF_RGB_FORMAT_ARGB ||
+                       rgb_format == AVIF_RGB_FORMAT_ABGR)
+                          ? 0
+                          : 3;
+                  for (uint32_t y = 0; y < kHeight; ++y) {
+                    for (uint32_t x = 0; x < width; ++x) {
+                      ASSERT_EQ(GetRgbSample(simd, y, x * 4 + alpha_offset),
+                                max_alpha);
+                    }
+                  }
+                }
+              }
+              avifSetCPUMask(AVIF_CPU_ALL);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 // Selected configurations
 
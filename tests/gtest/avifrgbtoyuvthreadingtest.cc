@@ -41,6 +41,9 @@ TEST_P(YUVToRGBThreadingTest, TestIdentical) {
   if (rgb_depth > 8 && rgb_format == AVIF_RGB_FORMAT_RGB_565) {
     return;
   }
+  if (rgb_depth != 10 && rgb_format == AVIF_RGB_FORMAT_RGBA1010102) {
+    return;
+  }
 
   ImagePtr yuv(avifImageCreate(width, height, yuv_depth, yuv_format));
   ASSERT_NE(yuv, nullptr);
@@ -0,0 +1,229 @@
+// Copyright 2026 Google LLC
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "avif/avif.h"
+#include "aviftest_helpers.h"
+#include "gtest/gtest.h"
+
+namespace avif {
+namespace {
+
+// Used to pass the data folder path to the GoogleTest suites.
+const char* data_path = nullptr;
+
+//------------------------------------------------------------------------------
+
+struct RowBand {
+  uint32_t first_row;
+  uint32_t row_count;
+};
+
+void RecordRowBand(avifDecoder* /*decoder*/, uint32_t first_row,
+                   uint32_t row_count, void* user_data) {
+  reinterpret_cast<std::vector<RowBand>*>(user_data)->push_back(
+      {first_row, row_count});
+}
+
+// Checks that the bands cover [0:height) from top to bottom without overlap.
+void ExpectContiguousBands(const std::vector<RowBand>& bands,
+                           uint32_t height) {
+  uint32_t next_row = 0;
+  for (const RowBand& band : bands) {
+    EXPECT_EQ(band.first_row, next_row);
+    EXPECT_GT(band.row_count, 0u);
+    next_row = band.first_row + band.row_count;
+  }
+  EXPECT_EQ(next_row, height);
+}
+
+// Simulates a network stream where only the first available_size bytes were
+// received.
+struct StreamingData {
+  const avifRWData* file;
+  size_t available_size;
+};
+
+avifResult StreamingRead(avifIO* io, uint32_t read_flags, uint64_t offset,
+                         size_t size, avifROData* out) {
+  StreamingData* data = reinterpret_cast<StreamingData*>(io->data);
+  if (read_flags != 0 || offset > data->file->size) {
+    return AVIF_RESULT_IO_ERROR;
+  }
+  size = std::min(size, static_cast<size_t>(data->file->size - offset));
+  if (offset + size > data->available_size) {
+    return AVIF_RESULT_WAITING_ON_IO;
+  }
+  out->data = data->file->data + offset;
+  out->size = size;
+  return AVIF_RESULT_OK;
+}
+
+class RowsReadyTest
+    : public testing::TestWithParam<
+          std::tuple<std::string, avifRGBFormat, avifChromaUpsampling>> {};
+
+TEST_P(RowsReadyTest, SameAsWholeImageConversion) {
+  if (!testutil::Av1DecoderAvailable()) {
+    GTEST_SKIP() << "AV1 Codec unavailable, skip test.";
+  }
+  const std::string& file_name = std::get<0>(GetParam());
+  const avifRGBFormat rgb_format = std::get<1>(GetParam());
+  const avifChromaUpsampling upsampling = std::get<2>(GetParam());
+
+  DecoderPtr decoder(avifDecoderCreate());
+  ASSERT_NE(decoder, nullptr);
+  ASSERT_EQ(avifDecoderSetIOFile(decoder.get(),
+                                 (std::string(data_path) + file_name).c_str()),
+            AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK);
+  testutil::AvifRgbImage rgb(decoder->image, decoder->image->depth,
+                             rgb_format);
+  rgb.chromaUpsampling = upsampling;
+  std::vector<RowBand> bands;
+  decoder->rgbOutput = &rgb;
+  decoder->rowsReady = RecordRowBand;
+  decoder->rowsReadyUserData = &bands;
+  ASSERT_EQ(avifDecoderNextImage(decoder.get()), AVIF_RESULT_OK);
+  ExpectContiguousBands(bands, decoder->image->height);
+
+  testutil::AvifRgbImage reference(decoder->image, decoder->image->depth,
+                                   rgb_format);
+  reference.chromaUpsampling = upsampling;
+  ASSERT_EQ(avifImageYUVToRGB(decoder->image, &reference), AVIF_RESULT_OK);
+  EXPECT_TRUE(testutil::AreImagesEqual(rgb, reference));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Grid, RowsReadyTest,
+    testing::Combine(testing::Values("sofa_grid1x5_420.avif",
+                                     "color_grid_alpha_nogrid.avif",
+                                     "color_grid_alpha_grid_gainmap_nogrid.avif"),
+                     testing::Values(AVIF_RGB_FORMAT_RGBA,
+                                     AVIF_RGB_FORMAT_BGR),
+                     testing::Values(AVIF_CHROMA_UPSAMPLING_BILINEAR,
+                                     AVIF_CHROMA_UPSAMPLING_NEAREST)));
+INSTANTIATE_TEST_SUITE_P(
+    NoGrid, RowsReadyTest,
+    testing::Combine(testing::Values("white_1x1.avif",
+                                     "paris_icc_exif_xmp.avif"),
+                     testing::Values(AVIF_RGB_FORMAT_RGBA),
+                     testing::Values(AVIF_CHROMA_UPSAMPLING_AUTOMATIC)));
+
+// The grid is converted band by band while the file is still being received.
+TEST(RowsReadyIncrementalTest, Grid) {
+  if (!testutil::Av1DecoderAvailable()) {
+    GTEST_SKIP() << "AV1 Codec unavailable, skip test.";
+  }
+  const testutil::AvifRwData file =
+      testutil::ReadFile(std::string(data_path) + "sofa_grid1x5_420.avif");
+  ASSERT_NE(file.size, 0u);
+  StreamingData data = {&file, file.size};
+  avifIO io = {};
+  io.read = StreamingRead;
+  io.sizeHint = file.size;
+  io.persistent = AVIF_TRUE;
+  io.data = &data;
+  DecoderPtr decoder(avifDecoderCreate());
+  ASSERT_NE(decoder, nullptr);
+  avifDecoderSetIO(decoder.get(), &io);
+  decoder->allowIncremental = AVIF_TRUE;
+  ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK);
+
+  testutil::AvifRgbImage rgb(decoder->image, 8, AVIF_RGB_FORMAT_RGBA);
+  std::vector<RowBand> bands;
+  decoder->rgbOutput = &rgb;
+  decoder->rowsReady = RecordRowBand;
+  decoder->rowsReadyUserData = &bands;
+
+  // Only make the beginning of the file available, then feed the rest in
+  // chunks until the image is fully decoded.
+  data.available_size = file.size / 4;
+  uint32_t num_waits_with_rows = 0;
+  avifResult result;
+  while ((result = avifDecoderNextImage(decoder.get())) ==
+         AVIF_RESULT_WAITING_ON_IO) {
+    if (!bands.empty()) {
+      ++num_waits_with_rows;
+      // Converted rows never exceed decoded rows.
+      EXPECT_LE(bands.back().first_row + bands.back().row_count,
+                avifDecoderDecodedRowCount(decoder.get()));
+    }
+    ASSERT_LT(data.available_size, file.size);
+    data.available_size = std::min(data.available_size + file.size / 16,
+                                   static_cast<size_t>(file.size));
+  }
+  ASSERT_EQ(result, AVIF_RESULT_OK);
+  EXPECT_GT(num_waits_with_rows, 0u);
+  ExpectContiguousBands(bands, decoder->image->height);
+
+  testutil::AvifRgbImage reference(decoder->image, 8, AVIF_RGB_FORMAT_RGBA);
+  ASSERT_EQ(avifImageYUVToRGB(decoder->image, &reference), AVIF_RESULT_OK);
+  EXPECT_TRUE(testutil::AreImagesEqual(rgb, reference));
+  decoder->io = nullptr;  // io is owned by this function.
+}
+
+// Without rgbOutput, the callback reports the rows of decoder->image.
+TEST(RowsReadyNoRgbTest, Grid) {
+  if (!testutil::Av1DecoderAvailable()) {
+    GTEST_SKIP() << "AV1 Codec unavailable, skip test.";
+  }
+  DecoderPtr decoder(avifDecoderCreate());
+  ASSERT_NE(decoder, nullptr);
+  ASSERT_EQ(avifDecoderSetIOFile(
+                decoder.get(),
+                (std::string(data_path) + "sofa_grid1x5_420.avif").c_str()),
+            AVIF_RESULT_OK);
+  std::vector<RowBand> bands;
+  decoder->rowsReady = RecordRowBand;
+  decoder->rowsReadyUserData = &bands;
+  ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderNextImage(decoder.get()), AVIF_RESULT_OK);
+  // One band per grid row.
+  EXPECT_EQ(bands.size(), 5u);
+  ExpectContiguousBands(bands, decoder->image->height);
+}
+
+TEST(RowsReadyInvalidTest, WrongDimensions) {
+  if (!testutil::Av1DecoderAvailable()) {
+    GTEST_SKIP() << "AV1 Codec unavailable, skip test.";
+  }
+  DecoderPtr decoder(avifDecoderCreate());
+  ASSERT_NE(decoder, nullptr);
+  ASSERT_EQ(avifDecoderSetIOFile(
+                decoder.get(),
+                (std::string(data_path) + "sofa_grid1x5_420.avif").c_str()),
+            AVIF_RESULT_OK);
+  ASSERT_EQ(avifDecoderParse(decoder.get()), AVIF_RESULT_OK);
+  ImagePtr smaller(avifImageCreate(decoder->image->width / 2,
+                                   decoder->image->height, 8,
+                                   AVIF_PIXEL_FORMAT_YUV420));
+  ASSERT_NE(smaller, nullptr);
+  testutil::AvifRgbImage rgb(smaller.get(), 8, AVIF_RGB_FORMAT_RGBA);
+  decoder->rgbOutput = &rgb;
+  EXPECT_EQ(avifDecoderNextImage(decoder.get()),
+            AVIF_RESULT_INVALID_ARGUMENT);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace
+}  // namespace avif
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  if (argc != 2) {
+    std::cerr << "There must be exactly one argument containing the path to "
+                 "the test data folder"
+              << std::endl;
+    return 1;
+  }
+  avif::data_path = argv[1];
+  return RUN_ALL_TESTS();
+}
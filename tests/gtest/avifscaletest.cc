@@ -2,9 +2,12 @@
 // SPDX-License-Identifier: BSD-2-Clause
 
 #include <cstdint>
+#include <cstring>
 #include <limits>
+#include <utility>
 
 #include "avif/avif.h"
+#include "avif/internal.h"
 #include "aviftest_helpers.h"
 #include "gtest/gtest.h"
 
@@ -94,6 +97,372 @@ TEST(ScaleTest, LargerThanDefaultLimits) {
 
 //------------------------------------------------------------------------------
 
+// Returns a YUV 4:4:4 image converted from rgb, to compare RGB images with
+// testutil::GetPsnr().
+ImagePtr ToYuv444(const avifRGBImage& rgb) {
+  ImagePtr image(avifImageCreate(rgb.width, rgb.height, rgb.depth,
+                                 AVIF_PIXEL_FORMAT_YUV444));
+  if (image == nullptr ||
+      avifImageRGBToYUV(image.get(), &rgb) != AVIF_RESULT_OK) {
+    return nullptr;
+  }
+  return image;
+}
+
+class YUVToRGBScaledTest
+    : public testing::TestWithParam<
+          std::tuple</*bit_depth=*/int, /*yuv_format=*/avifPixelFormat,
+                     /*create_alpha=*/bool>> {};
+
+// Filtering while converting is close to scaling the YUV planes then
+// converting.
+TEST_P(YUVToRGBScaledTest, SimilarToScaleThenConvert) {
+  const int bit_depth = std::get<0>(GetParam());
+  const avifPixelFormat yuv_format = std::get<1>(GetParam());
+  const bool create_alpha = std::get<2>(GetParam());
+
+  const ImagePtr image =
+      testutil::ReadImage(data_path, "paris_exif_xmp_icc.jpg", yuv_format,
+                          bit_depth, AVIF_CHROMA_DOWNSAMPLING_BEST_QUALITY,
+                          kIgnoreMetadata, kIgnoreMetadata, kIgnoreMetadata);
+  ASSERT_NE(image, nullptr);
+  if (create_alpha && !image->alphaPlane) {
+    // Simulate alpha plane with a view on luma.
+    image->alphaPlane = image->yuvPlanes[AVIF_CHAN_Y];
+    image->alphaRowBytes = image->yuvRowBytes[AVIF_CHAN_Y];
+    image->imageOwnsAlphaPlane = false;
+  }
+
+  const uint32_t scaled_width = image->width / 3;
+  const uint32_t scaled_height = image->height / 4 + 1;
+  ImagePtr scaled_image(avifImageCreateEmpty());
+  ASSERT_NE(scaled_image, nullptr);
+  ASSERT_EQ(avifImageCopy(scaled_image.get(), image.get(), AVIF_PLANES_ALL),
+            AVIF_RESULT_OK);
+  avifDiagnostics diag;
+  ASSERT_EQ(
+      avifImageScale(scaled_image.get(), scaled_width, scaled_height, &diag),
+      AVIF_RESULT_OK)
+      << diag.error;
+  testutil::AvifRgbImage reference(scaled_image.get(), 8,
+                                   AVIF_RGB_FORMAT_RGBA);
+  ASSERT_EQ(avifImageYUVToRGB(scaled_image.get(), &reference), AVIF_RESULT_OK);
+
+  testutil::AvifRgbImage rgb(scaled_image.get(), 8, AVIF_RGB_FORMAT_RGBA);
+  ASSERT_EQ(avifImageYUVToRGBScaled(image.get(), &rgb), AVIF_RESULT_OK);
+
+  const ImagePtr reference_yuv = ToYuv444(reference);
+  const ImagePtr rgb_yuv = ToYuv444(rgb);
+  ASSERT_NE(reference_yuv, nullptr);
+  ASSERT_NE(rgb_yuv, nullptr);
+  EXPECT_GT(testutil::GetPsnr(*reference_yuv, *rgb_yuv), 35.0);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Some, YUVToRGBScaledTest,
+    Combine(/*bit_depth=*/Values(8, 10),
+            Values(AVIF_PIXEL_FORMAT_YUV444, AVIF_PIXEL_FORMAT_YUV422,
+                   AVIF_PIXEL_FORMAT_YUV420, AVIF_PIXEL_FORMAT_YUV400),
+            /*create_alpha=*/Values(true, false)));
+
+TEST(YUVToRGBScaledBoxTest, Average) {
+  // Each output pixel is the rounded average of a 2x2 block of samples.
+  ImagePtr image = testutil::CreateImage(4, 2, 8, AVIF_PIXEL_FORMAT_YUV444,
+                                         AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  const uint32_t yuv[] = {100, 128, 128};
+  testutil::FillImagePlain(image.get(), yuv);
+  image->yuvPlanes[AVIF_CHAN_Y][0] = 10;
+  image->yuvPlanes[AVIF_CHAN_Y][3] = 141;
+  image->yuvPlanes[AVIF_CHAN_Y][image->yuvRowBytes[AVIF_CHAN_Y] + 2] = 200;
+
+  ImagePtr expected = testutil::CreateImage(2, 1, 8, AVIF_PIXEL_FORMAT_YUV444,
+                                            AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(expected, nullptr);
+  testutil::FillImagePlain(expected.get(), yuv);
+  expected->yuvPlanes[AVIF_CHAN_Y][0] = (10 + 100 * 3 + 2) / 4;
+  expected->yuvPlanes[AVIF_CHAN_Y][1] = (141 + 200 + 100 * 2 + 2) / 4;
+  testutil::AvifRgbImage reference(expected.get(), 8, AVIF_RGB_FORMAT_RGB);
+  ASSERT_EQ(avifImageYUVToRGB(expected.get(), &reference), AVIF_RESULT_OK);
+
+  testutil::AvifRgbImage rgb(expected.get(), 8, AVIF_RGB_FORMAT_RGB);
+  ASSERT_EQ(avifImageYUVToRGBScaled(image.get(), &rgb), AVIF_RESULT_OK);
+  EXPECT_TRUE(testutil::AreImagesEqual(reference, rgb));
+
+  // Upscaling is not supported.
+  testutil::AvifRgbImage larger(image.get(), 8, AVIF_RGB_FORMAT_RGB);
+  larger.width = image->width + 1;
+  EXPECT_EQ(avifImageYUVToRGBScaled(image.get(), &larger),
+            AVIF_RESULT_INVALID_ARGUMENT);
+
+  // Unsupported conversions are not reported as allocation failures.
+  testutil::AvifRgbImage unsupported(expected.get(), 8,
+                                     AVIF_RGB_FORMAT_RGB_565);
+  unsupported.depth = 10;
+  EXPECT_EQ(avifImageYUVToRGBScaled(image.get(), &unsupported),
+            AVIF_RESULT_REFORMAT_FAILED);
+}
+
+//------------------------------------------------------------------------------
+// avifImageScaleInto()
+
+// Returns an image with the properties of image but without planes.
+ImagePtr CreateLike(const avifImage& image, uint32_t width, uint32_t height) {
+  ImagePtr scaled(
+      avifImageCreate(width, height, image.depth, image.yuvFormat));
+  if (scaled != nullptr) scaled->yuvRange = image.yuvRange;
+  return scaled;
+}
+
+class ScaleIntoTest
+    : public testing::TestWithParam<
+          std::tuple</*bit_depth=*/int, /*yuv_format=*/avifPixelFormat,
+                     avifScaleFilter>> {};
+
+TEST_P(ScaleIntoTest, Roundtrip) {
+  const int bit_depth = std::get<0>(GetParam());
+  const avifPixelFormat yuv_format = std::get<1>(GetParam());
+  const avifScaleFilter filter = std::get<2>(GetParam());
+
+  const ImagePtr image =
+      testutil::ReadImage(data_path, "paris_exif_xmp_icc.jpg", yuv_format,
+                          bit_depth, AVIF_CHROMA_DOWNSAMPLING_BEST_QUALITY,
+                          kIgnoreMetadata, kIgnoreMetadata, kIgnoreMetadata);
+  ASSERT_NE(image, nullptr);
+  if (!image->alphaPlane) {
+    // Simulate alpha plane with a view on luma.
+    image->alphaPlane = image->yuvPlanes[AVIF_CHAN_Y];
+    image->alphaRowBytes = image->yuvRowBytes[AVIF_CHAN_Y];
+    image->imageOwnsAlphaPlane = false;
+  }
+
+  ImagePtr scaled_image =
+      CreateLike(*image, static_cast<uint32_t>(image->width * 0.9),
+                 static_cast<uint32_t>(image->height * 2.14));
+  ASSERT_NE(scaled_image, nullptr);
+  avifDiagnostics diag;
+  ASSERT_EQ(avifImageScaleInto(image.get(), scaled_image.get(), filter,
+                               /*maxThreads=*/4, &diag),
+            AVIF_RESULT_OK)
+      << diag.error;
+  ASSERT_NE(scaled_image->alphaPlane, nullptr);
+
+  ImagePtr roundtrip = CreateLike(*image, image->width, image->height);
+  ASSERT_NE(roundtrip, nullptr);
+  ASSERT_EQ(avifImageScaleInto(scaled_image.get(), roundtrip.get(), filter,
+                               /*maxThreads=*/4, &diag),
+            AVIF_RESULT_OK)
+      << diag.error;
+  const double psnr = testutil::GetPsnr(*image, *roundtrip);
+  EXPECT_GT(psnr, 30.0);
+  EXPECT_LT(psnr, 50.0);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Some, ScaleIntoTest,
+    Combine(/*bit_depth=*/Values(8, 10, 12),
+            Values(AVIF_PIXEL_FORMAT_YUV444, AVIF_PIXEL_FORMAT_YUV420,
+                   AVIF_PIXEL_FORMAT_YUV400),
+            Values(AVIF_SCALE_FILTER_BOX, AVIF_SCALE_FILTER_BILINEAR,
+                   AVIF_SCALE_FILTER_BICUBIC, AVIF_SCALE_FILTER_LANCZOS3)));
+
+TEST(ScaleIntoFilterTest, ThreadsFlatAndIdentity) {
+  ImagePtr image = testutil::CreateImage(
+      75, 150, 10, AVIF_PIXEL_FORMAT_YUV420, AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  testutil::FillImageGradient(image.get());
+  ImagePtr flat = testutil::CreateImage(
+      75, 150, 10, AVIF_PIXEL_FORMAT_YUV420, AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+  ASSERT_NE(flat, nullptr);
+  const uint32_t yuva[] = {1023, 0, 700, 512};
+  testutil::FillImagePlain(flat.get(), yuva);
+
+  for (avifScaleFilter filter :
+       {AVIF_SCALE_FILTER_BOX, AVIF_SCALE_FILTER_BILINEAR,
+        AVIF_SCALE_FILTER_BICUBIC, AVIF_SCALE_FILTER_LANCZOS3}) {
+    SCOPED_TRACE(filter);
+    for (const auto& [width, height] :
+         {std::pair<uint32_t, uint32_t>{31, 400}, {200, 67}}) {
+      // The number of threads does not change the result.
+      ImagePtr single = CreateLike(*image, width, height);
+      ImagePtr multi = CreateLike(*image, width, height);
+      ASSERT_NE(single, nullptr);
+      ASSERT_NE(multi, nullptr);
+      ASSERT_EQ(avifImageScaleInto(image.get(), single.get(), filter, 1,
+                                   nullptr),
+                AVIF_RESULT_OK);
+      ASSERT_EQ(avifImageScaleInto(image.get(), multi.get(), filter, 8,
+                                   nullptr),
+                AVIF_RESULT_OK);
+      EXPECT_TRUE(testutil::AreImagesEqual(*single, *multi));
+
+      // Flat planes stay flat.
+      ImagePtr flat_scaled = CreateLike(*flat, width, height);
+      ImagePtr expected = testutil::CreateImage(
+          width, height, 10, AVIF_PIXEL_FORMAT_YUV420, AVIF_PLANES_ALL,
+          AVIF_RANGE_FULL);
+      ASSERT_NE(flat_scaled, nullptr);
+      ASSERT_NE(expected, nullptr);
+      testutil::FillImagePlain(expected.get(), yuva);
+      ASSERT_EQ(avifImageScaleInto(flat.get(), flat_scaled.get(), filter, 2,
+                                   nullptr),
+                AVIF_RESULT_OK);
+      EXPECT_TRUE(testutil::AreImagesEqual(*flat_scaled, *expected));
+    }
+
+    // Same dimensions is a copy.
+    ImagePtr copy = CreateLike(*image, image->width, image->height);
+    ASSERT_NE(copy, nullptr);
+    ASSERT_EQ(avifImageScaleInto(image.get(), copy.get(), filter, 1, nullptr),
+              AVIF_RESULT_OK);
+    EXPECT_TRUE(testutil::AreImagesEqual(*image, *copy));
+  }
+}
+
+// Compares the SIMD kernels to the scalar ones on noise, which makes the
+// filters overshoot, with windows that are not multiples of the vector sizes.
+TEST(ScaleIntoFilterTest, SIMDMatchesScalar) {
+  for (int depth : {8, 10, 12, 16}) {
+    ImagePtr image = testutil::CreateImage(150, 70, depth,
+                                           AVIF_PIXEL_FORMAT_YUV420,
+                                           AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+    ASSERT_NE(image, nullptr);
+    const uint32_t max = (1u << depth) - 1;
+    uint32_t seed = 777;
+    for (int c = AVIF_CHAN_Y; c <= AVIF_CHAN_A; ++c) {
+      uint8_t* plane = avifImagePlane(image.get(), c);
+      const uint32_t row_bytes = avifImagePlaneRowBytes(image.get(), c);
+      for (uint32_t y = 0; y < avifImagePlaneHeight(image.get(), c); ++y) {
+        for (uint32_t x = 0; x < avifImagePlaneWidth(image.get(), c); ++x) {
+          seed = seed * 1664525u + 1013904223u;
+          // Mostly extreme samples.
+          uint32_t value = ((seed >> 16) & 1) ? max : 0;
+          if ((seed >> 28) == 0) value = (seed >> 8) & max;
+          if (depth > 8) {
+            reinterpret_cast<uint16_t*>(plane + y * row_bytes)[x] =
+                static_cast<uint16_t>(value);
+          } else {
+            plane[y * row_bytes + x] = static_cast<uint8_t>(value);
+          }
+        }
+      }
+    }
+
+    for (avifScaleFilter filter :
+         {AVIF_SCALE_FILTER_BOX, AVIF_SCALE_FILTER_BILINEAR,
+          AVIF_SCALE_FILTER_BICUBIC, AVIF_SCALE_FILTER_LANCZOS3}) {
+      for (const auto& [width, height] :
+           {std::pair<uint32_t, uint32_t>{301, 163}, {121, 45}, {37, 19}}) {
+        SCOPED_TRACE(testing::Message() << "depth " << depth << " filter "
+                                        << filter << " " << width << "x"
+                                        << height);
+        ImagePtr reference = CreateLike(*image, width, height);
+        ASSERT_NE(reference, nullptr);
+        avifSetCPUMask(0);
+        ASSERT_EQ(avifImageScaleInto(image.get(), reference.get(), filter, 1,
+                                     nullptr),
+                  AVIF_RESULT_OK);
+        for (uint32_t cpu_mask : {AVIF_CPU_SSE2, AVIF_CPU_ALL}) {
+          ImagePtr scaled = CreateLike(*image, width, height);
+          ASSERT_NE(scaled, nullptr);
+          avifSetCPUMask(cpu_mask);
+          ASSERT_EQ(avifImageScaleInto(image.get(), scaled.get(), filter, 1,
+                                       nullptr),
+                    AVIF_RESULT_OK);
+          EXPECT_TRUE(testutil::AreImagesEqual(*reference, *scaled))
+              << "cpu_mask " << cpu_mask;
+        }
+        avifSetCPUMask(AVIF_CPU_ALL);
+      }
+    }
+  }
+}
+
+TEST(ScaleIntoFilterTest, BoxAverage) {
+  ImagePtr image = testutil::CreateImage(4, 2, 8, AVIF_PIXEL_FORMAT_YUV400,
+                                         AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  const uint8_t samples[2][4] = {{10, 20, 30, 40}, {50, 60, 70, 81}};
+  for (int y = 0; y < 2; ++y) {
+    std::memcpy(image->yuvPlanes[AVIF_CHAN_Y] +
+                    y * image->yuvRowBytes[AVIF_CHAN_Y],
+                samples[y], 4);
+  }
+  ImagePtr scaled = CreateLike(*image, 2, 1);
+  ASSERT_NE(scaled, nullptr);
+  ASSERT_EQ(avifImageScaleInto(image.get(), scaled.get(),
+                               AVIF_SCALE_FILTER_BOX, 1, nullptr),
+            AVIF_RESULT_OK);
+  EXPECT_EQ(scaled->yuvPlanes[AVIF_CHAN_Y][0], (10 + 20 + 50 + 60 + 2) / 4);
+  EXPECT_EQ(scaled->yuvPlanes[AVIF_CHAN_Y][1], (30 + 40 + 70 + 81 + 2) / 4);
+}
+
+TEST(ScaleIntoFilterTest, CallerProvidedDestination) {
+  ImagePtr image = testutil::CreateImage(
+      64, 48, 8, AVIF_PIXEL_FORMAT_YUV422, AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  testutil::FillImageGradient(image.get());
+
+  // Planes that the destination image does not own.
+  ImagePtr owner = testutil::CreateImage(
+      32, 24, 8, AVIF_PIXEL_FORMAT_YUV422, AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(owner, nullptr);
+  ImagePtr scaled = CreateLike(*image, 32, 24);
+  ASSERT_NE(scaled, nullptr);
+  for (int c = AVIF_CHAN_Y; c <= AVIF_CHAN_V; ++c) {
+    scaled->yuvPlanes[c] = owner->yuvPlanes[c];
+    scaled->yuvRowBytes[c] = owner->yuvRowBytes[c];
+  }
+  scaled->imageOwnsYUVPlanes = AVIF_FALSE;
+  ASSERT_EQ(avifImageScaleInto(image.get(), scaled.get(),
+                               AVIF_SCALE_FILTER_BICUBIC, 2, nullptr),
+            AVIF_RESULT_OK);
+  EXPECT_EQ(scaled->yuvPlanes[AVIF_CHAN_Y], owner->yuvPlanes[AVIF_CHAN_Y]);
+  EXPECT_FALSE(scaled->imageOwnsYUVPlanes);
+
+  ImagePtr reference = CreateLike(*image, 32, 24);
+  ASSERT_NE(reference, nullptr);
+  ASSERT_EQ(avifImageScaleInto(image.get(), reference.get(),
+                               AVIF_SCALE_FILTER_BICUBIC, 1, nullptr),
+            AVIF_RESULT_OK);
+  EXPECT_TRUE(testutil::AreImagesEqual(*reference, *scaled));
+}
+
+TEST(ScaleIntoFilterTest, InvalidArguments) {
+  ImagePtr image = testutil::CreateImage(
+      16, 16, 8, AVIF_PIXEL_FORMAT_YUV420, AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  avifDiagnostics diag;
+  EXPECT_EQ(avifImageScaleInto(image.get(), image.get(),
+                               AVIF_SCALE_FILTER_BOX, 1, &diag),
+            AVIF_RESULT_INVALID_ARGUMENT);
+  ImagePtr other_depth(avifImageCreate(8, 8, 10, AVIF_PIXEL_FORMAT_YUV420));
+  ASSERT_NE(other_depth, nullptr);
+  EXPECT_EQ(avifImageScaleInto(image.get(), other_depth.get(),
+                               AVIF_SCALE_FILTER_BOX, 1, &diag),
+            AVIF_RESULT_INVALID_ARGUMENT);
+  ImagePtr other_format(avifImageCreate(8, 8, 8, AVIF_PIXEL_FORMAT_YUV444));
+  ASSERT_NE(other_format, nullptr);
+  EXPECT_EQ(avifImageScaleInto(image.get(), other_format.get(),
+                               AVIF_SCALE_FILTER_BOX, 1, &diag),
+            AVIF_RESULT_INVALID_ARGUMENT);
+  ImagePtr too_large = CreateLike(*image, 40000, 2);
+  ASSERT_NE(too_large, nullptr);
+  EXPECT_NE(avifImageScaleInto(image.get(), too_large.get(),
+                               AVIF_SCALE_FILTER_BOX, 1, &diag),
+            AVIF_RESULT_OK);
+  ImagePtr scaled = CreateLike(*image, 8, 8);
+  ASSERT_NE(scaled, nullptr);
+  EXPECT_EQ(avifImageScaleInto(image.get(), scaled.get(),
+                               AVIF_SCALE_FILTER_COUNT, 1, &diag),
+            AVIF_RESULT_INVALID_ARGUMENT);
+  EXPECT_EQ(avifImageScaleInto(image.get(), scaled.get(),
+                               AVIF_SCALE_FILTER_BOX, -1, &diag),
+            AVIF_RESULT_INVALID_ARGUMENT);
+}
+
+//------------------------------------------------------------------------------
+
 }  // namespace
 }  // namespace avif
 
@@ -104,6 +104,7 @@ RgbChannelOffsets GetRgbChannelOffsets(avifRGBFormat format) {
     case AVIF_RGB_FORMAT_ABGR:
       return {/*r=*/3, /*g=*/2, /*b=*/1, /*a=*/0};
     case AVIF_RGB_FORMAT_RGB_565:
+    case AVIF_RGB_FORMAT_RGBA1010102:
     case AVIF_RGB_FORMAT_COUNT:
     default:
       return {/*r=*/0, /*g=*/0, /*b=*/0, /*a=*/0};
@@ -0,0 +1,239 @@
+// Copyright 2026 Google LLC
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <tuple>
+#include <vector>
+
+#include "avif/avif.h"
+#include "aviftest_helpers.h"
+#include "gtest/gtest.h"
+
+using ::testing::Combine;
+using ::testing::Values;
+
+namespace avif {
+namespace {
+
+//------------------------------------------------------------------------------
+
+// Returns the 10-bit PQ code of the luminance in nits.
+uint32_t NitsToPq10(double nits) {
+  const double m1 = 0.1593017578125, m2 = 78.84375, c1 = 0.8359375,
+               c2 = 18.8515625, c3 = 18.6875;
+  const double y = std::pow(nits / 10000.0, m1);
+  const double pq = std::pow((c1 + c2 * y) / (1.0 + c3 * y), m2);
+  return static_cast<uint32_t>(std::lround(pq * 1023.0));
+}
+
+// Returns the 8-bit sRGB code of the linear value in [0, 1].
+uint32_t LinearToSrgb8(double v) {
+  const double s =
+      v <= 0.0031308 ? 12.92 * v : 1.055 * std::pow(v, 1 / 2.4) - 0.055;
+  return static_cast<uint32_t>(std::lround(s * 255.0));
+}
+
+// Returns a 10-bit full range 4:4:4 HDR image where the pixel of each column
+// is gray with the luma sample y_samples[x].
+ImagePtr CreateGrayRamp(const std::vector<uint32_t>& y_samples,
+                        avifTransferCharacteristics transfer) {
+  ImagePtr image = testutil::CreateImage(
+      static_cast<int>(y_samples.size()), 2, 10, AVIF_PIXEL_FORMAT_YUV444,
+      AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  if (image == nullptr) return nullptr;
+  image->colorPrimaries = AVIF_COLOR_PRIMARIES_BT2020;
+  image->transferCharacteristics = transfer;
+  image->matrixCoefficients = AVIF_MATRIX_COEFFICIENTS_BT2020_NCL;
+  const uint32_t yuva[] = {0, 512, 512, 1023};
+  testutil::FillImagePlain(image.get(), yuva);
+  for (uint32_t y = 0; y < image->height; ++y) {
+    uint16_t* row = reinterpret_cast<uint16_t*>(
+        image->yuvPlanes[AVIF_CHAN_Y] + y * image->yuvRowBytes[AVIF_CHAN_Y]);
+    for (size_t x = 0; x < y_samples.size(); ++x) {
+      row[x] = static_cast<uint16_t>(y_samples[x]);
+    }
+  }
+  return image;
+}
+
+TEST(ToneMapToSDRTest, PqGrays) {
+  // Black, 50 nits, 150 nits, 203 nits (SDR white), 1000 nits (assumed peak).
+  const std::vector<uint32_t> y_samples = {0, NitsToPq10(50), NitsToPq10(150),
+                                           NitsToPq10(203), NitsToPq10(1000),
+                                           1023};
+  ImagePtr image =
+      CreateGrayRamp(y_samples, AVIF_TRANSFER_CHARACTERISTICS_PQ);
+  ASSERT_NE(image, nullptr);
+  testutil::AvifRgbImage rgb(image.get(), 8, AVIF_RGB_FORMAT_RGB);
+  rgb.toneMapToSDR = AVIF_TRUE;
+  ASSERT_EQ(avifImageYUVToRGB(image.get(), &rgb), AVIF_RESULT_OK);
+
+  uint32_t gray[6];
+  for (uint32_t x = 0; x < 6; ++x) {
+    const uint8_t* pixel = rgb.pixels + rgb.rowBytes + x * 3;
+    // Grays stay gray.
+    EXPECT_EQ(pixel[0], pixel[1]);
+    EXPECT_EQ(pixel[0], pixel[2]);
+    gray[x] = pixel[1];
+  }
+  EXPECT_EQ(gray[0], 0u);
+  // Below the knee of the curve, the luminance relative to SDR white is kept.
+  EXPECT_NEAR(gray[1], LinearToSrgb8(50.0 / 203), 1);
+  // Above it, highlights are compressed up to the peak.
+  EXPECT_GT(gray[2], LinearToSrgb8(100.0 / 203));
+  EXPECT_LT(gray[2], LinearToSrgb8(150.0 / 203));
+  EXPECT_LT(gray[3], 255u);
+  EXPECT_GT(gray[3], gray[2]);
+  EXPECT_EQ(gray[4], 255u);
+  EXPECT_EQ(gray[5], 255u);
+
+  // A lower peak luminance from the content light level information leaves
+  // more of the range untouched.
+  image->clli.maxCLL = 400;
+  testutil::AvifRgbImage rgb400(image.get(), 8, AVIF_RGB_FORMAT_RGB);
+  rgb400.toneMapToSDR = AVIF_TRUE;
+  ASSERT_EQ(avifImageYUVToRGB(image.get(), &rgb400), AVIF_RESULT_OK);
+  EXPECT_GT(rgb400.pixels[2 * 3], gray[2]);
+  EXPECT_GT(rgb400.pixels[3 * 3], gray[3]);
+  EXPECT_EQ(rgb400.pixels[4 * 3], 255u);
+}
+
+TEST(ToneMapToSDRTest, HlgGrays) {
+  // HLG reference white (75%) is mapped close to SDR white, with some room
+  // left for highlights.
+  ImagePtr image = CreateGrayRamp({0, 256, 767, 1023},
+                                  AVIF_TRANSFER_CHARACTERISTICS_HLG);
+  ASSERT_NE(image, nullptr);
+  testutil::AvifRgbImage rgb(image.get(), 8, AVIF_RGB_FORMAT_RGB);
+  rgb.toneMapToSDR = AVIF_TRUE;
+  ASSERT_EQ(avifImageYUVToRGB(image.get(), &rgb), AVIF_RESULT_OK);
+  EXPECT_EQ(rgb.pixels[0], 0u);
+  EXPECT_GT(rgb.pixels[3], 0u);
+  EXPECT_GT(rgb.pixels[6], rgb.pixels[3]);
+  EXPECT_GT(rgb.pixels[6], 220u);
+  EXPECT_EQ(rgb.pixels[9], 255u);
+}
+
+// Other transfer characteristics are converted as usual.
+TEST(ToneMapToSDRTest, SdrIsUnchanged) {
+  ImagePtr image = testutil::CreateImage(
+      13, 9, 10, AVIF_PIXEL_FORMAT_YUV420, AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  testutil::FillImageGradient(image.get());
+  image->transferCharacteristics = AVIF_TRANSFER_CHARACTERISTICS_SRGB;
+  testutil::AvifRgbImage reference(image.get(), 8, AVIF_RGB_FORMAT_RGBA);
+  ASSERT_EQ(avifImageYUVToRGB(image.get(), &reference), AVIF_RESULT_OK);
+  testutil::AvifRgbImage rgb(image.get(), 8, AVIF_RGB_FORMAT_RGBA);
+  rgb.toneMapToSDR = AVIF_TRUE;
+  ASSERT_EQ(avifImageYUVToRGB(image.get(), &rgb), AVIF_RESULT_OK);
+  EXPECT_TRUE(testutil::AreImagesEqual(reference, rgb));
+}
+
+class ToneMapToSDRFormatTest
+    : public testing::TestWithParam<
+          std::tuple<avifTransferCharacteristics, avifPixelFormat,
+                     /*depth=*/int, avifRGBFormat>> {};
+
+// The output does not depend on the channel order or the number of threads,
+// and alpha is copied or multiplied after tone mapping.
+TEST_P(ToneMapToSDRFormatTest, Consistent) {
+  const avifTransferCharacteristics transfer = std::get<0>(GetParam());
+  const avifPixelFormat yuv_format = std::get<1>(GetParam());
+  const int depth = std::get<2>(GetParam());
+  const avifRGBFormat format = std::get<3>(GetParam());
+
+  // Taller than a few bands of rows converted at a time.
+  ImagePtr image = testutil::CreateImage(31, 75, 10, yuv_format,
+                                         AVIF_PLANES_ALL, AVIF_RANGE_LIMITED);
+  ASSERT_NE(image, nullptr);
+  testutil::FillImageGradient(image.get());
+  image->colorPrimaries = AVIF_COLOR_PRIMARIES_BT2020;
+  image->transferCharacteristics = transfer;
+  image->matrixCoefficients = AVIF_MATRIX_COEFFICIENTS_BT2020_NCL;
+
+  testutil::AvifRgbImage reference(image.get(), depth, AVIF_RGB_FORMAT_RGBA);
+  reference.toneMapToSDR = AVIF_TRUE;
+  ASSERT_EQ(avifImageYUVToRGB(image.get(), &reference), AVIF_RESULT_OK);
+
+  testutil::AvifRgbImage rgb(image.get(), depth, format);
+  rgb.toneMapToSDR = AVIF_TRUE;
+  rgb.maxThreads = 4;
+  rgb.alphaPremultiplied = AVIF_TRUE;
+  ASSERT_EQ(avifImageYUVToRGB(image.get(), &rgb), AVIF_RESULT_OK);
+
+  const uint32_t max = (1u << depth) - 1;
+  const uint32_t channel_count = avifRGBFormatChannelCount(format);
+  uint32_t rgb_index[3] = {0, 1, 2};
+  if (format == AVIF_RGB_FORMAT_BGR) {
+    rgb_index[0] = 2;
+    rgb_index[2] = 0;
+  } else if (format == AVIF_RGB_FORMAT_ARGB) {
+    rgb_index[0] = 1;
+    rgb_index[1] = 2;
+    rgb_index[2] = 3;
+  }
+  // Returns the sample at index i of row y.
+  auto get = [&](const avifRGBImage& image, uint32_t y,
+                 uint32_t i) -> uint32_t {
+    const uint8_t* row = image.pixels + y * image.rowBytes;
+    return depth > 8 ? reinterpret_cast<const uint16_t*>(row)[i] : row[i];
+  };
+  for (uint32_t y = 0; y < rgb.height; ++y) {
+    for (uint32_t x = 0; x < rgb.width; ++x) {
+      const uint32_t alpha = get(reference, y, x * 4 + 3);
+      const uint32_t offset = x * channel_count;
+      const uint32_t expected[3] = {get(reference, y, x * 4 + 0),
+                                    get(reference, y, x * 4 + 1),
+                                    get(reference, y, x * 4 + 2)};
+      for (int c = 0; c < 3; ++c) {
+        // The premultiplied samples are computed before rounding the color
+        // and alpha samples.
+        const double premultiplied =
+            expected[c] * alpha / static_cast<double>(max);
+        ASSERT_LE(std::abs(get(rgb, y, offset + rgb_index[c]) - premultiplied),
+                  1.5)
+            << "at " << x << "," << y;
+      }
+      if (format == AVIF_RGB_FORMAT_ARGB) {
+        ASSERT_EQ(get(rgb, y, offset), alpha);
+      }
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    All, ToneMapToSDRFormatTest,
+    Combine(Values(AVIF_TRANSFER_CHARACTERISTICS_PQ,
+                   AVIF_TRANSFER_CHARACTERISTICS_HLG),
+            Values(AVIF_PIXEL_FORMAT_YUV444, AVIF_PIXEL_FORMAT_YUV420,
+                   AVIF_PIXEL_FORMAT_YUV400),
+            /*depth=*/Values(8, 10, 16),
+            Values(AVIF_RGB_FORMAT_RGB, AVIF_RGB_FORMAT_BGR,
+                   AVIF_RGB_FORMAT_ARGB)));
+
+TEST(ToneMapToSDRTest, UnsupportedFormats) {
+  ImagePtr image = testutil::CreateImage(
+      8, 8, 10, AVIF_PIXEL_FORMAT_YUV420, AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  image->transferCharacteristics = AVIF_TRANSFER_CHARACTERISTICS_PQ;
+  for (avifRGBFormat format :
+       {AVIF_RGB_FORMAT_GRAY, AVIF_RGB_FORMAT_RGB_565,
+        AVIF_RGB_FORMAT_RGBA1010102}) {
+    const int depth = format == AVIF_RGB_FORMAT_RGBA1010102 ? 10 : 8;
+    testutil::AvifRgbImage rgb(image.get(), depth, format);
+    rgb.toneMapToSDR = AVIF_TRUE;
+    EXPECT_EQ(avifImageYUVToRGB(image.get(), &rgb),
+              AVIF_RESULT_REFORMAT_FAILED);
+  }
+  testutil::AvifRgbImage rgb(image.get(), 16, AVIF_RGB_FORMAT_RGBA);
+  rgb.isFloat = AVIF_TRUE;
+  rgb.toneMapToSDR = AVIF_TRUE;
+  EXPECT_EQ(avifImageYUVToRGB(image.get(), &rgb), AVIF_RESULT_REFORMAT_FAILED);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace
+}  // namespace avif
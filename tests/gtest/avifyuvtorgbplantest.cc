@@ -0,0 +1,162 @@
+// Copyright 2026 Google LLC
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "avif/avif.h"
+#include "avif/avif_cxx.h"
+#include "aviftest_helpers.h"
+#include "gtest/gtest.h"
+
+using ::testing::Bool;
+using ::testing::Combine;
+using ::testing::Values;
+
+namespace avif {
+namespace {
+
+//------------------------------------------------------------------------------
+
+bool AreRgbImagesEqual(const avifRGBImage& a, const avifRGBImage& b) {
+  const size_t row_size =
+      static_cast<size_t>(a.width) * avifRGBImagePixelSize(&a);
+  for (uint32_t y = 0; y < a.height; ++y) {
+    if (std::memcmp(a.pixels + y * a.rowBytes, b.pixels + y * b.rowBytes,
+                    row_size) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+class YUVToRGBPlanParamTest
+    : public testing::TestWithParam<
+          std::tuple</*yuv_depth=*/int, avifPixelFormat, /*rgb_depth=*/int,
+                     avifRGBFormat, avifChromaUpsampling,
+                     /*avoid_libyuv=*/bool>> {};
+
+// Converting with a plan gives the same result as without.
+TEST_P(YUVToRGBPlanParamTest, SameAsWithoutPlan) {
+  const int yuv_depth = std::get<0>(GetParam());
+  const avifPixelFormat yuv_format = std::get<1>(GetParam());
+  const int rgb_depth = std::get<2>(GetParam());
+  const avifRGBFormat rgb_format = std::get<3>(GetParam());
+
+  // A plan is valid for images of any dimensions.
+  YUVToRGBPlanPtr plan;
+  for (uint32_t width : {13u, 64u}) {
+    SCOPED_TRACE(width);
+    ImagePtr image = testutil::CreateImage(width, 9, yuv_depth, yuv_format,
+                                           AVIF_PLANES_ALL, AVIF_RANGE_LIMITED);
+    ASSERT_NE(image, nullptr);
+    testutil::FillImageGradient(image.get(), /*offset=*/width);
+
+    testutil::AvifRgbImage reference(image.get(), rgb_depth, rgb_format);
+    reference.chromaUpsampling = std::get<4>(GetParam());
+    reference.avoidLibYUV = std::get<5>(GetParam());
+    ASSERT_EQ(avifImageYUVToRGB(image.get(), &reference), AVIF_RESULT_OK);
+
+    testutil::AvifRgbImage rgb(image.get(), rgb_depth, rgb_format);
+    rgb.chromaUpsampling = std::get<4>(GetParam());
+    rgb.avoidLibYUV = std::get<5>(GetParam());
+    if (plan == nullptr) {
+      plan.reset(avifYUVToRGBPlanCreate(image.get(), &rgb));
+      ASSERT_NE(plan, nullptr);
+    }
+    ASSERT_EQ(avifImageYUVToRGBWithPlan(plan.get(), image.get(), &rgb),
+              AVIF_RESULT_OK);
+    EXPECT_TRUE(AreRgbImagesEqual(reference, rgb));
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    All, YUVToRGBPlanParamTest,
+    Combine(/*yuv_depth=*/Values(8, 10),
+            Values(AVIF_PIXEL_FORMAT_YUV444, AVIF_PIXEL_FORMAT_YUV420,
+                   AVIF_PIXEL_FORMAT_YUV400),
+            /*rgb_depth=*/Values(8, 16),
+            Values(AVIF_RGB_FORMAT_RGB, AVIF_RGB_FORMAT_RGBA),
+            Values(AVIF_CHROMA_UPSAMPLING_AUTOMATIC,
+                   AVIF_CHROMA_UPSAMPLING_NEAREST),
+            /*avoid_libyuv=*/Bool()));
+
+// A plan can be used by several threads at once.
+TEST(YUVToRGBPlanTest, ConcurrentConversions) {
+  ImagePtr image = testutil::CreateImage(
+      64, 32, 10, AVIF_PIXEL_FORMAT_YUV420, AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  testutil::FillImageGradient(image.get());
+  testutil::AvifRgbImage reference(image.get(), 8, AVIF_RGB_FORMAT_RGBA);
+  reference.avoidLibYUV = AVIF_TRUE;
+  ASSERT_EQ(avifImageYUVToRGB(image.get(), &reference), AVIF_RESULT_OK);
+
+  YUVToRGBPlanPtr plan(avifYUVToRGBPlanCreate(image.get(), &reference));
+  ASSERT_NE(plan, nullptr);
+  constexpr int kNumThreads = 4;
+  std::vector<std::unique_ptr<testutil::AvifRgbImage>> rgbs;
+  std::vector<avifResult> results(kNumThreads, AVIF_RESULT_UNKNOWN_ERROR);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    rgbs.push_back(std::make_unique<testutil::AvifRgbImage>(
+        image.get(), 8, AVIF_RGB_FORMAT_RGBA));
+    rgbs.back()->avoidLibYUV = AVIF_TRUE;
+  }
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&, i]() {
+      results[i] =
+          avifImageYUVToRGBWithPlan(plan.get(), image.get(), rgbs[i].get());
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  for (int i = 0; i < kNumThreads; ++i) {
+    ASSERT_EQ(results[i], AVIF_RESULT_OK);
+    EXPECT_TRUE(AreRgbImagesEqual(reference, *rgbs[i]));
+  }
+}
+
+TEST(YUVToRGBPlanTest, Mismatch) {
+  ImagePtr image = testutil::CreateImage(
+      16, 16, 8, AVIF_PIXEL_FORMAT_YUV420, AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  testutil::AvifRgbImage rgb(image.get(), 8, AVIF_RGB_FORMAT_RGBA);
+  YUVToRGBPlanPtr plan(avifYUVToRGBPlanCreate(image.get(), &rgb));
+  ASSERT_NE(plan, nullptr);
+
+  ImagePtr other_depth = testutil::CreateImage(
+      16, 16, 10, AVIF_PIXEL_FORMAT_YUV420, AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(other_depth, nullptr);
+  EXPECT_EQ(avifImageYUVToRGBWithPlan(plan.get(), other_depth.get(), &rgb),
+            AVIF_RESULT_INVALID_ARGUMENT);
+
+  const avifMatrixCoefficients matrix_coefficients = image->matrixCoefficients;
+  image->matrixCoefficients = AVIF_MATRIX_COEFFICIENTS_BT709;
+  EXPECT_EQ(avifImageYUVToRGBWithPlan(plan.get(), image.get(), &rgb),
+            AVIF_RESULT_INVALID_ARGUMENT);
+  image->matrixCoefficients = matrix_coefficients;
+
+  testutil::AvifRgbImage bgra(image.get(), 8, AVIF_RGB_FORMAT_BGRA);
+  EXPECT_EQ(avifImageYUVToRGBWithPlan(plan.get(), image.get(), &bgra),
+            AVIF_RESULT_INVALID_ARGUMENT);
+  EXPECT_EQ(avifImageYUVToRGBWithPlan(plan.get(), image.get(), &rgb),
+            AVIF_RESULT_OK);
+}
+
+TEST(YUVToRGBPlanTest, Unsupported) {
+  // YCgCo-Re requires the RGB depth to be the YUV depth minus 2.
+  ImagePtr image = testutil::CreateImage(
+      16, 16, 10, AVIF_PIXEL_FORMAT_YUV444, AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  image->matrixCoefficients = AVIF_MATRIX_COEFFICIENTS_YCGCO_RE;
+  testutil::AvifRgbImage rgb(image.get(), 10, AVIF_RGB_FORMAT_RGBA);
+  EXPECT_EQ(avifYUVToRGBPlanCreate(image.get(), &rgb), nullptr);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace
+}  // namespace avif
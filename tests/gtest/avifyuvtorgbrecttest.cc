@@ -0,0 +1,112 @@
+// Copyright 2026 Google LLC
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <tuple>
+
+#include "avif/avif.h"
+#include "aviftest_helpers.h"
+#include "gtest/gtest.h"
+
+using ::testing::Bool;
+using ::testing::Combine;
+using ::testing::Values;
+
+namespace avif {
+namespace {
+
+//------------------------------------------------------------------------------
+
+// Returns true if rect of full has the same pixels as rgb.
+bool IsSameAsRect(const avifRGBImage& full, const avifCropRect& rect,
+                  const avifRGBImage& rgb) {
+  const uint32_t pixel_size = avifRGBImagePixelSize(&full);
+  for (uint32_t y = 0; y < rect.height; ++y) {
+    const uint8_t* full_row = full.pixels + (rect.y + y) * full.rowBytes +
+                              rect.x * pixel_size;
+    if (std::memcmp(full_row, rgb.pixels + y * rgb.rowBytes,
+                    rect.width * pixel_size) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+class YUVToRGBRectTest
+    : public testing::TestWithParam<std::tuple<
+          /*yuv_depth=*/int, avifPixelFormat, avifChromaUpsampling,
+          /*premultiply=*/bool>> {};
+
+// Converting a rect gives the same pixels as converting the whole image.
+TEST_P(YUVToRGBRectTest, SameAsWholeImage) {
+  const int yuv_depth = std::get<0>(GetParam());
+  const avifPixelFormat yuv_format = std::get<1>(GetParam());
+  const avifChromaUpsampling upsampling = std::get<2>(GetParam());
+  const bool premultiply = std::get<3>(GetParam());
+
+  ImagePtr image = testutil::CreateImage(23, 17, yuv_depth, yuv_format,
+                                         AVIF_PLANES_ALL, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  testutil::FillImageGradient(image.get());
+  testutil::AvifRgbImage full(image.get(), 8, AVIF_RGB_FORMAT_RGBA);
+  full.chromaUpsampling = upsampling;
+  full.alphaPremultiplied = premultiply;
+  ASSERT_EQ(avifImageYUVToRGB(image.get(), &full), AVIF_RESULT_OK);
+
+  for (const avifCropRect& rect :
+       {avifCropRect{0, 0, 23, 17}, avifCropRect{0, 0, 1, 1},
+        avifCropRect{22, 16, 1, 1}, avifCropRect{1, 1, 21, 15},
+        avifCropRect{0, 5, 23, 6}, avifCropRect{0, 6, 23, 5},
+        avifCropRect{3, 2, 5, 7}, avifCropRect{8, 9, 15, 8}}) {
+    SCOPED_TRACE("rect " + std::to_string(rect.x) + "," +
+                 std::to_string(rect.y) + " " + std::to_string(rect.width) +
+                 "x" + std::to_string(rect.height));
+    avifRGBImage rgb = full;
+    rgb.width = rect.width;
+    rgb.height = rect.height;
+    rgb.pixels = nullptr;
+    rgb.rowBytes = 0;
+    ASSERT_EQ(avifRGBImageAllocatePixels(&rgb), AVIF_RESULT_OK);
+    const avifResult result = avifImageYUVToRGBRect(image.get(), &rect, &rgb);
+    EXPECT_EQ(result, AVIF_RESULT_OK);
+    EXPECT_TRUE(result != AVIF_RESULT_OK || IsSameAsRect(full, rect, rgb));
+    avifRGBImageFreePixels(&rgb);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    All, YUVToRGBRectTest,
+    Combine(/*yuv_depth=*/Values(8, 10),
+            Values(AVIF_PIXEL_FORMAT_YUV444, AVIF_PIXEL_FORMAT_YUV422,
+                   AVIF_PIXEL_FORMAT_YUV420, AVIF_PIXEL_FORMAT_YUV400),
+            Values(AVIF_CHROMA_UPSAMPLING_AUTOMATIC,
+                   AVIF_CHROMA_UPSAMPLING_NEAREST),
+            /*premultiply=*/Bool()));
+
+TEST(YUVToRGBRectInvalidTest, Arguments) {
+  ImagePtr image = testutil::CreateImage(
+      16, 16, 8, AVIF_PIXEL_FORMAT_YUV420, AVIF_PLANES_YUV, AVIF_RANGE_FULL);
+  ASSERT_NE(image, nullptr);
+  testutil::AvifRgbImage rgb(image.get(), 8, AVIF_RGB_FORMAT_RGBA);
+  rgb.width = 8;
+  rgb.height = 8;
+
+  avifCropRect rect = {8, 8, 8, 8};
+  EXPECT_EQ(avifImageYUVToRGBRect(image.get(), &rect, &rgb), AVIF_RESULT_OK);
+  rect = {9, 8, 8, 8};  // Out of bounds.
+  EXPECT_EQ(avifImageYUVToRGBRect(image.get(), &rect, &rgb),
+            AVIF_RESULT_INVALID_ARGUMENT);
+  rect = {0, 0, 8, 7};  // Not the dimensions of rgb.
+  EXPECT_EQ(avifImageYUVToRGBRect(image.get(), &rect, &rgb),
+            AVIF_RESULT_INVALID_ARGUMENT);
+  rect = {0, 0, 0, 0};
+  EXPECT_EQ(avifImageYUVToRGBRect(image.get(), &rect, &rgb),
+            AVIF_RESULT_INVALID_ARGUMENT);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace
+}  // namespace avif
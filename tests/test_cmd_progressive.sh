@@ -22,14 +22,17 @@ source $(dirname "$0")/cmd_test_common.sh || exit
 
 # Input file paths.
 INPUT_Y4M="${TESTDATA_DIR}/kodim03_yuv420_8bpc.y4m"
+INPUT_PNG="${TESTDATA_DIR}/paris_icc_exif_xmp.png"
 # Output file names.
 ENCODED_FILE="avif_test_cmd_encoded.avif"
+ENCODED_FILE_COPY="avif_test_cmd_encoded_copy.avif"
 DECODED_FILE="avif_test_cmd_decoded.png"
+INPUT_PNG_COPY="avif_test_cmd_input_copy.png"
 
 # Cleanup
 cleanup() {
   pushd ${TMP_DIR}
-    rm -- "${ENCODED_FILE}" "${DECODED_FILE}"
+    rm -f -- "${ENCODED_FILE}" "${ENCODED_FILE_COPY}" "${DECODED_FILE}" "${INPUT_PNG_COPY}"
   popd
 }
 trap cleanup EXIT
@@ -45,6 +48,12 @@ pushd ${TMP_DIR}
   "${AVIFDEC}" "${ENCODED_FILE}" "${DECODED_FILE}"
   "${AVIFDEC}" --progressive "${ENCODED_FILE}" "${DECODED_FILE}"
 
+  echo "Testing manual layered encoding with the same file read once"
+  cp "${INPUT_PNG}" "${INPUT_PNG_COPY}"
+  "${AVIFENC}" -s 8 --layered -q:u 2 "${INPUT_PNG}" -q:u 60 "${INPUT_PNG}" -o "${ENCODED_FILE}"
+  "${AVIFENC}" -s 8 --layered -q:u 2 "${INPUT_PNG}" -q:u 60 "${INPUT_PNG_COPY}" -o "${ENCODED_FILE_COPY}"
+  cmp "${ENCODED_FILE}" "${ENCODED_FILE_COPY}"
+
   # libavif relies on libyuv to do scaling
   echo "Testing layered encoding with frame scaling"
   if avifenc -V | grep -o "libyuv : available" --quiet; then
@@ -20,16 +20,18 @@ source $(dirname "$0")/cmd_test_common.sh || exit
 
 # Input file paths.
 INPUT_Y4M="${TESTDATA_DIR}/kodim03_yuv420_8bpc.y4m"
+INPUT_PNG="${TESTDATA_DIR}/paris_icc_exif_xmp.png"
 # Output file names.
 ENCODED_FILE="avif_test_cmd_targetsize_encoded.avif"
 DECODED_SMALLEST_FILE="avif_test_cmd_targetsize_decoded_smallest.png"
 DECODED_BIGGEST_FILE="avif_test_cmd_targetsize_decoded_biggest.png"
+OUT_MSG="avif_test_cmd_targetsize_out_msg.txt"
 
 # Cleanup
 cleanup() {
   pushd ${TMP_DIR}
     rm -f -- "${ENCODED_FILE}" "${DECODED_SMALLEST_FILE}" \
-             "${DECODED_BIGGEST_FILE}"
+             "${DECODED_BIGGEST_FILE}" "${OUT_MSG}"
   popd
 }
 trap cleanup EXIT
@@ -57,6 +59,14 @@ pushd ${TMP_DIR}
   # Negative test.
   [[ $(wc -c < "${ENCODED_FILE}") -eq ${SMALLEST_FILE_SIZE} ]] && exit 1
 
+  # The metadata of the input file is kept.
+  "${AVIFENC}" -s 8 "${INPUT_PNG}" -o "${ENCODED_FILE}" --target-size 10000
+  "${AVIFDEC}" --info "${ENCODED_FILE}" > "${OUT_MSG}"
+  cat "${OUT_MSG}"
+  grep "ICC Profile    : Present" "${OUT_MSG}"
+  grep "XMP Metadata   : Present" "${OUT_MSG}"
+  grep "Exif Metadata  : Present" "${OUT_MSG}"
+
   # Same as above but with a grid made of two tiles.
   TILE0="${DECODED_SMALLEST_FILE}"
   TILE1="${DECODED_BIGGEST_FILE}"